@@ -23,12 +23,15 @@
 #include "CaretLogger.h"
 #include "CaretOMP.h"
 #include "CiftiFile.h"
+#include "CorrelationHelper.h"
 #include "FileInformation.h"
 #include "MetricFile.h"
 #include "SurfaceFile.h"
 #include "VolumeFile.h"
 
+#include <algorithm>
 #include <cmath>
+#include <exception>
 #include <fstream>
 #include <string>
 #include <vector>
@@ -266,18 +269,57 @@ AlgorithmCiftiAverageROICorrelation::AlgorithmCiftiAverageROICorrelation(Progres
     ciftiOut->setCiftiXML(newXml);
     if (numCifti > 1)//skip averaging in single subject case
     {
+        int numThreads = 1;
+#ifdef CARET_OMP
+        numThreads = omp_get_max_threads();
+#endif
+        //with enough subjects, give each thread whole subjects, which also keeps that many files reading at once
+        //otherwise, do one subject at a time, with the correlation of each parallelized instead
+        const bool subjectParallel = (numThreads > 1 && numCifti >= numThreads);
         vector<vector<double> > accum(colSize, vector<double>(numMaps, 0.0));
-        for (int i = 0; i < numCifti; ++i)
+        exception_ptr exPtr;
+        int exceptedFile = -1;
+#pragma omp CARET_PAR if(subjectParallel)
         {
-            processCifti(ciftiList[i], tempresult, leftROI, rightROI, cerebROI, volROI, numMaps, leftAreaPointer, rightAreaPointer, cerebAreaPointer);
-            for (int j = 0; j < colSize; ++j)
+            vector<vector<float> > myResult(colSize, vector<float>(numMaps));
+            vector<vector<double> > myAccum(colSize, vector<double>(numMaps, 0.0));//per thread, summed at the end
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int i = 0; i < numCifti; ++i)
             {
-                for (int myMap = 0; myMap < numMaps; ++myMap)
+                if (exceptedFile > -1) continue;//"abort" the remaining subjects, "break" isn't allowed
+                try
                 {
-                    accum[j][myMap] += tempresult[j][myMap];
+                    processCifti(ciftiList[i], myResult, leftROI, rightROI, cerebROI, volROI, numMaps, leftAreaPointer, rightAreaPointer, cerebAreaPointer);
+                    for (int j = 0; j < colSize; ++j)
+                    {
+                        for (int myMap = 0; myMap < numMaps; ++myMap)
+                        {
+                            myAccum[j][myMap] += myResult[j][myMap];
+                        }
+                    }
+                } catch (...) {
+#pragma omp critical
+                    {
+                        if (exceptedFile < 0 || i < exceptedFile)
+                        {
+                            exceptedFile = i;
+                            exPtr = current_exception();
+                        }
+                    }
+                }
+            }
+#pragma omp critical
+            {
+                for (int j = 0; j < colSize; ++j)
+                {
+                    for (int myMap = 0; myMap < numMaps; ++myMap)
+                    {
+                        accum[j][myMap] += myAccum[j][myMap];
+                    }
                 }
             }
         }
+        if (exceptedFile > -1) rethrow_exception(exPtr);
         for (int i = 0; i < colSize; ++i)
         {
             for (int myMap = 0; myMap < numMaps; ++myMap)
@@ -341,6 +383,11 @@ AlgorithmCiftiAverageROICorrelation::AlgorithmCiftiAverageROICorrelation(Progres
         cerebAreaSurf->computeNodeAreas(cerebAreaData);
         cerebAreaPointer = cerebAreaData.data();
     }
+    vector<vector<float> > roiData(colSize, vector<float>(numMaps));//read the roi once, subjects may be processed in parallel
+    for (int i = 0; i < colSize; ++i)
+    {
+        ciftiROI->getRow(roiData[i].data(), i);
+    }
     vector<vector<float> > tempresult(colSize, vector<float>(numMaps));
     CiftiXMLOld newXml = baseXML;
     newXml.resetRowsToScalars(numMaps);
@@ -351,18 +398,57 @@ AlgorithmCiftiAverageROICorrelation::AlgorithmCiftiAverageROICorrelation(Progres
     ciftiOut->setCiftiXML(newXml);
     if (numCifti > 1)//skip averaging in single subject case
     {
+        int numThreads = 1;
+#ifdef CARET_OMP
+        numThreads = omp_get_max_threads();
+#endif
+        //with enough subjects, give each thread whole subjects, which also keeps that many files reading at once
+        //otherwise, do one subject at a time, with the correlation of each parallelized instead
+        const bool subjectParallel = (numThreads > 1 && numCifti >= numThreads);
         vector<vector<double> > accum(colSize, vector<double>(numMaps, 0.0));
-        for (int i = 0; i < numCifti; ++i)
+        exception_ptr exPtr;
+        int exceptedFile = -1;
+#pragma omp CARET_PAR if(subjectParallel)
         {
-            processCifti(ciftiList[i], tempresult, ciftiROI, numMaps, leftAreaPointer, rightAreaPointer, cerebAreaPointer);
-            for (int j = 0; j < colSize; ++j)
+            vector<vector<float> > myResult(colSize, vector<float>(numMaps));
+            vector<vector<double> > myAccum(colSize, vector<double>(numMaps, 0.0));//per thread, summed at the end
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int i = 0; i < numCifti; ++i)
+            {
+                if (exceptedFile > -1) continue;//"abort" the remaining subjects, "break" isn't allowed
+                try
+                {
+                    processCifti(ciftiList[i], myResult, roiXML, roiData, numMaps, leftAreaPointer, rightAreaPointer, cerebAreaPointer);
+                    for (int j = 0; j < colSize; ++j)
+                    {
+                        for (int myMap = 0; myMap < numMaps; ++myMap)
+                        {
+                            myAccum[j][myMap] += myResult[j][myMap];
+                        }
+                    }
+                } catch (...) {
+#pragma omp critical
+                    {
+                        if (exceptedFile < 0 || i < exceptedFile)
+                        {
+                            exceptedFile = i;
+                            exPtr = current_exception();
+                        }
+                    }
+                }
+            }
+#pragma omp critical
             {
-                for (int myMap = 0; myMap < numMaps; ++myMap)
+                for (int j = 0; j < colSize; ++j)
                 {
-                    accum[j][myMap] += tempresult[j][myMap];
+                    for (int myMap = 0; myMap < numMaps; ++myMap)
+                    {
+                        accum[j][myMap] += myAccum[j][myMap];
+                    }
                 }
             }
         }
+        if (exceptedFile > -1) rethrow_exception(exPtr);
         for (int i = 0; i < colSize; ++i)
         {
             for (int myMap = 0; myMap < numMaps; ++myMap)
@@ -372,7 +458,7 @@ AlgorithmCiftiAverageROICorrelation::AlgorithmCiftiAverageROICorrelation(Progres
             ciftiOut->setRow(tempresult[i].data(), i);
         }
     } else {
-        processCifti(ciftiList[0], tempresult, ciftiROI, numMaps, leftAreaPointer, rightAreaPointer, cerebAreaPointer);
+        processCifti(ciftiList[0], tempresult, roiXML, roiData, numMaps, leftAreaPointer, rightAreaPointer, cerebAreaPointer);
         for (int i = 0; i < colSize; ++i)
         {
             ciftiOut->setRow(tempresult[i].data(), i);
@@ -412,84 +498,32 @@ void AlgorithmCiftiAverageROICorrelation::processCifti(const CiftiFile* myCifti,
                                                        const int& numMaps, const float* leftAreas, const float* rightAreas, const float* cerebAreas)
 {
     int rowSize = myCifti->getNumberOfColumns();
-    int colSize = myCifti->getNumberOfRows();
     vector<vector<float> > average(numMaps, vector<float>(rowSize));
-    vector<float> rrs(numMaps);
-    for (int myMap = 0; myMap < numMaps; ++myMap)
     {
-        vector<double> accumarray(rowSize, 0.0);
-        addSurface(myCifti, StructureEnum::CORTEX_LEFT, accumarray, leftROI, myMap, leftAreas);//we don't need to keep track of the kernel sums because we are correlating
-        addSurface(myCifti, StructureEnum::CORTEX_RIGHT, accumarray, rightROI, myMap, rightAreas);
-        addSurface(myCifti, StructureEnum::CEREBELLUM, accumarray, cerebROI, myMap, cerebAreas);
-        addVolume(myCifti, accumarray, volROI, myMap);
-        double accum = 0.0;
-        for (int i = 0; i < rowSize; ++i)
-        {
-            accum += accumarray[i];
-        }
-        double mean = accum / rowSize;
-        accum = 0.0;
-        for (int i = 0; i < rowSize; ++i)
-        {
-            average[myMap][i] = accumarray[i] - mean;//remove the mean from the average timeseries to optimize the correlation, and change back to float for possible speed improvement
-            accum += average[myMap][i] * average[myMap][i];
-        }
-        rrs[myMap] = sqrt(accum);//compute this only once
-    }
-    int curRow = 0;
-#pragma omp CARET_PAR
-    {
-        vector<float> rowscratch(rowSize);
-#pragma omp CARET_FOR schedule(dynamic)
-        for (int i = 0; i < colSize; ++i)
+        vector<vector<double> > accumarray(numMaps, vector<double>(rowSize, 0.0));
+        addSurface(myCifti, StructureEnum::CORTEX_LEFT, accumarray, leftROI, leftAreas);//we don't need to keep track of the kernel sums because we are correlating
+        addSurface(myCifti, StructureEnum::CORTEX_RIGHT, accumarray, rightROI, rightAreas);
+        addSurface(myCifti, StructureEnum::CEREBELLUM, accumarray, cerebROI, cerebAreas);
+        addVolume(myCifti, accumarray, volROI);
+        for (int myMap = 0; myMap < numMaps; ++myMap)
         {
-            int myRow;
-#pragma omp critical
-            {
-                myRow = curRow;//force sequential reading
-                ++curRow;
-                myCifti->getRow(rowscratch.data(), myRow);//and never read multiple rows at once from the same file
-            }
-            double tempaccum = 0.0;//compute mean of new row
-            for (int j = 0; j < rowSize; ++j)
-            {
-                tempaccum += rowscratch[j];
-            }
-            float thismean = tempaccum / rowSize;
-            tempaccum = 0.0;
-            for (int j = 0; j < rowSize; ++j)
+            for (int i = 0; i < rowSize; ++i)
             {
-                rowscratch[j] -= thismean;//demean
-                tempaccum += rowscratch[j] * rowscratch[j];//precompute rrs
-            }
-            float thisrrs = sqrt(tempaccum);
-            for (int myMap = 0; myMap < numMaps; ++myMap)
-            {
-                double corraccum = 0.0;//correlate
-                for (int j = 0; j < rowSize; ++j)
-                {
-                    corraccum += rowscratch[j] * average[myMap][j];//gather the correlation
-                }
-                corraccum /= rrs[myMap] * thisrrs;
-                if (corraccum > 0.999999) corraccum = 0.999999;
-                if (corraccum < -0.999999) corraccum = -0.999999;
-                output[myRow][myMap] = 0.5 * log((1 + corraccum) / (1 - corraccum));//fisher z transform, needed for averaging
+                average[myMap][i] = accumarray[myMap][i];//change back to float for possible speed improvement
             }
         }
     }
+    correlateAverages(myCifti, average, output);
 }
 
-void AlgorithmCiftiAverageROICorrelation::processCifti(const CiftiFile* myCifti, vector<vector<float> >& output, const CiftiFile* ciftiROI, const int& numMaps,
-                                                       const float* leftAreas, const float* rightAreas, const float* cerebAreas)
+void AlgorithmCiftiAverageROICorrelation::processCifti(const CiftiFile* myCifti, vector<vector<float> >& output, const CiftiXMLOld& roiXML, const vector<vector<float> >& roiData,
+                                                       const int& numMaps, const float* leftAreas, const float* rightAreas, const float* cerebAreas)
 {
     int rowSize = myCifti->getNumberOfColumns();
-    int colSize = myCifti->getNumberOfRows();
     vector<vector<float> > average(numMaps, vector<float>(rowSize));
-    vector<float> rrs(numMaps);
-    const CiftiXMLOld& roiXML = ciftiROI->getCiftiXMLOld();
     vector<StructureEnum::Enum> surfStructures, ignored;
     roiXML.getStructureLists(CiftiXMLOld::ALONG_COLUMN, surfStructures, ignored);
-    vector<float> roiScratch(numMaps), dataScratch(rowSize);
+    vector<float> dataScratch(rowSize);
     {
         vector<vector<double> > accumarray(numMaps, vector<double>(rowSize, 0.0));
         for (int whichStruct = 0; whichStruct < (int)surfStructures.size(); ++whichStruct)
@@ -514,7 +548,7 @@ void AlgorithmCiftiAverageROICorrelation::processCifti(const CiftiFile* myCifti,
             for (int i = 0; i < (int)myMap.size(); ++i)
             {
                 bool dataLoaded = false;
-                ciftiROI->getRow(roiScratch.data(), myMap[i].m_ciftiIndex);
+                const vector<float>& roiScratch = roiData[myMap[i].m_ciftiIndex];
                 for (int j = 0; j < numMaps; ++j)
                 {
                     if (roiScratch[j] != 0.0f)
@@ -545,7 +579,7 @@ void AlgorithmCiftiAverageROICorrelation::processCifti(const CiftiFile* myCifti,
         for (int i = 0; i < (int)myMap.size(); ++i)
         {
             bool dataLoaded = false;
-            ciftiROI->getRow(roiScratch.data(), myMap[i].m_ciftiIndex);
+            const vector<float>& roiScratch = roiData[myMap[i].m_ciftiIndex];
             for (int j = 0; j < numMaps; ++j)
             {
                 if (roiScratch[j] != 0.0f)
@@ -564,118 +598,110 @@ void AlgorithmCiftiAverageROICorrelation::processCifti(const CiftiFile* myCifti,
         }
         for (int i = 0; i < numMaps; ++i)
         {
-            double accum = 0.0;
-            for (int j = 0; j < rowSize; ++j)
-            {
-                accum += accumarray[i][j];
-            }
-            float mean = accum / rowSize;
-            accum = 0.0;
             for (int j = 0; j < rowSize; ++j)
             {
-                average[i][j] = accumarray[i][j] - mean;
-                accum += average[i][j] * average[i][j];
+                average[i][j] = accumarray[i][j];
             }
             vector<double>().swap(accumarray[i]);//hack to free memory before it goes out of scope
-            rrs[i] = sqrt(accum);
         }
     }
-    int curRow = 0;
-#pragma omp CARET_PAR
+    correlateAverages(myCifti, average, output);
+}
+
+void AlgorithmCiftiAverageROICorrelation::correlateAverages(const CiftiFile* myCifti, vector<vector<float> >& average, vector<vector<float> >& output)
+{
+    int rowSize = myCifti->getNumberOfColumns();
+    int colSize = myCifti->getNumberOfRows();
+    int numMaps = (int)average.size();
+    for (int myMap = 0; myMap < numMaps; ++myMap)
     {
-        vector<float> rowscratch(rowSize);
-#pragma omp CARET_FOR schedule(dynamic)
-        for (int i = 0; i < colSize; ++i)
+        CorrelationHelper::normalize(average[myMap].data(), rowSize);//normalize the roi timeseries only once per subject, no matter how many rows or rois
+    }
+    const int BLOCK_ROWS = 256;
+    vector<vector<float> > rowBlock(min(BLOCK_ROWS, colSize), vector<float>(rowSize));
+    for (int blockStart = 0; blockStart < colSize; blockStart += BLOCK_ROWS)
+    {
+        int blockEnd = min(colSize, blockStart + BLOCK_ROWS);
+        for (int i = blockStart; i < blockEnd; ++i)
+        {//read sequentially, and never read multiple rows at once from the same file
+            myCifti->getRow(rowBlock[i - blockStart].data(), i);
+        }
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int i = blockStart; i < blockEnd; ++i)
         {
-            int myRow;
-#pragma omp critical
-            {
-                myRow = curRow;//force sequential reading
-                ++curRow;
-                myCifti->getRow(rowscratch.data(), myRow);//and never read multiple rows at once from the same file
-            }
-            double tempaccum = 0.0;//compute mean of new row
-            for (int j = 0; j < rowSize; ++j)
-            {
-                tempaccum += rowscratch[j];
-            }
-            float thismean = tempaccum / rowSize;
-            tempaccum = 0.0;
-            for (int j = 0; j < rowSize; ++j)
-            {
-                rowscratch[j] -= thismean;//demean
-                tempaccum += rowscratch[j] * rowscratch[j];//precompute rrs
-            }
-            float thisrrs = sqrt(tempaccum);
+            float* rowscratch = rowBlock[i - blockStart].data();
+            CorrelationHelper::normalize(rowscratch, rowSize);
             for (int myMap = 0; myMap < numMaps; ++myMap)
             {
-                double corraccum = 0.0;//correlate
-                for (int j = 0; j < rowSize; ++j)
-                {
-                    corraccum += rowscratch[j] * average[myMap][j];//gather the correlation
-                }
-                corraccum /= rrs[myMap] * thisrrs;
-                if (corraccum > 0.999999) corraccum = 0.999999;
-                if (corraccum < -0.999999) corraccum = -0.999999;
-                output[myRow][myMap] = 0.5 * log((1 + corraccum) / (1 - corraccum));//fisher z transform, needed for averaging
+                output[i][myMap] = CorrelationHelper::correlate(rowscratch, average[myMap].data(), rowSize, true);//fisher z transform, needed for averaging
             }
         }
     }
 }
 
-void AlgorithmCiftiAverageROICorrelation::addSurface(const CiftiFile* myCifti, StructureEnum::Enum myStruct, vector<double>& accum, const MetricFile* myRoi, const int& myMap, const float* myAreas)
+void AlgorithmCiftiAverageROICorrelation::addSurface(const CiftiFile* myCifti, StructureEnum::Enum myStruct, vector<vector<double> >& accum, const MetricFile* myRoi, const float* myAreas)
 {
     if (myRoi == NULL) return;
     vector<CiftiBrainModelsMap::SurfaceMap> surfaceMap = myCifti->getCiftiXML().getBrainModelsMap(CiftiXML::ALONG_COLUMN).getSurfaceMap(myStruct);
     int mapSize = (int)surfaceMap.size();
     int rowSize = myCifti->getNumberOfColumns();
+    int numMaps = (int)accum.size();
     vector<float> rowscratch(rowSize);
-    if (myAreas != NULL)
+    for (int i = 0; i < mapSize; ++i)
     {
-        for (int i = 0; i < mapSize; ++i)
+        bool dataLoaded = false;//read each row only once, no matter how many rois use it
+        float thisArea = (myAreas != NULL ? myAreas[surfaceMap[i].m_surfaceNode] : 1.0f);
+        for (int myMap = 0; myMap < numMaps; ++myMap)
         {
             float value = myRoi->getValue(surfaceMap[i].m_surfaceNode, myMap);
             if (value != 0.0f)
             {
-                float thisArea = myAreas[surfaceMap[i].m_surfaceNode];
-                myCifti->getRow(rowscratch.data(), surfaceMap[i].m_ciftiIndex);
-                for (int j = 0; j < rowSize; ++j)
+                if (!dataLoaded)
                 {
-                    accum[j] += rowscratch[j] * value * thisArea;
+                    myCifti->getRow(rowscratch.data(), surfaceMap[i].m_ciftiIndex);
+                    dataLoaded = true;
                 }
-            }
-        }
-    } else {
-        for (int i = 0; i < mapSize; ++i)
-        {
-            float value = myRoi->getValue(surfaceMap[i].m_surfaceNode, myMap);
-            if (value != 0.0f)
-            {
-                myCifti->getRow(rowscratch.data(), surfaceMap[i].m_ciftiIndex);
-                for (int j = 0; j < rowSize; ++j)
+                if (myAreas != NULL)
                 {
-                    accum[j] += rowscratch[j] * value;
+                    for (int j = 0; j < rowSize; ++j)
+                    {
+                        accum[myMap][j] += rowscratch[j] * value * thisArea;
+                    }
+                } else {
+                    for (int j = 0; j < rowSize; ++j)
+                    {
+                        accum[myMap][j] += rowscratch[j] * value;
+                    }
                 }
             }
         }
     }
 }
 
-void AlgorithmCiftiAverageROICorrelation::addVolume(const CiftiFile* myCifti, vector<double>& accum, const VolumeFile* myRoi, const int& myMap)
+void AlgorithmCiftiAverageROICorrelation::addVolume(const CiftiFile* myCifti, vector<vector<double> >& accum, const VolumeFile* myRoi)
 {
     if (myRoi == NULL) return;
     vector<CiftiBrainModelsMap::VolumeMap> volMap = myCifti->getCiftiXML().getBrainModelsMap(CiftiXML::ALONG_COLUMN).getFullVolumeMap();
     int mapSize = (int)volMap.size();
     int rowSize = myCifti->getNumberOfColumns();
+    int numMaps = (int)accum.size();
     vector<float> rowscratch(rowSize);
     for (int i = 0; i < mapSize; ++i)
     {
-        if (myRoi->getValue(volMap[i].m_ijk, myMap) > 0.0f)
+        bool dataLoaded = false;
+        for (int myMap = 0; myMap < numMaps; ++myMap)
         {
-            myCifti->getRow(rowscratch.data(), volMap[i].m_ciftiIndex);
-            for (int j = 0; j < rowSize; ++j)
+            if (myRoi->getValue(volMap[i].m_ijk, myMap) > 0.0f)
             {
-                accum[j] += rowscratch[j];
+                if (!dataLoaded)
+                {
+                    myCifti->getRow(rowscratch.data(), volMap[i].m_ciftiIndex);
+                    dataLoaded = true;
+                }
+                for (int j = 0; j < rowSize; ++j)
+                {
+                    accum[myMap][j] += rowscratch[j];
+                }
             }
         }
     }
@@ -27,6 +27,8 @@
 
 namespace caret {
     
+    class CiftiXMLOld;
+    
     class AlgorithmCiftiAverageROICorrelation : public AbstractAlgorithm
     {
         AlgorithmCiftiAverageROICorrelation();
@@ -34,10 +36,11 @@ namespace caret {
         void verifyVolumeComponent(const int& index, const CiftiFile* myCifti, const VolumeFile* volROI);
         void processCifti(const CiftiFile* myCifti, std::vector<std::vector<float> >& output, const MetricFile* leftROI, const MetricFile* rightROI, const MetricFile* cerebROI, const VolumeFile* volROI,
                           const int& numMaps, const float* leftAreas, const float* rightAreas, const float* cerebAreas);
-        void processCifti(const CiftiFile* myCifti, std::vector<std::vector<float> >& output, const CiftiFile* ciftiROI,
+        void processCifti(const CiftiFile* myCifti, std::vector<std::vector<float> >& output, const CiftiXMLOld& roiXML, const std::vector<std::vector<float> >& roiData,
                           const int& numMaps, const float* leftAreas, const float* rightAreas, const float* cerebAreas);
-        void addSurface(const CiftiFile* myCifti, StructureEnum::Enum myStruct, std::vector<double>& accum, const MetricFile* myRoi, const int& myMap, const float* myAreas);
-        void addVolume(const CiftiFile* myCifti, std::vector<double>& accum, const VolumeFile* myRoi, const int& myMap);
+        void correlateAverages(const CiftiFile* myCifti, std::vector<std::vector<float> >& average, std::vector<std::vector<float> >& output);//normalizes average in place
+        void addSurface(const CiftiFile* myCifti, StructureEnum::Enum myStruct, std::vector<std::vector<double> >& accum, const MetricFile* myRoi, const float* myAreas);
+        void addVolume(const CiftiFile* myCifti, std::vector<std::vector<double> >& accum, const VolumeFile* myRoi);
     protected:
         static float getSubAlgorithmWeight();
         static float getAlgorithmInternalWeight();
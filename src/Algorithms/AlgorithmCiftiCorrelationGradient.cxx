@@ -28,6 +28,7 @@
 #include "CiftiFile.h"
 #include "GeodesicHelper.h"
 #include "MetricFile.h"
+#include "MetricGradientObject.h"
 #include "SurfaceFile.h"
 #include "Vector3D.h"
 #include "VolumeFile.h"
@@ -505,6 +506,8 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
     {
         mySmooth.grabNew(new MetricSmoothingObject(mySurf, surfKern, &myRoi, MetricSmoothingObject::GEO_GAUSS_AREA, areaData));//computes the smoothing weights only once per surface
     }
+    CaretPointer<MetricGradientObject> myGradient(new MetricGradientObject(mySurf, myRoi.getValuePointerForColumn(0), false, areaData));//likewise, the gradient regressions only depend on the surface and roi
+    vector<float> gradScratch(mySurf->getNumberOfNodes());
     for (int startpos = 0; startpos < mapSize; startpos += numCacheRows)
     {
         int endpos = startpos + numCacheRows;
@@ -565,18 +568,16 @@ void AlgorithmCiftiCorrelationGradient::processSurfaceComponent(StructureEnum::E
             }
         }
         int numMetricCols = endpos - startpos;
-        MetricFile outputMetric, outputMetric2;
+        MetricFile outputMetric;
         for (int j = 0; j < numMetricCols; ++j)
         {
-            const float* myCol;
+            const float* myCol = gradScratch.data();
             if (surfKern > 0.0f)
             {
                 mySmooth->smoothColumn(&computeMetric, j, &outputMetric);
-                AlgorithmMetricGradient(NULL, mySurf, &outputMetric, &outputMetric2, NULL, -1.0f, &myRoi, false, -1, myAreas);
-                myCol = outputMetric2.getValuePointerForColumn(0);
+                myGradient->computeGradient(outputMetric.getValuePointerForColumn(0), gradScratch.data());
             } else {
-                AlgorithmMetricGradient(NULL, mySurf, &computeMetric, &outputMetric, NULL, -1.0f, &myRoi, false, j, myAreas);
-                myCol = outputMetric.getValuePointerForColumn(0);
+                myGradient->computeGradient(computeMetric.getValuePointerForColumn(j), gradScratch.data());
             }
             for (int i = 0; i < mapSize; ++i)
             {
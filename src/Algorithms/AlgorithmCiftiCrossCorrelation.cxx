@@ -25,15 +25,21 @@
 #include "CaretLogger.h"
 #include "CaretOMP.h"
 #include "CiftiFile.h"
-#include "dot_wrapper.h"
+#include "CorrelationHelper.h"
 #include "FileInformation.h"
 
+#include <algorithm>
 #include <cmath>
 #include <fstream>
 
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    const int64_t B_BLOCK_ROWS = 64;//rows of cifti-b read and correlated at a time
+}
+
 AString AlgorithmCiftiCrossCorrelation::getCommandSwitch()
 {
     return "-cifti-cross-correlation";
@@ -61,11 +67,15 @@ OperationParameters* AlgorithmCiftiCrossCorrelation::getParameters()
     OptionalParameter* memLimitOpt = ret->createOptionalParameter(6, "-mem-limit", "restrict memory usage");
     memLimitOpt->addDoubleParameter(1, "limit-GB", "memory limit in gigabytes");
     
+    ret->createOptionalParameter(7, "-spearman", "use spearman rank correlation instead of pearson correlation");
+    
     ret->setHelpText(
         AString("Correlates every row in <cifti-a> with every row in <cifti-b>.  ") +
         "The mapping along columns in <cifti-b> becomes the mapping along rows in the output.\n\n" +
         "When using the -fisher-z option, the output is NOT a Z-score, it is artanh(r), to do further math on this output, consider using -cifti-math.\n\n" +
-        "Restricting the memory usage will make it calculate the output in chunks, by reading through <cifti-b> multiple times."
+        "Restricting the memory usage will make it calculate the output in chunks, by reading through <cifti-b> multiple times.\n\n" +
+        "The -spearman option replaces the values in each row with their ranks before correlating, with tied values getting the average of their ranks.  " +
+        "When used with -weights, columns with zero weight are excluded before ranking, and the other weights are applied to the ranks."
     );
     return ret;
 }
@@ -112,14 +122,15 @@ void AlgorithmCiftiCrossCorrelation::useParameters(OperationParameters* myParams
             throw AlgorithmException("memory limit cannot be negative");
         }
     }
-    AlgorithmCiftiCrossCorrelation(myProgObj, myCiftiA, myCiftiB, myCiftiOut, weights, fisherZ, memLimitGB);
+    bool spearman = myParams->getOptionalParameter(7)->m_present;
+    AlgorithmCiftiCrossCorrelation(myProgObj, myCiftiA, myCiftiB, myCiftiOut, weights, fisherZ, memLimitGB, spearman);
 }
 
 AlgorithmCiftiCrossCorrelation::AlgorithmCiftiCrossCorrelation(ProgressObject* myProgObj, const CiftiFile* myCiftiA, const CiftiFile* myCiftiB, CiftiFile* myCiftiOut,
-                                                               const vector<float>* weights, const bool& fisherZ, const float& memLimitGB) : AbstractAlgorithm(myProgObj)
+                                                               const vector<float>* weights, const bool& fisherZ, const float& memLimitGB, const bool& spearman) : AbstractAlgorithm(myProgObj)
 {
     LevelProgress myProgress(myProgObj);
-    init(myCiftiA, myCiftiB, myCiftiOut, weights);
+    init(myCiftiA, myCiftiB, myCiftiOut, weights, spearman);
     CiftiXMLOld outXML = myCiftiA->getCiftiXMLOld();
     outXML.copyMapping(CiftiXMLOld::ALONG_ROW, myCiftiB->getCiftiXMLOld(), CiftiXMLOld::ALONG_COLUMN);//(try to) copy B's along column mapping to output's along row mapping
     myCiftiOut->setCiftiXML(outXML);
@@ -128,31 +139,41 @@ AlgorithmCiftiCrossCorrelation::AlgorithmCiftiCrossCorrelation(ProgressObject* m
     {
         chunkSize = numRowsForMem(memLimitGB);
     }
+    const int64_t rowLength = getCompactLength();
     vector<vector<float> > outscratch(chunkSize, vector<float>(m_numRowsB));//allocate output rows
+    vector<vector<float> > blockB(min(B_BLOCK_ROWS, m_numRowsB), vector<float>(m_numCols));
+    vector<const float*> rowsA, rowsB;
+    vector<float*> outRows;
     for (int64_t chunkStart = 0; chunkStart < m_numRowsA; chunkStart += chunkSize)
     {
         int64_t chunkEnd = chunkStart + chunkSize;
         if (chunkEnd > m_numRowsA) chunkEnd = m_numRowsA;
         cacheRowsA(chunkStart, chunkEnd);
-        int64_t counter = 0;
-#pragma omp CARET_PARFOR schedule(dynamic)
-        for (int64_t i = 0; i < m_numRowsB; ++i)
+        rowsA.resize(chunkEnd - chunkStart);
+        outRows.resize(chunkEnd - chunkStart);
+        for (int64_t indA = chunkStart; indA < chunkEnd; ++indA)
         {
-            float rrsB;
-            int64_t indB;
-            const float* rowB;
-#pragma omp critical
+            rowsA[indA - chunkStart] = m_rowCacheA[indA - chunkStart].data();
+        }
+        for (int64_t blockStart = 0; blockStart < m_numRowsB; blockStart += B_BLOCK_ROWS)
+        {//tile the output: a small block of B rows stays in cache while every cached A row is correlated against it
+            int64_t blockEnd = min(blockStart + B_BLOCK_ROWS, m_numRowsB);
+            for (int64_t indB = blockStart; indB < blockEnd; ++indB)
+            {//rows must be read in order, so do it outside the parallel part
+                m_ciftiB->getRow(blockB[indB - blockStart].data(), indB);
+            }
+            rowsB.resize(blockEnd - blockStart);
+#pragma omp CARET_PARFOR schedule(dynamic)
+            for (int64_t indB = blockStart; indB < blockEnd; ++indB)
             {
-                indB = counter;//manually in-order rows because we need to read them from disk, and can't request more than one at a time
-                ++counter;
-                rowB = getRowB(indB, rrsB);
+                adjustRow(blockB[indB - blockStart].data());
+                rowsB[indB - blockStart] = blockB[indB - blockStart].data();
             }
-            for (int indA = chunkStart; indA < chunkEnd; ++indA)
+            for (int64_t indA = chunkStart; indA < chunkEnd; ++indA)
             {
-                float rrsA;
-                const float* rowA = getCachedRowA(indA, rrsA);
-                outscratch[indA - chunkStart][indB] = correlate(rowA, rrsA, rowB, rrsB, fisherZ);
+                outRows[indA - chunkStart] = outscratch[indA - chunkStart].data() + blockStart;
             }
+            CorrelationHelper::correlateBlock(rowsA, rowsB, rowLength, outRows, fisherZ);
         }
         for (int64_t indA = chunkStart; indA < chunkEnd; ++indA)
         {
@@ -161,8 +182,9 @@ AlgorithmCiftiCrossCorrelation::AlgorithmCiftiCrossCorrelation(ProgressObject* m
     }
 }
 
-void AlgorithmCiftiCrossCorrelation::init(const CiftiFile* myCiftiA, const CiftiFile* myCiftiB, const CiftiFile* myCiftiOut, const vector<float>* weights)
+void AlgorithmCiftiCrossCorrelation::init(const CiftiFile* myCiftiA, const CiftiFile* myCiftiB, const CiftiFile* myCiftiOut, const vector<float>* weights, const bool& spearman)
 {
+    m_spearman = spearman;
     m_numCols = myCiftiA->getNumberOfColumns();
     if (myCiftiB->getNumberOfColumns() != m_numCols) throw AlgorithmException("input cifti files have different row lengths");
     m_numRowsA = myCiftiA->getNumberOfRows();
@@ -170,8 +192,6 @@ void AlgorithmCiftiCrossCorrelation::init(const CiftiFile* myCiftiA, const Cifti
     m_ciftiA = myCiftiA;
     m_ciftiB = myCiftiB;
     m_ciftiOut = myCiftiOut;
-    m_rowInfoA.resize(m_numRowsA);//calls default constructors, setting m_haveCalculated and m_cacheIndex
-    m_rowInfoB.resize(m_numRowsB);
     if (weights != NULL)
     {
         m_weightSum = 0.0;
@@ -212,11 +232,7 @@ int64_t AlgorithmCiftiCrossCorrelation::numRowsForMem(const float& memLimitGB)
     if (m_ciftiOut->isInMemory()) targetBytes -= sizeof(float) * m_numRowsA * m_numRowsB;//count only in-memory output against total, the only time inputs might be in memory is in the GUI
     int64_t bytesPerInputRow = sizeof(float) * m_numCols;//this means we expect the user to give "current free memory" as the limit
     int64_t bytesPerOutputRow = sizeof(float) * m_numRowsB;
-#ifdef CARET_OMP
-    targetBytes -= bytesPerInputRow * omp_get_max_threads();//subtract the temporary row memory
-#else
-    targetBytes -= bytesPerInputRow;
-#endif
+    targetBytes -= bytesPerInputRow * min(B_BLOCK_ROWS, m_numRowsB);//subtract the block of B rows
     int64_t ret = 1;
     if (targetBytes < 1)
     {
@@ -242,70 +258,10 @@ int64_t AlgorithmCiftiCrossCorrelation::numRowsForMem(const float& memLimitGB)
     return ret;
 }
 
-float AlgorithmCiftiCrossCorrelation::correlate(const float* row1, const float& rrs1, const float* row2, const float& rrs2, const bool& fisherZ)
+int64_t AlgorithmCiftiCrossCorrelation::getCompactLength()
 {
-    double r;
-    if (m_weightedMode)
-    {
-        int numWeights = (int)m_weightIndexes.size();//because we compacted the data in the row to not include any zero weights
-        double accum = dsdot(row1, row2, numWeights);//these have already had the weighted row means subtracted out, and weights applied
-        r = accum / (rrs1 * rrs2);//as do these
-    } else {
-        double accum = dsdot(row1, row2, m_numCols);//these have already had the row means subtracted out
-        r = accum / (rrs1 * rrs2);
-    }
-    if (fisherZ)
-    {
-        if (r > 0.999999) r = 0.999999;//prevent inf
-        if (r < -0.999999) r = -0.999999;//prevent -inf
-        return 0.5 * log((1 + r) / (1 - r));
-    } else {
-        if (r > 1.0) r = 1.0;//don't output anything silly
-        if (r < -1.0) r = -1.0;
-        return r;
-    }
-}
-
-const float* AlgorithmCiftiCrossCorrelation::getCachedRowA(const int64_t& ciftiIndex, float& rootResidSqr)
-{
-    CaretAssertVectorIndex(m_rowInfoA, ciftiIndex);
-    CaretAssert(m_rowInfoA[ciftiIndex].m_cacheIndex != -1);
-    rootResidSqr = m_rowInfoA[ciftiIndex].m_rootResidSqr;
-    return m_rowCacheA[m_rowInfoA[ciftiIndex].m_cacheIndex].m_row.data();
-}
-
-const float* AlgorithmCiftiCrossCorrelation::getRowB(const int64_t& ciftiIndex, float& rootResidSqr)
-{
-    CaretAssertVectorIndex(m_rowInfoB, ciftiIndex);
-    float* ret = getTempRowB();//purely allocation, one array per thread
-    m_ciftiB->getRow(ret, ciftiIndex);
-    adjustRow(ret, m_rowInfoB[ciftiIndex]);
-    rootResidSqr = m_rowInfoB[ciftiIndex].m_rootResidSqr;//NOTE: must do this AFTER adjustRow, because it is not computed before it on the first chunk
-    return ret;
-}
-
-float* AlgorithmCiftiCrossCorrelation::getTempRowB()
-{
-#ifdef CARET_OMP
-    int oldsize = (int)m_tempRowsB.size();
-    int threadNum = omp_get_thread_num();
-    if (threadNum >= oldsize)
-    {
-        m_tempRowsB.resize(threadNum + 1);
-        for (int i = oldsize; i <= threadNum; ++i)
-        {
-            m_tempRowsB[i] = CaretArray<float>(m_numCols);
-        }
-    }
-    return m_tempRowsB[threadNum].getArray();
-#else
-    if (m_tempRowsB.size() == 0)
-    {
-        m_tempRowsB.resize(1);
-        m_tempRowsB[0] = CaretArray<float>(m_numCols);
-    }
-    return m_tempRowsB[0].getArray();
-#endif
+    if (m_weightedMode) return (int64_t)m_weightIndexes.size();//because we compact the data in the row to not include any zero weights
+    return m_numCols;
 }
 
 void AlgorithmCiftiCrossCorrelation::cacheRowsA(const int64_t& begin, const int64_t& end)
@@ -313,103 +269,54 @@ void AlgorithmCiftiCrossCorrelation::cacheRowsA(const int64_t& begin, const int6
     CaretAssert(begin > -1);
     CaretAssert(end <= m_numRowsA);
     CaretAssert(begin < end);//takes care of end <= 0 and being >= numrows
-    int64_t cacheSize = (int64_t)m_rowCacheA.size();//clear the existing cache references
-    for (int64_t i = 0; i < cacheSize; ++i)
-    {
-        m_rowInfoA[m_rowCacheA[i].m_ciftiIndex].m_cacheIndex = -1;
-    }
     m_rowCacheA.resize(end - begin);//set to exactly the size needed
-    int64_t counter = begin;//force in-order row reading via critical and counter
+    for (int64_t i = begin; i < end; ++i)
+    {//rows must be read in order, so do it outside the parallel part
+        m_rowCacheA[i - begin].resize(m_numCols);
+        m_ciftiA->getRow(m_rowCacheA[i - begin].data(), i);
+    }
 #pragma omp CARET_PARFOR schedule(dynamic)
     for (int64_t i = begin; i < end; ++i)
     {
-        int64_t myindex;
-#pragma omp critical
-        {
-            myindex = counter;
-            ++counter;
-            m_rowCacheA[myindex - begin].m_row.resize(m_numCols);
-            m_ciftiA->getRow(m_rowCacheA[myindex - begin].m_row.data(), myindex);
-        }
-        CacheRow& myRow = m_rowCacheA[myindex - begin];
-        myRow.m_ciftiIndex = myindex;
-        m_rowInfoA[myindex].m_cacheIndex = myindex - begin;
-        adjustRow(myRow.m_row.data(), m_rowInfoA[myindex]);
+        adjustRow(m_rowCacheA[i - begin].data());
     }
 }
 
-void AlgorithmCiftiCrossCorrelation::adjustRow(float* row, RowInfo& info)
-{
-    if (!info.m_haveCalculated)//ensure statistics are calculated
+void AlgorithmCiftiCrossCorrelation::adjustRow(float* row)
+{//COMPACT data, rank if applicable, then normalize so that correlating two rows is just a dot product
+    if (m_weightedMode)
     {
-        info.m_haveCalculated = true;
-        double accum = 0.0;
-        if (m_weightedMode)
+        int64_t mycount = (int64_t)m_weightIndexes.size();
+        for (int64_t i = 0; i < mycount; ++i)
         {
-            int64_t mycount = (int64_t)m_weightIndexes.size();
-            if (m_binaryWeights)
-            {
-                for (int64_t i = 0; i < mycount; ++i)
-                {
-                    accum += row[m_weightIndexes[i]];
-                }
-                info.m_mean = accum / mycount;
-                accum = 0.0;
-                for (int64_t i = 0; i < mycount; ++i)
-                {
-                    float tempf = row[m_weightIndexes[i]] - info.m_mean;
-                    accum += tempf * tempf;
-                }
-                info.m_rootResidSqr = sqrt(accum);
-            } else {
-                for (int64_t i = 0; i < mycount; ++i)
-                {
-                    accum += m_weights[i] * row[m_weightIndexes[i]];
-                }
-                info.m_mean = accum / m_weightSum;
-                accum = 0.0;
-                for (int64_t i = 0; i < mycount; ++i)
-                {
-                    float tempf = row[m_weightIndexes[i]] - info.m_mean;
-                    accum += m_weights[i] * tempf * tempf;
-                }
-                info.m_rootResidSqr = sqrt(accum);
-            }
+            row[i] = row[m_weightIndexes[i]];//indexes are increasing, so this never overwrites anything still needed
+        }
+        if (m_spearman) CorrelationHelper::rankTransform(row, mycount);
+        if (m_binaryWeights)
+        {
+            CorrelationHelper::normalize(row, mycount);
         } else {
-            for (int64_t i = 0; i < m_numCols; ++i)
+            double accum = 0.0;
+            for (int64_t i = 0; i < mycount; ++i)
             {
-                accum += row[i];
+                accum += m_weights[i] * row[i];
             }
-            info.m_mean = accum / m_numCols;
+            float mean = accum / m_weightSum;
             accum = 0.0;
-            for (int64_t i = 0; i < m_numCols; ++i)
-            {
-                float tempf = row[i] - info.m_mean;
-                accum += tempf * tempf;
-            }
-            info.m_rootResidSqr = sqrt(accum);
-        }
-    }
-    if (m_weightedMode)//COMPACT data, subtract mean, multiply by square root of weights if applicable
-    {
-        int64_t mycount = (int64_t)m_weightIndexes.size();
-        if (m_binaryWeights)
-        {
             for (int64_t i = 0; i < mycount; ++i)
             {
-                row[i] = row[m_weightIndexes[i]] - info.m_mean;
+                row[i] = sqrt(m_weights[i]) * (row[i] - mean);//this is so the numerator doesn't get squared weights applied, since this happens to both rows
+                accum += row[i] * row[i];
             }
-        } else {
+            float scale = 1.0 / sqrt(accum);
             for (int64_t i = 0; i < mycount; ++i)
             {
-                row[i] = sqrt(m_weights[i]) * (row[m_weightIndexes[i]] - info.m_mean);//this is so the numerator doesn't get squared weights applied, since this happens to both rows
+                row[i] *= scale;
             }
         }
     } else {
-        for (int64_t i = 0; i < m_numCols; ++i)
-        {
-            row[i] -= info.m_mean;
-        }
+        if (m_spearman) CorrelationHelper::rankTransform(row, m_numCols);
+        CorrelationHelper::normalize(row, m_numCols);
     }
 }
 
@@ -170,7 +170,7 @@ AlgorithmCiftiLabelAdjacency::AlgorithmCiftiLabelAdjacency(ProgressObject* myPro
             if (baseIndex < 0) continue;
             int baseLabel = indexToParcel[baseIndex];//translate on the fly, to do separate we would need to put indexToParcel into a temporary CiftiFile
             if (baseLabel < 0) continue;
-            const vector<int32_t>& neighbors = myHelp->getNodeNeighbors(i);
+            const TopologyIndexList neighbors = myHelp->getNodeNeighbors(i);
             int numNeighbors = (int)neighbors.size();
             for (int j = 0; j < numNeighbors; ++j)
             {
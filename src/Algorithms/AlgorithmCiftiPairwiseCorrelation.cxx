@@ -25,9 +25,10 @@
 #include "CaretLogger.h"
 #include "CaretOMP.h"
 #include "CiftiFile.h"
+#include "CorrelationHelper.h"
 #include "FileInformation.h"
 
-#include <cmath>
+#include <algorithm>
 
 using namespace caret;
 using namespace std;
@@ -55,8 +56,11 @@ OperationParameters* AlgorithmCiftiPairwiseCorrelation::getParameters()
     
     ret->createOptionalParameter(5, "-override-mapping-check", "don't check the mappings for compatibility, only check length");
     
+    ret->createOptionalParameter(6, "-spearman", "use spearman rank correlation instead of pearson correlation");
+    
     ret->setHelpText(
-        AString("For each row in <cifti-a>, correlate it with the same row in <cifti-b>, and put the result in the same row of <cifti-out>, which has only one column.")
+        AString("For each row in <cifti-a>, correlate it with the same row in <cifti-b>, and put the result in the same row of <cifti-out>, which has only one column.  ") +
+        "The -spearman option replaces the values in each row with their ranks before correlating, with tied values getting the average of their ranks."
     );
     return ret;
 }
@@ -68,11 +72,12 @@ void AlgorithmCiftiPairwiseCorrelation::useParameters(OperationParameters* myPar
     CiftiFile* myCiftiOut = myParams->getOutputCifti(3);
     bool fisherZ = myParams->getOptionalParameter(4)->m_present;
     bool overrideMappingCheck = myParams->getOptionalParameter(5)->m_present;
-    AlgorithmCiftiPairwiseCorrelation(myProgObj, myCiftiA, myCiftiB, myCiftiOut, fisherZ, overrideMappingCheck);
+    bool spearman = myParams->getOptionalParameter(6)->m_present;
+    AlgorithmCiftiPairwiseCorrelation(myProgObj, myCiftiA, myCiftiB, myCiftiOut, fisherZ, overrideMappingCheck, spearman);
 }
 
 AlgorithmCiftiPairwiseCorrelation::AlgorithmCiftiPairwiseCorrelation(ProgressObject* myProgObj, const CiftiFile* myCiftiA, const CiftiFile* myCiftiB, CiftiFile* myCiftiOut,
-                                                                     const bool& fisherZ, const bool& overrideMappingCheck) : AbstractAlgorithm(myProgObj)
+                                                                     const bool& fisherZ, const bool& overrideMappingCheck, const bool& spearman) : AbstractAlgorithm(myProgObj)
 {
     LevelProgress myProgress(myProgObj);
     CiftiXMLOld outXML = myCiftiA->getCiftiXMLOld();
@@ -87,56 +92,35 @@ AlgorithmCiftiPairwiseCorrelation::AlgorithmCiftiPairwiseCorrelation(ProgressObj
     outXML.resetRowsToScalars(1);
     outXML.setMapNameForRowIndex(0, "pairwise correlation");
     myCiftiOut->setCiftiXML(outXML);
-    vector<float> rowA(rowLength), rowB(rowLength), columnOut(numRows);
-    for (int64_t i = 0; i < numRows; ++i)
+    vector<float> columnOut(numRows);
+    const int64_t BLOCK_ROWS = 256;
+    vector<vector<float> > blockA(min(BLOCK_ROWS, numRows), vector<float>(rowLength)), blockB(blockA.size(), vector<float>(rowLength));
+    for (int64_t blockStart = 0; blockStart < numRows; blockStart += BLOCK_ROWS)
     {
-        float rrsA, rrsB;
-        myCiftiA->getRow(rowA.data(), i);
-        myCiftiB->getRow(rowB.data(), i);
-        preprocess(rowA.data(), rowLength, rrsA);
-        preprocess(rowB.data(), rowLength, rrsB);
-        columnOut[i] = correlate(rowA.data(), rrsA, rowB.data(), rrsB, rowLength, fisherZ);
+        int64_t blockEnd = min(numRows, blockStart + BLOCK_ROWS);
+        for (int64_t i = blockStart; i < blockEnd; ++i)
+        {//reading must be in order, so do it outside the parallel part
+            myCiftiA->getRow(blockA[i - blockStart].data(), i);
+            myCiftiB->getRow(blockB[i - blockStart].data(), i);
+        }
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int64_t i = blockStart; i < blockEnd; ++i)
+        {
+            float* rowA = blockA[i - blockStart].data();
+            float* rowB = blockB[i - blockStart].data();
+            if (spearman)
+            {
+                CorrelationHelper::rankTransform(rowA, rowLength);
+                CorrelationHelper::rankTransform(rowB, rowLength);
+            }
+            CorrelationHelper::normalize(rowA, rowLength);
+            CorrelationHelper::normalize(rowB, rowLength);
+            columnOut[i] = CorrelationHelper::correlate(rowA, rowB, rowLength, fisherZ);
+        }
     }
     myCiftiOut->setColumn(columnOut.data(), 0);
 }
 
-void AlgorithmCiftiPairwiseCorrelation::preprocess(float* row, const int64_t length, float& rrsOut)
-{
-    double accum = 0.0;
-    for (int64_t i = 0; i < length; ++i)
-    {
-        accum += row[i];
-    }
-    float mean = accum / length;
-    accum = 0.0;
-    for (int64_t i = 0; i < length; ++i)
-    {
-        row[i] -= mean;
-        accum += row[i] * row[i];
-    }
-    rrsOut = sqrt(accum);
-}
-
-float AlgorithmCiftiPairwiseCorrelation::correlate(const float* rowA, const float& rrsA, const float* rowB, const float& rrsB, const int64_t& length, const bool& fisherZ)
-{
-    double r = 0.0;
-    for (int64_t i = 0; i < length; ++i)
-    {
-        r += rowA[i] * rowB[i];
-    }
-    r /= rrsA * rrsB;
-    if (fisherZ)
-    {
-        if (r > 0.999999) r = 0.999999;//prevent inf
-        if (r < -0.999999) r = -0.999999;//prevent -inf
-        return 0.5 * log((1 + r) / (1 - r));
-    } else {
-        if (r > 1.0) r = 1.0;//don't output anything silly
-        if (r < -1.0) r = -1.0;
-        return r;
-    }
-}
-
 float AlgorithmCiftiPairwiseCorrelation::getAlgorithmInternalWeight()
 {
     return 1.0f;//override this if needed, if the progress bar isn't smooth
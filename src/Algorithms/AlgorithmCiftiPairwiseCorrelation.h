@@ -28,14 +28,12 @@ namespace caret {
     class AlgorithmCiftiPairwiseCorrelation : public AbstractAlgorithm
     {
         AlgorithmCiftiPairwiseCorrelation();
-        void preprocess(float* row, const int64_t length, float& rrsOut);
-        float correlate(const float* rowA, const float& rrsA, const float* rowB, const float& rrsB, const int64_t& length, const bool& fisherZ);
     protected:
         static float getSubAlgorithmWeight();
         static float getAlgorithmInternalWeight();
     public:
         AlgorithmCiftiPairwiseCorrelation(ProgressObject* myProgObj, const CiftiFile* myCiftiA, const CiftiFile* myCiftiB, CiftiFile* myCiftiOut,
-                                          const bool& fisherZ = false, const bool& overrideMappingCheck = false);
+                                          const bool& fisherZ = false, const bool& overrideMappingCheck = false, const bool& spearman = false);
         static OperationParameters* getParameters();
         static void useParameters(OperationParameters* myParams, ProgressObject* myProgObj);
         static AString getCommandSwitch();
@@ -21,6 +21,7 @@
 #include "AlgorithmCiftiParcellate.h"
 #include "AlgorithmException.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "CiftiFile.h"
 #include "GiftiLabel.h"
 #include "GiftiLabelTable.h"
@@ -29,6 +30,7 @@
 #include "ReductionOperation.h"
 #include "SurfaceFile.h"
 
+#include <algorithm>
 #include <cmath>
 #include <map>
 
@@ -238,6 +240,187 @@ void AlgorithmCiftiParcellate::useParameters(OperationParameters* myParams, Prog
                              legacyMode, emptyFillValue, emptyMaskOut);
 }
 
+namespace
+{
+    //MEAN and SUM (weighted or not) are linear, so they can be done as a sparse parcel-by-brainordinate matrix product instead of gathering every value and reducing
+    //label data gets rounded first, and only-numeric and outlier exclusion need to look at every value, so those still use the gather path
+    bool useSparseParcellation(const ReductionEnum::Enum& method, const float& excludeLow, const float& excludeHigh, const bool& onlyNumeric, const bool& isLabel)
+    {
+        if (method != ReductionEnum::MEAN && method != ReductionEnum::SUM) return false;
+        if (excludeLow > 0.0f && excludeHigh > 0.0f) return false;
+        return !onlyNumeric && !isLabel;
+    }
+    
+    struct SparseParcelMatrix
+    {//compressed rows, one per parcel, members in index order so that the sums are done in the same order as the gather path
+        vector<int64_t> m_offsets, m_members;
+        vector<float> m_weights;//1 for unweighted, multiplying by 1 is exact
+        vector<float> m_indexWeights;//the same weights, looked up by brainordinate index
+        vector<double> m_divisors;//1 for SUM, count or sum of weights for MEAN
+        SparseParcelMatrix(const vector<int>& indexToParcel, const int& numParcels, const vector<vector<float> >* parcelWeights, const ReductionEnum::Enum& method)
+        {
+            const int64_t numIndices = (int64_t)indexToParcel.size();
+            m_offsets.assign(numParcels + 1, 0);
+            for (int64_t i = 0; i < numIndices; ++i)
+            {
+                if (indexToParcel[i] != -1) ++m_offsets[indexToParcel[i] + 1];
+            }
+            for (int p = 0; p < numParcels; ++p)
+            {
+                m_offsets[p + 1] += m_offsets[p];
+            }
+            m_members.resize(m_offsets[numParcels]);
+            m_weights.resize(m_offsets[numParcels], 1.0f);
+            m_indexWeights.resize(numIndices, 0.0f);
+            vector<int64_t> fillPos(m_offsets.begin(), m_offsets.end() - 1);
+            for (int64_t i = 0; i < numIndices; ++i)
+            {
+                int parcel = indexToParcel[i];
+                if (parcel == -1) continue;
+                int64_t pos = fillPos[parcel]++;
+                m_members[pos] = i;
+                if (parcelWeights != NULL)
+                {
+                    CaretAssert((int64_t)(*parcelWeights)[parcel].size() == m_offsets[parcel + 1] - m_offsets[parcel]);
+                    m_weights[pos] = (*parcelWeights)[parcel][pos - m_offsets[parcel]];
+                }
+                m_indexWeights[i] = m_weights[pos];
+            }
+            m_divisors.resize(numParcels, 1.0);
+            if (method == ReductionEnum::MEAN)
+            {
+                for (int p = 0; p < numParcels; ++p)
+                {
+                    if (parcelWeights != NULL)
+                    {
+                        double weightsum = 0.0;//same accumulation as ReductionOperation::reduceWeighted
+                        for (int64_t k = m_offsets[p]; k < m_offsets[p + 1]; ++k) weightsum += m_weights[k];
+                        m_divisors[p] = weightsum;
+                    } else {
+                        m_divisors[p] = (double)(m_offsets[p + 1] - m_offsets[p]);
+                    }
+                }
+            }
+        }
+        bool isEmpty(const int& parcel) const { return m_offsets[parcel] == m_offsets[parcel + 1]; }
+        int getNumParcels() const { return (int)m_divisors.size(); }
+    };
+    
+    void sparseParcellateAlongRow(const CiftiFile* myCiftiIn, CiftiFile* myCiftiOut, const SparseParcelMatrix& myMatrix, const vector<int64_t>& dims, const float& emptyFillVal)
+    {
+        const int64_t numCols = dims[0];
+        const int numParcels = myMatrix.getNumParcels();
+        int64_t numRows = 1;
+        for (int i = 1; i < (int)dims.size(); ++i) numRows *= dims[i];
+        const int64_t blockRows = min(numRows, max((int64_t)1, min((int64_t)64, ((int64_t)1 << 24) / max(numCols, (int64_t)1))));//file IO isn't thread safe, so read a block serially, then reduce it in parallel
+        vector<vector<float> > inRows(blockRows, vector<float>(numCols)), outRows(blockRows, vector<float>(numParcels));
+        vector<vector<int64_t> > rowIndices(blockRows);
+        MultiDimIterator<int64_t> iter(vector<int64_t>(dims.begin() + 1, dims.end()));
+        while (!iter.atEnd())
+        {
+            int64_t numInBlock = 0;
+            for (; numInBlock < blockRows && !iter.atEnd(); ++numInBlock, ++iter)
+            {
+                rowIndices[numInBlock] = *iter;
+                myCiftiIn->getRow(inRows[numInBlock].data(), *iter);
+            }
+#pragma omp CARET_PARFOR schedule(dynamic)
+            for (int64_t r = 0; r < numInBlock; ++r)
+            {
+                const float* inRow = inRows[r].data();
+                float* outRow = outRows[r].data();
+                for (int p = 0; p < numParcels; ++p)
+                {
+                    if (myMatrix.isEmpty(p))
+                    {
+                        outRow[p] = emptyFillVal;
+                        continue;
+                    }
+                    double accum = 0.0;
+                    for (int64_t k = myMatrix.m_offsets[p]; k < myMatrix.m_offsets[p + 1]; ++k)
+                    {
+                        accum += inRow[myMatrix.m_members[k]] * myMatrix.m_weights[k];
+                    }
+                    outRow[p] = (float)(accum / myMatrix.m_divisors[p]);
+                }
+            }
+            for (int64_t r = 0; r < numInBlock; ++r)
+            {
+                myCiftiOut->setRow(outRows[r].data(), rowIndices[r]);
+            }
+        }
+    }
+    
+    void sparseParcellateAlongColumn(const CiftiFile* myCiftiIn, const int& direction, CiftiFile* myCiftiOut, const SparseParcelMatrix& myMatrix,
+                                     const vector<int>& indexToParcel, const vector<int64_t>& dims, const float& emptyFillVal)
+    {
+        const int64_t numCols = dims[0];
+        const int numParcels = myMatrix.getNumParcels();
+        const int64_t blockRows = max((int64_t)1, min((int64_t)256, ((int64_t)1 << 24) / max(numCols, (int64_t)1)));
+        const int64_t colChunk = 256;//threads split the columns, so each output sum is only touched by one thread, in index order
+        const int64_t numChunks = (numCols + colChunk - 1) / colChunk;
+        vector<vector<float> > inRows(blockRows, vector<float>(numCols));
+        vector<int64_t> blockMembers(blockRows);
+        vector<double> sums(numParcels * numCols);
+        vector<float> scratchOutRow(numCols);
+        vector<int64_t> otherDims = dims;
+        otherDims.erase(otherDims.begin() + direction);//direction being parcellated
+        otherDims.erase(otherDims.begin());//row
+        for (MultiDimIterator<int64_t> iter(otherDims); !iter.atEnd(); ++iter)
+        {
+            vector<int64_t> indices(dims.size() - 1);
+            for (int i = 0; i < (int)otherDims.size(); ++i)
+            {
+                if (i < direction - 1)
+                {
+                    indices[i] = (*iter)[i];
+                } else {
+                    indices[i + 1] = (*iter)[i];
+                }
+            }
+            sums.assign(sums.size(), 0.0);
+            int64_t next = 0;
+            while (next < dims[direction])
+            {
+                int64_t numInBlock = 0;
+                for (; numInBlock < blockRows && next < dims[direction]; ++next)
+                {
+                    if (indexToParcel[next] == -1) continue;
+                    indices[direction - 1] = next;
+                    myCiftiIn->getRow(inRows[numInBlock].data(), indices);
+                    blockMembers[numInBlock] = next;
+                    ++numInBlock;
+                }
+#pragma omp CARET_PARFOR schedule(static)
+                for (int64_t chunk = 0; chunk < numChunks; ++chunk)
+                {
+                    const int64_t colStart = chunk * colChunk, colEnd = min(numCols, colStart + colChunk);
+                    for (int64_t r = 0; r < numInBlock; ++r)
+                    {
+                        const float* inRow = inRows[r].data();
+                        const float weight = myMatrix.m_indexWeights[blockMembers[r]];
+                        double* sumRow = sums.data() + indexToParcel[blockMembers[r]] * numCols;
+                        for (int64_t j = colStart; j < colEnd; ++j)
+                        {
+                            sumRow[j] += inRow[j] * weight;
+                        }
+                    }
+                }
+            }
+            for (int p = 0; p < numParcels; ++p)
+            {
+                indices[direction - 1] = p;
+                const double* sumRow = sums.data() + p * numCols;
+                for (int64_t j = 0; j < numCols; ++j)
+                {
+                    scratchOutRow[j] = (myMatrix.isEmpty(p) ? emptyFillVal : (float)(sumRow[j] / myMatrix.m_divisors[p]));
+                }
+                myCiftiOut->setRow(scratchOutRow.data(), indices);
+            }
+        }
+    }
+}
+
 AlgorithmCiftiParcellate::AlgorithmCiftiParcellate(ProgressObject* myProgObj, const CiftiFile* myCiftiIn, const CiftiFile* myCiftiLabel, const int& direction, CiftiFile* myCiftiOut,
                                                    const ReductionEnum::Enum& method, const float& excludeLow, const float& excludeHigh, const bool& onlyNumeric,
                                                    const bool& legacyMode, const float& emptyFillVal, CiftiFile* emptyMaskOut) : AbstractAlgorithm(myProgObj)
@@ -324,6 +507,17 @@ AlgorithmCiftiParcellate::AlgorithmCiftiParcellate(ProgressObject* myProgObj, co
     {
         CaretLogWarning(ReductionEnum::toName(method) + " reduction requested while parcellating label data");
     }
+    if (useSparseParcellation(method, excludeLow, excludeHigh, onlyNumeric, isLabel))
+    {
+        SparseParcelMatrix myMatrix(indexToParcel, numParcels, NULL, method);
+        if (direction == CiftiXML::ALONG_ROW)
+        {
+            sparseParcellateAlongRow(myCiftiIn, myCiftiOut, myMatrix, dims, emptyFillVal);
+        } else {
+            sparseParcellateAlongColumn(myCiftiIn, direction, myCiftiOut, myMatrix, indexToParcel, dims, emptyFillVal);
+        }
+        return;
+    }
     if (direction == CiftiXML::ALONG_ROW)
     {
         vector<float> scratchOutRow(numParcels);
@@ -352,31 +546,40 @@ AlgorithmCiftiParcellate::AlgorithmCiftiParcellate(ProgressObject* myProgObj, co
                     }
                 }
             }
+            AString reduceError;//ReductionOperation throws on bad input, which must not escape the parallel region
+#pragma omp CARET_PARFOR schedule(dynamic)
             for (int j = 0; j < numParcels; ++j)
             {
-                CaretAssert(parcelCounts[j] == (int64_t)parcelData[j].size());
-                if (parcelCounts[j] > 0 && (method != ReductionEnum::SAMPSTDEV || parcelCounts[j] > 1))
+                try
                 {
-                    if (excludeLow > 0.0f && excludeHigh > 0.0f)
+                    CaretAssert(parcelCounts[j] == (int64_t)parcelData[j].size());
+                    if (parcelCounts[j] > 0 && (method != ReductionEnum::SAMPSTDEV || parcelCounts[j] > 1))
                     {
-                        scratchOutRow[j] = ReductionOperation::reduceExcludeDev(parcelData[j].data(), parcelData[j].size(), method, excludeLow, excludeHigh);
-                    } else {
-                        if (onlyNumeric)
+                        if (excludeLow > 0.0f && excludeHigh > 0.0f)
                         {
-                            scratchOutRow[j] = ReductionOperation::reduceOnlyNumeric(parcelData[j].data(), parcelData[j].size(), method);
+                            scratchOutRow[j] = ReductionOperation::reduceExcludeDev(parcelData[j].data(), parcelData[j].size(), method, excludeLow, excludeHigh);
                         } else {
-                            scratchOutRow[j] = ReductionOperation::reduce(parcelData[j].data(), parcelData[j].size(), method);
+                            if (onlyNumeric)
+                            {
+                                scratchOutRow[j] = ReductionOperation::reduceOnlyNumeric(parcelData[j].data(), parcelData[j].size(), method);
+                            } else {
+                                scratchOutRow[j] = ReductionOperation::reduce(parcelData[j].data(), parcelData[j].size(), method);
+                            }
+                        }
+                    } else {//labelDir can't be 0 (row) because we are parcellating along row, so row must be dense
+                        if (isLabel)
+                        {
+                            scratchOutRow[j] = myOutXML.getLabelsMap(labelDir).getMapLabelTable((*iter)[labelDir - 1])->getUnassignedLabelKey();
+                        } else {
+                            scratchOutRow[j] = emptyFillVal;//odd corner case, but probably fine: with nonzero empty fill value and SAMPSTDEV, parcels with only one element get the fill value, but aren't technically empty
                         }
                     }
-                } else {//labelDir can't be 0 (row) because we are parcellating along row, so row must be dense
-                    if (isLabel)
-                    {
-                        scratchOutRow[j] = myOutXML.getLabelsMap(labelDir).getMapLabelTable((*iter)[labelDir - 1])->getUnassignedLabelKey();
-                    } else {
-                        scratchOutRow[j] = emptyFillVal;//odd corner case, but probably fine: with nonzero empty fill value and SAMPSTDEV, parcels with only one element get the fill value, but aren't technically empty
-                    }
+                } catch (CaretException& e) {
+#pragma omp critical
+                    reduceError = e.whatString();
                 }
             }
+            if (reduceError != "") throw AlgorithmException(reduceError);
             myCiftiOut->setRow(scratchOutRow.data(), *iter);
         }
     } else {
@@ -437,21 +640,30 @@ AlgorithmCiftiParcellate::AlgorithmCiftiParcellate(ProgressObject* myProgObj, co
                 vector<vector<float> >& parcelRef = parcelData[i];
                 if (count > 0 && (method != ReductionEnum::SAMPSTDEV || count > 1))
                 {
+                    AString reduceError;
+#pragma omp CARET_PARFOR schedule(dynamic)
                     for (int j = 0; j < numCols; ++j)
                     {
-                        CaretAssert((int64_t)parcelRef[j].size() == count);
-                        if (excludeLow > 0.0f && excludeHigh > 0.0f)
+                        try
                         {
-                            scratchOutRow[j] = ReductionOperation::reduceExcludeDev(parcelRef[j].data(), parcelRef[j].size(), method, excludeLow, excludeHigh);
-                        } else {
-                            if (onlyNumeric)
+                            CaretAssert((int64_t)parcelRef[j].size() == count);
+                            if (excludeLow > 0.0f && excludeHigh > 0.0f)
                             {
-                                scratchOutRow[j] = ReductionOperation::reduceOnlyNumeric(parcelRef[j].data(), parcelRef[j].size(), method);
+                                scratchOutRow[j] = ReductionOperation::reduceExcludeDev(parcelRef[j].data(), parcelRef[j].size(), method, excludeLow, excludeHigh);
                             } else {
-                                scratchOutRow[j] = ReductionOperation::reduce(parcelRef[j].data(), parcelRef[j].size(), method);
+                                if (onlyNumeric)
+                                {
+                                    scratchOutRow[j] = ReductionOperation::reduceOnlyNumeric(parcelRef[j].data(), parcelRef[j].size(), method);
+                                } else {
+                                    scratchOutRow[j] = ReductionOperation::reduce(parcelRef[j].data(), parcelRef[j].size(), method);
+                                }
                             }
+                        } catch (CaretException& e) {
+#pragma omp critical
+                            reduceError = e.whatString();
                         }
                     }
+                    if (reduceError != "") throw AlgorithmException(reduceError);
                 } else {
                     for (int j = 0; j < numCols; ++j)
                     {
@@ -521,6 +733,17 @@ namespace
             }
             emptyMaskOut->setColumn(emptyMaskData.data(), 0);
         }
+        if (useSparseParcellation(method, excludeLow, excludeHigh, onlyNumeric, isLabel))
+        {
+            SparseParcelMatrix myMatrix(indexToParcel, numParcels, &parcelWeights, method);
+            if (direction == CiftiXML::ALONG_ROW)
+            {
+                sparseParcellateAlongRow(myCiftiIn, myCiftiOut, myMatrix, dims, emptyFillVal);
+            } else {
+                sparseParcellateAlongColumn(myCiftiIn, direction, myCiftiOut, myMatrix, indexToParcel, dims, emptyFillVal);
+            }
+            return;
+        }
         int64_t numCols = myInputXML.getDimensionLength(CiftiXML::ALONG_ROW);
         vector<float> scratchRow(numCols);
         if (direction == CiftiXML::ALONG_ROW)
@@ -551,31 +774,40 @@ namespace
                         }
                     }
                 }
+                AString reduceError;//ReductionOperation throws on bad input, which must not escape the parallel region
+#pragma omp CARET_PARFOR schedule(dynamic)
                 for (int j = 0; j < numParcels; ++j)
                 {
-                    CaretAssert(parcelWeights[j].size() == parcelData[j].size());
-                    if (parcelData[j].size() > 0 && (method != ReductionEnum::SAMPSTDEV || parcelData[j].size() > 1))
+                    try
                     {
-                        if (excludeLow > 0.0f && excludeHigh > 0.0f)
+                        CaretAssert(parcelWeights[j].size() == parcelData[j].size());
+                        if (parcelData[j].size() > 0 && (method != ReductionEnum::SAMPSTDEV || parcelData[j].size() > 1))
                         {
-                            scratchOutRow[j] = ReductionOperation::reduceWeightedExcludeDev(parcelData[j].data(), parcelWeights[j].data(), parcelData[j].size(), method, excludeLow, excludeHigh);
-                        } else {
-                            if (onlyNumeric)
+                            if (excludeLow > 0.0f && excludeHigh > 0.0f)
+                            {
+                                scratchOutRow[j] = ReductionOperation::reduceWeightedExcludeDev(parcelData[j].data(), parcelWeights[j].data(), parcelData[j].size(), method, excludeLow, excludeHigh);
+                            } else {
+                                if (onlyNumeric)
+                                {
+                                    scratchOutRow[j] = ReductionOperation::reduceWeightedOnlyNumeric(parcelData[j].data(), parcelWeights[j].data(), parcelData[j].size(), method);
+                                } else {
+                                    scratchOutRow[j] = ReductionOperation::reduceWeighted(parcelData[j].data(), parcelWeights[j].data(), parcelData[j].size(), method);
+                                }
+                            }
+                        } else {//labelDir can't be 0 (row) because we are parcellating along row, so row must be dense
+                            if (isLabel)
                             {
-                                scratchOutRow[j] = ReductionOperation::reduceWeightedOnlyNumeric(parcelData[j].data(), parcelWeights[j].data(), parcelData[j].size(), method);
+                                scratchOutRow[j] = myOutXML.getLabelsMap(labelDir).getMapLabelTable((*iter)[labelDir - 1])->getUnassignedLabelKey();
                             } else {
-                                scratchOutRow[j] = ReductionOperation::reduceWeighted(parcelData[j].data(), parcelWeights[j].data(), parcelData[j].size(), method);
+                                scratchOutRow[j] = emptyFillVal;
                             }
                         }
-                    } else {//labelDir can't be 0 (row) because we are parcellating along row, so row must be dense
-                        if (isLabel)
-                        {
-                            scratchOutRow[j] = myOutXML.getLabelsMap(labelDir).getMapLabelTable((*iter)[labelDir - 1])->getUnassignedLabelKey();
-                        } else {
-                            scratchOutRow[j] = emptyFillVal;
-                        }
+                    } catch (CaretException& e) {
+#pragma omp critical
+                        reduceError = e.whatString();
                     }
                 }
+                if (reduceError != "") throw AlgorithmException(reduceError);
                 myCiftiOut->setRow(scratchOutRow.data(), *iter);
             }
         } else {
@@ -636,21 +868,30 @@ namespace
                     vector<vector<float> >& parcelRef = parcelData[i];
                     if (count > 0 && (method != ReductionEnum::SAMPSTDEV || count > 1))
                     {
+                        AString reduceError;
+#pragma omp CARET_PARFOR schedule(dynamic)
                         for (int j = 0; j < numCols; ++j)
                         {
-                            CaretAssert((int64_t)parcelRef[j].size() == count);
-                            if (excludeLow > 0.0f && excludeHigh > 0.0f)
+                            try
                             {
-                                scratchOutRow[j] = ReductionOperation::reduceWeightedExcludeDev(parcelRef[j].data(), parcelWeights[i].data(), parcelRef[j].size(), method, excludeLow, excludeHigh);
-                            } else {
-                                if (onlyNumeric)
+                                CaretAssert((int64_t)parcelRef[j].size() == count);
+                                if (excludeLow > 0.0f && excludeHigh > 0.0f)
                                 {
-                                    scratchOutRow[j] = ReductionOperation::reduceWeightedOnlyNumeric(parcelRef[j].data(), parcelWeights[i].data(), parcelRef[j].size(), method);
+                                    scratchOutRow[j] = ReductionOperation::reduceWeightedExcludeDev(parcelRef[j].data(), parcelWeights[i].data(), parcelRef[j].size(), method, excludeLow, excludeHigh);
                                 } else {
-                                    scratchOutRow[j] = ReductionOperation::reduceWeighted(parcelRef[j].data(), parcelWeights[i].data(), parcelRef[j].size(), method);
+                                    if (onlyNumeric)
+                                    {
+                                        scratchOutRow[j] = ReductionOperation::reduceWeightedOnlyNumeric(parcelRef[j].data(), parcelWeights[i].data(), parcelRef[j].size(), method);
+                                    } else {
+                                        scratchOutRow[j] = ReductionOperation::reduceWeighted(parcelRef[j].data(), parcelWeights[i].data(), parcelRef[j].size(), method);
+                                    }
                                 }
+                            } catch (CaretException& e) {
+#pragma omp critical
+                                reduceError = e.whatString();
                             }
                         }
+                        if (reduceError != "") throw AlgorithmException(reduceError);
                     } else {
                         for (int j = 0; j < numCols; ++j)
                         {
@@ -22,6 +22,7 @@
 #include "AlgorithmException.h"
 #include "CaretAssert.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "CiftiFile.h"
 #include "MultiDimIterator.h"
 #include "ReductionOperation.h"
@@ -131,7 +132,7 @@ AlgorithmCiftiReduce::AlgorithmCiftiReduce(ProgressObject* myProgObj, const Cift
             CaretLogWarning("-cifti-reduce is being used for a length=1 reduction on file '" + ciftiIn->getFileName() + "'");
         }
         vector<vector<float> > scratchInRows(inDims[direction], vector<float>(inDims[0]));
-        vector<float> outRow(inDims[0]), reduceScratch(inDims[direction]);//reduction isn't along row, so out rows will be same length as in rows
+        vector<float> outRow(inDims[0]);//reduction isn't along row, so out rows will be same length as in rows
         vector<int64_t> otherDims = inDims;
         otherDims.erase(otherDims.begin() + direction);//direction isn't 0
         otherDims.erase(otherDims.begin());//remove row direction because getRow/setRow
@@ -144,19 +145,32 @@ AlgorithmCiftiReduce::AlgorithmCiftiReduce(ProgressObject* myProgObj, const Cift
                 indexvec[direction - 1] = i;
                 ciftiIn->getRow(scratchInRows[i].data(), indexvec);
             }
-            for (int64_t i = 0; i < inDims[0]; ++i)
+            AString reduceError;//ReductionOperation throws on bad input, which must not escape the parallel region
+#pragma omp CARET_PAR
             {
-                for (int64_t j = 0; j < inDims[direction]; ++j)
-                {//need reduction input in contiguous array
-                    reduceScratch[j] = scratchInRows[j][i];
-                }
-                if (onlyNumeric)
+                vector<float> reduceScratch(inDims[direction]);
+#pragma omp CARET_FOR schedule(static)
+                for (int64_t i = 0; i < inDims[0]; ++i)
                 {
-                    outRow[i] = ReductionOperation::reduceOnlyNumeric(reduceScratch.data(), inDims[direction], myReduce);
-                } else {
-                    outRow[i] = ReductionOperation::reduce(reduceScratch.data(), inDims[direction], myReduce);
+                    for (int64_t j = 0; j < inDims[direction]; ++j)
+                    {//need reduction input in contiguous array
+                        reduceScratch[j] = scratchInRows[j][i];
+                    }
+                    try
+                    {
+                        if (onlyNumeric)
+                        {
+                            outRow[i] = ReductionOperation::reduceOnlyNumeric(reduceScratch.data(), inDims[direction], myReduce);
+                        } else {
+                            outRow[i] = ReductionOperation::reduce(reduceScratch.data(), inDims[direction], myReduce);
+                        }
+                    } catch (CaretException& e) {
+#pragma omp critical
+                        reduceError = e.whatString();
+                    }
                 }
             }
+            if (reduceError != "") throw AlgorithmException(reduceError);
             indexvec[direction - 1] = 0;//only one element along reduce output direction
             ciftiOut->setRow(outRow.data(), indexvec);
         }
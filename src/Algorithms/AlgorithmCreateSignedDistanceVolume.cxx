@@ -32,12 +32,191 @@
 
 #include <algorithm>
 #include <cmath>
+#include <limits>
 #include <set>
 #include <vector>
 
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    //parallel fast sweeping on the same neighborhood graph that the dijkstra method uses
+    //each of the 8 sweep directions only uses the offsets that point backwards along it, so every voxel on a diagonal plane (i + j + k = constant, after flipping axes)
+    //depends only on earlier planes, and a whole plane can be updated in parallel
+    //sweeps are repeated until nothing changes, paths that have to turn around an obstacle just take more rounds
+    //like the dijkstra method, any offset can give a voxel a value, but a voxel only propagates its value further once it has been reached through a face offset
+    //(m_dist <= maxFaceDist) from a propagating voxel, so values don't leak through thin walls by jumping over them
+    void sweepApproximate(const int64_t dims[3], const int64_t boxMin[3], const int64_t boxMax[3], const vector<DistVoxOffset>& neighborhood, const float& maxFaceDist,
+                          const float& approxLim, const bool& negative, vector<float>& scratchFrame, vector<int>& volMarked)
+    {
+        const int64_t frameSize = dims[0] * dims[1] * dims[2];
+        const float unassigned = numeric_limits<float>::infinity();
+        const int validMark = (negative ? 16 : 2);
+        vector<float> sweepDist(frameSize, unassigned);//distance with the sign flipped for the negative side, so both signs can use min
+        vector<char> sweepState(frameSize, 0);//0 = can be updated, 1 = fixed source, 2 = fixed, but doesn't propagate, 3 = can be updated, and propagates (reached through a face offset)
+        const int64_t faceStride[3] = { 1, dims[0], dims[0] * dims[1] };
+#pragma omp CARET_PARFOR schedule(static)
+        for (int64_t i = 0; i < frameSize; ++i)
+        {
+            const int mark = volMarked[i];
+            if ((mark & 4) != 0)
+            {
+                const float value = (negative ? -scratchFrame[i] : scratchFrame[i]);
+                sweepState[i] = 2;
+                if ((mark & 1) != 0 && value > 0.0f)
+                {//exact value on this side of the surface, only start from voxels that have a face neighbor without an exact value, same as dijkstra
+                    const int64_t ijk[3] = { i % dims[0], (i / dims[0]) % dims[1], i / (dims[0] * dims[1]) };
+                    for (int axis = 0; axis < 3 && sweepState[i] != 1; ++axis)
+                    {
+                        if ((ijk[axis] > 0 && (volMarked[i - faceStride[axis]] & 1) == 0) || (ijk[axis] < dims[axis] - 1 && (volMarked[i + faceStride[axis]] & 1) == 0))
+                        {
+                            sweepState[i] = 1;
+                        }
+                    }
+                }
+                sweepDist[i] = value;
+            }
+        }
+        struct SweepOffset
+        {
+            int64_t m_offset[3];
+            float m_dist;
+            bool m_face;
+        };
+        vector<SweepOffset> sweepMasks[8];
+        for (int sweep = 0; sweep < 8; ++sweep)
+        {
+            for (size_t neigh = 0; neigh < neighborhood.size(); ++neigh)
+            {
+                bool upwind = true;
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    int dir = ((sweep >> axis) & 1) ? -1 : 1;
+                    if (neighborhood[neigh].m_offset[axis] * dir < 0) upwind = false;
+                }
+                if (upwind)
+                {//neighbor is at voxel minus offset, so it is on an earlier plane
+                    SweepOffset tempOffset;
+                    for (int axis = 0; axis < 3; ++axis) tempOffset.m_offset[axis] = neighborhood[neigh].m_offset[axis];
+                    tempOffset.m_dist = neighborhood[neigh].m_dist;
+                    tempOffset.m_face = (neighborhood[neigh].m_dist <= maxFaceDist);
+                    sweepMasks[sweep].push_back(tempOffset);
+                }
+            }
+        }
+        const int64_t boxDims[3] = { boxMax[0] - boxMin[0], boxMax[1] - boxMin[1], boxMax[2] - boxMin[2] };
+        if (boxDims[0] <= 0 || boxDims[1] <= 0 || boxDims[2] <= 0) return;
+        const int neighSize = (int)neighborhood.size();
+        vector<float> initDist(frameSize, unassigned);
+#pragma omp CARET_PARFOR schedule(static)
+        for (int64_t k = boxMin[2]; k < boxMax[2]; ++k)
+        {//dijkstra also gives one step from every exact voxel with a valid value, including ones on the other side of the surface, without them propagating further
+            for (int64_t j = boxMin[1]; j < boxMax[1]; ++j)
+            {
+                for (int64_t i = boxMin[0]; i < boxMax[0]; ++i)
+                {
+                    const int64_t index = i + dims[0] * (j + dims[1] * k);
+                    if (sweepState[index] != 0) continue;
+                    float best = unassigned;
+                    for (int neigh = 0; neigh < neighSize; ++neigh)
+                    {
+                        const int64_t ni = i - neighborhood[neigh].m_offset[0], nj = j - neighborhood[neigh].m_offset[1], nk = k - neighborhood[neigh].m_offset[2];
+                        if (ni < 0 || ni >= dims[0] || nj < 0 || nj >= dims[1] || nk < 0 || nk >= dims[2]) continue;
+                        const int64_t neighIndex = ni + dims[0] * (nj + dims[1] * nk);
+                        const int neighMark = volMarked[neighIndex];
+                        if ((neighMark & 1) == 0 || (neighMark & 4) == 0 || (neighMark & validMark) == 0) continue;
+                        const float tempf = sweepDist[neighIndex] + neighborhood[neigh].m_dist;
+                        if (tempf < best && abs(tempf) <= approxLim) best = tempf;
+                    }
+                    initDist[index] = best;
+                }
+            }
+        }
+#pragma omp CARET_PARFOR schedule(static)
+        for (int64_t i = 0; i < frameSize; ++i)
+        {
+            if (sweepState[i] == 0) sweepDist[i] = initDist[i];
+        }
+        const int64_t numPlanes = boxDims[0] + boxDims[1] + boxDims[2] - 2;
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+#pragma omp CARET_PAR
+            {
+                bool threadChanged = false;
+                for (int sweep = 0; sweep < 8; ++sweep)
+                {
+                    const vector<SweepOffset>& mask = sweepMasks[sweep];
+                    const int maskSize = (int)mask.size();
+                    for (int64_t plane = 0; plane < numPlanes; ++plane)
+                    {
+                        const int64_t kLow = max((int64_t)0, plane - (boxDims[0] - 1) - (boxDims[1] - 1)), kHigh = min(boxDims[2] - 1, plane);
+#pragma omp CARET_FOR schedule(static)
+                        for (int64_t kp = kLow; kp <= kHigh; ++kp)
+                        {
+                            const int64_t jLow = max((int64_t)0, plane - kp - (boxDims[0] - 1)), jHigh = min(boxDims[1] - 1, plane - kp);
+                            for (int64_t jp = jLow; jp <= jHigh; ++jp)
+                            {
+                                const int64_t ip = plane - kp - jp;
+                                int64_t ijk[3] = { ip, jp, kp };
+                                for (int axis = 0; axis < 3; ++axis)
+                                {//convert from position along sweep to voxel index
+                                    ijk[axis] = (((sweep >> axis) & 1) ? boxMax[axis] - 1 - ijk[axis] : boxMin[axis] + ijk[axis]);
+                                }
+                                const int64_t index = ijk[0] + dims[0] * (ijk[1] + dims[1] * ijk[2]);
+                                if (sweepState[index] == 1 || sweepState[index] == 2) continue;
+                                float best = sweepDist[index];
+                                bool faceReached = false;
+                                for (int neigh = 0; neigh < maskSize; ++neigh)
+                                {
+                                    const int64_t ni = ijk[0] - mask[neigh].m_offset[0], nj = ijk[1] - mask[neigh].m_offset[1], nk = ijk[2] - mask[neigh].m_offset[2];
+                                    if (ni < boxMin[0] || ni >= boxMax[0] || nj < boxMin[1] || nj >= boxMax[1] || nk < boxMin[2] || nk >= boxMax[2]) continue;
+                                    const int64_t neighIndex = ni + dims[0] * (nj + dims[1] * nk);
+                                    const char neighState = sweepState[neighIndex];
+                                    if (neighState != 1 && neighState != 3) continue;//only propagating voxels give values
+                                    if (mask[neigh].m_face) faceReached = true;
+                                    const float tempf = sweepDist[neighIndex] + mask[neigh].m_dist;
+                                    if (tempf < best && abs(tempf) <= approxLim)
+                                    {
+                                        best = tempf;
+                                    }
+                                }
+                                if (best < sweepDist[index])
+                                {
+                                    sweepDist[index] = best;
+                                    threadChanged = true;
+                                }
+                                if (faceReached && sweepState[index] == 0 && sweepDist[index] != unassigned)
+                                {
+                                    sweepState[index] = 3;
+                                    threadChanged = true;
+                                }
+                            }
+                        }//implicit barrier, next plane needs this one to be finished
+                    }
+                }
+                if (threadChanged)
+                {
+#pragma omp critical
+                    changed = true;
+                }
+            }
+        }
+#pragma omp CARET_PARFOR schedule(static)
+        for (int64_t i = 0; i < frameSize; ++i)
+        {
+            if ((sweepState[i] == 0 || sweepState[i] == 3) && sweepDist[i] != unassigned)
+            {
+                scratchFrame[i] = (negative ? -sweepDist[i] : sweepDist[i]);
+                volMarked[i] |= validMark;
+                if (sweepState[i] == 3) volMarked[i] |= 4;//frozen, voxels that never propagated keep their value without being frozen, like dijkstra
+            }
+        }
+    }
+}
+
 AString AlgorithmCreateSignedDistanceVolume::getCommandSwitch()
 {
     return "-create-signed-distance-volume";
@@ -75,10 +254,15 @@ OperationParameters* AlgorithmCreateSignedDistanceVolume::getParameters()
     OptionalParameter* windingMethodOpt = ret->createOptionalParameter(8, "-winding", "winding method for point inside surface test");
     windingMethodOpt->addStringParameter(1, "method", "name of the method (default EVEN_ODD)");
     
+    ret->createOptionalParameter(10, "-approx-sweep", "compute the approximate distances with parallel sweeping instead of dijkstra's method");
+    
     ret->setHelpText(
         AString("Computes the signed distance function of the surface.  Exact distance is calculated by finding the closest point on any surface triangle ") +
         "to the center of the voxel.  Approximate distance is calculated starting with these distances, using dijkstra's method with a neighborhood of voxels.  " +
-        "Specifying too small of an exact distance may produce unexpected results.  Valid specifiers for winding methods are as follows:\n\n" +
+        "Specifying too small of an exact distance may produce unexpected results.  " +
+        "The -approx-sweep option computes the approximate distances over the same neighborhood by repeated sweeps through the volume, which can use multiple threads, " +
+        "but may differ slightly from dijkstra's method where the region is only connected diagonally.  " +
+        "Valid specifiers for winding methods are as follows:\n\n" +
         "EVEN_ODD (default)\nNEGATIVE\nNONZERO\nNORMALS\n\nThe NORMALS method uses the normals of triangles and edges, or the closest triangle hit by a ray from the point.  " +
         "This method may be slightly faster, but is only reliable for a closed surface that does not cross through itself.  All other methods count entry (positive) and " +
         "exit (negative) crossings of a vertical ray from the point, then counts as inside if the total is odd, negative, or nonzero, respectively."
@@ -150,11 +334,13 @@ void AlgorithmCreateSignedDistanceVolume::useParameters(OperationParameters* myP
     {
         myRoiOut = roiOutOpt->getOutputVolume(1);
     }
-    AlgorithmCreateSignedDistanceVolume(myProgObj, mySurf, myVolOut, myRoiOut, fillValue, exactLim, approxLim, approxNeighborhood, myWinding);
+    bool approxSweep = myParams->getOptionalParameter(10)->m_present;
+    AlgorithmCreateSignedDistanceVolume(myProgObj, mySurf, myVolOut, myRoiOut, fillValue, exactLim, approxLim, approxNeighborhood, myWinding, approxSweep);
 }
 
 AlgorithmCreateSignedDistanceVolume::AlgorithmCreateSignedDistanceVolume(ProgressObject* myProgObj, const SurfaceFile* mySurf, VolumeFile* myVolOut, VolumeFile* myRoiOut, const float& fillValue,
-                                                                         const float& exactLim, const float& approxLim, const int& approxNeighborhood, const SignedDistanceHelper::WindingLogic& myWinding) : AbstractAlgorithm(myProgObj)
+                                                                         const float& exactLim, const float& approxLim, const int& approxNeighborhood, const SignedDistanceHelper::WindingLogic& myWinding,
+                                                                         const bool& approxSweep) : AbstractAlgorithm(myProgObj)
 {
     if (exactLim <= 0.0f)
     {
@@ -350,22 +536,23 @@ AlgorithmCreateSignedDistanceVolume::AlgorithmCreateSignedDistanceVolume(Progres
         }
         myProgress.reportProgress(markweight);
         myProgress.setTask("computing exact distances");
-#pragma omp CARET_PAR
         {
-            int64_t numExact = (int64_t)exactVoxelList.size();
+            int64_t numExact = (int64_t)exactVoxelList.size() / 3;
+            vector<float> exactCoords(numExact * 3), exactDists(numExact);
+            vector<char> exactValid(numExact);
+#pragma omp CARET_PARFOR schedule(static)
+            for (int64_t i = 0; i < numExact; ++i)
+            {
+                myVolOut->indexToSpace(exactVoxelList.data() + i * 3, exactCoords.data() + i * 3);
+            }
             CaretPointer<SignedDistanceHelper> myDist = mySurf->getSignedDistanceHelper();
-            Vector3D thisCoord;
-#pragma omp CARET_FOR schedule(dynamic)
-            for (int64_t i = 0; i < numExact; i += 3)
+            myDist->distLimitedBatch(exactCoords.data(), numExact, outThresh, exactDists.data(), exactValid.data(), myWinding);
+            for (int64_t i = 0; i < numExact; ++i)
             {
-                const int64_t* thisVox = exactVoxelList.data() + i;
-                myVolOut->indexToSpace(thisVox, thisCoord);
-                bool valid = false;
-                float thisDist = myDist->distLimited(thisCoord, outThresh, valid, myWinding);
-                if (valid)
+                if (exactValid[i] != 0)
                 {
-                    int64_t tempindex = myVolOut->getIndex(thisVox);
-                    scratchFrame[tempindex] = thisDist;
+                    int64_t tempindex = myVolOut->getIndex(exactVoxelList.data() + i * 3);
+                    scratchFrame[tempindex] = exactDists[i];
                     volMarked[tempindex] |= 22;//set marked to have valid value (positive and negative), and frozen
                 }
             }
@@ -467,170 +654,194 @@ AlgorithmCreateSignedDistanceVolume::AlgorithmCreateSignedDistanceVolume(Progres
             }
         }//positives
         float maxFaceDist = max(max(ivec.length(), jvec.length()), kvec.length()) * 1.01f;//add a fudge factor to make sure rounding error doesn't remove a cardinal direction
-        int neighSize = neighborhood.size();//this is provably correct for volumes where there is no diagonal shorter than the longest index vector, so we test this explicitly just in case
-        CaretMinHeap<VoxelIndex, float> posHeap;
-        CaretArray<int64_t> heapIndexes(frameSize);
-        int numExact = (int)exactVoxelList.size();
-        for (int64_t i = 0; i < numExact; i += 3)
+        if (approxSweep)
         {
-            int64_t* thisVoxel = exactVoxelList.data() + i;
-            int64_t thisindex = myVolOut->getIndex(thisVoxel);
-            if ((volMarked[thisindex] & 2) != 0) //using fixup method, there are voxels marked as "exact signed distance run" that don't have a value, because it was beyond both limits
+            int64_t boxMin[3] = { myDims[0], myDims[1], myDims[2] }, boxMax[3] = { 0, 0, 0 };//only sweep the part of the volume that approxLim can reach
+            for (int64_t i = 0; i < (int64_t)exactVoxelList.size(); i += 3)
             {
-                float tempf = scratchFrame[thisindex];
-                for (int neigh = 0; neigh < neighSize; ++neigh)
+                if ((volMarked[myVolOut->getIndex(exactVoxelList.data() + i)] & 4) == 0) continue;
+                for (int axis = 0; axis < 3; ++axis)
                 {
-                    int64_t tempijk[3];
-                    tempijk[0] = thisVoxel[0] + neighborhood[neigh].m_offset[0];
-                    tempijk[1] = thisVoxel[1] + neighborhood[neigh].m_offset[1];
-                    tempijk[2] = thisVoxel[2] + neighborhood[neigh].m_offset[2];
-                    if (myVolOut->indexValid(tempijk))
-                    {
-                        int64_t tempindex = myVolOut->getIndex(tempijk);
-                        float tempf2 = tempf + neighborhood[neigh].m_dist;
-                        if (abs(tempf2) <= approxLim && (volMarked[tempindex] & 4) == 0 && ((volMarked[tempindex] & 2) == 0 || tempf2 < scratchFrame[tempindex]))
-                        {//within approxlim (so no stragglers outside limit), not frozen, and either no value or worse value
-                            volMarked[tempindex] |= 2;
-                            scratchFrame[tempindex] = tempf2;
-                        }
-                    }
+                    boxMin[axis] = min(boxMin[axis], exactVoxelList[i + axis]);
+                    boxMax[axis] = max(boxMax[axis], exactVoxelList[i + axis] + 1);
                 }
-                if (tempf > 0.0f)
-                {//start only from positive values
-                    //check face neighbors for being unmarked
-                    for (int neigh = 0; neigh < 18; neigh += 3)
+            }
+            const float planeSpacing[3] = { iOrthHat.dot(ivec), jOrthHat.dot(jvec), kOrthHat.dot(kvec) };
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                int64_t margin = (int64_t)ceil(approxLim / planeSpacing[axis]) + 1;
+                boxMin[axis] = max((int64_t)0, boxMin[axis] - margin);
+                boxMax[axis] = min(myDims[axis], boxMax[axis] + margin);
+            }
+            sweepApproximate(myDims.data(), boxMin, boxMax, neighborhood, maxFaceDist, approxLim, false, scratchFrame, volMarked);
+            myProgress.reportProgress(markweight + exactweight + approxweight * 0.5f);
+            sweepApproximate(myDims.data(), boxMin, boxMax, neighborhood, maxFaceDist, approxLim, true, scratchFrame, volMarked);
+        } else {
+            int neighSize = neighborhood.size();//this is provably correct for volumes where there is no diagonal shorter than the longest index vector, so we test this explicitly just in case
+            CaretMinHeap<VoxelIndex, float> posHeap;
+            CaretArray<int64_t> heapIndexes(frameSize);
+            int numExact = (int)exactVoxelList.size();
+            for (int64_t i = 0; i < numExact; i += 3)
+            {
+                int64_t* thisVoxel = exactVoxelList.data() + i;
+                int64_t thisindex = myVolOut->getIndex(thisVoxel);
+                if ((volMarked[thisindex] & 2) != 0) //using fixup method, there are voxels marked as "exact signed distance run" that don't have a value, because it was beyond both limits
+                {
+                    float tempf = scratchFrame[thisindex];
+                    for (int neigh = 0; neigh < neighSize; ++neigh)
                     {
                         int64_t tempijk[3];
-                        tempijk[0] = thisVoxel[0] + faceNeigh[neigh];
-                        tempijk[1] = thisVoxel[1] + faceNeigh[neigh + 1];
-                        tempijk[2] = thisVoxel[2] + faceNeigh[neigh + 2];
+                        tempijk[0] = thisVoxel[0] + neighborhood[neigh].m_offset[0];
+                        tempijk[1] = thisVoxel[1] + neighborhood[neigh].m_offset[1];
+                        tempijk[2] = thisVoxel[2] + neighborhood[neigh].m_offset[2];
                         if (myVolOut->indexValid(tempijk))
                         {
-                            int64_t tempIndex = myVolOut->getIndex(tempijk);
-                            if ((volMarked[tempIndex] & 1) == 0)
-                            {//only add this to the heap if it has unmarked face neighbors
-                                posHeap.push(VoxelIndex(thisVoxel), tempf);//don't need to store the index to change the key, value is frozen
-                                break;
+                            int64_t tempindex = myVolOut->getIndex(tempijk);
+                            float tempf2 = tempf + neighborhood[neigh].m_dist;
+                            if (abs(tempf2) <= approxLim && (volMarked[tempindex] & 4) == 0 && ((volMarked[tempindex] & 2) == 0 || tempf2 < scratchFrame[tempindex]))
+                            {//within approxlim (so no stragglers outside limit), not frozen, and either no value or worse value
+                                volMarked[tempindex] |= 2;
+                                scratchFrame[tempindex] = tempf2;
                             }
                         }
                     }
-                }
-            }
-        }//initialization done, now (sort of) dijkstras - in order to not go to the "inside" (and to run faster), it only adds things that are FACE neighbors to the heap for cubic voxels
-        while (!posHeap.isEmpty())
-        {
-            float curDist;
-            VoxelIndex curVoxel = posHeap.pop(&curDist);
-            int64_t curIndex = myVolOut->getIndex(curVoxel.m_ijk);
-            volMarked[curIndex] |= 4;//frozen
-            volMarked[curIndex] &= ~8;//no longer in the heap, don't try to modify by the index it used to have
-            for (int neigh = 0; neigh < neighSize; ++neigh)
-            {
-                int64_t tempijk[3];
-                tempijk[0] = curVoxel.m_ijk[0] + neighborhood[neigh].m_offset[0];
-                tempijk[1] = curVoxel.m_ijk[1] + neighborhood[neigh].m_offset[1];
-                tempijk[2] = curVoxel.m_ijk[2] + neighborhood[neigh].m_offset[2];
-                if (myVolOut->indexValid(tempijk))
-                {
-                    float tempf = curDist + neighborhood[neigh].m_dist;
-                    int tempindex = myVolOut->getIndex(tempijk);
-                    int& tempmark = volMarked[tempindex];
-                    if (abs(tempf) <= approxLim && (tempmark & 4) == 0 && ((tempmark & 2) == 0 || scratchFrame[tempindex] > tempf))
-                    {//within range, not frozen, no value or current value is worse
-                        tempmark |= 2;//valid value
-                        scratchFrame[tempindex] = tempf;
-                        if ((tempmark & 8) != 0)//if it is already in the heap, we must update its key (log time worst case, but changes should generally be small)
+                    if (tempf > 0.0f)
+                    {//start only from positive values
+                        //check face neighbors for being unmarked
+                        for (int neigh = 0; neigh < 18; neigh += 3)
                         {
-                            posHeap.changekey(heapIndexes[tempindex], tempf);
+                            int64_t tempijk[3];
+                            tempijk[0] = thisVoxel[0] + faceNeigh[neigh];
+                            tempijk[1] = thisVoxel[1] + faceNeigh[neigh + 1];
+                            tempijk[2] = thisVoxel[2] + faceNeigh[neigh + 2];
+                            if (myVolOut->indexValid(tempijk))
+                            {
+                                int64_t tempIndex = myVolOut->getIndex(tempijk);
+                                if ((volMarked[tempIndex] & 1) == 0)
+                                {//only add this to the heap if it has unmarked face neighbors
+                                    posHeap.push(VoxelIndex(thisVoxel), tempf);//don't need to store the index to change the key, value is frozen
+                                    break;
+                                }
+                            }
                         }
                     }
-                    if ((tempmark & 12) == 0 && (tempmark & 2) != 0 && neighborhood[neigh].m_dist <= maxFaceDist)
-                    {//this neatly handles both face neighbors and any other needed neighbors to maintain dijkstra correctness under extreme scenarios
-                        heapIndexes[tempindex] = posHeap.push(VoxelIndex(tempijk), scratchFrame[tempindex]);
-                        tempmark |= 8;//has a heap index
-                    }
                 }
-            }
-        }//negatives
-        myProgress.reportProgress(markweight + exactweight + approxweight * 0.5f);
-        CaretMaxHeap<VoxelIndex, float> negHeap;
-        for (int64_t i = 0; i < numExact; i += 3)
-        {
-            int64_t* thisVoxel = exactVoxelList.data() + i;
-            int64_t thisindex = myVolOut->getIndex(thisVoxel);
-            if ((volMarked[thisindex] & 16) != 0) //using fixup method, there are voxels marked as "exact signed distance run" that don't have a valid value, because it was beyond both limits
+            }//initialization done, now (sort of) dijkstras - in order to not go to the "inside" (and to run faster), it only adds things that are FACE neighbors to the heap for cubic voxels
+            while (!posHeap.isEmpty())
             {
-                float tempf = scratchFrame[thisindex];
+                float curDist;
+                VoxelIndex curVoxel = posHeap.pop(&curDist);
+                int64_t curIndex = myVolOut->getIndex(curVoxel.m_ijk);
+                volMarked[curIndex] |= 4;//frozen
+                volMarked[curIndex] &= ~8;//no longer in the heap, don't try to modify by the index it used to have
                 for (int neigh = 0; neigh < neighSize; ++neigh)
                 {
                     int64_t tempijk[3];
-                    tempijk[0] = thisVoxel[0] + neighborhood[neigh].m_offset[0];
-                    tempijk[1] = thisVoxel[1] + neighborhood[neigh].m_offset[1];
-                    tempijk[2] = thisVoxel[2] + neighborhood[neigh].m_offset[2];
+                    tempijk[0] = curVoxel.m_ijk[0] + neighborhood[neigh].m_offset[0];
+                    tempijk[1] = curVoxel.m_ijk[1] + neighborhood[neigh].m_offset[1];
+                    tempijk[2] = curVoxel.m_ijk[2] + neighborhood[neigh].m_offset[2];
                     if (myVolOut->indexValid(tempijk))
                     {
-                        int64_t tempindex = myVolOut->getIndex(tempijk);
-                        float tempf2 = tempf - neighborhood[neigh].m_dist;
-                        if (abs(tempf2) <= approxLim && (volMarked[tempindex] & 4) == 0 && ((volMarked[tempindex] & 16) == 0 || tempf2 > scratchFrame[tempindex]))
-                        {//within approxlim (so no stragglers outside limit), not frozen, and either no value or worse value
-                            volMarked[tempindex] |= 16;
-                            scratchFrame[tempindex] = tempf2;
+                        float tempf = curDist + neighborhood[neigh].m_dist;
+                        int tempindex = myVolOut->getIndex(tempijk);
+                        int& tempmark = volMarked[tempindex];
+                        if (abs(tempf) <= approxLim && (tempmark & 4) == 0 && ((tempmark & 2) == 0 || scratchFrame[tempindex] > tempf))
+                        {//within range, not frozen, no value or current value is worse
+                            tempmark |= 2;//valid value
+                            scratchFrame[tempindex] = tempf;
+                            if ((tempmark & 8) != 0)//if it is already in the heap, we must update its key (log time worst case, but changes should generally be small)
+                            {
+                                posHeap.changekey(heapIndexes[tempindex], tempf);
+                            }
+                        }
+                        if ((tempmark & 12) == 0 && (tempmark & 2) != 0 && neighborhood[neigh].m_dist <= maxFaceDist)
+                        {//this neatly handles both face neighbors and any other needed neighbors to maintain dijkstra correctness under extreme scenarios
+                            heapIndexes[tempindex] = posHeap.push(VoxelIndex(tempijk), scratchFrame[tempindex]);
+                            tempmark |= 8;//has a heap index
                         }
                     }
                 }
-                if (tempf < 0.0f)
-                {//start only from negative values
-                    //check face neighbors for being unmarked
-                    for (int neigh = 0; neigh < 18; neigh += 3)
+            }//negatives
+            myProgress.reportProgress(markweight + exactweight + approxweight * 0.5f);
+            CaretMaxHeap<VoxelIndex, float> negHeap;
+            for (int64_t i = 0; i < numExact; i += 3)
+            {
+                int64_t* thisVoxel = exactVoxelList.data() + i;
+                int64_t thisindex = myVolOut->getIndex(thisVoxel);
+                if ((volMarked[thisindex] & 16) != 0) //using fixup method, there are voxels marked as "exact signed distance run" that don't have a valid value, because it was beyond both limits
+                {
+                    float tempf = scratchFrame[thisindex];
+                    for (int neigh = 0; neigh < neighSize; ++neigh)
                     {
                         int64_t tempijk[3];
-                        tempijk[0] = thisVoxel[0] + faceNeigh[neigh];
-                        tempijk[1] = thisVoxel[1] + faceNeigh[neigh + 1];
-                        tempijk[2] = thisVoxel[2] + faceNeigh[neigh + 2];
+                        tempijk[0] = thisVoxel[0] + neighborhood[neigh].m_offset[0];
+                        tempijk[1] = thisVoxel[1] + neighborhood[neigh].m_offset[1];
+                        tempijk[2] = thisVoxel[2] + neighborhood[neigh].m_offset[2];
                         if (myVolOut->indexValid(tempijk))
                         {
-                            int64_t tempIndex = myVolOut->getIndex(tempijk);
-                            if ((volMarked[tempIndex] & 1) == 0)
-                            {//only add this to the heap if it has unmarked face neighbors
-                                negHeap.push(VoxelIndex(thisVoxel), tempf);//don't need to store the index to change the key, value is frozen
-                                break;
+                            int64_t tempindex = myVolOut->getIndex(tempijk);
+                            float tempf2 = tempf - neighborhood[neigh].m_dist;
+                            if (abs(tempf2) <= approxLim && (volMarked[tempindex] & 4) == 0 && ((volMarked[tempindex] & 16) == 0 || tempf2 > scratchFrame[tempindex]))
+                            {//within approxlim (so no stragglers outside limit), not frozen, and either no value or worse value
+                                volMarked[tempindex] |= 16;
+                                scratchFrame[tempindex] = tempf2;
+                            }
+                        }
+                    }
+                    if (tempf < 0.0f)
+                    {//start only from negative values
+                        //check face neighbors for being unmarked
+                        for (int neigh = 0; neigh < 18; neigh += 3)
+                        {
+                            int64_t tempijk[3];
+                            tempijk[0] = thisVoxel[0] + faceNeigh[neigh];
+                            tempijk[1] = thisVoxel[1] + faceNeigh[neigh + 1];
+                            tempijk[2] = thisVoxel[2] + faceNeigh[neigh + 2];
+                            if (myVolOut->indexValid(tempijk))
+                            {
+                                int64_t tempIndex = myVolOut->getIndex(tempijk);
+                                if ((volMarked[tempIndex] & 1) == 0)
+                                {//only add this to the heap if it has unmarked face neighbors
+                                    negHeap.push(VoxelIndex(thisVoxel), tempf);//don't need to store the index to change the key, value is frozen
+                                    break;
+                                }
                             }
                         }
                     }
                 }
             }
-        }
-        while (!negHeap.isEmpty())
-        {
-            float curDist;
-            VoxelIndex curVoxel = negHeap.pop(&curDist);
-            int64_t curIndex = myVolOut->getIndex(curVoxel.m_ijk);
-            volMarked[curIndex] |= 4;//frozen
-            volMarked[curIndex] &= ~8;//no longer in the heap, don't try to modify by the index it used to have
-            for (int neigh = 0; neigh < neighSize; ++neigh)
+            while (!negHeap.isEmpty())
             {
-                int64_t tempijk[3];
-                tempijk[0] = curVoxel.m_ijk[0] + neighborhood[neigh].m_offset[0];
-                tempijk[1] = curVoxel.m_ijk[1] + neighborhood[neigh].m_offset[1];
-                tempijk[2] = curVoxel.m_ijk[2] + neighborhood[neigh].m_offset[2];
-                if (myVolOut->indexValid(tempijk))
+                float curDist;
+                VoxelIndex curVoxel = negHeap.pop(&curDist);
+                int64_t curIndex = myVolOut->getIndex(curVoxel.m_ijk);
+                volMarked[curIndex] |= 4;//frozen
+                volMarked[curIndex] &= ~8;//no longer in the heap, don't try to modify by the index it used to have
+                for (int neigh = 0; neigh < neighSize; ++neigh)
                 {
-                    float tempf = curDist - neighborhood[neigh].m_dist;
-                    int tempindex = myVolOut->getIndex(tempijk);
-                    int& tempmark = volMarked[tempindex];
-                    if (abs(tempf) <= approxLim && (tempmark & 4) == 0 && ((tempmark & 16) == 0 || scratchFrame[tempindex] < tempf))
-                    {//within range, not frozen, no value or current value is worse
-                        tempmark |= 16;//valid value
-                        scratchFrame[tempindex] = tempf;
-                        if ((tempmark & 8) != 0)//if it is already in the heap, we must update its key (log time worst case, but changes should generally be small)
-                        {
-                            negHeap.changekey(heapIndexes[tempindex], tempf);
+                    int64_t tempijk[3];
+                    tempijk[0] = curVoxel.m_ijk[0] + neighborhood[neigh].m_offset[0];
+                    tempijk[1] = curVoxel.m_ijk[1] + neighborhood[neigh].m_offset[1];
+                    tempijk[2] = curVoxel.m_ijk[2] + neighborhood[neigh].m_offset[2];
+                    if (myVolOut->indexValid(tempijk))
+                    {
+                        float tempf = curDist - neighborhood[neigh].m_dist;
+                        int tempindex = myVolOut->getIndex(tempijk);
+                        int& tempmark = volMarked[tempindex];
+                        if (abs(tempf) <= approxLim && (tempmark & 4) == 0 && ((tempmark & 16) == 0 || scratchFrame[tempindex] < tempf))
+                        {//within range, not frozen, no value or current value is worse
+                            tempmark |= 16;//valid value
+                            scratchFrame[tempindex] = tempf;
+                            if ((tempmark & 8) != 0)//if it is already in the heap, we must update its key (log time worst case, but changes should generally be small)
+                            {
+                                negHeap.changekey(heapIndexes[tempindex], tempf);
+                            }
+                        }
+                        if ((tempmark & 12) == 0 && (tempmark & 16) != 0 && neighborhood[neigh].m_dist <= maxFaceDist)
+                        {//this neatly handles both face neighbors and any other needed neighbors to maintain dijkstra correctness under extreme scenarios
+                            heapIndexes[tempindex] = negHeap.push(VoxelIndex(tempijk), scratchFrame[tempindex]);
+                            tempmark |= 8;//has a heap index
                         }
-                    }
-                    if ((tempmark & 12) == 0 && (tempmark & 16) != 0 && neighborhood[neigh].m_dist <= maxFaceDist)
-                    {//this neatly handles both face neighbors and any other needed neighbors to maintain dijkstra correctness under extreme scenarios
-                        heapIndexes[tempindex] = negHeap.push(VoxelIndex(tempijk), scratchFrame[tempindex]);
-                        tempmark |= 8;//has a heap index
                     }
                 }
             }
@@ -378,7 +378,7 @@ void AlgorithmMetricDilate::processColumn(float* colScratch, const float* myInpu
                 int closestNode = myGeoHelp->getClosestNodeInRoi(i, charRoi.data(), distance, closestDist);
                 if (closestNode == -1)//check neighbors, to ensure we dilate by at least one node everywhere
                 {
-                    const vector<int32_t>& nodeList = myTopoHelp->getNodeNeighbors(i);
+                    const TopologyIndexList nodeList = myTopoHelp->getNodeNeighbors(i);
                     vector<float> distList;
                     myGeoHelp->getGeoToTheseNodes(i, nodeList, distList);//ok, its a little silly to do this
                     const int numInRange = (int)nodeList.size();
@@ -596,7 +596,7 @@ void AlgorithmMetricDilate::precomputeStencils(vector<pair<int, StencilElem> >&
                 int closestNode = myGeoHelp->getClosestNodeInRoi(i, charRoi.data(), distance, closestDist);
                 if (closestNode == -1)//check neighbors, to ensure we dilate by at least one node everywhere
                 {
-                    const vector<int32_t>& nodeList = myTopoHelp->getNodeNeighbors(i);
+                    const TopologyIndexList nodeList = myTopoHelp->getNodeNeighbors(i);
                     vector<float> distList;
                     myGeoHelp->getGeoToTheseNodes(i, nodeList, distList);//ok, its a little silly to do this
                     const int numInRange = (int)nodeList.size();
@@ -711,7 +711,7 @@ void AlgorithmMetricDilate::precomputeNearest(vector<pair<int, int> >& myNearest
                 int closestNode = myGeoHelp->getClosestNodeInRoi(i, charRoi.data(), distance, closestDist);
                 if (closestNode == -1)//check neighbors, to ensure we dilate by at least one node everywhere
                 {
-                    const vector<int32_t>& nodeList = myTopoHelp->getNodeNeighbors(i);
+                    const TopologyIndexList nodeList = myTopoHelp->getNodeNeighbors(i);
                     vector<float> distList;
                     myGeoHelp->getGeoToTheseNodes(i, nodeList, distList);//ok, its a little silly to do this
                     const int numInRange = (int)nodeList.size();
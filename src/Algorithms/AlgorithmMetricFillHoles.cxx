@@ -115,7 +115,7 @@ AlgorithmMetricFillHoles::AlgorithmMetricFillHoles(ProgressObject* myProgObj, co
                 {
                     int curnode = mystack.back();
                     mystack.pop_back();
-                    const vector<int32_t>& neighbors = myHelp->getNodeNeighbors(curnode);
+                    const TopologyIndexList neighbors = myHelp->getNodeNeighbors(curnode);
                     int numNeigh = (int)neighbors.size();
                     for (int j = 0; j < numNeigh; ++j)
                     {
@@ -22,6 +22,8 @@
 #include "AlgorithmException.h"
 
 #include "CaretLogger.h"
+#include "CaretOMP.h"
+#include "ConnectedComponentHelper.h"
 #include "GeodesicHelper.h"
 #include "MetricFile.h"
 #include "SurfaceFile.h"
@@ -153,12 +155,12 @@ namespace
         double area;
     };
     
-    void processColumn(const float* data, const float* roiData, const float* nodeAreas, TopologyHelper* myTopoHelp, GeodesicHelper* myGeoHelp,
-                       const float& threshVal, const float& minArea, const bool& lessThan, const float& areaRatio, const float& distanceCutoff,
-                       float* outData, int& markVal)
-    {
+    void findColumnClusters(const float* data, const float* roiData, const float* nodeAreas, TopologyHelper* myTopoHelp, GeodesicHelper* myGeoHelp,
+                            const float& threshVal, const float& minArea, const bool& lessThan, const float& areaRatio, const float& distanceCutoff,
+                            vector<Cluster>& clusters)
+    {//doesn't modify anything shared, so columns can be done in parallel (as long as each thread has its own geodesic helper)
         int numNodes = myTopoHelp->getNumberOfNodes();
-        vector<int> marked(numNodes, 0);
+        vector<char> marked(numNodes, 0);
         if (lessThan)
         {
             for (int i = 0; i < numNodes; ++i)
@@ -177,41 +179,30 @@ namespace
                 }
             }
         }
-        vector<Cluster> clusters;
+        vector<int64_t> labels;
+        int64_t numComponents = ConnectedComponentHelper::labelSurface(myTopoHelp, marked.data(), labels);
+        vector<vector<int32_t> > components;
+        ConnectedComponentHelper::getComponentMembers(labels, numComponents, components);
+        clusters.clear();
         float biggestSize = 0.0f;
         int biggestCluster = -1;
-        for (int i = 0; i < numNodes; ++i)
-        {
-            if (marked[i])
+        for (int64_t i = 0; i < numComponents; ++i)
+        {//components are in order of lowest vertex, same as the previous flood fill order
+            Cluster newCluster;
+            newCluster.members.swap(components[i]);
+            int numMembers = (int)newCluster.members.size();
+            for (int j = 0; j < numMembers; ++j)
             {
-                Cluster newCluster;
-                newCluster.members.push_back(i);
-                marked[i] = 0;//unmark it when added to list to prevent multiples
-                for (int index = 0; index < (int)newCluster.members.size(); ++index)//NOTE: vector grows inside loop
-                {
-                    int node = newCluster.members[index];//keep list around so we can put it into the output immediately if it is large enough
-                    newCluster.area += nodeAreas[node];
-                    const vector<int32_t>& neighbors = myTopoHelp->getNodeNeighbors(node);
-                    int numNeigh = (int)neighbors.size();
-                    for (int n = 0; n < numNeigh; ++n)
-                    {
-                        const int32_t& neighbor = neighbors[n];
-                        if (marked[neighbor])
-                        {
-                            newCluster.members.push_back(neighbor);
-                            marked[neighbor] = 0;
-                        }
-                    }
-                }
-                if (newCluster.area > minArea)
+                newCluster.area += nodeAreas[newCluster.members[j]];
+            }
+            if (newCluster.area > minArea)
+            {
+                if (newCluster.area > biggestSize)
                 {
-                    if (newCluster.area > biggestSize)
-                    {
-                        biggestSize = newCluster.area;
-                        biggestCluster = (int)clusters.size();
-                    }
-                    clusters.push_back(newCluster);
+                    biggestSize = newCluster.area;
+                    biggestCluster = (int)clusters.size();
                 }
+                clusters.push_back(newCluster);
             }
         }
         vector<int32_t> pathScratch;
@@ -249,6 +240,10 @@ namespace
                 }
             }
         }
+    }
+    
+    void markClusters(const vector<Cluster>& clusters, float* outData, int& markVal)
+    {
         for (size_t i = 0; i < clusters.size(); ++i)
         {
             if (markVal == 0)
@@ -304,39 +299,61 @@ AlgorithmMetricFindClusters::AlgorithmMetricFindClusters(ProgressObject* myProgO
         nodeAreas = myAreas->getValuePointerForColumn(0);
     }
     CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper();
-    CaretPointer<GeodesicHelper> myGeoHelp;
     CaretPointer<GeodesicHelperBase> myGeoBase;
-    if (distanceCutoff > 0.0f)//geodesic is only needed for distance cutoff
+    if (distanceCutoff > 0.0f && myAreas != NULL)//corrected areas need their own geodesic base, each thread makes a helper from it
     {
-        if (myAreas == NULL)
-        {
-            myGeoHelp = mySurf->getGeodesicHelper();
-        } else {
-            myGeoBase.grabNew(new GeodesicHelperBase(mySurf, myAreas->getValuePointerForColumn(0)));
-            myGeoHelp.grabNew(new GeodesicHelper(myGeoBase));
-        }
+        myGeoBase.grabNew(new GeodesicHelperBase(mySurf, myAreas->getValuePointerForColumn(0)));
     }
-    vector<int> toSearch;
     int markVal = startVal;//give each cluster a different value, including across maps
     if (columnNum == -1)
     {
         myMetricOut->setNumberOfNodesAndColumns(numNodes, numCols);
         myMetricOut->setStructure(mySurf->getStructure());
-        for (int c = 0; c < numCols; ++c)
+        vector<vector<Cluster> > columnClusters(numCols);
+#pragma omp CARET_PAR
         {
+            CaretPointer<GeodesicHelper> myGeoHelp;
+            if (distanceCutoff > 0.0f)//geodesic is only needed for distance cutoff
+            {
+                if (myAreas == NULL)
+                {
+                    myGeoHelp = mySurf->getGeodesicHelper();
+                } else {
+                    myGeoHelp.grabNew(new GeodesicHelper(myGeoBase));
+                }
+            }
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int c = 0; c < numCols; ++c)
+            {
+                findColumnClusters(myMetric->getValuePointerForColumn(c), roiData, nodeAreas, myTopoHelp, myGeoHelp, threshVal, minArea, lessThan, areaRatio, distanceCutoff, columnClusters[c]);
+            }
+        }
+        for (int c = 0; c < numCols; ++c)
+        {//marking must be done in column order, so the cluster values stay the same as doing it serially
             myMetricOut->setColumnName(c, myMetric->getColumnName(c));
             vector<float> outData(numNodes, 0.0f);
-            const float* data = myMetric->getValuePointerForColumn(c);
-            processColumn(data, roiData, nodeAreas, myTopoHelp, myGeoHelp, threshVal, minArea, lessThan, areaRatio, distanceCutoff, outData.data(), markVal);
+            markClusters(columnClusters[c], outData.data(), markVal);
             myMetricOut->setValuesForColumn(c, outData.data());
+            vector<Cluster>().swap(columnClusters[c]);
         }
     } else {
         myMetricOut->setNumberOfNodesAndColumns(numNodes, 1);
         myMetricOut->setStructure(mySurf->getStructure());
         myMetricOut->setColumnName(0, myMetric->getColumnName(columnNum));
+        CaretPointer<GeodesicHelper> myGeoHelp;
+        if (distanceCutoff > 0.0f)
+        {
+            if (myAreas == NULL)
+            {
+                myGeoHelp = mySurf->getGeodesicHelper();
+            } else {
+                myGeoHelp.grabNew(new GeodesicHelper(myGeoBase));
+            }
+        }
+        vector<Cluster> clusters;
+        findColumnClusters(myMetric->getValuePointerForColumn(columnNum), roiData, nodeAreas, myTopoHelp, myGeoHelp, threshVal, minArea, lessThan, areaRatio, distanceCutoff, clusters);
         vector<float> outData(numNodes, 0.0f);
-        const float* data = myMetric->getValuePointerForColumn(columnNum);
-        processColumn(data, roiData, nodeAreas, myTopoHelp, myGeoHelp, threshVal, minArea, lessThan, areaRatio, distanceCutoff, outData.data(), markVal);
+        markClusters(clusters, outData.data(), markVal);
         myMetricOut->setValuesForColumn(0, outData.data());
     }
     if (endVal != NULL) *endVal = markVal;
@@ -21,11 +21,12 @@
 #include "AlgorithmMetricRemoveIslands.h"
 #include "AlgorithmException.h"
 
+#include "CaretOMP.h"
+#include "ConnectedComponentHelper.h"
 #include "MetricFile.h"
 #include "SurfaceFile.h"
 #include "TopologyHelper.h"
 
-#include <utility>
 #include <vector>
 
 using namespace caret;
@@ -92,65 +93,44 @@ AlgorithmMetricRemoveIslands::AlgorithmMetricRemoveIslands(ProgressObject* myPro
     int numCols = myMetric->getNumberOfColumns();
     myMetricOut->setNumberOfNodesAndColumns(numNodes, numCols);
     myMetricOut->setStructure(myMetric->getStructure());
+    CaretPointer<TopologyHelper> myHelp = mySurf->getTopologyHelper();
+#pragma omp CARET_PARFOR schedule(dynamic)
     for (int col = 0; col < numCols; ++col)
     {
-        vector<pair<float, vector<int> > > areas;
-        vector<int> used(numNodes, 0);
-        CaretPointer<TopologyHelper> myHelp = mySurf->getTopologyHelper();
         const float* roiData = myMetric->getValuePointerForColumn(col);
         myMetricOut->setColumnName(col, myMetric->getColumnName(col));
+        vector<char> mask(numNodes, 0);
         for (int i = 0; i < numNodes; ++i)
         {
-            if (used[i] == 0 && roiData[i] > 0.0f)
-            {
-                areas.push_back(make_pair(0.0f, vector<int>()));
-                vector<int>& thisAreaMembers = areas.back().second;
-                float& thisSurfArea = areas.back().first;
-                thisAreaMembers.push_back(i);
-                thisSurfArea += areaData[i];
-                used[i] = 1;
-                vector<int> mystack;
-                mystack.push_back(i);
-                while (!mystack.empty())
-                {
-                    int curnode = mystack.back();
-                    mystack.pop_back();
-                    const vector<int32_t>& neighbors = myHelp->getNodeNeighbors(curnode);
-                    int numNeigh = (int)neighbors.size();
-                    for (int j = 0; j < numNeigh; ++j)
-                    {
-                        int thisneigh = neighbors[j];
-                        if (used[thisneigh] == 0 && roiData[thisneigh] > 0.0f)
-                        {
-                            used[thisneigh] = 1;
-                            thisAreaMembers.push_back(thisneigh);
-                            thisSurfArea += areaData[thisneigh];
-                            mystack.push_back(thisneigh);
-                        }
-                    }
-                }
-            }
+            if (roiData[i] > 0.0f) mask[i] = 1;
+        }
+        vector<int64_t> labels;
+        int64_t numAreas = ConnectedComponentHelper::labelSurface(myHelp, mask.data(), labels);
+        vector<float> areas(numAreas, 0.0f);
+        for (int i = 0; i < numNodes; ++i)
+        {
+            if (labels[i] >= 0) areas[labels[i]] += areaData[i];
         }
         vector<float> outscratch(numNodes, 0.0f);
-        int numAreas = (int)areas.size();
         if (numAreas > 0)
         {
-            int bestIndex = 0;
-            float bestArea = areas[0].first;
-            for (int i = 1; i < numAreas; ++i)
+            int64_t bestIndex = 0;
+            float bestArea = areas[0];
+            for (int64_t i = 1; i < numAreas; ++i)
             {
-                float thisArea = (int)areas[i].first;
+                float thisArea = (int)areas[i];
                 if (thisArea > bestArea)
                 {
                     bestIndex = i;
                     bestArea = thisArea;
                 }
             }
-            const vector<int>& thisArea = areas[bestIndex].second;
-            int numAreaNodes = (int)thisArea.size();
-            for (int i = 0; i < numAreaNodes; ++i)
+            for (int i = 0; i < numNodes; ++i)
             {
-                outscratch[thisArea[i]] = 1.0f;//make it into a simple 0/1 metric, even if it wasn't before
+                if (labels[i] == bestIndex)
+                {
+                    outscratch[i] = 1.0f;//make it into a simple 0/1 metric, even if it wasn't before
+                }
             }
         }
         myMetricOut->setValuesForColumn(col, outscratch.data());
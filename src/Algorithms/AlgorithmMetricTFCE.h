@@ -25,13 +25,9 @@
 
 namespace caret {
     
-    class TopologyHelper;
-    
     class AlgorithmMetricTFCE : public AbstractAlgorithm
     {
         AlgorithmMetricTFCE();
-        void processColumn(const SurfaceFile* mySurf, const float* colData, float* outData, const float* roiData, const float& param_e, const float& param_h, const float* areaData);
-        void tfce_pos(TopologyHelper* myHelper, const float* colData, double* accumData, const float* roiData, const float& param_e, const float& param_h, const float* areaData);
     protected:
         static float getSubAlgorithmWeight();
         static float getAlgorithmInternalWeight();
@@ -24,6 +24,8 @@
 #include "MetricFile.h"
 #include "SurfaceFile.h"
 
+#include <vector>
+
 using namespace caret;
 using namespace std;
 
@@ -92,15 +94,10 @@ AlgorithmSignedDistanceToSurface::AlgorithmSignedDistanceToSurface(ProgressObjec
     int numNodes = testSurf->getNumberOfNodes();
     myMetricOut->setNumberOfNodesAndColumns(numNodes, 1);
     myMetricOut->setStructure(testSurf->getStructure());
-#pragma omp CARET_PAR
-    {
-        CaretPointer<SignedDistanceHelper> myHelp = levelSetSurf->getSignedDistanceHelper();
-#pragma omp CARET_FOR schedule(dynamic)
-        for (int i = 0; i < numNodes; ++i)
-        {
-            myMetricOut->setValue(i, 0, myHelp->dist(testSurf->getCoordinate(i), myWinding));
-        }
-    }
+    vector<float> distances(numNodes);
+    CaretPointer<SignedDistanceHelper> myHelp = levelSetSurf->getSignedDistanceHelper();
+    myHelp->distBatch(testSurf->getCoordinateData(), numNodes, distances.data(), myWinding);//parallel inside
+    myMetricOut->setValuesForColumn(0, distances.data());
 }
 
 float AlgorithmSignedDistanceToSurface::getAlgorithmInternalWeight()
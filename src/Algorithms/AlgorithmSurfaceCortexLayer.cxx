@@ -118,7 +118,7 @@ AlgorithmSurfaceCortexLayer::AlgorithmSurfaceCortexLayer(ProgressObject* myProgO
         {
             float d1;
             Vector3D axisHat = (pialCenter - whiteCenter).normal(&d1);
-            const vector<int32_t>& neighbors = myTopoHelp->getNodeNeighbors(i);
+            const TopologyIndexList neighbors = myTopoHelp->getNodeNeighbors(i);
             int numNeigh = (int)neighbors.size();
             for (int j = 0; j < numNeigh; ++j)
             {
@@ -192,7 +192,7 @@ AlgorithmSurfaceCortexLayer::AlgorithmSurfaceCortexLayer(ProgressObject* myProgO
             distFrac /= numNeigh;
         } else {
             float a = 0.0f, b = 0.0f, c = 0.0f;//constants for the cubic function that will give the volume
-            const vector<int32_t>& myTiles = myTopoHelp->getNodeTiles(i);
+            const TopologyIndexList myTiles = myTopoHelp->getNodeTiles(i);
             int numTiles = (int)myTiles.size();
             for (int j = 0; j < numTiles; ++j)
             {
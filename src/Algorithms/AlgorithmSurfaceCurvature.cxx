@@ -98,7 +98,7 @@ AlgorithmSurfaceCurvature::AlgorithmSurfaceCurvature(ProgressObject* myProgObj,
     const float* normalData = mySurf->getNormalData();
     for (int i = 0; i < numNodes; ++i)
     {
-        const vector<int32_t>& neighbors = myTopoHelp->getNodeNeighbors(i);
+        const TopologyIndexList neighbors = myTopoHelp->getNodeNeighbors(i);
         int numNeigh = (int)neighbors.size();
         float k1 = 0.0f, k2 = 0.0f;
         if (numNeigh > 0)
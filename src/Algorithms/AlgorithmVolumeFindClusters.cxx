@@ -25,6 +25,7 @@
 #include "CaretLogger.h"
 #include "CaretPointer.h"
 #include "CaretPointLocator.h"
+#include "ConnectedComponentHelper.h"
 #include "VolumeFile.h"
 #include "VoxelIJK.h"
 
@@ -136,6 +137,11 @@ void AlgorithmVolumeFindClusters::useParameters(OperationParameters* myParams, P
 
 namespace
 {
+    VoxelIJK indexToIJK(const int64_t& index, const vector<int64_t>& dims)
+    {
+        return VoxelIJK(index % dims[0], (index / dims[0]) % dims[1], index / (dims[0] * dims[1]));
+    }
+    
     void processSubvol(const float* inFrame, VolumeFile* volOut, const int64_t& outSubvol, const int64_t& outComponent, const float& threshValue, const float& minVolume,
                        const bool& lessThan, const float* roiFrame, const float& sizeRatio, const float& distanceCutoff, int& markVal)
     {
@@ -146,13 +152,6 @@ namespace
         mySpace.getSpacingVectors(ivec, jvec, kvec, origin);
         float voxelVolume = abs(ivec.dot(jvec.cross(kvec)));
         int64_t minVoxels = (int64_t)ceil(minVolume / voxelVolume);
-        vector<VoxelIJK> neighbors;
-        neighbors.push_back(VoxelIJK(1, 0, 0));
-        neighbors.push_back(VoxelIJK(-1, 0, 0));
-        neighbors.push_back(VoxelIJK(0, 1, 0));
-        neighbors.push_back(VoxelIJK(0, -1, 0));
-        neighbors.push_back(VoxelIJK(0, 0, 1));
-        neighbors.push_back(VoxelIJK(0, 0, -1));
         vector<char> marked(frameSize, 0);
         if (lessThan)
         {
@@ -172,53 +171,29 @@ namespace
                 }
             }
         }
-        vector<vector<VoxelIJK> > clusters;
+        vector<int64_t> labels;
+        int64_t numComponents = ConnectedComponentHelper::labelVolume(dims.data(), marked.data(), labels, 6);//face neighbors only
+        vector<char>().swap(marked);
+        vector<vector<int64_t> > clusters;
+        ConnectedComponentHelper::getComponentMembers(labels, numComponents, clusters);//in order of lowest index, same as a flood fill in ijk order
+        vector<int64_t>().swap(labels);
         size_t biggestCount = 0;
         int64_t biggestCluster = -1;
-        for (int64_t k = 0; k < dims[2]; ++k)
+        size_t numKept = 0;
+        for (int64_t i = 0; i < numComponents; ++i)
         {
-            for (int64_t j = 0; j < dims[1]; ++j)
+            if ((int64_t)clusters[i].size() >= minVoxels)
             {
-                for (int64_t i = 0; i < dims[0]; ++i)
+                if (clusters[i].size() > biggestCount)
                 {
-                    int64_t myIndex = mySpace.getIndex(i, j, k);
-                    if (marked[myIndex])
-                    {
-                        vector<VoxelIJK> voxelList;
-                        voxelList.push_back(VoxelIJK(i, j, k));
-                        marked[myIndex] = 0;//don't let voxels get duplicated in the list
-                        for (int64_t index = 0; index < (int64_t)voxelList.size(); ++index)//NOTE: vector grows inside loop
-                        {
-                            const VoxelIJK& thisVoxel = voxelList[index];
-                            for (int n = 0; n < (int)neighbors.size(); ++n)
-                            {
-                                VoxelIJK neighVox(thisVoxel.m_ijk[0] + neighbors[n].m_ijk[0],
-                                                    thisVoxel.m_ijk[1] + neighbors[n].m_ijk[1],
-                                                    thisVoxel.m_ijk[2] + neighbors[n].m_ijk[2]);
-                                if (mySpace.indexValid(neighVox.m_ijk))
-                                {
-                                    int64_t neighIndex = mySpace.getIndex(neighVox.m_ijk);
-                                    if (marked[neighIndex])
-                                    {
-                                        voxelList.push_back(neighVox);
-                                        marked[neighIndex] = 0;
-                                    }
-                                }
-                            }
-                        }
-                        if ((int64_t)voxelList.size() >= minVoxels)
-                        {
-                            if (voxelList.size() > biggestCount)
-                            {
-                                biggestCount = voxelList.size();
-                                biggestCluster = (int64_t)clusters.size();
-                            }
-                            clusters.push_back(voxelList);
-                        }
-                    }
+                    biggestCount = clusters[i].size();
+                    biggestCluster = (int64_t)numKept;
                 }
+                if ((int64_t)numKept != i) clusters[numKept].swap(clusters[i]);
+                ++numKept;
             }
         }
+        clusters.resize(numKept);
         if (!clusters.empty()) CaretAssert(biggestCluster != -1);
         if (biggestCluster != -1 && (distanceCutoff > 0.0f || sizeRatio > 0.0f))
         {
@@ -230,7 +205,7 @@ namespace
                 for (size_t i = 0; i < clusters[biggestCluster].size(); ++i)
                 {
                     float thisCoord[3];
-                    mySpace.indexToSpace(clusters[biggestCluster][i].m_ijk, thisCoord);
+                    mySpace.indexToSpace(indexToIJK(clusters[biggestCluster][i], dims).m_ijk, thisCoord);
                     biggestCoords.push_back(thisCoord[0]);
                     biggestCoords.push_back(thisCoord[1]);
                     biggestCoords.push_back(thisCoord[2]);
@@ -252,7 +227,7 @@ namespace
                         for (size_t j = 0; j < clusters[i].size(); ++j)
                         {
                             float thisCoord[3];
-                            mySpace.indexToSpace(clusters[i][j].m_ijk, thisCoord);
+                            mySpace.indexToSpace(indexToIJK(clusters[i][j], dims).m_ijk, thisCoord);
                             int32_t ret = myLocator->closestPointLimited(thisCoord, distanceCutoff);
                             if (ret == -1)
                             {
@@ -281,7 +256,7 @@ namespace
             if ((int)tempVal != markVal) throw AlgorithmException("too many clusters, unable to mark them uniquely");
             for (size_t index = 0; index < clusters[i].size(); ++index)
             {
-                volOut->setValue(tempVal, clusters[i][index].m_ijk, outSubvol, outComponent);
+                volOut->setValue(tempVal, indexToIJK(clusters[i][index], dims).m_ijk, outSubvol, outComponent);
             }
             ++markVal;
         }
@@ -35,6 +35,7 @@
 #include "AlgorithmSurfaceToSurface3dDistance.h"
 #include "AlgorithmCreateSignedDistanceVolume.h"
 
+#include <algorithm>
 #include <cmath>
 #include <fstream>
 
@@ -86,6 +87,8 @@ OperationParameters* AlgorithmVolumeToSurfaceMapping::getParameters()
     ribbonWeights->addVolumeOutputParameter(2, "weights-out", "volume to write the weights to");
     OptionalParameter* ribbonWeightsText = ribbonOpt->createOptionalParameter(6, "-output-weights-text", "write the voxel weights for all vertices to a text file");
     ribbonWeightsText->addStringParameter(1, "text-out", "output - the output text filename");//fake the output formatting
+    OptionalParameter* weightsCacheOpt = ribbonOpt->createOptionalParameter(11, "-weights-cache", "reuse voxel weights saved in a binary file, computing and saving them if they don't match the inputs");
+    weightsCacheOpt->addStringParameter(1, "cache-file", "the binary weights filename");
     
     OptionalParameter* myelinStyleOpt = ret->createOptionalParameter(9, "-myelin-style", "use the method from myelin mapping");
     myelinStyleOpt->addVolumeParameter(1, "ribbon-roi", "an roi volume of the cortical ribbon for this hemisphere");
@@ -111,7 +114,10 @@ OperationParameters* AlgorithmVolumeToSurfaceMapping::getParameters()
         "The -gaussian option makes it act more like the myelin method, where the distance of a voxel from <surface> is used to downweight the voxel.  " +
         "The -interpolate suboption, instead of doing a weighted average of voxels, interpolates from the volume at the subdivided points inside the ribbon.  " +
         "If using both -interpolate and the -weighted suboption to -volume-roi, the roi volume weights are linearly interpolated, " +
-        "unless the -interpolate method is ENCLOSING_VOXEL, in which case ENCLOSING_VOXEL is also used for sampling the roi volume weights." +
+        "unless the -interpolate method is ENCLOSING_VOXEL, in which case ENCLOSING_VOXEL is also used for sampling the roi volume weights.  " +
+        "The -weights-cache suboption stores the voxel weights in a binary file along with hashes of the surfaces, the volume space, the roi, and the ribbon options, " +
+        "so that mapping several volumes in the same space with the same surfaces only computes the weights once.  " +
+        "If the file doesn't exist or doesn't match the inputs, the weights are computed and the file is overwritten." +
         "\n\n" +
         "The myelin style method uses part of the caret5 myelin mapping command to do the mapping: for each surface vertex, take all voxels that are in a cylinder " +
         "with radius and height equal to cortical thickness, centered on the vertex and aligned with the surface normal, and that are also within the ribbon ROI, " +
@@ -262,17 +268,27 @@ void AlgorithmVolumeToSurfaceMapping::useParameters(OperationParameters* myParam
                 weightsOut = ribbonWeights->getOutputVolume(2);
             }
             OptionalParameter* ribbonWeightsText = ribbonOpt->getOptionalParameter(6);
+            AString weightsCacheFile;
+            OptionalParameter* weightsCacheOpt = ribbonOpt->getOptionalParameter(11);
+            if (weightsCacheOpt->m_present)
+            {
+                weightsCacheFile = weightsCacheOpt->getString(1);
+            }
             if (ribbonInterp)
             {
                 if (ribbonWeightsText->m_present || weightsOut != NULL)
                 {
                     throw AlgorithmException("-output-weights options are incompatible with -interpolate");
                 }
+                if (weightsCacheOpt->m_present)
+                {
+                    throw AlgorithmException("-weights-cache is incompatible with -interpolate");
+                }
                 AlgorithmVolumeToSurfaceMapping(myProgObj, myVolume, mySurface, myMetricOut, innerSurf, outerSurf, volInterpMethod, myRoiVol, weightedRoi, subdivisions, thinColumns,
                                                 mySubVol, gaussScale, badVertices);
             } else {
                 AlgorithmVolumeToSurfaceMapping(myProgObj, myVolume, mySurface, myMetricOut, innerSurf, outerSurf, myRoiVol, weightedRoi, subdivisions, thinColumns,
-                                                mySubVol, gaussScale, badVertices, weightsOutVertex, weightsOut);
+                                                mySubVol, gaussScale, badVertices, weightsOutVertex, weightsOut, weightsCacheFile);
             }
             if (ribbonWeightsText->m_present)
             {//do this after the algorithm, to let it do the error condition checking
@@ -281,7 +297,8 @@ void AlgorithmVolumeToSurfaceMapping::useParameters(OperationParameters* myParam
                 vector<vector<VoxelWeight> > myWeights;
                 const float* roiFrame = NULL;
                 if (myRoiVol != NULL) roiFrame = myRoiVol->getFrame();
-                AlgorithmVolumeToSurfaceMapping::precomputeWeightsRibbon(myWeights, myVolume->getVolumeSpace(), innerSurf, outerSurf, roiFrame, weightedRoi, subdivisions, thinColumns, mySurface, gaussScale);
+                AlgorithmVolumeToSurfaceMapping::precomputeWeightsRibbon(myWeights, myVolume->getVolumeSpace(), innerSurf, outerSurf, roiFrame, weightedRoi, subdivisions, thinColumns, mySurface, gaussScale,
+                                                                         weightsCacheFile);//the algorithm already saved them, if requested
                 for (int i = 0; i < (int)myWeights.size(); ++i)
                 {
                     outFile << i << ", " << myWeights[i].size();
@@ -410,7 +427,7 @@ AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject*
 AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject* myProgObj, const VolumeFile* myVolume, const SurfaceFile* mySurface, MetricFile* myMetricOut,
                                                                  const SurfaceFile* innerSurf, const SurfaceFile* outerSurf, const VolumeFile* roiVol, const bool roiWeights,
                                                                  const int32_t& subdivisions, const bool& thinColumns, const int64_t& mySubVol, const float& gaussScale, MetricFile* badVertices,
-                                                                 const int& weightsOutVertex, VolumeFile* weightsOut) : AbstractAlgorithm(myProgObj)
+                                                                 const int& weightsOutVertex, VolumeFile* weightsOut, const AString& weightsCacheFile) : AbstractAlgorithm(myProgObj)
 {
     LevelProgress myProgress(myProgObj);
     vector<int64_t> myVolDims;
@@ -454,7 +471,7 @@ AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject*
     vector<vector<VoxelWeight> > myWeights;
     const float* roiFrame = NULL;
     if (roiVol != NULL) roiFrame = roiVol->getFrame();
-    precomputeWeightsRibbon(myWeights, myVolume->getVolumeSpace(), innerSurf, outerSurf, roiFrame, roiWeights, subdivisions, thinColumns, mySurface, gaussScale);
+    precomputeWeightsRibbon(myWeights, myVolume->getVolumeSpace(), innerSurf, outerSurf, roiFrame, roiWeights, subdivisions, thinColumns, mySurface, gaussScale, weightsCacheFile);
     if (weightsOut != NULL)
     {
         weightsOut->setValueAllVoxels(0.0f);
@@ -465,83 +482,82 @@ AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject*
             weightsOut->setValue(vertexWeights[i].weight, vertexWeights[i].ijk);
         }
     }
-    CaretArray<float> myScratchArray(numNodes);
-    float* myScratch = myScratchArray.getArray();
-    if (mySubVol == -1)
+    //flatten the weights into compressed rows of frame indices, so that the mapping is one sparse matrix times the (voxels x frames) data
+    vector<int64_t> rowStart(numNodes + 1, 0);
+    for (int64_t node = 0; node < numNodes; ++node)
     {
-        for (int64_t i = 0; i < myVolDims[3]; ++i)
-        {
-            for (int64_t j = 0; j < myVolDims[4]; ++j)
-            {
-                int64_t thisCol = i * myVolDims[4] + j;
-                AString metricLabel = myVolume->getMapName(i);
-                if (myVolDims[4] != 1)
-                {
-                    metricLabel += " component " + AString::number(j);
-                }
-                metricLabel += " ribbon constrained";
-                myMetricOut->setColumnName(thisCol, metricLabel);
+        rowStart[node + 1] = rowStart[node] + (int64_t)myWeights[node].size();
+    }
+    const VolumeSpace& volSpace = myVolume->getVolumeSpace();
+    vector<int64_t> voxIndices(rowStart[numNodes]);
+    vector<float> voxWeights(rowStart[numNodes]), totalWeights(numNodes);
 #pragma omp CARET_PARFOR schedule(dynamic)
-                for (int64_t node = 0; node < numNodes; ++node)
-                {
-                    myScratch[node] = 0.0f;
-                    float totalWeight = 0.0f;
-                    int numVoxels = (int)myWeights[node].size();
-                    for (int voxel = 0; voxel < numVoxels; ++voxel)
-                    {
-                        float thisWeight = myWeights[node][voxel].weight;
-                        totalWeight += thisWeight;
-                        myScratch[node] += thisWeight * myVolume->getValue(myWeights[node][voxel].ijk, i, j);
-                    }
-                    if (totalWeight != 0.0f)
-                    {
-                        myScratch[node] /= totalWeight;
-                    } else {
-                        myScratch[node] = 0.0f;
-                        if (thisCol == 0 && badVertices != NULL)
-                        {
-                            badVertScratch[node] = 1.0f;
-                        }
-                    }
-                }
-                myMetricOut->setValuesForColumn(thisCol, myScratch);
-            }
+    for (int64_t node = 0; node < numNodes; ++node)
+    {
+        const vector<VoxelWeight>& nodeWeights = myWeights[node];
+        float totalWeight = 0.0f;
+        for (int64_t voxel = 0; voxel < (int64_t)nodeWeights.size(); ++voxel)
+        {
+            voxIndices[rowStart[node] + voxel] = volSpace.getIndex(nodeWeights[voxel].ijk);
+            voxWeights[rowStart[node] + voxel] = nodeWeights[voxel].weight;
+            totalWeight += nodeWeights[voxel].weight;
         }
-    } else {
+        totalWeights[node] = totalWeight;
+        if (totalWeight == 0.0f && badVertices != NULL)
+        {
+            badVertScratch[node] = 1.0f;
+        }
+    }
+    vector<vector<VoxelWeight> >().swap(myWeights);//release the nested vectors, we only need the flattened version now
+    vector<int64_t> colBrick, colComponent;//the (subvolume, component) pair for each output column
+    for (int64_t i = 0; i < myVolDims[3]; ++i)
+    {
+        if (mySubVol != -1 && i != mySubVol) continue;
         for (int64_t j = 0; j < myVolDims[4]; ++j)
         {
-            AString metricLabel = myVolume->getMapName(mySubVol);
+            colBrick.push_back(i);
+            colComponent.push_back(j);
+            AString metricLabel = myVolume->getMapName(i);
             if (myVolDims[4] != 1)
             {
                 metricLabel += " component " + AString::number(j);
             }
             metricLabel += " ribbon constrained";
-            int64_t thisCol = j;
-            myMetricOut->setColumnName(thisCol, metricLabel);
-#pragma omp CARET_PARFOR schedule(dynamic)
-            for (int64_t node = 0; node < numNodes; ++node)
+            myMetricOut->setColumnName((int64_t)colBrick.size() - 1, metricLabel);
+        }
+    }
+    const int64_t FRAME_BLOCK = 16;//frames per pass, so each vertex's weights are read once for many frames, without keeping a copy of the whole output
+    vector<const float*> framePtrs(FRAME_BLOCK);
+    vector<float> blockOut(FRAME_BLOCK * numNodes);
+    for (int64_t blockStart = 0; blockStart < numColumns; blockStart += FRAME_BLOCK)
+    {
+        const int64_t blockSize = min(FRAME_BLOCK, numColumns - blockStart);
+        for (int64_t f = 0; f < blockSize; ++f)
+        {
+            framePtrs[f] = myVolume->getFrame(colBrick[blockStart + f], colComponent[blockStart + f]);
+        }
+#pragma omp CARET_PARFOR schedule(dynamic, 64)
+        for (int64_t node = 0; node < numNodes; ++node)
+        {
+            const int64_t rowEnd = rowStart[node + 1];
+            for (int64_t f = 0; f < blockSize; ++f)
             {
-                    myScratch[node] = 0.0f;
-                    float totalWeight = 0.0f;
-                    int numVoxels = (int)myWeights[node].size();
-                    for (int voxel = 0; voxel < numVoxels; ++voxel)
-                    {
-                        float thisWeight = myWeights[node][voxel].weight;
-                        totalWeight += thisWeight;
-                        myScratch[node] += thisWeight * myVolume->getValue(myWeights[node][voxel].ijk, mySubVol, j);
-                    }
-                    if (totalWeight != 0.0f)
+                float accum = 0.0f;
+                if (totalWeights[node] != 0.0f)
+                {
+                    const float* frame = framePtrs[f];
+                    for (int64_t voxel = rowStart[node]; voxel < rowEnd; ++voxel)
                     {
-                        myScratch[node] /= totalWeight;
-                    } else {
-                        myScratch[node] = 0.0f;
-                        if (badVertices != NULL)
-                        {
-                            badVertScratch[node] = 1.0f;
-                        }
+                        accum += voxWeights[voxel] * frame[voxIndices[voxel]];
                     }
+                    accum /= totalWeights[node];
+                }
+                blockOut[f * numNodes + node] = accum;
             }
-            myMetricOut->setValuesForColumn(thisCol, myScratch);
+        }
+        for (int64_t f = 0; f < blockSize; ++f)
+        {
+            myMetricOut->setValuesForColumn(blockStart + f, blockOut.data() + f * numNodes);
         }
     }
     if (badVertices != NULL)
@@ -673,10 +689,29 @@ AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject*
 
 void AlgorithmVolumeToSurfaceMapping::precomputeWeightsRibbon(vector<vector<VoxelWeight> >& myWeights, const VolumeSpace& volSpace,
                                                               const SurfaceFile* innerSurf, const SurfaceFile* outerSurf, const float* roiFrame, const bool roiWeights,
-                                                              const int& subdivisions, const bool& thinColumns, const SurfaceFile* gaussSurf, const float& gaussScale)
+                                                              const int& subdivisions, const bool& thinColumns, const SurfaceFile* gaussSurf, const float& gaussScale,
+                                                              const AString& cacheFile)
 {
-    RibbonMappingHelper::computeWeightsRibbon(myWeights, volSpace, innerSurf, outerSurf, roiFrame, subdivisions, thinColumns);
     const int numNodes = innerSurf->getNumberOfNodes();
+    uint64_t surfaceKey = 0, volumeKey = 0, optionsKey = 0;
+    if (cacheFile != "")
+    {
+        surfaceKey = RibbonMappingHelper::hashSurface(outerSurf, RibbonMappingHelper::hashSurface(innerSurf));
+        if (gaussScale > 0.0f) surfaceKey = RibbonMappingHelper::hashSurface(gaussSurf, surfaceKey);
+        volumeKey = RibbonMappingHelper::hashVolumeSpace(volSpace);
+        if (roiFrame != NULL)
+        {
+            const int64_t* dims = volSpace.getDims();
+            volumeKey = RibbonMappingHelper::hashBytes(roiFrame, dims[0] * dims[1] * dims[2] * sizeof(float), volumeKey);
+        }
+        const char flags[2] = { (char)(roiWeights ? 1 : 0), (char)(thinColumns ? 1 : 0) };
+        const int32_t subdivNum = subdivisions;
+        optionsKey = RibbonMappingHelper::hashBytes(flags, 2);
+        optionsKey = RibbonMappingHelper::hashBytes(&subdivNum, sizeof(int32_t), optionsKey);
+        optionsKey = RibbonMappingHelper::hashBytes(&gaussScale, sizeof(float), optionsKey);
+        if (RibbonMappingHelper::readWeights(cacheFile, myWeights, volSpace, numNodes, surfaceKey, volumeKey, optionsKey)) return;
+    }
+    RibbonMappingHelper::computeWeightsRibbon(myWeights, volSpace, innerSurf, outerSurf, roiFrame, subdivisions, thinColumns);
     if (roiWeights)
     {
         CaretAssert(roiFrame != NULL);
@@ -712,6 +747,10 @@ void AlgorithmVolumeToSurfaceMapping::precomputeWeightsRibbon(vector<vector<Voxe
             }
         }
     }
+    if (cacheFile != "")
+    {
+        RibbonMappingHelper::writeWeights(cacheFile, myWeights, volSpace, surfaceKey, volumeKey, optionsKey);
+    }
 }
 
 //myelin style mapping
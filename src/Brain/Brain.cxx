@@ -39,6 +39,7 @@
 #include "CaretDataFileHelper.h"
 #include "CaretHttpManager.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "CaretPreferences.h"
 #include "CaretResult.h"
 #include "ChartTwoCartesianOrientedAxesYokingManager.h"
@@ -6551,6 +6552,8 @@ Brain::loadFilesSelectedInSpecFile(EventSpecFileReadDataFiles* readSpecFileDataF
     
     sortDataFilesByFileNameNoPath();
 
+    createSurfaceHelpers();
+    
     /*
      * Reset the primary anatomical surfaces since they can get set
      * incorrectly when loading files
@@ -6598,6 +6601,32 @@ Brain::loadFilesSelectedInSpecFile(EventSpecFileReadDataFiles* readSpecFileDataF
                                                      "");
 }
 
+/**
+ * Create the topology helpers and point locators for all surfaces in parallel
+ * so that they are not created, one at a time, on first use.  Surfaces with
+ * identical triangles (all surfaces of a hemisphere) share one topology.
+ */
+void
+Brain::createSurfaceHelpers()
+{
+    std::vector<Surface*> allSurfaces;
+    for (auto bs : m_brainStructures) {
+        std::vector<Surface*> surfaces;
+        bs->getSurfaces(surfaces);
+        allSurfaces.insert(allSurfaces.end(),
+                           surfaces.begin(),
+                           surfaces.end());
+    }
+    
+    const int32_t numSurfaces = static_cast<int32_t>(allSurfaces.size());
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int32_t i = 0; i < numSurfaces; i++) {
+        const Surface* surface = allSurfaces[i];
+        surface->getTopologyHelper();
+        surface->getPointLocator();
+    }
+}
+
 /**
  * Some files are sorted by name
  */
@@ -585,6 +585,8 @@ namespace caret {
         
         void sortDataFilesByFileNameNoPath();
         
+        void createSurfaceHelpers();
+        
         void createModelChartTwo();
         
         /**
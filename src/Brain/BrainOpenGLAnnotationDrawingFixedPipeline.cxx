@@ -70,6 +70,7 @@
 #include "GraphicsPrimitiveV3fC4ub.h"
 #include "GraphicsPrimitiveV3fN3f.h"
 #include "GraphicsPrimitiveV3fT2f.h"
+#include "GraphicsRenderProfiler.h"
 #include "GraphicsShape.h"
 #include "GraphicsUtilitiesOpenGL.h"
 #include "HistologySlice.h"
@@ -728,6 +729,11 @@ BrainOpenGLAnnotationDrawingFixedPipeline::drawAnnotationsInternal(const Drawing
                                                                    const Surface* surfaceDisplayed,
                                                                    const float sliceThickness)
 {
+    GraphicsRenderProfiler::ScopedTimer profileTimer("Annotation Drawing");
+    if (profileTimer.isActive()) {
+        profileTimer.setDetailName(AnnotationCoordinateSpaceEnum::toGuiName(drawingCoordinateSpace));
+    }
+    
     CaretAssert(drawingDataType != DrawingDataType::INVALID);
     
     if (m_inputs->m_brain == NULL) {
@@ -4183,6 +4189,8 @@ BrainOpenGLAnnotationDrawingFixedPipeline::drawText(AnnotationFile* annotationFi
     CaretAssert(text);
     CaretAssert(text->getType() == AnnotationTypeEnum::TEXT);
     
+    GraphicsRenderProfiler::ScopedTimer profileTimer("Annotation Text");
+    
     /*
      * Annotations with "DISPLAY_GROUP" propery may be turned on/off by user.
      */
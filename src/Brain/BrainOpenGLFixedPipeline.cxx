@@ -114,13 +114,13 @@
 #include "GiftiLabelTable.h"
 #include "GraphicsEngineDataOpenGL.h"
 #include "GraphicsFramesPerSecond.h"
+#include "GraphicsRenderProfiler.h"
 #include "GraphicsObjectToWindowTransform.h"
 #include "GraphicsPrimitiveV3fC4f.h"
 #include "GraphicsPrimitiveV3fC4ub.h"
 #include "GraphicsPrimitiveV3fN3fC4ub.h"
 #include "GraphicsPrimitiveV3f.h"
 #include "GraphicsPrimitiveV3fT2f.h"
-#include "GraphicsPrimitiveV3fN3fC4f.h"
 #include "GraphicsRegionSelectionBox.h"
 #include "GraphicsShape.h"
 #include "GraphicsViewport.h"
@@ -160,6 +160,7 @@
 #include "PaletteScalarAndColor.h"
 #include "Plane.h"
 #include "SessionManager.h"
+#include "SignedDistanceHelper.h"
 #include "Surface.h"
 #include "SurfaceMontageViewport.h"
 #include "SurfaceNodeColoring.h"
@@ -780,6 +781,11 @@ BrainOpenGLFixedPipeline::drawModelsImplementation(const int32_t windowIndex,
                                                    const std::vector<const BrainOpenGLViewportContent*>& viewportContents,
                                                    const GraphicsFramesPerSecond* graphicsFramesPerSecond)
 {
+    GraphicsRenderProfiler::ScopedTimer profileTimer(GraphicsRenderProfiler::FRAME_STAGE_NAME);
+    if (profileTimer.isActive()) {
+        profileTimer.setDetailName("Window " + AString::number(windowIndex + 1));
+    }
+    
     /*
      * We only clear the drawing viewport contents when
      * drawing all models.  Projection and Selection only
@@ -930,6 +936,11 @@ BrainOpenGLFixedPipeline::drawModelsImplementation(const int32_t windowIndex,
         updateForegroundAndBackgroundColors(vpContent);
         
         const BrowserTabContent* tabContent = vpContent->getBrowserTabContent();
+        
+        GraphicsRenderProfiler::ScopedTimer profileTabTimer("Tab",
+                                                            ((tabContent != NULL)
+                                                             ? tabContent->getTabNumber()
+                                                             : -1));
 
         if ( ! windowAnnotationsDrawnFlag) {
             if (tabContent != NULL) {
@@ -2826,7 +2837,7 @@ BrainOpenGLFixedPipeline::drawSurface(Surface* surface,
                         glDisable(GL_CULL_FACE);
                     }
                     if (DeveloperFlagsEnum::isFlag(DeveloperFlagsEnum::DEVELOPER_FLAG_SURFACE_BUFFER)) {
-                        GraphicsPrimitiveV3fN3fC4f* primitive(NULL);
+                        GraphicsPrimitiveV3fN3fC4ub* primitive(NULL);
                         const int32_t tabIndex(this->browserTabContent->getTabNumber());
                         switch (surfaceTabType) {
                             case SurfaceTabType::SINGLE_SURFACE:
@@ -3046,52 +3057,65 @@ BrainOpenGLFixedPipeline::drawSurfaceTriangles(Surface* surface,
             break;
     }
     
+    /*
+     * When possible, find the triangle under the mouse by casting
+     * a ray through the surface instead of drawing it for selection
+     */
+    int32_t triangleIndex = -1;
+    float depth = -1.0;
+    bool isRayCast = false;
     if (isSelect) {
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        isRayCast = getSurfaceTriangleHitByMouseRay(surface,
+                                                    triangleIndex,
+                                                    depth);
+        if ( ! isRayCast) {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        }
     }
     
     uint8_t rgba[4];
     
-    glBegin(GL_TRIANGLES);
-    for (int32_t i = 0; i < numTriangles; i++) {
-        const int32_t i3 = i * 3;
-        const int32_t n1 = triangles[i3];
-        const int32_t n2 = triangles[i3+1];
-        const int32_t n3 = triangles[i3+2];
+    if ( ! isRayCast) {
+        glBegin(GL_TRIANGLES);
+        for (int32_t i = 0; i < numTriangles; i++) {
+            const int32_t i3 = i * 3;
+            const int32_t n1 = triangles[i3];
+            const int32_t n2 = triangles[i3+1];
+            const int32_t n3 = triangles[i3+2];
         
-        if (isSelect) {
-            this->colorIdentification->addItem(rgba, SelectionItemDataTypeEnum::SURFACE_TRIANGLE, i);
-            glColor3ubv(rgba);
-            glNormal3fv(&normals[n1*3]);
-            glVertex3fv(&coordinates[n1*3]);
-            glNormal3fv(&normals[n2*3]);
-            glVertex3fv(&coordinates[n2*3]);
-            glNormal3fv(&normals[n3*3]);
-            glVertex3fv(&coordinates[n3*3]);
-        }
-        else {
-            glColor4fv(&nodeColoringRGBA[n1*4]);
-            glNormal3fv(&normals[n1*3]);
-            glVertex3fv(&coordinates[n1*3]);
-            glColor4fv(&nodeColoringRGBA[n2*4]);
-            glNormal3fv(&normals[n2*3]);
-            glVertex3fv(&coordinates[n2*3]);
-            glColor4fv(&nodeColoringRGBA[n3*4]);
-            glNormal3fv(&normals[n3*3]);
-            glVertex3fv(&coordinates[n3*3]);
+            if (isSelect) {
+                this->colorIdentification->addItem(rgba, SelectionItemDataTypeEnum::SURFACE_TRIANGLE, i);
+                glColor3ubv(rgba);
+                glNormal3fv(&normals[n1*3]);
+                glVertex3fv(&coordinates[n1*3]);
+                glNormal3fv(&normals[n2*3]);
+                glVertex3fv(&coordinates[n2*3]);
+                glNormal3fv(&normals[n3*3]);
+                glVertex3fv(&coordinates[n3*3]);
+            }
+            else {
+                glColor4fv(&nodeColoringRGBA[n1*4]);
+                glNormal3fv(&normals[n1*3]);
+                glVertex3fv(&coordinates[n1*3]);
+                glColor4fv(&nodeColoringRGBA[n2*4]);
+                glNormal3fv(&normals[n2*3]);
+                glVertex3fv(&coordinates[n2*3]);
+                glColor4fv(&nodeColoringRGBA[n3*4]);
+                glNormal3fv(&normals[n3*3]);
+                glVertex3fv(&coordinates[n3*3]);
+            }
         }
+        glEnd();
     }
-    glEnd();
     
     if (isSelect) {
-        int32_t triangleIndex = -1;
-        float depth = -1.0;
-        this->getIndexFromColorSelection(SelectionItemDataTypeEnum::SURFACE_TRIANGLE, 
-                                         this->mouseX, 
-                                         this->mouseY,
-                                         triangleIndex,
-                                         depth);
-        
+        if ( ! isRayCast) {
+            this->getIndexFromColorSelection(SelectionItemDataTypeEnum::SURFACE_TRIANGLE, 
+                                             this->mouseX, 
+                                             this->mouseY,
+                                             triangleIndex,
+                                             depth);
+        }
         
         if (triangleIndex >= 0) {
             bool isTriangleIdAccepted = false;
@@ -3378,7 +3402,6 @@ BrainOpenGLFixedPipeline::drawSurfaceNodes(Surface* surface,
         case MODE_IDENTIFICATION:
             if (nodeID->isEnabledForSelection()) {
                 isSelect = true;
-                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);            
             }
             else {
                 return;
@@ -3396,34 +3419,113 @@ BrainOpenGLFixedPipeline::drawSurfaceNodes(Surface* surface,
             pointSize = 2.0;
         }
     }
-    setPointSize(pointSize);
     
-    glBegin(GL_POINTS);
-    for (int32_t i = 0; i < numNodes; i++) {
-        const int32_t i3 = i * 3;
-        
-        if (isSelect) {
-            this->colorIdentification->addItem(rgba, SelectionItemDataTypeEnum::SURFACE_NODE, i);
-            glColor3ubv(rgba);
-            glNormal3fv(&normals[i3]);
-            glVertex3fv(&coordinates[i3]);
+    /*
+     * When possible, find the vertex under the mouse from the triangle
+     * hit by a ray cast through the surface instead of drawing the vertices
+     */
+    int nodeIndex = -1;
+    float depth = -1.0;
+    bool isRayCast = false;
+    if (isSelect) {
+        int32_t triangleIndex = -1;
+        float triangleDepth = -1.0;
+        isRayCast = getSurfaceTriangleHitByMouseRay(surface,
+                                                    triangleIndex,
+                                                    triangleDepth);
+        if (isRayCast) {
+            if (triangleIndex >= 0) {
+                GLdouble selectionModelviewMatrix[16];
+                glGetDoublev(GL_MODELVIEW_MATRIX, selectionModelviewMatrix);
+                
+                GLdouble selectionProjectionMatrix[16];
+                glGetDoublev(GL_PROJECTION_MATRIX, selectionProjectionMatrix);
+                
+                GLint selectionViewport[4];
+                glGetIntegerv(GL_VIEWPORT, selectionViewport);
+                
+                /*
+                 * Candidates are the triangle's vertices and their neighbors.
+                 * A vertex is selected if the point drawn for it would cover
+                 * the pixel under the mouse.
+                 */
+                CaretPointer<TopologyHelper> topologyHelper = surface->getTopologyHelper();
+                const int32_t* triangleNodes = surface->getTriangle(triangleIndex);
+                const double pixelX = this->mouseX + 0.5;
+                const double pixelY = this->mouseY + 0.5;
+                const double halfPointSize = pointSize / 2.0;
+                double nearestDistance = std::numeric_limits<double>::max();
+                for (int32_t iTri = 0; iTri < 3; iTri++) {
+                    int32_t numNeighbors = 0;
+                    const int32_t* neighbors = topologyHelper->getNodeNeighbors(triangleNodes[iTri],
+                                                                                 numNeighbors);
+                    for (int32_t iNeigh = -1; iNeigh < numNeighbors; iNeigh++) {
+                        const int32_t candidate = ((iNeigh < 0)
+                                                   ? triangleNodes[iTri]
+                                                   : neighbors[iNeigh]);
+                        const float* xyz = &coordinates[candidate * 3];
+                        double windowXYZ[3];
+                        if (gluProject(xyz[0],
+                                       xyz[1],
+                                       xyz[2],
+                                       selectionModelviewMatrix,
+                                       selectionProjectionMatrix,
+                                       selectionViewport,
+                                       &windowXYZ[0],
+                                       &windowXYZ[1],
+                                       &windowXYZ[2])) {
+                            if ((std::fabs(windowXYZ[0] - pixelX) <= halfPointSize)
+                                && (std::fabs(windowXYZ[1] - pixelY) <= halfPointSize)) {
+                                const double dist = MathFunctions::distanceSquared2D(windowXYZ[0],
+                                                                                     windowXYZ[1],
+                                                                                     pixelX,
+                                                                                     pixelY);
+                                if (dist < nearestDistance) {
+                                    nearestDistance = dist;
+                                    nodeIndex = candidate;
+                                    depth = windowXYZ[2];
+                                }
+                            }
+                        }
+                    }
+                }
+            }
         }
         else {
-            glColor4fv(&nodeColoringRGBA[i*4]);
-            glNormal3fv(&normals[i3]);
-            glVertex3fv(&coordinates[i3]);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         }
     }
-    glEnd();
+    
+    if ( ! isRayCast) {
+        setPointSize(pointSize);
+        
+        glBegin(GL_POINTS);
+        for (int32_t i = 0; i < numNodes; i++) {
+            const int32_t i3 = i * 3;
+            
+            if (isSelect) {
+                this->colorIdentification->addItem(rgba, SelectionItemDataTypeEnum::SURFACE_NODE, i);
+                glColor3ubv(rgba);
+                glNormal3fv(&normals[i3]);
+                glVertex3fv(&coordinates[i3]);
+            }
+            else {
+                glColor4fv(&nodeColoringRGBA[i*4]);
+                glNormal3fv(&normals[i3]);
+                glVertex3fv(&coordinates[i3]);
+            }
+        }
+        glEnd();
+    }
     
     if (isSelect) {
-        int nodeIndex = -1;
-        float depth = -1.0;
-        this->getIndexFromColorSelection(SelectionItemDataTypeEnum::SURFACE_NODE, 
-                                         this->mouseX, 
-                                         this->mouseY,
-                                         nodeIndex,
-                                         depth);
+        if ( ! isRayCast) {
+            this->getIndexFromColorSelection(SelectionItemDataTypeEnum::SURFACE_NODE, 
+                                             this->mouseX, 
+                                             this->mouseY,
+                                             nodeIndex,
+                                             depth);
+        }
         if (nodeIndex >= 0) {
             if (nodeID->isOtherScreenDepthCloserToViewer(depth)) {
                 nodeID->setBrain(surface->getBrainStructure()->getBrain());
@@ -5271,12 +5373,18 @@ BrainOpenGLFixedPipeline::drawVolumeVoxelsAsCubesWholeBrainOutsideFaces(std::vec
             /*
              * Voxel coloring for axial slice
              */
-            volumeFile->getVoxelColorsForSliceInMap(volInfo.mapIndex,
-                                                    VolumeSliceViewPlaneEnum::AXIAL,
-                                                    kVoxel,
-                                                    displayGroup,
-                                                    this->windowTabIndex,
-                                                    axialSliceRGBA.data());
+            {
+                GraphicsRenderProfiler::ScopedTimer profileTimer("Volume Slice Coloring");
+                if (profileTimer.isActive()) {
+                    profileTimer.setDetailName(volInfo.mapFile->getFileNameNoPath());
+                }
+                volumeFile->getVoxelColorsForSliceInMap(volInfo.mapIndex,
+                                                        VolumeSliceViewPlaneEnum::AXIAL,
+                                                        kVoxel,
+                                                        displayGroup,
+                                                        this->windowTabIndex,
+                                                        axialSliceRGBA.data());
+            }
             /*
              * Apply layer opacity
              */
@@ -8012,6 +8120,119 @@ BrainOpenGLFixedPipeline::getIndexFromColorSelection(SelectionItemDataTypeEnum::
     glPopClientAttrib();
 }
 
+/**
+ * Find the surface triangle under the mouse by casting a ray,
+ * through the pixel under the mouse, against the surface's bounding
+ * volume hierarchy.  The ray is converted to the surface's coordinate
+ * system using the current modelview and projection matrices so that
+ * the tab's transformation is honored.  This avoids drawing the surface
+ * for identification.
+ *
+ * @param surface
+ *    Surface that is tested.
+ * @param triangleIndexOut
+ *    Output with index of triangle nearest the viewer under the
+ *    mouse or negative if no triangle is under the mouse.
+ * @param depthOut
+ *    Output with screen depth of the position on the triangle.
+ * @return
+ *    True if the ray was cast, false if ray casting cannot be used
+ *    (clipping planes are enabled) and the surface must be drawn
+ *    for identification.
+ */
+bool
+BrainOpenGLFixedPipeline::getSurfaceTriangleHitByMouseRay(const Surface* surface,
+                                                          int32_t& triangleIndexOut,
+                                                          float& depthOut)
+{
+    triangleIndexOut = -1;
+    depthOut = -1.0;
+    
+    /*
+     * Clipping removes parts of the surface that the ray
+     * would hit so use identification by drawing
+     */
+    if (glIsEnabled(GL_CLIP_PLANE0)
+        || glIsEnabled(GL_CLIP_PLANE1)
+        || glIsEnabled(GL_CLIP_PLANE2)
+        || glIsEnabled(GL_CLIP_PLANE3)
+        || glIsEnabled(GL_CLIP_PLANE4)
+        || glIsEnabled(GL_CLIP_PLANE5)) {
+        return false;
+    }
+    
+    if (surface->getNumberOfTriangles() <= 0) {
+        return true;
+    }
+    
+    GLdouble selectionModelviewMatrix[16];
+    glGetDoublev(GL_MODELVIEW_MATRIX, selectionModelviewMatrix);
+    
+    GLdouble selectionProjectionMatrix[16];
+    glGetDoublev(GL_PROJECTION_MATRIX, selectionProjectionMatrix);
+    
+    GLint selectionViewport[4];
+    glGetIntegerv(GL_VIEWPORT, selectionViewport);
+    
+    /*
+     * Ray through center of pixel from near to far clipping plane
+     */
+    const double pixelX = this->mouseX + 0.5;
+    const double pixelY = this->mouseY + 0.5;
+    double nearXYZ[3], farXYZ[3];
+    if ( ! (gluUnProject(pixelX,
+                         pixelY,
+                         0.0,
+                         selectionModelviewMatrix,
+                         selectionProjectionMatrix,
+                         selectionViewport,
+                         &nearXYZ[0],
+                         &nearXYZ[1],
+                         &nearXYZ[2])
+            && gluUnProject(pixelX,
+                            pixelY,
+                            1.0,
+                            selectionModelviewMatrix,
+                            selectionProjectionMatrix,
+                            selectionViewport,
+                            &farXYZ[0],
+                            &farXYZ[1],
+                            &farXYZ[2]))) {
+        return false;
+    }
+    
+    const float rayStart[3] = { (float)nearXYZ[0], (float)nearXYZ[1], (float)nearXYZ[2] };
+    const float rayEnd[3]   = { (float)farXYZ[0],  (float)farXYZ[1],  (float)farXYZ[2] };
+    
+    int32_t triangleIndex = -1;
+    float fraction = 0.0;
+    if (surface->getSignedDistanceHelper()->firstHitBySegment(rayStart,
+                                                              rayEnd,
+                                                              triangleIndex,
+                                                              fraction)) {
+        const double hitXYZ[3] = {
+            nearXYZ[0] + (farXYZ[0] - nearXYZ[0]) * fraction,
+            nearXYZ[1] + (farXYZ[1] - nearXYZ[1]) * fraction,
+            nearXYZ[2] + (farXYZ[2] - nearXYZ[2]) * fraction
+        };
+        double windowXYZ[3];
+        if (gluProject(hitXYZ[0],
+                       hitXYZ[1],
+                       hitXYZ[2],
+                       selectionModelviewMatrix,
+                       selectionProjectionMatrix,
+                       selectionViewport,
+                       &windowXYZ[0],
+                       &windowXYZ[1],
+                       &windowXYZ[2])) {
+            triangleIndexOut = triangleIndex;
+            depthOut = windowXYZ[2];
+        }
+    }
+    
+    return true;
+}
+
 /**
  * Set the selected item's screen coordinates.
  * @param item
@@ -422,6 +422,10 @@ namespace caret {
         void setSelectedItemScreenXYZ(SelectionItem* item,
                                         const float itemXYZ[3]);
 
+        bool getSurfaceTriangleHitByMouseRay(const Surface* surface,
+                                             int32_t& triangleIndexOut,
+                                             float& depthOut);
+
         void setViewportAndOrthographicProjection(const int32_t viewport[4],
                                                   const  ProjectionViewTypeEnum::Enum projectionType);
         
@@ -19,6 +19,7 @@
  */
 /*LICENSE_END*/
 
+#include <algorithm>
 #include <cmath>
 #include <limits>
 
@@ -53,6 +54,7 @@
 #include "GraphicsEngineDataOpenGL.h"
 #include "GraphicsObjectToWindowTransform.h"
 #include "GraphicsPrimitiveV3fC4f.h"
+#include "GraphicsRenderProfiler.h"
 #include "GraphicsUtilitiesOpenGL.h"
 #include "GraphicsShape.h"
 #include "GraphicsViewport.h"
@@ -628,6 +630,21 @@ BrainOpenGLVolumeSliceDrawing::drawVolumeSliceViewTypeMontage(const AllSliceView
         sliceIndex -= sliceStep;
     }
     
+    /*
+     * Coordinates of the slices in the montage so that
+     * voxel coloring of all slices is performed together
+     */
+    m_montageSliceCoordinates.clear();
+    m_montageSliceColorings.clear();
+    for (int32_t iCell = 0; iCell < numSlicesViewed; iCell++) {
+        const int32_t cellSliceIndex = sliceIndex - (iCell * sliceStep);
+        if ((cellSliceIndex >= 0)
+            && (cellSliceIndex < maximumSliceIndex)) {
+            m_montageSliceCoordinates.push_back(sliceOrigin
+                                                + sliceThickness * cellSliceIndex);
+        }
+    }
+    
     if (sliceIndex >= 0) {
         for (int32_t i = 0; i < numRows; i++) {
             for (int32_t j = 0; j < numCols; j++) {
@@ -692,6 +709,9 @@ BrainOpenGLVolumeSliceDrawing::drawVolumeSliceViewTypeMontage(const AllSliceView
         }
     }
     
+    m_montageSliceCoordinates.clear();
+    m_montageSliceColorings.clear();
+    
     /*
      * Draw the axes labels for the montage view
      */
@@ -1451,15 +1471,22 @@ BrainOpenGLVolumeSliceDrawing::drawOrthogonalSlice(const VolumeSliceViewPlaneEnu
         /*
          * Get colors for all voxels in the slice.
          */
-        const int64_t validVoxelCount = volumeFile->getVoxelColorsForSliceInMap(volInfo.mapIndex,
-                                                                        firstVoxelIJK,
-                                                                        rowStepIJK,
-                                                                        columnStepIJK,
-                                                                        drawBottomToTopInfo.numberOfVoxels,
-                                                                        drawLeftToRightInfo.numberOfVoxels,
-                                                                        displayGroup,
-                                                                        browserTabIndex,
-                                                                        sliceVoxelsRGBA);
+        int64_t validVoxelCount(0);
+        {
+            GraphicsRenderProfiler::ScopedTimer profileTimer("Volume Slice Coloring");
+            if (profileTimer.isActive()) {
+                profileTimer.setDetailName(volInfo.mapFile->getFileNameNoPath());
+            }
+            validVoxelCount = volumeFile->getVoxelColorsForSliceInMap(volInfo.mapIndex,
+                                                                      firstVoxelIJK,
+                                                                      rowStepIJK,
+                                                                      columnStepIJK,
+                                                                      drawBottomToTopInfo.numberOfVoxels,
+                                                                      drawLeftToRightInfo.numberOfVoxels,
+                                                                      displayGroup,
+                                                                      browserTabIndex,
+                                                                      sliceVoxelsRGBA);
+        }
 
         /*
          * Is label outline mode?
@@ -1979,16 +2006,23 @@ BrainOpenGLVolumeSliceDrawing::drawOrthogonalSliceWithCulling(const VolumeSliceV
             numVoxelsZ
         };//only used to multiply them all together to get an element count for the presumed array size, so just provide them as XYZ
         
-        const int64_t validVoxelCount =
-           volumeFile->getVoxelColorsForSubSliceInMap(mapIndex,
-                                                   sliceViewPlane,
-                                                   sliceIndexForDrawing,
-                                                   culledFirstVoxelIJK,
-                                                   culledLastVoxelIJK,
-                                                   voxelCountXYZ,
-                                                   displayGroup,
-                                                   browserTabIndex,
-                                                   sliceVoxelsRGBA);
+        int64_t validVoxelCount(0);
+        {
+            GraphicsRenderProfiler::ScopedTimer profileTimer("Volume Slice Coloring");
+            if (profileTimer.isActive()) {
+                profileTimer.setDetailName(volInfo.mapFile->getFileNameNoPath());
+            }
+            validVoxelCount = getOrthogonalSubSliceColors(volumeFile,
+                                                          mapIndex,
+                                                          sliceViewPlane,
+                                                          sliceIndexForDrawing,
+                                                          culledFirstVoxelIJK,
+                                                          culledLastVoxelIJK,
+                                                          voxelCountXYZ,
+                                                          displayGroup,
+                                                          browserTabIndex,
+                                                          sliceVoxelsRGBA);
+        }
         
         /*
          * Is label outline mode?
@@ -2187,6 +2221,202 @@ BrainOpenGLVolumeSliceDrawing::drawOrthogonalSliceWithCulling(const VolumeSliceV
     glShadeModel(GL_SMOOTH);
 }
 
+/**
+ * Get the colors for voxels in a sub-slice of an orthogonal slice.
+ * When a montage is being drawn, the sub-slices for all of the slices
+ * in the montage are colored on the first call and later calls for
+ * the other slices in the montage copy the colors.
+ *
+ * @param volumeFile
+ *    Volume containing the slice.
+ * @param mapIndex
+ *    Index of the map.
+ * @param sliceViewPlane
+ *    The plane for slice drawing.
+ * @param sliceIndex
+ *    Index of the slice.
+ * @param firstVoxelIJK
+ *    Indices of voxel for first corner of sub-slice (inclusive).
+ * @param lastVoxelIJK
+ *    Indices of voxel for last corner of sub-slice (inclusive).
+ * @param voxelCountXYZ
+ *    Voxel counts for each axis of the sub-slice.
+ * @param displayGroup
+ *    The selected display group.
+ * @param tabIndex
+ *    Index of selected tab.
+ * @param rgbaOut
+ *    Output containing the rgba values (must have been allocated
+ *    by caller to sufficient count of elements in the sub-slice).
+ * @return
+ *    Number of voxels with alpha greater than zero.
+ */
+int64_t
+BrainOpenGLVolumeSliceDrawing::getOrthogonalSubSliceColors(const VolumeMappableInterface* volumeFile,
+                                                           const int32_t mapIndex,
+                                                           const VolumeSliceViewPlaneEnum::Enum sliceViewPlane,
+                                                           const int64_t sliceIndex,
+                                                           const int64_t firstVoxelIJK[3],
+                                                           const int64_t lastVoxelIJK[3],
+                                                           const int64_t voxelCountXYZ[3],
+                                                           const DisplayGroupEnum::Enum displayGroup,
+                                                           const int32_t tabIndex,
+                                                           uint8_t* rgbaOut)
+{
+    if (m_montageSliceCoordinates.size() < 2) {
+        return volumeFile->getVoxelColorsForSubSliceInMap(mapIndex,
+                                                          sliceViewPlane,
+                                                          sliceIndex,
+                                                          firstVoxelIJK,
+                                                          lastVoxelIJK,
+                                                          voxelCountXYZ,
+                                                          displayGroup,
+                                                          tabIndex,
+                                                          rgbaOut);
+    }
+    
+    /*
+     * Find the volume's dimension that contains the slices
+     */
+    VolumeSpace::OrientTypes orient[3];
+    volumeFile->getVolumeSpace().getOrientation(orient);
+    int32_t sliceDim = -1;
+    for (int32_t whichDim = 0; whichDim < 3; whichDim++) {
+        switch (orient[whichDim]) {
+            case VolumeSpace::LEFT_TO_RIGHT:
+            case VolumeSpace::RIGHT_TO_LEFT:
+                if (sliceViewPlane == VolumeSliceViewPlaneEnum::PARASAGITTAL) {
+                    sliceDim = whichDim;
+                }
+                break;
+            case VolumeSpace::POSTERIOR_TO_ANTERIOR:
+            case VolumeSpace::ANTERIOR_TO_POSTERIOR:
+                if (sliceViewPlane == VolumeSliceViewPlaneEnum::CORONAL) {
+                    sliceDim = whichDim;
+                }
+                break;
+            case VolumeSpace::INFERIOR_TO_SUPERIOR:
+            case VolumeSpace::SUPERIOR_TO_INFERIOR:
+                if (sliceViewPlane == VolumeSliceViewPlaneEnum::AXIAL) {
+                    sliceDim = whichDim;
+                }
+                break;
+        }
+    }
+    CaretAssert(sliceDim >= 0);
+    
+    const int64_t sliceRgbaCount = voxelCountXYZ[0] * voxelCountXYZ[1] * voxelCountXYZ[2] * 4;
+    
+    /*
+     * Slices in the montage are all drawn with the same
+     * viewport size so the corners are usually the same
+     */
+    const MontageSliceColoring* coloring = NULL;
+    for (const MontageSliceColoring& msc : m_montageSliceColorings) {
+        if ((msc.m_volume == volumeFile)
+            && (msc.m_mapIndex == mapIndex)
+            && (msc.m_sliceViewPlane == sliceViewPlane)) {
+            bool sameCornersFlag = true;
+            for (int32_t i = 0; i < 3; i++) {
+                if (i != sliceDim) {
+                    if ((msc.m_firstVoxelIJK[i] != firstVoxelIJK[i])
+                        || (msc.m_lastVoxelIJK[i] != lastVoxelIJK[i])) {
+                        sameCornersFlag = false;
+                    }
+                }
+            }
+            if (sameCornersFlag) {
+                if (msc.m_sliceIndexToColorIndex.find(sliceIndex) != msc.m_sliceIndexToColorIndex.end()) {
+                    coloring = &msc;
+                    break;
+                }
+            }
+        }
+    }
+    
+    if (coloring == NULL) {
+        /*
+         * Convert the montage slice coordinates to slice indices in this volume
+         */
+        int64_t dimIJK[3], numMaps, numComponents;
+        volumeFile->getDimensions(dimIJK[0], dimIJK[1], dimIJK[2], numMaps, numComponents);
+        
+        float xyz[3];
+        volumeFile->indexToSpace(firstVoxelIJK[0], firstVoxelIJK[1], firstVoxelIJK[2],
+                                 xyz[0], xyz[1], xyz[2]);
+        int32_t xyzIndex = -1;
+        switch (sliceViewPlane) {
+            case VolumeSliceViewPlaneEnum::ALL:
+                CaretAssert(0);
+                break;
+            case VolumeSliceViewPlaneEnum::AXIAL:
+                xyzIndex = 2;
+                break;
+            case VolumeSliceViewPlaneEnum::CORONAL:
+                xyzIndex = 1;
+                break;
+            case VolumeSliceViewPlaneEnum::PARASAGITTAL:
+                xyzIndex = 0;
+                break;
+        }
+        CaretAssert(xyzIndex >= 0);
+        
+        MontageSliceColoring msc;
+        msc.m_volume         = volumeFile;
+        msc.m_mapIndex       = mapIndex;
+        msc.m_sliceViewPlane = sliceViewPlane;
+        for (int32_t i = 0; i < 3; i++) {
+            msc.m_firstVoxelIJK[i] = firstVoxelIJK[i];
+            msc.m_lastVoxelIJK[i]  = lastVoxelIJK[i];
+        }
+        
+        std::vector<int64_t> sliceIndices;
+        msc.m_sliceIndexToColorIndex.insert(std::make_pair(sliceIndex,
+                                                           0));
+        sliceIndices.push_back(sliceIndex);
+        for (const float sliceCoord : m_montageSliceCoordinates) {
+            xyz[xyzIndex] = sliceCoord;
+            int64_t ijk[3];
+            volumeFile->enclosingVoxel(xyz[0], xyz[1], xyz[2],
+                                       ijk[0], ijk[1], ijk[2]);
+            const int64_t montageSliceIndex = ijk[sliceDim];
+            if ((montageSliceIndex >= 0)
+                && (montageSliceIndex < dimIJK[sliceDim])) {
+                if (msc.m_sliceIndexToColorIndex.find(montageSliceIndex) == msc.m_sliceIndexToColorIndex.end()) {
+                    msc.m_sliceIndexToColorIndex.insert(std::make_pair(montageSliceIndex,
+                                                                       static_cast<int64_t>(sliceIndices.size())));
+                    sliceIndices.push_back(montageSliceIndex);
+                }
+            }
+        }
+        
+        msc.m_rgba.resize(sliceRgbaCount * sliceIndices.size());
+        msc.m_validVoxelCounts.resize(sliceIndices.size());
+        volumeFile->getVoxelColorsForSubSlicesInMap(mapIndex,
+                                                    sliceViewPlane,
+                                                    sliceIndices,
+                                                    firstVoxelIJK,
+                                                    lastVoxelIJK,
+                                                    voxelCountXYZ,
+                                                    displayGroup,
+                                                    tabIndex,
+                                                    &msc.m_rgba[0],
+                                                    &msc.m_validVoxelCounts[0]);
+        m_montageSliceColorings.push_back(msc);
+        coloring = &m_montageSliceColorings.back();
+    }
+    
+    CaretAssert(coloring);
+    const auto iter = coloring->m_sliceIndexToColorIndex.find(sliceIndex);
+    CaretAssert(iter != coloring->m_sliceIndexToColorIndex.end());
+    const int64_t colorIndex = iter->second;
+    CaretAssertVectorIndex(coloring->m_validVoxelCounts, colorIndex);
+    std::copy(coloring->m_rgba.begin() + (colorIndex * sliceRgbaCount),
+              coloring->m_rgba.begin() + ((colorIndex + 1) * sliceRgbaCount),
+              rgbaOut);
+    return coloring->m_validVoxelCounts[colorIndex];
+}
+
 /**
  * Create the equation for the slice plane
  *
@@ -4920,15 +5150,22 @@ BrainOpenGLVolumeSliceDrawing::drawOrthogonalSliceAllView(const VolumeSliceViewP
             << " rowstep IJK: " << AString::fromNumbers(rowStepIJK, 3, ",")
             << " colstep IJK: " << AString::fromNumbers(columnStepIJK, 3, ",") << std::endl;
         }
-        const int64_t validVoxelCount = volumeInterface->getVoxelColorsForSliceInMap(volInfo.mapIndex,
-                                                                                firstVoxelIJK,
-                                                                                rowStepIJK,
-                                                                                columnStepIJK,
-                                                                                drawBottomToTopInfo.numberOfVoxels,
-                                                                                drawLeftToRightInfo.numberOfVoxels,
-                                                                                displayGroup,
-                                                                                browserTabIndex,
-                                                                                sliceVoxelsRGBA);
+        int64_t validVoxelCount(0);
+        {
+            GraphicsRenderProfiler::ScopedTimer profileTimer("Volume Slice Coloring");
+            if (profileTimer.isActive()) {
+                profileTimer.setDetailName(volInfo.mapFile->getFileNameNoPath());
+            }
+            validVoxelCount = volumeInterface->getVoxelColorsForSliceInMap(volInfo.mapIndex,
+                                                                           firstVoxelIJK,
+                                                                           rowStepIJK,
+                                                                           columnStepIJK,
+                                                                           drawBottomToTopInfo.numberOfVoxels,
+                                                                           drawLeftToRightInfo.numberOfVoxels,
+                                                                           displayGroup,
+                                                                           browserTabIndex,
+                                                                           sliceVoxelsRGBA);
+        }
         
         /*
          * Is label outline mode?
@@ -21,6 +21,8 @@
  */
 /*LICENSE_END*/
 
+#include <map>
+
 #include "BrainOpenGLFixedPipeline.h"
 #include "CaretObject.h"
 #include "DisplayGroupEnum.h"
@@ -227,6 +229,53 @@ namespace caret {
             const int32_t m_columnIndex;
         };
 
+        /**
+         * Colors of the slices in a montage from one volume map that are
+         * colored together when the first of the slices is drawn
+         */
+        class MontageSliceColoring {
+        public:
+            /**
+             * Volume containing the slices
+             */
+            const VolumeMappableInterface* m_volume;
+            
+            /**
+             * Map index
+             */
+            int32_t m_mapIndex;
+            
+            /**
+             * Plane of the slices
+             */
+            VolumeSliceViewPlaneEnum::Enum m_sliceViewPlane;
+            
+            /**
+             * Corners of the slices (the slice's dimension is ignored)
+             */
+            int64_t m_firstVoxelIJK[3];
+            
+            /**
+             * Corners of the slices (the slice's dimension is ignored)
+             */
+            int64_t m_lastVoxelIJK[3];
+            
+            /**
+             * Index of each slice in the colors
+             */
+            std::map<int64_t, int64_t> m_sliceIndexToColorIndex;
+            
+            /**
+             * Coloring of the slices one after the other (4 components per voxel)
+             */
+            std::vector<uint8_t> m_rgba;
+            
+            /**
+             * Number of voxels with alpha greater than zero in each slice
+             */
+            std::vector<int64_t> m_validVoxelCounts;
+        };
+        
         BrainOpenGLVolumeSliceDrawing(const BrainOpenGLVolumeSliceDrawing&);
         
         BrainOpenGLVolumeSliceDrawing& operator=(const BrainOpenGLVolumeSliceDrawing&);
@@ -272,6 +321,17 @@ namespace caret {
                                             const float sliceCoordinates[3],
                                             const Plane& plane);
         
+        int64_t getOrthogonalSubSliceColors(const VolumeMappableInterface* volumeFile,
+                                            const int32_t mapIndex,
+                                            const VolumeSliceViewPlaneEnum::Enum sliceViewPlane,
+                                            const int64_t sliceIndex,
+                                            const int64_t firstVoxelIJK[3],
+                                            const int64_t lastVoxelIJK[3],
+                                            const int64_t voxelCountXYZ[3],
+                                            const DisplayGroupEnum::Enum displayGroup,
+                                            const int32_t tabIndex,
+                                            uint8_t* rgbaOut);
+        
         void createSlicePlaneEquation(const VolumeSliceProjectionTypeEnum::Enum sliceProjectionType,
                                       const VolumeSliceViewPlaneEnum::Enum sliceViewPlane,
                                       const float sliceCoordinates[3],
@@ -415,6 +475,12 @@ namespace caret {
         
         bool m_identificationModeFlag;
         
+        /** Coordinates of the slices in the montage being drawn (empty if not drawing a montage) */
+        std::vector<float> m_montageSliceCoordinates;
+        
+        /** Colors of montage slices that are colored together */
+        std::vector<MontageSliceColoring> m_montageSliceColorings;
+        
         static const int32_t IDENTIFICATION_INDICES_PER_VOXEL;
         
         // ADD_NEW_MEMBERS_HERE
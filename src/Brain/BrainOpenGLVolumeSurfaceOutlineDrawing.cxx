@@ -25,6 +25,8 @@
 
 #include <cmath>
 
+#include <QtConcurrent/QtConcurrent>
+
 #include "CaretAssert.h"
 #include "CaretLogger.h"
 #include "CaretOMP.h"
@@ -43,6 +45,8 @@
 #include "Surface.h"
 #include "SurfaceNodeColoring.h"
 #include "SurfacePlaneIntersectionToContour.h"
+#include "SurfaceTriangleSpanIndex.h"
+#include "TopologyHelper.h"
 #include "VolumeMappableInterface.h"
 #include "VolumeSurfaceOutlineModel.h"
 #include "VolumeSurfaceOutlineModelCacheKey.h"
@@ -290,6 +294,273 @@ BrainOpenGLVolumeSurfaceOutlineDrawing::drawSurfaceOutlineCachedOnVolume(const V
                              outlineSet,
                              fixedPipelineDrawing,
                              useNegativePolygonOffsetFlag);
+    
+    switch (sliceProjectionType) {
+        case VolumeSliceProjectionTypeEnum::VOLUME_SLICE_PROJECTION_OBLIQUE:
+            break;
+        case VolumeSliceProjectionTypeEnum::VOLUME_SLICE_PROJECTION_ORTHOGONAL:
+            prefetchSurfaceOutlines(underlayVolume,
+                                    sliceViewPlane,
+                                    sliceXYZ,
+                                    plane,
+                                    outlineSet,
+                                    fixedPipelineDrawing);
+            break;
+        case VolumeSliceProjectionTypeEnum::VOLUME_SLICE_PROJECTION_MPR:
+            break;
+        case VolumeSliceProjectionTypeEnum::VOLUME_SLICE_PROJECTION_MPR_THREE:
+            break;
+    }
+}
+
+/**
+ * Start creating, on background threads, the surface outlines for the
+ * slices next to the slice being drawn so that the outlines are in the
+ * outline cache when the user moves to those slices.  More slices are
+ * created in the direction the user is moving through the slices.
+ *
+ * @param underlayVolume
+ *    The underlay volume
+ * @param sliceViewPlane
+ *    Slice view plane (axial, coronal, parasagittal)
+ * @param sliceXYZ
+ *    Coordinates of slices
+ * @param plane
+ *    Plane of the volume slice on which surface outlines are drawn.
+ * @param outlineSet
+ *    The surface outline set.
+ * @param fixedPipelineDrawing
+ *    The fixed pipeline drawing.
+ */
+void
+BrainOpenGLVolumeSurfaceOutlineDrawing::prefetchSurfaceOutlines(const VolumeMappableInterface* underlayVolume,
+                                                                const VolumeSliceViewPlaneEnum::Enum sliceViewPlane,
+                                                                const float sliceXYZ[3],
+                                                                const Plane& plane,
+                                                                VolumeSurfaceOutlineSetModel* outlineSet,
+                                                                BrainOpenGLFixedPipeline* fixedPipelineDrawing)
+{
+    if (underlayVolume == NULL) {
+        return;
+    }
+    
+    int32_t axisIndex(-1);
+    switch (sliceViewPlane) {
+        case VolumeSliceViewPlaneEnum::ALL:
+            break;
+        case VolumeSliceViewPlaneEnum::AXIAL:
+            axisIndex = 2;
+            break;
+        case VolumeSliceViewPlaneEnum::CORONAL:
+            axisIndex = 1;
+            break;
+        case VolumeSliceViewPlaneEnum::PARASAGITTAL:
+            axisIndex = 0;
+            break;
+    }
+    if (axisIndex < 0) {
+        return;
+    }
+    
+    int64_t sliceIJK[3];
+    underlayVolume->enclosingVoxel(sliceXYZ[0], sliceXYZ[1], sliceXYZ[2],
+                                   sliceIJK[0], sliceIJK[1], sliceIJK[2]);
+    if ( ! underlayVolume->indexValid(sliceIJK[0], sliceIJK[1], sliceIJK[2])) {
+        return;
+    }
+    int64_t dimIJK[3], numMaps, numComponents;
+    underlayVolume->getDimensions(dimIJK[0], dimIJK[1], dimIJK[2], numMaps, numComponents);
+    
+    /*
+     * Find the volume dimension that moves through the slices and
+     * whether increasing the index increases the slice coordinate
+     */
+    float voxelXYZ[3];
+    underlayVolume->indexToSpace(sliceIJK, voxelXYZ);
+    int32_t sliceDimension(-1);
+    int32_t indexDirection(1);
+    float largestStep(0.0);
+    for (int32_t iDim = 0; iDim < 3; iDim++) {
+        int64_t ijk[3] = { sliceIJK[0], sliceIJK[1], sliceIJK[2] };
+        ijk[iDim] += 1;
+        float xyz[3];
+        underlayVolume->indexToSpace(ijk, xyz);
+        const float step(xyz[axisIndex] - voxelXYZ[axisIndex]);
+        if (std::fabs(step) > largestStep) {
+            largestStep    = std::fabs(step);
+            sliceDimension = iDim;
+            indexDirection = ((step > 0.0) ? 1 : -1);
+        }
+    }
+    if (sliceDimension < 0) {
+        return;
+    }
+    
+    const float sliceSpacing(underlayVolume->getMaximumVoxelSpacing());
+    
+    const int32_t numberOfOutlines = outlineSet->getNumberOfDislayedVolumeSurfaceOutlines();
+    for (int32_t io = 0; io < numberOfOutlines; io++) {
+        VolumeSurfaceOutlineModel* outline = outlineSet->getVolumeSurfaceOutlineModel(io);
+        if ( ! (outline->isDisplayed()
+                && outline->isDrawLinesModeSelected())) {
+            continue;
+        }
+        Surface* surface = outline->getSurface();
+        if (surface == NULL) {
+            continue;
+        }
+        
+        const int32_t scrollDirection(outline->updateSliceScrollDirection(sliceViewPlane,
+                                                                          sliceXYZ[axisIndex]));
+        
+        /*
+         * Outline for slice being drawn should have been added
+         * to the cache.  If not, the cache is not usable.
+         */
+        const VolumeSurfaceOutlineModelCacheKey sliceKey(underlayVolume,
+                                                         sliceViewPlane,
+                                                         sliceXYZ[axisIndex]);
+        if ( ! outline->isOutlineCachePrimitivesAvailable(sliceKey)) {
+            continue;
+        }
+        
+        const float thicknessPercentage(outline->getThicknessPercentageViewportHeight());
+        if (thicknessPercentage < 0.0f) {
+            continue;
+        }
+        
+        /*
+         * Number of slices away from the slice being drawn.  When the
+         * direction is not known, create one slice on each side.
+         */
+        std::vector<int32_t> sliceOffsets;
+        if (scrollDirection == 0) {
+            sliceOffsets = { 1, -1 };
+        }
+        else {
+            sliceOffsets = { scrollDirection, 2 * scrollDirection, 3 * scrollDirection };
+        }
+        
+        /*
+         * Surface data is copied so that the surface may be changed or
+         * destroyed while outlines are created on the background threads
+         */
+        std::shared_ptr<const std::vector<float>> coordinatesCopy;
+        std::shared_ptr<const std::vector<float>> vertexColoringCopy;
+        CaretPointer<const SurfaceTriangleSpanIndex> triangleSpanIndex;
+        CaretColorEnum::Enum outlineColor = CaretColorEnum::BLACK;
+        
+        for (const int32_t sliceOffset : sliceOffsets) {
+            int64_t ijk[3] = { sliceIJK[0], sliceIJK[1], sliceIJK[2] };
+            ijk[sliceDimension] += (sliceOffset * indexDirection);
+            if ((ijk[sliceDimension] < 0)
+                || (ijk[sliceDimension] >= dimIJK[sliceDimension])) {
+                continue;
+            }
+            float xyz[3];
+            underlayVolume->indexToSpace(ijk, xyz);
+            float neighborSliceXYZ[3] = { sliceXYZ[0], sliceXYZ[1], sliceXYZ[2] };
+            neighborSliceXYZ[axisIndex] = xyz[axisIndex];
+            
+            const VolumeSurfaceOutlineModelCacheKey neighborKey(underlayVolume,
+                                                                sliceViewPlane,
+                                                                neighborSliceXYZ[axisIndex]);
+            if (outline->isOutlineCachePrimitivesAvailable(neighborKey)) {
+                continue;
+            }
+            if ( ! outline->makeRoomForOutlineCachePrimitivesFuture()) {
+                break;
+            }
+            
+            if (coordinatesCopy == NULL) {
+                const float* xyzData(surface->getCoordinateData());
+                coordinatesCopy.reset(new std::vector<float>(xyzData,
+                                                             xyzData + (surface->getNumberOfNodes() * 3)));
+                triangleSpanIndex = surface->getTriangleSpanIndex();
+                const float* nodeColoringRGBA = getOutlineColoring(outline,
+                                                                   surface,
+                                                                   fixedPipelineDrawing,
+                                                                   outlineColor);
+                if (nodeColoringRGBA != NULL) {
+                    vertexColoringCopy.reset(new std::vector<float>(nodeColoringRGBA,
+                                                                    nodeColoringRGBA + (surface->getNumberOfNodes() * 4)));
+                }
+            }
+            
+            Plane neighborPlane(plane);
+            neighborPlane.shiftPlane(-plane.signedDistanceToPlane(neighborSliceXYZ));
+            
+            const CaretPointer<TopologyHelper> topologyHelper(surface->getTopologyHelper(true));
+            const float slicePlaneDepth(outline->getSlicePlaneDepth());
+            const float separation(getSeparation(outline));
+            
+            const QFuture<std::vector<GraphicsPrimitive*>> primitivesFuture =
+            QtConcurrent::run([=]() {
+                return createContoursInBackground(coordinatesCopy,
+                                                  topologyHelper,
+                                                  triangleSpanIndex,
+                                                  neighborPlane,
+                                                  sliceSpacing,
+                                                  outlineColor,
+                                                  vertexColoringCopy,
+                                                  thicknessPercentage,
+                                                  slicePlaneDepth,
+                                                  separation);
+            });
+            
+            const HistologySlice* histologySlice(NULL);
+            outline->setOutlineCachePrimitivesFuture(histologySlice,
+                                                     underlayVolume,
+                                                     neighborKey,
+                                                     primitivesFuture);
+        }
+    }
+}
+
+/**
+ * Get the coloring for a surface outline.
+ *
+ * @param outline
+ *    The surface outline.
+ * @param surface
+ *    Surface in the outline.
+ * @param fixedPipelineDrawing
+ *    The fixed pipeline drawing.
+ * @param outlineColorOut
+ *    Output with outline coloring or, if CUSTOM, use the vertex coloring.
+ * @return
+ *    The per-vertex coloring if the outline color is CUSTOM, else NULL.
+ */
+float*
+BrainOpenGLVolumeSurfaceOutlineDrawing::getOutlineColoring(VolumeSurfaceOutlineModel* outline,
+                                                           Surface* surface,
+                                                           BrainOpenGLFixedPipeline* fixedPipelineDrawing,
+                                                           CaretColorEnum::Enum& outlineColorOut)
+{
+    outlineColorOut = CaretColorEnum::BLACK;
+    int32_t colorSourceBrowserTabIndex = -1;
+    
+    VolumeSurfaceOutlineColorOrTabModel* colorOrTabModel = outline->getColorOrTabModel();
+    VolumeSurfaceOutlineColorOrTabModel::Item* selectedColorOrTabItem = colorOrTabModel->getSelectedItem();
+    switch (selectedColorOrTabItem->getItemType()) {
+        case VolumeSurfaceOutlineColorOrTabModel::Item::ITEM_TYPE_BROWSER_TAB:
+            colorSourceBrowserTabIndex = selectedColorOrTabItem->getBrowserTabIndex();
+            outlineColorOut = CaretColorEnum::CUSTOM;
+            break;
+        case VolumeSurfaceOutlineColorOrTabModel::Item::ITEM_TYPE_COLOR:
+            outlineColorOut = selectedColorOrTabItem->getColor();
+            break;
+    }
+    const bool surfaceColorFlag = (colorSourceBrowserTabIndex >= 0);
+    
+    float* nodeColoringRGBA = NULL;
+    if (surfaceColorFlag) {
+        nodeColoringRGBA = fixedPipelineDrawing->surfaceNodeColoring->colorSurfaceNodes(NULL,
+                                                                                        surface,
+                                                                                        colorSourceBrowserTabIndex);
+    }
+    
+    return nodeColoringRGBA;
 }
 
 /**
@@ -393,27 +664,10 @@ BrainOpenGLVolumeSurfaceOutlineDrawing::drawSurfaceOutlineCached(const Histology
                 }
                 else {
                     CaretColorEnum::Enum outlineColor = CaretColorEnum::BLACK;
-                    int32_t colorSourceBrowserTabIndex = -1;
-                    
-                    VolumeSurfaceOutlineColorOrTabModel* colorOrTabModel = outline->getColorOrTabModel();
-                    VolumeSurfaceOutlineColorOrTabModel::Item* selectedColorOrTabItem = colorOrTabModel->getSelectedItem();
-                    switch (selectedColorOrTabItem->getItemType()) {
-                        case VolumeSurfaceOutlineColorOrTabModel::Item::ITEM_TYPE_BROWSER_TAB:
-                            colorSourceBrowserTabIndex = selectedColorOrTabItem->getBrowserTabIndex();
-                            outlineColor = CaretColorEnum::CUSTOM;
-                            break;
-                        case VolumeSurfaceOutlineColorOrTabModel::Item::ITEM_TYPE_COLOR:
-                            outlineColor = selectedColorOrTabItem->getColor();
-                            break;
-                    }
-                    const bool surfaceColorFlag = (colorSourceBrowserTabIndex >= 0);
-                    
-                    float* nodeColoringRGBA = NULL;
-                    if (surfaceColorFlag) {
-                        nodeColoringRGBA = fixedPipelineDrawing->surfaceNodeColoring->colorSurfaceNodes(NULL,
-                                                                                                        surface,
-                                                                                                        colorSourceBrowserTabIndex);
-                    }
+                    float* nodeColoringRGBA = getOutlineColoring(outline,
+                                                                 surface,
+                                                                 fixedPipelineDrawing,
+                                                                 outlineColor);
                     
                     float sliceSpacing(1.0);
                     if (underlayVolume != NULL) {
@@ -766,6 +1020,96 @@ BrainOpenGLVolumeSurfaceOutlineDrawing::createContours(const SurfaceFile* surfac
     }
 }
 
+/**
+ * Create the contours on a background thread using a copy of the surface
+ * so that the surface may be changed or destroyed during creation of
+ * the contours.  Unlike createContours(), the depth steps are not
+ * performed in parallel since several of these may run at once.
+ *
+ * @param coordinates
+ *     Copy of the surface's coordinates.
+ * @param topologyHelper
+ *     Topology helper for the surface (must have sorted node info).
+ * @param triangleSpanIndex
+ *     Triangle span index for the surface.
+ * @param plane
+ *     Plane intersected with the surface.
+ * @param sliceSpacingMM
+ *     Spacing of slices in millimeters
+ * @param outlineColor
+ *     outline coloring or, if value is CUSTOM, use the vertex coloring
+ * @param nodeColoringRGBA
+ *     Copy of the per-vertex coloring if 'caretColor' is CUSTOM
+ * @param thicknessPercentage
+ *     Thickness of outlines percentage of viewport height
+ * @param slicePlaneDepth
+ *     Depth that slice plane along normal vector
+ * @param userOutlineSeparation
+ *     User override for outline separation when depth is greater than zero
+ * @return
+ *     The contour primitives.
+ */
+std::vector<GraphicsPrimitive*>
+BrainOpenGLVolumeSurfaceOutlineDrawing::createContoursInBackground(const std::shared_ptr<const std::vector<float>>& coordinates,
+                                                                   const CaretPointer<TopologyHelper>& topologyHelper,
+                                                                   const CaretPointer<const SurfaceTriangleSpanIndex>& triangleSpanIndex,
+                                                                   const Plane& plane,
+                                                                   const float sliceSpacingMM,
+                                                                   const CaretColorEnum::Enum outlineColor,
+                                                                   const std::shared_ptr<const std::vector<float>>& nodeColoringRGBA,
+                                                                   const float thicknessPercentage,
+                                                                   const float slicePlaneDepth,
+                                                                   const float userOutlineSeparation)
+{
+    CaretAssert(coordinates);
+    
+    std::vector<GraphicsPrimitive*> contourPrimitives;
+    
+    int32_t numSteps(1);
+    float depthStart(0.0);
+    float depthStepSize(0.0);
+    if (slicePlaneDepth > 0.0) {
+        computeDepthNumStepsAndStepSize(sliceSpacingMM,
+                                        slicePlaneDepth,
+                                        userOutlineSeparation,
+                                        numSteps,
+                                        depthStart,
+                                        depthStepSize);
+    }
+    
+    const int32_t numberOfVertices(static_cast<int32_t>(coordinates->size() / 3));
+    for (int32_t i = 0; i < numSteps; i++) {
+        const float depthOffset(depthStart +
+                                depthStepSize * static_cast<float>(i));
+        Plane intersectionPlane(plane);
+        intersectionPlane.shiftPlane(depthOffset);
+        SurfacePlaneIntersectionToContour contour(coordinates->data(),
+                                                  numberOfVertices,
+                                                  topologyHelper,
+                                                  triangleSpanIndex,
+                                                  intersectionPlane,
+                                                  plane,
+                                                  outlineColor,
+                                                  ((nodeColoringRGBA != NULL)
+                                                   ? nodeColoringRGBA->data()
+                                                   : NULL),
+                                                  thicknessPercentage);
+        AString errorMessage;
+        std::vector<GraphicsPrimitive*> primitives;
+        if (contour.createContours(primitives,
+                                   errorMessage)) {
+            contourPrimitives.insert(contourPrimitives.end(),
+                                     primitives.begin(),
+                                     primitives.end());
+        }
+        else {
+            CaretLogSevere(errorMessage);
+        }
+    }
+    
+    return contourPrimitives;
+}
+
 /**
  * Compute the number of steps and step size for slice plane depth
  * @param sliceSpacingMM
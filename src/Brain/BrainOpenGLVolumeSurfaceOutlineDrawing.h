@@ -27,6 +27,7 @@
 
 #include "CaretColorEnum.h"
 #include "CaretObject.h"
+#include "CaretPointer.h"
 #include "ModelTypeEnum.h"
 #include "VolumeSliceProjectionTypeEnum.h"
 #include "VolumeSliceViewPlaneEnum.h"
@@ -40,7 +41,10 @@ namespace caret {
     class HistologySlicesFile;
     class Matrix4x4;
     class Plane;
+    class Surface;
     class SurfaceFile;
+    class SurfaceTriangleSpanIndex;
+    class TopologyHelper;
     class VolumeMappableInterface;
     class VolumeSurfaceOutlineModelCacheKey;
     class VolumeSurfaceOutlineSetModel;
@@ -109,15 +113,27 @@ namespace caret {
                                          BrainOpenGLFixedPipeline* fixedPipelineDrawing,
                                          const bool useNegativePolygonOffsetFlag);
         
+        void prefetchSurfaceOutlines(const VolumeMappableInterface* underlayVolume,
+                                     const VolumeSliceViewPlaneEnum::Enum sliceViewPlane,
+                                     const float sliceXYZ[3],
+                                     const Plane& plane,
+                                     VolumeSurfaceOutlineSetModel* outlineSet,
+                                     BrainOpenGLFixedPipeline* fixedPipelineDrawing);
+        
+        float* getOutlineColoring(VolumeSurfaceOutlineModel* outline,
+                                  Surface* surface,
+                                  BrainOpenGLFixedPipeline* fixedPipelineDrawing,
+                                  CaretColorEnum::Enum& outlineColorOut);
+        
         void projectContoursToHistologySlice(const HistologySlice* histologySlice,
                                              std::vector<GraphicsPrimitive*>& contourPrimitives);
         
-        void computeDepthNumStepsAndStepSize(const float sliceSpacingMM,
-                                             const float slicePlaneDepth,
-                                             const float userOutlineSeparation,
-                                             int32_t& numStepsOut,
-                                             float& depthStartOut,
-                                             float& depthStepSizeOut);
+        static void computeDepthNumStepsAndStepSize(const float sliceSpacingMM,
+                                                    const float slicePlaneDepth,
+                                                    const float userOutlineSeparation,
+                                                    int32_t& numStepsOut,
+                                                    float& depthStartOut,
+                                                    float& depthStepSizeOut);
         
         void createContours(const SurfaceFile* surface,
                             const Plane& plane,
@@ -129,6 +145,17 @@ namespace caret {
                             const float userOutlineSeparation,
                             std::vector<GraphicsPrimitive*>& contourPrimitives);
         
+        static std::vector<GraphicsPrimitive*> createContoursInBackground(const std::shared_ptr<const std::vector<float>>& coordinates,
+                                                                          const CaretPointer<TopologyHelper>& topologyHelper,
+                                                                          const CaretPointer<const SurfaceTriangleSpanIndex>& triangleSpanIndex,
+                                                                          const Plane& plane,
+                                                                          const float sliceSpacingMM,
+                                                                          const CaretColorEnum::Enum caretColor,
+                                                                          const std::shared_ptr<const std::vector<float>>& vertexColoringRGBA,
+                                                                          const float contourThicknessPercentage,
+                                                                          const float slicePlaneDepth,
+                                                                          const float userOutlineSeparation);
+        
         float getSeparation(const VolumeSurfaceOutlineModel* outline) const;
         
         // ADD_NEW_MEMBERS_HERE
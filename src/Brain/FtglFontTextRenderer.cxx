@@ -87,6 +87,7 @@
 #include "GraphicsOpenGLError.h"
 #include "GraphicsPrimitiveV3f.h"
 #include "GraphicsPrimitiveV3fN3f.h"
+#include "GraphicsRenderProfiler.h"
 #include "GraphicsShape.h"
 #include "GraphicsUtilitiesOpenGL.h"
 #include "MathFunctions.h"
@@ -382,6 +383,8 @@ void
 FtglFontTextRenderer::drawTextAtViewportCoordinatesInternal(const AnnotationText& annotationText,
                                                             const TextStringGroup& textStringGroup)
 {
+    GraphicsRenderProfiler::ScopedTimer profileTimer("FTGL Text Rendering");
+    
     FTFont* font = getFont(annotationText,
                            FtglFontTypeEnum::TEXTURE,
                            false);
@@ -1440,6 +1443,8 @@ FtglFontTextRenderer::drawTextInModelSpaceInternal(const AnnotationText& annotat
                                                    const TextStringGroup& textStringGroup,
                                                    const float heightOrWidthForPercentageSizeText)
 {
+    GraphicsRenderProfiler::ScopedTimer profileTimer("FTGL Text Rendering");
+    
     FTFont* font = getFont(annotationText,
                            FtglFontTypeEnum::POLYGON,
                            heightOrWidthForPercentageSizeText,
@@ -2225,6 +2230,8 @@ m_textDrawingSpace(TextDrawingSpace::VIEWPORT)
 {
     CaretAssert(font);
     
+    GraphicsRenderProfiler::ScopedTimer profileTimer("Text Layout");
+    
     m_textDrawingSpace = TextDrawingSpace::VIEWPORT;
     if (m_annotationText.isInSurfaceSpaceWithTangentOffset()) {
         m_textDrawingSpace = TextDrawingSpace::MODEL;
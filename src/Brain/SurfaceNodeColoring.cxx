@@ -30,6 +30,7 @@
 #include "EventBrowserTabGet.h"
 #include "CaretAssert.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "CaretPreferences.h"
 #include "CiftiBrainordinateDataSeriesFile.h"
 #include "CiftiBrainordinateLabelFile.h"
@@ -47,6 +48,7 @@
 #include "EventModelSurfaceGet.h"
 #include "GiftiLabel.h"
 #include "GiftiLabelTable.h"
+#include "GraphicsRenderProfiler.h"
 #include "GroupAndNameHierarchyGroup.h"
 #include "LabelFile.h"
 #include "LabelDrawingProperties.h"
@@ -204,10 +206,30 @@ SurfaceNodeColoring::colorSurfaceNodes(Model* model,
         defaultColor = dsp->getDefaultColorRGB();
     }
     
+    GraphicsRenderProfiler::ScopedTimer profileTimer("Surface Node Coloring");
+    if (profileTimer.isActive()) {
+        profileTimer.setDetailName(surface->getFileNameNoPath());
+    }
+    
     const int numNodes = surface->getNumberOfNodes();
     const int numColorComponents = numNodes * 4;
     float *rgbaColor = new float[numColorComponents];
     
+    /*
+     * Coloring of each overlay that is kept with the surface
+     */
+    std::vector<SurfaceFile::OverlayColoringLayer>* overlayLayers = NULL;
+    if (surfaceModel != NULL) {
+        overlayLayers = &surface->getSurfaceOverlayColoringLayersForBrowserTab(browserTabIndex);
+    }
+    else if (surfaceMontageModel != NULL) {
+        overlayLayers = &surface->getSurfaceMontageOverlayColoringLayersForBrowserTab(browserTabIndex);
+    }
+    else if (wholeBrainModel != NULL) {
+        overlayLayers = &surface->getWholeBrainOverlayColoringLayersForBrowserTab(browserTabIndex);
+    }
+    CaretAssert(overlayLayers);
+    
     /*
      * Color the surface nodes
      */
@@ -216,6 +238,7 @@ SurfaceNodeColoring::colorSurfaceNodes(Model* model,
                             surface,
                             defaultColor,
                             overlaySet, 
+                            *overlayLayers,
                             rgbaColor);
     
     if (surfaceModel != NULL) {
@@ -303,6 +326,9 @@ SurfaceNodeColoring::showBrainordinateHighlightRegionOfInterest(const Brain* bra
  *    Default coloring for surface
  * @param overlaySet
  *    Surface overlay assignments for surface.
+ * @param overlayLayers
+ *    Coloring of each overlay from previous coloring.  Valid layers
+ *    for the same file and map are reused, others are recomputed.
  * @param rgbaNodeColors
  *    RGBA color components that are set by this method.
  */
@@ -312,6 +338,7 @@ SurfaceNodeColoring::colorSurfaceNodes(const DisplayPropertiesLabels* displayPro
                                        const Surface* surface,
                                        const std::array<uint8_t, 3>& defaultSurfaceColor,
                                        OverlaySet* overlaySet,
+                                       std::vector<SurfaceFile::OverlayColoringLayer>& overlayLayers,
                                        float* rgbaNodeColors)
 {
     const int32_t numNodes = surface->getNumberOfNodes();
@@ -340,7 +367,10 @@ SurfaceNodeColoring::colorSurfaceNodes(const DisplayPropertiesLabels* displayPro
     CaretAssert(brain);
     
     bool firstOverlayFlag = true;
-    float* overlayRGBV = new float[numNodes * 4];
+    
+    if (static_cast<int32_t>(overlayLayers.size()) < numberOfDisplayedOverlays) {
+        overlayLayers.resize(numberOfDisplayedOverlays);
+    }
     
     for (int32_t iOver = (numberOfDisplayedOverlays - 1); iOver >= 0; iOver--) {
         Overlay* overlay = overlaySet->getOverlay(iOver);
@@ -358,6 +388,35 @@ SurfaceNodeColoring::colorSurfaceNodes(const DisplayPropertiesLabels* displayPro
                 mapDataFileType = selectedMapFile->getDataFileType();
             }
             
+            CaretAssertVectorIndex(overlayLayers, iOver);
+            SurfaceFile::OverlayColoringLayer& layer = overlayLayers[iOver];
+            if (layer.m_validFlag
+                && (layer.m_mapFile == selectedMapFile)
+                && (layer.m_mapIndex == selectedMapIndex)
+                && (static_cast<int32_t>(layer.m_rgbv.size()) == (numNodes * 4))) {
+                /*
+                 * Coloring of file has not changed so only need to blend
+                 */
+                if (layer.m_coloringAssignedFlag) {
+                    compositeOverlayColoringLayer(&layer.m_rgbv[0],
+                                                  numNodes,
+                                                  overlay->getOpacity(),
+                                                  firstOverlayFlag,
+                                                  rgbaNodeColors);
+                    firstOverlayFlag = false;
+                }
+                continue;
+            }
+            
+            layer.m_rgbv.resize(numNodes * 4);
+            float* overlayRGBV = &layer.m_rgbv[0];
+            
+            GraphicsRenderProfiler::ScopedTimer profileOverlayTimer("Surface Overlay Coloring");
+            if (profileOverlayTimer.isActive()
+                && (selectedMapFile != NULL)) {
+                profileOverlayTimer.setDetailName(selectedMapFile->getFileNameNoPath());
+            }
+            
             bool isColoringValid = false;
             switch (mapDataFileType) {
                 case DataFileTypeEnum::ANNOTATION:
@@ -601,47 +660,17 @@ SurfaceNodeColoring::colorSurfaceNodes(const DisplayPropertiesLabels* displayPro
                 }
             }
             
+            layer.m_mapFile  = selectedMapFile;
+            layer.m_mapIndex = selectedMapIndex;
+            layer.m_coloringAssignedFlag = isColoringValid;
+            layer.m_validFlag = isOverlayColoringLayerCacheable(mapDataFileType);
+            
             if (isColoringValid) {
-                const float opacity = overlay->getOpacity();
-                const float oneMinusOpacity = 1.0 - opacity;
-                
-                for (int32_t i = 0; i < numNodes; i++) {
-                    const int32_t i4 = i * 4;
-                    const float valid = overlayRGBV[i4 + 3];
-                    if (valid > 0.0 ) {
-                        if (opacity < 1.0) {
-                            if (firstOverlayFlag) {
-                                /*
-                                 * When first overlay, there is nothing to 
-                                 * blend with
-                                 */
-                                rgbaNodeColors[i4]   = (overlayRGBV[i4]   * opacity);
-                                rgbaNodeColors[i4+1] = (overlayRGBV[i4+1] * opacity);
-                                rgbaNodeColors[i4+2] = (overlayRGBV[i4+2] * opacity);
-                            }
-                            else {
-                                /*
-                                 * Blend with underlaying colors
-                                 */
-                                rgbaNodeColors[i4]   = (overlayRGBV[i4]   * opacity)
-                                + (rgbaNodeColors[i4] * oneMinusOpacity);
-                                rgbaNodeColors[i4+1] = (overlayRGBV[i4+1] * opacity)
-                                + (rgbaNodeColors[i4+1] * oneMinusOpacity);
-                                rgbaNodeColors[i4+2] = (overlayRGBV[i4+2] * opacity)
-                                + (rgbaNodeColors[i4+2] * oneMinusOpacity);
-                            }
-                        }
-                        else {
-                            /*
-                             * No opacity so simple replace coloring
-                             */
-                            rgbaNodeColors[i4] = overlayRGBV[i4];
-                            rgbaNodeColors[i4+1] = overlayRGBV[i4+1];
-                            rgbaNodeColors[i4+2] = overlayRGBV[i4+2];
-                        }
-                    }
-                }
-                
+                compositeOverlayColoringLayer(overlayRGBV,
+                                              numNodes,
+                                              overlay->getOpacity(),
+                                              firstOverlayFlag,
+                                              rgbaNodeColors);
                 firstOverlayFlag = false;
             }
         }
@@ -662,8 +691,85 @@ SurfaceNodeColoring::colorSurfaceNodes(const DisplayPropertiesLabels* displayPro
     showBrainordinateHighlightRegionOfInterest(brain,
                                                surface,
                                                rgbaNodeColors);
+}
+
+/**
+ * Is the coloring of an overlay displaying a file of the given type cached?
+ * Coloring of connectivity matrix and dynamic files changes when data is
+ * loaded for identification without invalidating the file's coloring, so
+ * the coloring of these files is always recomputed.
+ *
+ * @param dataFileType
+ *    Type of the file.
+ * @return
+ *    True if the coloring may be reused until the file's coloring is invalidated.
+ */
+bool
+SurfaceNodeColoring::isOverlayColoringLayerCacheable(const DataFileTypeEnum::Enum dataFileType)
+{
+    bool cacheableFlag = false;
+    
+    switch (dataFileType) {
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_LABEL:
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_SCALAR:
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_TIME_SERIES:
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL_LABEL:
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL_SCALAR:
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL_SERIES:
+        case DataFileTypeEnum::LABEL:
+        case DataFileTypeEnum::METRIC:
+        case DataFileTypeEnum::RGBA:
+            cacheableFlag = true;
+            break;
+        default:
+            break;
+    }
     
-    delete[] overlayRGBV;
+    return cacheableFlag;
+}
+
+/**
+ * Blend the coloring of an overlay with the coloring of the overlays beneath it.
+ * Vertices not colored by the overlay (valid component is zero) are unchanged.
+ *
+ * @param overlayRGBV
+ *    Red, green, blue, valid components of the overlay's coloring.
+ * @param numberOfNodes
+ *    Number of nodes in surface.
+ * @param opacity
+ *    Opacity of the overlay.
+ * @param firstOverlayFlag
+ *    True if this is the first (bottom) overlay so there is nothing to blend with.
+ * @param rgbaNodeColors
+ *    RGBA color components that are updated.
+ */
+void
+SurfaceNodeColoring::compositeOverlayColoringLayer(const float* overlayRGBV,
+                                                   const int32_t numberOfNodes,
+                                                   const float opacity,
+                                                   const bool firstOverlayFlag,
+                                                   float* rgbaNodeColors)
+{
+    /*
+     * When fully opaque, overlay colors replace underlaying colors.
+     * When first overlay, there is nothing to blend with.
+     */
+    const float underlayWeight = (((opacity < 1.0f) && ( ! firstOverlayFlag))
+                                  ? (1.0f - opacity)
+                                  : 0.0f);
+    const float overlayWeight = ((opacity < 1.0f)
+                                 ? opacity
+                                 : 1.0f);
+    
+#pragma omp CARET_PARFOR schedule(static)
+    for (int32_t i = 0; i < numberOfNodes; i++) {
+        const int32_t i4 = i * 4;
+        if (overlayRGBV[i4 + 3] > 0.0f) {
+            rgbaNodeColors[i4]   = (overlayRGBV[i4]   * overlayWeight) + (rgbaNodeColors[i4]   * underlayWeight);
+            rgbaNodeColors[i4+1] = (overlayRGBV[i4+1] * overlayWeight) + (rgbaNodeColors[i4+1] * underlayWeight);
+            rgbaNodeColors[i4+2] = (overlayRGBV[i4+2] * overlayWeight) + (rgbaNodeColors[i4+2] * underlayWeight);
+        }
+    }
 }
 
 /**
@@ -26,8 +26,10 @@
 #include "CaretColorEnum.h"
 #include "CaretObject.h"
 #include "CaretPointer.h"
+#include "DataFileTypeEnum.h"
 #include "DisplayGroupEnum.h"
 #include "LabelDrawingTypeEnum.h"
+#include "SurfaceFile.h"
 
 namespace caret {
 
@@ -86,8 +88,17 @@ namespace caret {
                                const Surface* surface,
                                const std::array<uint8_t, 3>& defaultSurfaceColor,
                                OverlaySet* overlaySet,
+                               std::vector<SurfaceFile::OverlayColoringLayer>& overlayLayers,
                                float* rgbaNodeColors);
         
+        static bool isOverlayColoringLayerCacheable(const DataFileTypeEnum::Enum dataFileType);
+        
+        static void compositeOverlayColoringLayer(const float* overlayRGBV,
+                                                  const int32_t numberOfNodes,
+                                                  const float opacity,
+                                                  const bool firstOverlayFlag,
+                                                  float* rgbaNodeColors);
+        
         bool assignLabelColoring(const DisplayPropertiesLabels* dpl,
                                  const int32_t browserTabIndex,
                                  const BrainStructure* brainStructure,
@@ -26,6 +26,7 @@
 #include "CaretPreferences.h"
 #include "EventManager.h"
 #include "EventSurfaceColoringInvalidate.h"
+#include "GraphicsPrimitive.h"
 #include "SceneClass.h"
 #include "SceneClassAssistant.h"
 #include "SessionManager.h"
@@ -482,10 +483,28 @@ VolumeSurfaceOutlineModel::getOutlineCachePrimitives(const HistologySlice*
      * Don't let the cache become too big.
      * They do occupy buffers in the graphics memory
      * so we don't want to use too much of it.
+     * Outlines still on background threads are limited
+     * separately so that they are not waited upon here.
      */
     const int32_t maximumCacheSize(100);
-    if (m_outlineCache.size() > maximumCacheSize) {
-        clearOutlineCache();
+    if (static_cast<int32_t>(m_outlineCache.size()) > maximumCacheSize) {
+        for (auto iter : m_outlineCache) {
+            delete iter.second;
+        }
+        m_outlineCache.clear();
+    }
+    
+    /*
+     * Outline may have been created on a background thread
+     */
+    auto futureIter = m_outlineCacheFutures.find(key);
+    if (futureIter != m_outlineCacheFutures.end()) {
+        const std::vector<GraphicsPrimitive*> primitives(futureIter->second.result());
+        m_outlineCacheFutures.erase(futureIter);
+        setOutlineCachePrimitives(histologySlice,
+                                  underlayVolume,
+                                  key,
+                                  primitives);
     }
     
     auto iter = m_outlineCache.find(key);
@@ -520,6 +539,128 @@ VolumeSurfaceOutlineModel::clearOutlineCache()
         delete iter.second;
     }
     m_outlineCache.clear();
+    
+    /*
+     * Primitives are deleted on this thread since they are
+     * not used by the background threads after creation
+     */
+    for (auto& iter : m_outlineCacheFutures) {
+        for (GraphicsPrimitive* primitive : iter.second.result()) {
+            delete primitive;
+        }
+    }
+    m_outlineCacheFutures.clear();
+}
+
+/**
+ * Set the future that provides the outline primitives for the given cache
+ * key when the outline primitives are created on a background thread.
+ *
+ * @param histologySlice
+ *    The histology slice
+ * @param underlayVolume
+ *    The underlay volume
+ * @param key
+ *     Key into the outline cache identifying axis and slice
+ * @param primitivesFuture
+ *     Future that provides the primitives
+ */
+void
+VolumeSurfaceOutlineModel::setOutlineCachePrimitivesFuture(const HistologySlice*          histologySlice,
+                                                           const VolumeMappableInterface* underlayVolume,
+                                                           const VolumeSurfaceOutlineModelCacheKey& key,
+                                                           const QFuture<std::vector<GraphicsPrimitive*>>& primitivesFuture)
+{
+    CaretAssert( ! isOutlineCachePrimitivesAvailable(key));
+    
+    if (m_outlineCache.empty()
+        && m_outlineCacheFutures.empty()) {
+        m_outlineCacheInfo.update(this,
+                                  histologySlice,
+                                  underlayVolume);
+    }
+    
+    if (debugFlag) {
+        std::cout << "Adding future " << key.toString() << std::endl;
+    }
+    m_outlineCacheFutures.insert(std::make_pair(key, primitivesFuture));
+}
+
+/**
+ * Limit the number of outlines created on background threads.  Outlines
+ * that are finished but were never used are removed, one at a time, until
+ * there is room for another.  Outlines still being created are not removed
+ * since that would require waiting for them.
+ *
+ * @return True if there is room for another outline future, else false.
+ */
+bool
+VolumeSurfaceOutlineModel::makeRoomForOutlineCachePrimitivesFuture()
+{
+    const int32_t maximumFutureCount(12);
+    auto iter = m_outlineCacheFutures.begin();
+    while ((static_cast<int32_t>(m_outlineCacheFutures.size()) >= maximumFutureCount)
+           && (iter != m_outlineCacheFutures.end())) {
+        if (iter->second.isFinished()) {
+            if (debugFlag) {
+                std::cout << "Removing unused future " << iter->first.toString() << std::endl;
+            }
+            for (GraphicsPrimitive* primitive : iter->second.result()) {
+                delete primitive;
+            }
+            iter = m_outlineCacheFutures.erase(iter);
+        }
+        else {
+            ++iter;
+        }
+    }
+    
+    return (static_cast<int32_t>(m_outlineCacheFutures.size()) < maximumFutureCount);
+}
+
+/**
+ * @return True if the outline primitives for the given key are in the cache
+ * or are being created on a background thread.
+ *
+ * @param key
+ *     Key into the outline cache identifying axis and slice
+ */
+bool
+VolumeSurfaceOutlineModel::isOutlineCachePrimitivesAvailable(const VolumeSurfaceOutlineModelCacheKey& key) const
+{
+    return ((m_outlineCache.find(key) != m_outlineCache.end())
+            || (m_outlineCacheFutures.find(key) != m_outlineCacheFutures.end()));
+}
+
+/**
+ * Update the direction the user is moving through the slices in a slice view plane.
+ *
+ * @param sliceViewPlane
+ *     The slice view plane.
+ * @param sliceCoordinate
+ *     Coordinate of the slice being drawn.
+ * @return
+ *     Positive if slice coordinates are increasing, negative if decreasing,
+ *     or zero if the direction is not known.
+ */
+int32_t
+VolumeSurfaceOutlineModel::updateSliceScrollDirection(const VolumeSliceViewPlaneEnum::Enum sliceViewPlane,
+                                                      const float sliceCoordinate)
+{
+    int32_t& direction = m_scrollSliceDirections[sliceViewPlane];
+    
+    auto iter = m_scrollPreviousSliceCoordinates.find(sliceViewPlane);
+    if (iter != m_scrollPreviousSliceCoordinates.end()) {
+        if (sliceCoordinate > iter->second) {
+            direction = 1;
+        }
+        else if (sliceCoordinate < iter->second) {
+            direction = -1;
+        }
+    }
+    m_scrollPreviousSliceCoordinates[sliceViewPlane] = sliceCoordinate;
+    
+    return direction;
 }
 
 /* ==========================================================================================*/
@@ -23,9 +23,12 @@
 
 #include <map>
 
+#include <QFuture>
+
 #include "CaretObject.h"
 #include "EventListenerInterface.h"
 #include "SceneableInterface.h"
+#include "VolumeSliceViewPlaneEnum.h"
 #include "VolumeSurfaceOutlineColorOrTabModel.h"
 #include "VolumeSurfaceOutlineDrawingModeEnum.h"
 #include "VolumeSurfaceOutlineModelCacheKey.h"
@@ -96,6 +99,18 @@ namespace caret {
                                        const VolumeSurfaceOutlineModelCacheKey& key,
                                        std::vector<GraphicsPrimitive*>& primitivesOut);
         
+        void setOutlineCachePrimitivesFuture(const HistologySlice*          histologySlice,
+                                             const VolumeMappableInterface* underlayVolume,
+                                             const VolumeSurfaceOutlineModelCacheKey& key,
+                                             const QFuture<std::vector<GraphicsPrimitive*>>& primitivesFuture);
+        
+        bool isOutlineCachePrimitivesAvailable(const VolumeSurfaceOutlineModelCacheKey& key) const;
+        
+        bool makeRoomForOutlineCachePrimitivesFuture();
+        
+        int32_t updateSliceScrollDirection(const VolumeSliceViewPlaneEnum::Enum sliceViewPlane,
+                                           const float sliceCoordinate);
+        
         virtual SceneClass* saveToScene(const SceneAttributes* sceneAttributes,
                                         const AString& instanceName);
         
@@ -175,6 +190,15 @@ namespace caret {
         
         /** Cache for volume surface outlines */
         std::map<VolumeSurfaceOutlineModelCacheKey, VolumeSurfaceOutlineModelCacheValue*> m_outlineCache;
+        
+        /** Outlines being created on background threads that are moved to the cache when needed */
+        std::map<VolumeSurfaceOutlineModelCacheKey, QFuture<std::vector<GraphicsPrimitive*>>> m_outlineCacheFutures;
+        
+        /** Coordinate of slice most recently drawn in each slice view plane */
+        std::map<VolumeSliceViewPlaneEnum::Enum, float> m_scrollPreviousSliceCoordinates;
+        
+        /** Direction the user most recently moved the slices in each slice view plane */
+        std::map<VolumeSliceViewPlaneEnum::Enum, int32_t> m_scrollSliceDirections;
     };
     
 #ifdef __VOLUME_SURFACE_OUTLINE_MODEL_DECLARE__
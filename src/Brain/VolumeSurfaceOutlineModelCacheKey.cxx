@@ -57,7 +57,11 @@ m_mode(Mode::SLICE_VIEW_PLANE),
 m_sliceViewPlane(sliceViewPlane)
 {
     const float scaleFactor = computeScaleFactor(underlayVolume);
-    m_sliceCoordinateScaled = static_cast<int64_t>(sliceCoordinate * scaleFactor);
+    /*
+     * Round, not truncate, so that a coordinate computed slightly differently
+     * (such as from a voxel index for a neighboring slice) produces the same key
+     */
+    m_sliceCoordinateScaled = std::llround(sliceCoordinate * scaleFactor);
 }
 
 /**
@@ -97,10 +101,10 @@ VolumeSurfaceOutlineModelCacheKey::VolumeSurfaceOutlineModelCacheKey(const Volum
         const float scaleFactor = computeScaleFactor(underlayVolume);
         double a, b, c, d;
         plane.getPlane(a, b, c, d);
-        m_planeEquationScaled[0] = scaleFactor * a;
-        m_planeEquationScaled[1] = scaleFactor * b;
-        m_planeEquationScaled[2] = scaleFactor * c;
-        m_planeEquationScaled[3] = scaleFactor * d;
+        m_planeEquationScaled[0] = std::llround(scaleFactor * a);
+        m_planeEquationScaled[1] = std::llround(scaleFactor * b);
+        m_planeEquationScaled[2] = std::llround(scaleFactor * c);
+        m_planeEquationScaled[3] = std::llround(scaleFactor * d);
     }
 }
 
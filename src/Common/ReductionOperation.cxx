@@ -138,12 +138,11 @@ float ReductionOperation::reduce(const float* data, const int64_t& numElems, con
         }
         case ReductionEnum::MEDIAN:
         {
-            vector<float> dataCopy(numElems);
-            for (int64_t i = 0; i < numElems; ++i) dataCopy[i] = data[i];
-            sort(dataCopy.begin(), dataCopy.end());
+            vector<float> dataCopy(data, data + numElems);
+            nth_element(dataCopy.begin(), dataCopy.begin() + numElems / 2, dataCopy.end());//selection is linear time, and we only need the center
             if ((numElems & 1) == 0)//if even, average middle two
-            {
-                return (dataCopy[numElems / 2 - 1] + dataCopy[numElems / 2]) / 2.0f;
+            {//everything before the center is <= it, so the other middle element is the largest of those
+                return (*max_element(dataCopy.begin(), dataCopy.begin() + numElems / 2) + dataCopy[numElems / 2]) / 2.0f;
             } else {
                 return dataCopy[numElems / 2];//otherwise, take the center
             }
@@ -554,6 +553,122 @@ float ReductionOperation::reduceWeightedExcludeDev(const float* data, const floa
     return reduceWeighted(excluded.data(), exweights.data(), excluded.size(), type);
 }
 
+void ReductionOperation::reduceMultiple(const float* data, const int64_t& numElems, const vector<ReductionEnum::Enum>& types, float* resultsOut)
+{
+    CaretAssert(numElems > 0);
+    bool haveSum = false, haveResid = false;
+    double sum = 0.0, mean = 0.0, residsqr = 0.0;
+    for (int t = 0; t < (int)types.size(); ++t)
+    {
+        switch (types[t])
+        {
+            case ReductionEnum::SAMPSTDEV:
+            case ReductionEnum::TSNR:
+            case ReductionEnum::COV:
+                if (numElems < 2) throw CaretException("taking the sample standard deviation of 1 element would require dividing by zero");
+            //fallthrough
+            case ReductionEnum::MEAN:
+            case ReductionEnum::STDEV:
+            case ReductionEnum::VARIANCE:
+            case ReductionEnum::SUM:
+                break;
+            default:
+                resultsOut[t] = reduce(data, numElems, types[t]);
+                continue;
+        }
+        if (!haveSum)
+        {//same arithmetic as reduce(), so the results match exactly
+            for (int64_t i = 0; i < numElems; ++i) sum += data[i];
+            mean = sum / numElems;
+            haveSum = true;
+        }
+        if (types[t] == ReductionEnum::SUM)
+        {
+            resultsOut[t] = sum;
+            continue;
+        }
+        if (types[t] == ReductionEnum::MEAN)
+        {
+            resultsOut[t] = sum / numElems;
+            continue;
+        }
+        if (!haveResid)
+        {
+            for (int64_t i = 0; i < numElems; ++i)
+            {
+                double tempf = data[i] - mean;
+                residsqr += tempf * tempf;
+            }
+            haveResid = true;
+        }
+        switch (types[t])
+        {
+            case ReductionEnum::STDEV:
+                resultsOut[t] = sqrt(residsqr / numElems);
+                break;
+            case ReductionEnum::SAMPSTDEV:
+                resultsOut[t] = sqrt(residsqr / (numElems - 1));
+                break;
+            case ReductionEnum::VARIANCE:
+                resultsOut[t] = residsqr / numElems;
+                break;
+            case ReductionEnum::TSNR:
+                resultsOut[t] = mean / sqrt(residsqr / (numElems - 1));
+                break;
+            case ReductionEnum::COV:
+                resultsOut[t] = sqrt(residsqr / (numElems - 1)) / mean;
+                break;
+            default:
+                CaretAssertMessage(0, "unhandled type in sum-based reduction");
+                resultsOut[t] = 0.0f;
+        }
+    }
+}
+
+void ReductionOperation::percentiles(const float* data, const int64_t& numElems, const vector<float>& percents, float* resultsOut)
+{
+    CaretAssert(numElems > 0);
+    vector<float> dataCopy(data, data + numElems);
+    const bool sorted = (percents.size() > 1);//with several percentiles, one sort is cheaper than repeated selection
+    if (sorted) sort(dataCopy.begin(), dataCopy.end());
+    for (int p = 0; p < (int)percents.size(); ++p)
+    {
+        CaretAssert(percents[p] >= 0.0f && percents[p] <= 100.0f);
+        const double index = percents[p] / 100.0f * (numElems - 1);
+        if (index <= 0)
+        {
+            resultsOut[p] = (sorted ? dataCopy[0] : *min_element(dataCopy.begin(), dataCopy.end()));
+            continue;
+        }
+        if (index >= numElems - 1)
+        {
+            resultsOut[p] = (sorted ? dataCopy.back() : *max_element(dataCopy.begin(), dataCopy.end()));
+            continue;
+        }
+        double ipart, fpart;//double so that interpolation is accurate for large inputs
+        fpart = modf(index, &ipart);
+        const int64_t lower = (int64_t)ipart;
+        float lowVal, highVal;
+        if (sorted)
+        {
+            lowVal = dataCopy[lower];
+            highVal = dataCopy[lower + 1];
+        } else {//everything after the selected element is >= it, so the next one in sorted order is the smallest of those
+            nth_element(dataCopy.begin(), dataCopy.begin() + lower, dataCopy.end());
+            lowVal = dataCopy[lower];
+            highVal = *min_element(dataCopy.begin() + lower + 1, dataCopy.end());
+        }
+        resultsOut[p] = (1.0f - fpart) * lowVal + fpart * highVal;
+    }
+}
+
+float ReductionOperation::percentile(const float* data, const int64_t& numElems, const float& percent)
+{
+    float ret;
+    percentiles(data, numElems, vector<float>(1, percent), &ret);
+    return ret;
+}
+
 bool ReductionOperation::isLengthOneReasonable(const ReductionEnum::Enum& type)
 {
     switch(type)
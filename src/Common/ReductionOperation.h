@@ -24,6 +24,8 @@
 #include "AString.h"
 #include "ReductionEnum.h"
 
+#include <vector>
+
 namespace caret {
     
     class ReductionOperation
@@ -37,6 +39,11 @@ namespace caret {
         static float reduceWeighted(const float* data, const float* weights, const int64_t& numElems, const ReductionEnum::Enum& type);
         static float reduceWeightedExcludeDev(const float* data, const float* weights, const int64_t& numElems, const ReductionEnum::Enum& type, const float& numDevBelow, const float& numDevAbove);
         static float reduceWeightedOnlyNumeric(const float* data, const float* weights, const int64_t& numElems, const ReductionEnum::Enum& type);
+        ///compute several reductions of the same data, sharing the sum/deviation pass between the moment-based ones, results are identical to calling reduce() for each
+        static void reduceMultiple(const float* data, const int64_t& numElems, const std::vector<ReductionEnum::Enum>& types, float* resultsOut);
+        ///values at percentiles (0 to 100), interpolating between the two nearest elements, uses selection instead of sorting when there is only one
+        static void percentiles(const float* data, const int64_t& numElems, const std::vector<float>& percents, float* resultsOut);
+        static float percentile(const float* data, const int64_t& numElems, const float& percent);
         static bool isLengthOneReasonable(const ReductionEnum::Enum& type);
         static AString getHelpInfo();
     };
@@ -52,7 +52,7 @@ vector<CaretPointer<Border> > BorderTracingHelper::tracePrivate(vector<int>& mar
         {
             if (marked[i] != 0)
             {
-                const vector<int32_t>& edges = m_topoHelp->getNodeEdges(i);
+                const TopologyIndexList edges = m_topoHelp->getNodeEdges(i);
                 int numEdges = (int)edges.size();
                 for (int j = 0; j < numEdges; ++j)
                 {
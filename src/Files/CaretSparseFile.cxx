@@ -28,10 +28,52 @@
 
 #include <QByteArray>
 
+#include <algorithm>
+#include <cstring>
+
 using namespace caret;
 using namespace std;
 
 const char magic[] = "\0\0\0\0cst\0";
+const char magicV2[] = "\0\0\0\0cst\2";//version 2: rows delta and varint encoded, then compressed in blocks, with a table of block offsets
+
+namespace
+{
+    const int64_t ROWS_PER_BLOCK = 32;//random row access decodes a whole block, so keep them small
+    
+    //how version 2 files encode values
+    const int64_t VALUE_ENCODING_INTEGER = 0;//zigzag varint of the whole value
+    const int64_t VALUE_ENCODING_FIBERS = 1;//fiber fractions, each field of the packed value as its own varint (the count is in the high bits, so the whole value would always be a long varint)
+    const int V2_HEADER_FIELDS = 4;//dimensions, rows per block, value encoding
+    
+    void appendVarint(vector<char>& bytes, uint64_t value)
+    {
+        while (value >= 128)
+        {
+            bytes.push_back((char)((value & 127) | 128));
+            value >>= 7;
+        }
+        bytes.push_back((char)value);
+    }
+    
+    uint64_t readVarint(const char*& pos, const char* end)
+    {
+        uint64_t ret = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            if (pos >= end) throw DataFileException("compressed wbsparse block is truncated");
+            uint8_t byte = (uint8_t)*pos;
+            ++pos;
+            ret |= ((uint64_t)(byte & 127)) << shift;
+            if ((byte & 128) == 0) return ret;
+        }
+        throw DataFileException("invalid varint in compressed wbsparse block");
+    }
+    
+    //zigzag, so that small negative values are also short
+    uint64_t zigzag(const int64_t& value) { return (((uint64_t)value) << 1) ^ (uint64_t)(value >> 63); }
+    int64_t unzigzag(const uint64_t& value) { return (int64_t)(value >> 1) ^ -(int64_t)(value & 1); }
+}
 
 CaretSparseFile::CaretSparseFile(const AString& fileName)
 {
@@ -49,9 +91,15 @@ void CaretSparseFile::readFile(const AString& filename)
     FileInformation fileInfo(filename);//useful later for file size, but create it now to reduce the amount of time between file open and size check
     char buf[8];
     m_file.read(buf, 8);
-    for (int i = 0; i < 8; ++i)
+    m_version = 1;
+    if (memcmp(buf, magicV2, 8) == 0)
     {
-        if (buf[i] != magic[i]) throw DataFileException("file has the wrong magic string");
+        m_version = 2;
+    } else {
+        for (int i = 0; i < 8; ++i)
+        {
+            if (buf[i] != magic[i]) throw DataFileException("file has the wrong magic string");
+        }
     }
     m_file.read(m_dims, 2 * sizeof(int64_t));
     if (ByteOrderEnum::isSystemBigEndian())
@@ -59,21 +107,51 @@ void CaretSparseFile::readFile(const AString& filename)
         ByteSwapping::swapBytes(m_dims, 2);
     }
     if (m_dims[0] < 1 || m_dims[1] < 1) throw DataFileException("both dimensions must be positive");
-    m_indexArray.resize(m_dims[1] + 1);
-    vector<int64_t> lengthArray(m_dims[1]);
-    m_file.read(lengthArray.data(), m_dims[1] * sizeof(int64_t));
-    if (ByteOrderEnum::isSystemBigEndian())
+    int64_t xml_offset = -1;
+    m_cachedBlock = -1;
+    if (m_version == 2)
     {
-        ByteSwapping::swapBytes(lengthArray.data(), m_dims[1]);
-    }
-    m_indexArray[0] = 0;
-    for (int64_t i = 0; i < m_dims[1]; ++i)
-    {
-        if (lengthArray[i] > m_dims[0] || lengthArray[i] < 0) throw DataFileException("impossible value found in length array");
-        m_indexArray[i + 1] = m_indexArray[i] + lengthArray[i];
+        int64_t blockInfo[2];
+        m_file.read(blockInfo, 2 * sizeof(int64_t));
+        if (ByteOrderEnum::isSystemBigEndian())
+        {
+            ByteSwapping::swapBytes(blockInfo, 2);
+        }
+        m_rowsPerBlock = blockInfo[0];
+        m_valueEncoding = blockInfo[1];
+        if (m_rowsPerBlock < 1) throw DataFileException("impossible rows per block value in compressed wbsparse file");
+        if (m_valueEncoding != VALUE_ENCODING_INTEGER && m_valueEncoding != VALUE_ENCODING_FIBERS) throw DataFileException("unknown value encoding in compressed wbsparse file");
+        int64_t numBlocks = (m_dims[1] + m_rowsPerBlock - 1) / m_rowsPerBlock;
+        m_blockOffsets.resize(numBlocks + 1);
+        m_file.read(m_blockOffsets.data(), (numBlocks + 1) * sizeof(int64_t));
+        if (ByteOrderEnum::isSystemBigEndian())
+        {
+            ByteSwapping::swapBytes(m_blockOffsets.data(), numBlocks + 1);
+        }
+        m_valuesOffset = 8 + V2_HEADER_FIELDS * sizeof(int64_t) + (numBlocks + 1) * sizeof(int64_t);
+        if (m_blockOffsets[0] != m_valuesOffset) throw DataFileException("impossible value found in block offset array");
+        for (int64_t i = 0; i < numBlocks; ++i)
+        {
+            if (m_blockOffsets[i + 1] < m_blockOffsets[i]) throw DataFileException("impossible value found in block offset array");
+        }
+        xml_offset = m_blockOffsets[numBlocks];
+    } else {
+        m_indexArray.resize(m_dims[1] + 1);
+        vector<int64_t> lengthArray(m_dims[1]);
+        m_file.read(lengthArray.data(), m_dims[1] * sizeof(int64_t));
+        if (ByteOrderEnum::isSystemBigEndian())
+        {
+            ByteSwapping::swapBytes(lengthArray.data(), m_dims[1]);
+        }
+        m_indexArray[0] = 0;
+        for (int64_t i = 0; i < m_dims[1]; ++i)
+        {
+            if (lengthArray[i] > m_dims[0] || lengthArray[i] < 0) throw DataFileException("impossible value found in length array");
+            m_indexArray[i + 1] = m_indexArray[i] + lengthArray[i];
+        }
+        m_valuesOffset = 8 + 2 * sizeof(int64_t) + m_dims[1] * sizeof(int64_t);
+        xml_offset = m_valuesOffset + m_indexArray[m_dims[1]] * 2 * sizeof(int64_t);
     }
-    m_valuesOffset = 8 + 2 * sizeof(int64_t) + m_dims[1] * sizeof(int64_t);
-    int64_t xml_offset = m_valuesOffset + m_indexArray[m_dims[1]] * 2 * sizeof(int64_t);
     if (xml_offset >= fileInfo.size()) throw DataFileException("file is truncated");
     int64_t xml_length = fileInfo.size() - xml_offset;
     if (xml_length < 1) throw DataFileException("file is truncated");
@@ -100,9 +178,66 @@ CaretSparseFile::~CaretSparseFile()
 {
 }
 
+void CaretSparseFile::loadBlock(const int64_t& block)
+{
+    if (block == m_cachedBlock) return;
+    m_cachedBlock = -1;//in case of exception
+    int64_t numBytes = m_blockOffsets[block + 1] - m_blockOffsets[block];
+    QByteArray compressedBytes(numBytes, '\0');
+    m_file.seek(m_blockOffsets[block]);
+    m_file.read(compressedBytes.data(), numBytes);
+    QByteArray blockBytes = qUncompress(compressedBytes);
+    if (blockBytes.isEmpty()) throw DataFileException("failed to decompress block in wbsparse file");
+    const char* pos = blockBytes.constData(), *end = pos + blockBytes.size();
+    int64_t firstRow = block * m_rowsPerBlock, numRows = min(m_rowsPerBlock, m_dims[1] - firstRow);
+    m_blockRowStarts.resize(numRows + 1);
+    m_blockIndices.clear();
+    m_blockValues.clear();
+    m_blockRowStarts[0] = 0;
+    for (int64_t row = 0; row < numRows; ++row)
+    {
+        uint64_t numNonzero = readVarint(pos, end);
+        if (numNonzero > (uint64_t)m_dims[0]) throw DataFileException("impossible row length found in file");
+        int64_t lastIndex = -1;
+        for (uint64_t i = 0; i < numNonzero; ++i)
+        {
+            uint64_t delta = readVarint(pos, end);
+            if (delta >= (uint64_t)(m_dims[0] - lastIndex - 1)) throw DataFileException("impossible index value found in file");
+            lastIndex += (int64_t)delta + 1;
+            m_blockIndices.push_back(lastIndex);
+            if (m_valueEncoding == VALUE_ENCODING_FIBERS)
+            {//reassemble the packed value, so fibers decode the same as version 1
+                uint64_t totalCount = readVarint(pos, end);
+                uint64_t fraction0 = readVarint(pos, end), fraction1 = readVarint(pos, end), distance = readVarint(pos, end);
+                if (totalCount > 0xFFFFFFFFULL || fraction0 > 1023 || fraction1 > 1023 || distance > 1023) throw DataFileException("impossible fiber value found in file");
+                m_blockValues.push_back((int64_t)((totalCount << 32) | (fraction0 << 20) | (fraction1 << 10) | distance));
+            } else {
+                m_blockValues.push_back(unzigzag(readVarint(pos, end)));
+            }
+        }
+        m_blockRowStarts[row + 1] = (int64_t)m_blockIndices.size();
+    }
+    if (pos != end) throw DataFileException("extra data found in wbsparse file block");
+    m_cachedBlock = block;
+}
+
 void CaretSparseFile::getRow(const int64_t& index, int64_t* rowOut)
 {
     CaretAssert(index >= 0 && index < m_dims[1]);
+    if (m_version == 2)
+    {
+        loadBlock(index / m_rowsPerBlock);
+        int64_t row = index % m_rowsPerBlock;
+        for (int64_t i = 0; i < m_dims[0]; ++i)
+        {
+            rowOut[i] = 0;
+        }
+        for (int64_t i = m_blockRowStarts[row]; i < m_blockRowStarts[row + 1]; ++i)
+        {
+            rowOut[m_blockIndices[i]] = m_blockValues[i];
+        }
+        return;
+    }
     int64_t start = m_indexArray[index], end = m_indexArray[index + 1];
     int64_t numToRead = (end - start) * 2;
     m_scratchArray.resize(numToRead);
@@ -135,6 +270,14 @@ void CaretSparseFile::getRow(const int64_t& index, int64_t* rowOut)
 void CaretSparseFile::getRowSparse(const int64_t& index, vector<int64_t>& indicesOut, vector<int64_t>& valuesOut)
 {
     CaretAssert(index >= 0 && index < m_dims[1]);
+    if (m_version == 2)
+    {
+        loadBlock(index / m_rowsPerBlock);
+        int64_t row = index % m_rowsPerBlock;
+        indicesOut.assign(m_blockIndices.begin() + m_blockRowStarts[row], m_blockIndices.begin() + m_blockRowStarts[row + 1]);
+        valuesOut.assign(m_blockValues.begin() + m_blockRowStarts[row], m_blockValues.begin() + m_blockRowStarts[row + 1]);
+        return;
+    }
     int64_t start = m_indexArray[index], end = m_indexArray[index + 1];
     int64_t numToRead = (end - start) * 2, numNonzero = end - start;
     m_scratchArray.resize(numToRead);
@@ -206,7 +349,7 @@ void FiberFractions::zero()
     distance = 0.0f;
 }
 
-CaretSparseFileWriter::CaretSparseFileWriter(const AString& fileName, const CiftiXML& xml)
+CaretSparseFileWriter::CaretSparseFileWriter(const AString& fileName, const CiftiXML& xml, const bool& compressed)
 {
     if (!fileName.endsWith(".trajTEMP.wbsparse"))
     {//for now (and maybe forever), this format is single-purpose
@@ -222,21 +365,100 @@ CaretSparseFileWriter::CaretSparseFileWriter(const AString& fileName, const Cift
     {
         throw DataFileException("wbsparse files cannot be written compressed");
     }//because after we finish writing the data, we have to come back and write the lengths array
+    m_compressed = compressed;
+    m_encodedRows = 0;
+    m_valueEncoding = -1;//not known until the first row is written
     m_file.open(fileName, CaretBinaryFile::WRITE_TRUNCATE);
-    m_file.write(magic, 8);
-    int64_t tempdims[2] = { m_dims[0], m_dims[1] };
+    m_file.write((m_compressed ? magicV2 : magic), 8);
+    int64_t tempdims[V2_HEADER_FIELDS] = { m_dims[0], m_dims[1], ROWS_PER_BLOCK, VALUE_ENCODING_INTEGER };//value encoding is a placeholder, written for real in finish()
     if (ByteOrderEnum::isSystemBigEndian())
     {
-        ByteSwapping::swapBytes(tempdims, 2);
+        ByteSwapping::swapBytes(tempdims, V2_HEADER_FIELDS);
     }
-    m_file.write(tempdims, 2 * sizeof(int64_t));
+    m_file.write(tempdims, (m_compressed ? V2_HEADER_FIELDS : 2) * sizeof(int64_t));
     m_lengthArray.resize(m_dims[1], 0);//initialize the memory so that valgrind won't complain
-    m_file.write(m_lengthArray.data(), m_dims[1] * sizeof(uint64_t));//write it to get the file to the correct length
+    if (m_compressed)
+    {
+        int64_t numBlocks = (m_dims[1] + ROWS_PER_BLOCK - 1) / ROWS_PER_BLOCK;
+        m_valuesOffset = 8 + V2_HEADER_FIELDS * sizeof(int64_t) + (numBlocks + 1) * sizeof(int64_t);
+        m_blockOffsets.resize(numBlocks + 1, 0);
+        m_blockOffsets[0] = m_valuesOffset;
+        m_file.write(m_blockOffsets.data(), (numBlocks + 1) * sizeof(int64_t));//placeholder, written for real in finish()
+    } else {
+        m_file.write(m_lengthArray.data(), m_dims[1] * sizeof(uint64_t));//write it to get the file to the correct length
+        m_valuesOffset = 8 + 2 * sizeof(int64_t) + m_dims[1] * sizeof(int64_t);
+    }
     m_nextRowIndex = 0;
-    m_valuesOffset = 8 + 2 * sizeof(int64_t) + m_dims[1] * sizeof(int64_t);
+}
+
+void CaretSparseFileWriter::writeScratchArray(const int64_t& index)
+{
+    if (m_compressed)
+    {
+        while (m_encodedRows < index)
+        {
+            encodeRow(NULL, 0);//skipped rows
+        }
+        encodeRow(m_scratchArray.data(), m_scratchArray.size() / 2);
+        return;
+    }
+    if (ByteOrderEnum::isSystemBigEndian())
+    {
+        ByteSwapping::swapBytes(m_scratchArray.data(), m_scratchArray.size());
+    }
+    m_file.write(m_scratchArray.data(), m_scratchArray.size() * sizeof(int64_t));
+}
+
+void CaretSparseFileWriter::encodeRow(const int64_t* pairs, const int64_t& numNonzero)
+{
+    appendVarint(m_blockBytes, numNonzero);
+    int64_t lastIndex = -1;
+    for (int64_t i = 0; i < numNonzero; ++i)
+    {
+        appendVarint(m_blockBytes, pairs[i * 2] - lastIndex - 1);//indices are strictly increasing
+        lastIndex = pairs[i * 2];
+        if (m_valueEncoding == VALUE_ENCODING_FIBERS)
+        {
+            const uint64_t coded = (uint64_t)pairs[i * 2 + 1];
+            const uint64_t MASK = ((1 << 10) - 1);
+            appendVarint(m_blockBytes, coded >> 32);//total count
+            appendVarint(m_blockBytes, (coded >> 20) & MASK);//fractions and distance are at most 1000
+            appendVarint(m_blockBytes, (coded >> 10) & MASK);
+            appendVarint(m_blockBytes, coded & MASK);
+        } else {
+            appendVarint(m_blockBytes, zigzag(pairs[i * 2 + 1]));
+        }
+    }
+    ++m_encodedRows;
+    if (m_encodedRows % ROWS_PER_BLOCK == 0 || m_encodedRows == m_dims[1]) flushBlock();
+}
+
+void CaretSparseFileWriter::flushBlock()
+{
+    int64_t block = (m_encodedRows - 1) / ROWS_PER_BLOCK;
+    QByteArray compressedBytes = qCompress((const uchar*)m_blockBytes.data(), m_blockBytes.size());
+    m_file.write(compressedBytes.constData(), compressedBytes.size());
+    m_blockOffsets[block + 1] = m_blockOffsets[block] + compressedBytes.size();
+    m_blockBytes.clear();
+}
+
+void CaretSparseFileWriter::setValueEncoding(const int64_t& encoding)
+{
+    if (m_valueEncoding == -1)
+    {
+        m_valueEncoding = encoding;
+    } else if (m_valueEncoding != encoding) {
+        throw DataFileException("fiber and integer rows cannot be written to the same sparse file");
+    }
 }
 
 void CaretSparseFileWriter::writeRow(const int64_t& index, const int64_t* row)
+{
+    setValueEncoding(VALUE_ENCODING_INTEGER);
+    writeRowValues(index, row);
+}
+
+void CaretSparseFileWriter::writeRowValues(const int64_t& index, const int64_t* row)
 {
     CaretAssert(index < m_dims[1]);
     CaretAssert(index >= m_nextRowIndex);
@@ -257,16 +479,18 @@ void CaretSparseFileWriter::writeRow(const int64_t& index, const int64_t* row)
         }
     }
     m_lengthArray[index] = count;
-    if (ByteOrderEnum::isSystemBigEndian())
-    {
-        ByteSwapping::swapBytes(m_scratchArray.data(), m_scratchArray.size());
-    }
-    m_file.write(m_scratchArray.data(), m_scratchArray.size() * sizeof(int64_t));
+    writeScratchArray(index);
     m_nextRowIndex = index + 1;
     if (m_nextRowIndex == m_dims[1]) finish();
 }
 
 void CaretSparseFileWriter::writeRowSparse(const int64_t& index, const vector<int64_t>& indices, const vector<int64_t>& values)
+{
+    setValueEncoding(VALUE_ENCODING_INTEGER);
+    writeRowSparseValues(index, indices, values);
+}
+
+void CaretSparseFileWriter::writeRowSparseValues(const int64_t& index, const vector<int64_t>& indices, const vector<int64_t>& values)
 {
     CaretAssert(index < m_dims[1]);
     CaretAssert(index >= m_nextRowIndex);
@@ -287,17 +511,14 @@ void CaretSparseFileWriter::writeRowSparse(const int64_t& index, const vector<in
         m_scratchArray.push_back(indices[i]);
         m_scratchArray.push_back(values[i]);
     }
-    if (ByteOrderEnum::isSystemBigEndian())
-    {
-        ByteSwapping::swapBytes(m_scratchArray.data(), m_scratchArray.size());
-    }
-    m_file.write(m_scratchArray.data(), m_scratchArray.size() * sizeof(int64_t));
+    writeScratchArray(index);
     m_nextRowIndex = index + 1;
     if (m_nextRowIndex == m_dims[1]) finish();
 }
 
 void CaretSparseFileWriter::writeFibersRow(const int64_t& index, const FiberFractions* row)
 {
+    setValueEncoding(VALUE_ENCODING_FIBERS);
     if (m_scratchRow.size() != (size_t)m_dims[0]) m_scratchRow.resize(m_dims[0]);
     for (int64_t i = 0; i < m_dims[0]; ++i)
     {
@@ -308,18 +529,19 @@ void CaretSparseFileWriter::writeFibersRow(const int64_t& index, const FiberFrac
             encodeFibers(row[i], m_scratchRow[i]);
         }
     }
-    writeRow(index, (int64_t*)m_scratchRow.data());
+    writeRowValues(index, (int64_t*)m_scratchRow.data());
 }
 
 void CaretSparseFileWriter::writeFibersRowSparse(const int64_t& index, const vector<int64_t>& indices, const vector<FiberFractions>& values)
 {
+    setValueEncoding(VALUE_ENCODING_FIBERS);
     size_t numNonzero = values.size();//assume no zeros
     m_scratchSparseRow.resize(numNonzero);
     for (size_t i = 0; i < numNonzero; ++i)
     {
         encodeFibers(values[i], ((uint64_t*)m_scratchSparseRow.data())[i]);
     }
-    writeRowSparse(index, indices, m_scratchSparseRow);
+    writeRowSparseValues(index, indices, m_scratchSparseRow);
 }
 
 void CaretSparseFileWriter::finish()
@@ -331,8 +553,30 @@ void CaretSparseFileWriter::finish()
         m_lengthArray[m_nextRowIndex] = 0;
         ++m_nextRowIndex;
     }
+    if (m_compressed)
+    {
+        if (m_valueEncoding == -1) m_valueEncoding = VALUE_ENCODING_INTEGER;//no nonempty rows, so it doesn't matter
+        while (m_encodedRows < m_dims[1])
+        {
+            encodeRow(NULL, 0);
+        }
+    }
     QByteArray myXMLBytes = m_xml.writeXMLToQByteArray();
     m_file.write(myXMLBytes.constData(), myXMLBytes.size());
+    if (m_compressed)
+    {
+        m_file.seek(8 + 3 * sizeof(int64_t));
+        int64_t valueEncoding = m_valueEncoding;
+        if (ByteOrderEnum::isSystemBigEndian())
+        {
+            ByteSwapping::swapBytes(&valueEncoding, 1);
+            ByteSwapping::swapBytes(m_blockOffsets.data(), m_blockOffsets.size());
+        }
+        m_file.write(&valueEncoding, sizeof(int64_t));
+        m_file.write(m_blockOffsets.data(), m_blockOffsets.size() * sizeof(int64_t));
+        m_file.close();
+        return;
+    }
     m_file.seek(8 + 2 * sizeof(int64_t));
     if (ByteOrderEnum::isSystemBigEndian())
     {
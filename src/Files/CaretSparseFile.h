@@ -49,10 +49,15 @@ namespace caret {
         std::vector<int64_t> m_scratchArray, m_scratchSparseRow;
         CaretSparseFile(const CaretSparseFile& rhs);
         CiftiXML m_xml;
+        //version 2 (compressed) files: rows are in independently compressed blocks, the most recently used block is kept decoded
+        int m_version;
+        int64_t m_rowsPerBlock, m_valueEncoding, m_cachedBlock;
+        std::vector<int64_t> m_blockOffsets, m_blockRowStarts, m_blockIndices, m_blockValues;
+        void loadBlock(const int64_t& block);
     public:
         const int64_t* getDimensions() { return m_dims; }
 
-        CaretSparseFile() {};
+        CaretSparseFile() { m_version = 1; m_valueEncoding = 0; m_cachedBlock = -1; };
         
         virtual void readFile(const AString& filename);
         
@@ -85,8 +90,19 @@ namespace caret {
         std::vector<int64_t> m_scratchArray, m_scratchSparseRow;
         CaretSparseFileWriter(const CaretSparseFileWriter& rhs);
         CiftiXML m_xml;
+        bool m_compressed;
+        int64_t m_encodedRows, m_valueEncoding;
+        std::vector<int64_t> m_blockOffsets;
+        std::vector<char> m_blockBytes;
+        void setValueEncoding(const int64_t& encoding);
+        void writeRowValues(const int64_t& index, const int64_t* row);
+        void writeRowSparseValues(const int64_t& index, const std::vector<int64_t>& indices, const std::vector<int64_t>& values);
+        void writeScratchArray(const int64_t& index);
+        void encodeRow(const int64_t* pairs, const int64_t& numNonzero);
+        void flushBlock();
     public:
-        CaretSparseFileWriter(const AString& fileName, const CiftiXML& xml);
+        ///compressed uses the version 2 format: delta and varint encoded rows (fiber values with each field as a separate varint), compressed in blocks of rows, which reads much faster and is much smaller on disk
+        CaretSparseFileWriter(const AString& fileName, const CiftiXML& xml, const bool& compressed = false);
         
         ~CaretSparseFileWriter();
         
@@ -337,17 +337,17 @@ CiftiConnectivityMatrixDenseDynamicFile::getConnectivityCorrelationTwo() const
             CaretAssert(m_numberOfBrainordinates >= 2);
             const int64_t numData(m_numberOfBrainordinates
                                   * m_numberOfTimePoints);
-            m_dataSeriesMatrixData.resize(numData);
+            std::vector<float> dataSeriesMatrixData(numData); /* only needed until normalized by ConnectivityCorrelationTwo */
             
             std::vector<const float*> rowDataPointers;
             CaretAssert(m_parentDataSeriesCiftiFile);
             for (int64_t iRow = 0; iRow < m_numberOfBrainordinates; iRow++) {
                 const int64_t offset(iRow * m_numberOfTimePoints);
-                CaretAssertVectorIndex(m_dataSeriesMatrixData,
+                CaretAssertVectorIndex(dataSeriesMatrixData,
                                        (offset + (m_numberOfTimePoints - 1)));
-                m_parentDataSeriesCiftiFile->getRow(&m_dataSeriesMatrixData[offset],
+                m_parentDataSeriesCiftiFile->getRow(&dataSeriesMatrixData[offset],
                                                     iRow);
-                rowDataPointers.push_back(&m_dataSeriesMatrixData[offset]);
+                rowDataPointers.push_back(&dataSeriesMatrixData[offset]);
             }
             
             const int64_t nextTimePointStride(1);
@@ -95,8 +95,6 @@ namespace caret {
         mutable std::unique_ptr<ConnectivityCorrelationTwo> m_connectivityCorrelationTwo;
         
         mutable bool m_connectivityCorrelationFailedFlag = false;
-        
-        mutable std::vector<float> m_dataSeriesMatrixData;
 
         mutable std::unique_ptr<ConnectivityCorrelationSettings> m_correlationSettings;
         
@@ -332,17 +332,17 @@ CiftiConnectivityMatrixParcelDynamicFile::getConnectivityCorrelationTwo() const
             CaretAssert(m_numberOfParcels >= 2);
             const int64_t numData(m_numberOfParcels
                                   * m_numberOfTimePoints);
-            m_dataSeriesMatrixData.resize(numData);
+            std::vector<float> dataSeriesMatrixData(numData); /* only needed until normalized by ConnectivityCorrelationTwo */
             
             std::vector<const float*> rowDataPointers;
             CaretAssert(m_parentParcelSeriesCiftiFile);
             for (int64_t iRow = 0; iRow < m_numberOfParcels; iRow++) {
                 const int64_t offset(iRow * m_numberOfTimePoints);
-                CaretAssertVectorIndex(m_dataSeriesMatrixData,
+                CaretAssertVectorIndex(dataSeriesMatrixData,
                                        (offset + (m_numberOfTimePoints - 1)));
-                m_parentParcelSeriesCiftiFile->getRow(&m_dataSeriesMatrixData[offset],
+                m_parentParcelSeriesCiftiFile->getRow(&dataSeriesMatrixData[offset],
                                                       iRow);
-                rowDataPointers.push_back(&m_dataSeriesMatrixData[offset]);
+                rowDataPointers.push_back(&dataSeriesMatrixData[offset]);
             }
             
             const int64_t nextTimePointStride(1);
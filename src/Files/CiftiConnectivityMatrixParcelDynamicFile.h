@@ -112,8 +112,6 @@ namespace caret {
         mutable std::vector<float> m_parcelSeriesMatrixData;
 
         mutable std::unique_ptr<ConnectivityCorrelationSettings> m_correlationSettings;
-                
-        mutable std::vector<float> m_dataSeriesMatrixData;
         
         bool m_testConnectivityCorrelationFlag = true;
         
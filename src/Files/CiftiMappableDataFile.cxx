@@ -326,6 +326,10 @@ CiftiMappableDataFile::receiveEvent(Event* event)
         if (getDataFileType() == DataFileTypeEnum::CONNECTIVITY_SCALAR_DATA_SERIES) {
             /* Do not update colors in this file */
         }
+        else if ((colorInvalidateEvent->getMapFile() != NULL)
+                 && (colorInvalidateEvent->getMapFile() != this)) {
+            /* Only coloring of another file has changed */
+        }
         else {
             invalidateColoringInAllMaps();
         }
@@ -0,0 +1,217 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "ConnectedComponentHelper.h"
+
+#include "CaretAssert.h"
+#include "CaretOMP.h"
+#include "TopologyHelper.h"
+
+#include <algorithm>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    //NOTE: roots are always the lowest index in their set, so parent[i] <= i everywhere, which makes the final relabeling a single pass
+    int64_t findRoot(vector<int64_t>& parent, int64_t element)
+    {
+        while (parent[element] != element)
+        {
+            parent[element] = parent[parent[element]];//path halving
+            element = parent[element];
+        }
+        return element;
+    }
+
+    void unite(vector<int64_t>& parent, const int64_t& first, const int64_t& second)
+    {
+        int64_t root1 = findRoot(parent, first), root2 = findRoot(parent, second);
+        if (root1 == root2) return;
+        if (root1 < root2)
+        {
+            parent[root2] = root1;
+        } else {
+            parent[root1] = root2;
+        }
+    }
+
+    int64_t flattenLabels(vector<int64_t>& labels)
+    {
+        int64_t numElements = (int64_t)labels.size(), numComponents = 0;
+        for (int64_t i = 0; i < numElements; ++i)
+        {
+            if (labels[i] < 0) continue;//outside mask, or already converted (can't happen, parents are never after children)
+            if (labels[i] == i)
+            {
+                labels[i] = -2 - numComponents;//temporarily encode as negative so it can't be mistaken for a parent index
+                ++numComponents;
+            } else {
+                labels[i] = labels[labels[i]];//parent has a lower index, so it was already converted
+            }
+        }
+#pragma omp CARET_PARFOR schedule(static)
+        for (int64_t i = 0; i < numElements; ++i)
+        {
+            if (labels[i] != -1) labels[i] = -2 - labels[i];
+        }
+        return numComponents;
+    }
+
+    template <typename T>
+    void componentMembers(const vector<int64_t>& labels, const int64_t& numComponents, vector<vector<T> >& membersOut)
+    {
+        vector<int64_t> counts(numComponents, 0);
+        int64_t numElements = (int64_t)labels.size();
+        for (int64_t i = 0; i < numElements; ++i)
+        {
+            if (labels[i] >= 0) ++counts[labels[i]];
+        }
+        membersOut.clear();
+        membersOut.resize(numComponents);
+        for (int64_t i = 0; i < numComponents; ++i)
+        {
+            membersOut[i].reserve(counts[i]);
+        }
+        for (int64_t i = 0; i < numElements; ++i)
+        {
+            if (labels[i] >= 0) membersOut[labels[i]].push_back((T)i);
+        }
+    }
+}
+
+int64_t ConnectedComponentHelper::labelSurface(const TopologyHelper* topoHelp, const char* mask, vector<int64_t>& labelsOut)
+{
+    CaretAssert(topoHelp != NULL);
+    int32_t numNodes = topoHelp->getNumberOfNodes();
+    labelsOut.resize(numNodes);
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        labelsOut[i] = (mask[i] != 0 ? i : -1);
+    }
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        if (mask[i] == 0) continue;
+        int32_t numNeigh;
+        const int32_t* neighbors = topoHelp->getNodeNeighbors(i, numNeigh);
+        for (int32_t j = 0; j < numNeigh; ++j)
+        {
+            if (neighbors[j] < i && mask[neighbors[j]] != 0)//each edge only once
+            {
+                unite(labelsOut, i, neighbors[j]);
+            }
+        }
+    }
+    return flattenLabels(labelsOut);
+}
+
+int64_t ConnectedComponentHelper::labelVolume(const int64_t dims[3], const char* mask, vector<int64_t>& labelsOut, const int& connectivity)
+{
+    CaretAssert(connectivity == 6 || connectivity == 18 || connectivity == 26);
+    const int64_t frameSize = dims[0] * dims[1] * dims[2];
+    labelsOut.resize(frameSize);
+#pragma omp CARET_PARFOR schedule(static)
+    for (int64_t i = 0; i < frameSize; ++i)
+    {
+        labelsOut[i] = (mask[i] != 0 ? i : -1);
+    }
+    vector<int> stencil;//only the half of the neighborhood that comes earlier in index order, so each pair is only checked once
+    for (int dk = -1; dk <= 1; ++dk)
+    {
+        for (int dj = -1; dj <= 1; ++dj)
+        {
+            for (int di = -1; di <= 1; ++di)
+            {
+                int numNonzero = (di != 0 ? 1 : 0) + (dj != 0 ? 1 : 0) + (dk != 0 ? 1 : 0);
+                if (numNonzero == 0) continue;
+                if ((connectivity == 6 && numNonzero > 1) || (connectivity == 18 && numNonzero > 2)) continue;
+                if (dk > 0 || (dk == 0 && (dj > 0 || (dj == 0 && di > 0)))) continue;
+                stencil.push_back(di);
+                stencil.push_back(dj);
+                stencil.push_back(dk);
+            }
+        }
+    }
+    const int stencilSize = (int)stencil.size();
+    int64_t numSlabs = 1;
+#ifdef CARET_OMP
+    numSlabs = min((int64_t)omp_get_max_threads(), dims[2]);
+#endif
+    if (numSlabs < 1) numSlabs = 1;
+    vector<int64_t> slabStart(numSlabs + 1);
+    for (int64_t slab = 0; slab <= numSlabs; ++slab)
+    {
+        slabStart[slab] = dims[2] * slab / numSlabs;
+    }
+#pragma omp CARET_PARFOR schedule(static)
+    for (int64_t slab = 0; slab < numSlabs; ++slab)
+    {//each slab only links voxels inside itself, so the slabs never touch the same part of the parent array
+        for (int64_t k = slabStart[slab]; k < slabStart[slab + 1]; ++k)
+        {
+            for (int64_t j = 0; j < dims[1]; ++j)
+            {
+                for (int64_t i = 0; i < dims[0]; ++i)
+                {
+                    int64_t index = i + dims[0] * (j + dims[1] * k);
+                    if (mask[index] == 0) continue;
+                    for (int s = 0; s < stencilSize; s += 3)
+                    {
+                        int64_t ni = i + stencil[s], nj = j + stencil[s + 1], nk = k + stencil[s + 2];
+                        if (ni < 0 || ni >= dims[0] || nj < 0 || nj >= dims[1] || nk < slabStart[slab]) continue;
+                        int64_t neighIndex = ni + dims[0] * (nj + dims[1] * nk);
+                        if (mask[neighIndex] != 0) unite(labelsOut, index, neighIndex);
+                    }
+                }
+            }
+        }
+    }
+    for (int64_t slab = 1; slab < numSlabs; ++slab)
+    {//stitch each slab to the plane before it
+        int64_t k = slabStart[slab];
+        for (int64_t j = 0; j < dims[1]; ++j)
+        {
+            for (int64_t i = 0; i < dims[0]; ++i)
+            {
+                int64_t index = i + dims[0] * (j + dims[1] * k);
+                if (mask[index] == 0) continue;
+                for (int s = 0; s < stencilSize; s += 3)
+                {
+                    if (stencil[s + 2] != -1) continue;
+                    int64_t ni = i + stencil[s], nj = j + stencil[s + 1];
+                    if (ni < 0 || ni >= dims[0] || nj < 0 || nj >= dims[1]) continue;
+                    int64_t neighIndex = ni + dims[0] * (nj + dims[1] * (k - 1));
+                    if (mask[neighIndex] != 0) unite(labelsOut, index, neighIndex);
+                }
+            }
+        }
+    }
+    return flattenLabels(labelsOut);
+}
+
+void ConnectedComponentHelper::getComponentMembers(const vector<int64_t>& labels, const int64_t& numComponents, vector<vector<int64_t> >& membersOut)
+{
+    componentMembers(labels, numComponents, membersOut);
+}
+
+void ConnectedComponentHelper::getComponentMembers(const vector<int64_t>& labels, const int64_t& numComponents, vector<vector<int32_t> >& membersOut)
+{
+    componentMembers(labels, numComponents, membersOut);
+}
@@ -0,0 +1,51 @@
+#ifndef __CONNECTED_COMPONENT_HELPER_H__
+#define __CONNECTED_COMPONENT_HELPER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <vector>
+#include <stdint.h>
+
+namespace caret {
+
+    class TopologyHelper;
+
+    //union-find connected component labeling, shared by the find-clusters and remove-islands algorithms
+    //components are numbered in order of their lowest index, which is the same order a flood fill started from each unused element in index order finds them
+    class ConnectedComponentHelper
+    {
+        ConnectedComponentHelper();//static functions only
+    public:
+        ///label the components of the nonzero elements of mask on a surface, labels are -1 outside the mask, returns the number of components
+        static int64_t labelSurface(const TopologyHelper* topoHelp, const char* mask, std::vector<int64_t>& labelsOut);
+
+        ///label the components of the nonzero voxels of mask, connectivity is 6 (face), 18 (face and edge), or 26 (face, edge and corner)
+        ///large volumes are labeled in parallel slabs, which are then stitched together
+        static int64_t labelVolume(const int64_t dims[3], const char* mask, std::vector<int64_t>& labelsOut, const int& connectivity = 6);
+
+        ///get the members of each component in increasing index order
+        static void getComponentMembers(const std::vector<int64_t>& labels, const int64_t& numComponents, std::vector<std::vector<int64_t> >& membersOut);
+        static void getComponentMembers(const std::vector<int64_t>& labels, const int64_t& numComponents, std::vector<std::vector<int32_t> >& membersOut);
+    };
+
+}
+
+#endif //__CONNECTED_COMPONENT_HELPER_H__
@@ -115,27 +115,54 @@ m_dataStride(dataStride)
 {
     m_dataSets.resize(m_numberOfDataSets,
                       NULL);
+    
+    /*
+     * Normalized copy of all data sets, contiguous, so that each
+     * correlation is a single dot product of two rows.  The copy is
+     * only made for contiguous data, which the owning files copy from
+     * their parent file only to create this instance.  Strided data
+     * (volume frames) is used in place, since a copy would duplicate
+     * the parent's data including voxels outside of the brain.
+     */
+    const bool normalizedCopyFlag(m_dataStride == 1);
+    if (normalizedCopyFlag) {
+        m_normalizedData.resize(m_numberOfDataSets * m_numberOfDataElements);
+    }
 
 #pragma omp CARET_PARFOR schedule(dynamic)
-    for (int32_t dataSetIndex = 0; dataSetIndex < m_numberOfDataSets; dataSetIndex++) {
+    for (int64_t dataSetIndex = 0; dataSetIndex < m_numberOfDataSets; dataSetIndex++) {
         CaretAssertVectorIndex(dataSetPointers, dataSetIndex);
         const float* dataPtr(dataSetPointers[dataSetIndex]);
+        float* normalizedPtr(normalizedCopyFlag
+                             ? &m_normalizedData[dataSetIndex * m_numberOfDataElements]
+                             : NULL);
         
         float mean(0.0);
         float sqrtSumSquared(0.0);
         
-        computeMeanAndSumSquared(dataPtr,
-                                 numberOfDataElements,
-                                 dataStride,
-                                 mean,
-                                 sqrtSumSquared);
+        normalizeDataSet(dataPtr,
+                         numberOfDataElements,
+                         dataStride,
+                         normalizedPtr,
+                         mean,
+                         sqrtSumSquared);
         
-        m_dataSets[dataSetIndex] = new DataSet(dataSetIndex,
-                                               dataPtr,
-                                               m_numberOfDataElements,
-                                               m_dataStride,
-                                               mean,
-                                               sqrtSumSquared);
+        if (normalizedCopyFlag) {
+            m_dataSets[dataSetIndex] = new DataSet(dataSetIndex,
+                                                   normalizedPtr,
+                                                   m_numberOfDataElements,
+                                                   1,
+                                                   mean,
+                                                   sqrtSumSquared);
+        }
+        else {
+            m_dataSets[dataSetIndex] = new DataSet(dataSetIndex,
+                                                   dataPtr,
+                                                   m_numberOfDataElements,
+                                                   m_dataStride,
+                                                   mean,
+                                                   sqrtSumSquared);
+        }
     }
 
     if (m_debugFlag) {
@@ -144,7 +171,11 @@ m_dataStride(dataStride)
 }
 
 /**
- * Compute the mean and the square root of sum squared for the given data
+ * Compute the mean and the square root of sum squared for the given data,
+ * and copy it, normalized for the mode in the settings, into contiguous memory.
+ * For correlation, the copy is demeaned (unless no demean is enabled) and
+ * divided by the square root of sum squared, so correlation is just the dot
+ * product.  For covariance, the copy is only demeaned.
  * @param dataPtr
  *    Pointer to data
  * @param numberOfDataElements
@@ -152,36 +183,67 @@ m_dataStride(dataStride)
  * @param dataStride
  *    The offset of each element in one data pointer.  In most cases, the data is contiguous, this value is one.  In instance
  *    where the data is in the columns of a matrix, this value is the number of columns.
+ * @param normalizedDataOut
+ *    Output with normalized data, contiguous, numberOfDataElements long.
+ *    If NULL, only the mean and square root of sum squared are computed.
  * @param meanOut
  *    Output with mean
  * @param sqrtSumSquaredOut
  *    Output with square root of sum squared
  */
 void
-ConnectivityCorrelationTwo::computeMeanAndSumSquared(const float* dataPtr,
-                                                     const int64_t numberOfDataElements,
-                                                     const int64_t dataStride,
-                                                     float& meanOut,
-                                                     float& sqrtSumSquaredOut) const
+ConnectivityCorrelationTwo::normalizeDataSet(const float* dataPtr,
+                                             const int64_t numberOfDataElements,
+                                             const int64_t dataStride,
+                                             float* normalizedDataOut,
+                                             float& meanOut,
+                                             float& sqrtSumSquaredOut) const
 {
     /*
      * NOTE: Do not use OpenMP here.  OpenMP is used
      * in the method that calls this method.
      */
     double sum(0.0);
-    double sumSQ(0.0);
     for (int64_t j = 0; j < numberOfDataElements; j++) {
-        const int64_t offset(j * dataStride);
-        const float d(dataPtr[offset]);
-        sum   += d;
-        sumSQ += (d * d);
+        sum += dataPtr[j * dataStride];
     }
-    
     meanOut = (sum / static_cast<float>(numberOfDataElements));
-    const float sumSquared(m_settings.isCorrelationNoDemeanEnabled()
-                           ? sumSQ
-                           : (sumSQ - (m_numberOfDataElements * meanOut * meanOut)));
+    
+    bool correlationModeFlag(false);
+    switch (m_settings.getMode()) {
+        case ConnectivityCorrelationModeEnum::CORRELATION:
+            correlationModeFlag = true;
+            break;
+        case ConnectivityCorrelationModeEnum::COVARIANCE:
+            break;
+    }
+    
+    /*
+     * Sum the squared deviations directly, rather than
+     * sumSQ - n * mean^2, which can go negative from rounding
+     */
+    const float center((correlationModeFlag
+                        && m_settings.isCorrelationNoDemeanEnabled())
+                       ? 0.0
+                       : meanOut);
+    double sumSquared(0.0);
+    for (int64_t j = 0; j < numberOfDataElements; j++) {
+        const float d(dataPtr[j * dataStride] - center);
+        if (normalizedDataOut != NULL) {
+            normalizedDataOut[j] = d;
+        }
+        sumSquared += (d * d);
+    }
     sqrtSumSquaredOut = (std::sqrt(sumSquared));
+    
+    if ((normalizedDataOut != NULL)
+        && correlationModeFlag
+        && (sqrtSumSquaredOut > 0.0)) {
+        const double scale(1.0 / sqrtSumSquaredOut);
+        for (int64_t j = 0; j < numberOfDataElements; j++) {
+            normalizedDataOut[j] *= scale;
+        }
+    }
 }
 
 
@@ -358,45 +420,54 @@ ConnectivityCorrelationTwo::computeForDataSets(const DataSet& a,
 
     float value(0.0);
     
+    if ( ! m_normalizedData.empty()) {
+        /*
+         * Data sets were normalized when this instance was created,
+         * so both modes are a contiguous dot product
+         */
+        const double xySum(dsdot(a.m_dataElements,
+                                 b.m_dataElements,
+                                 m_numberOfDataElements));
+        
+        switch (m_settings.getMode()) {
+            case ConnectivityCorrelationModeEnum::CORRELATION:
+                if ((a.m_sqrtSumSquared != 0.0)
+                    && (b.m_sqrtSumSquared != 0.0)) {
+                    value = xySum;
+                    limitCorrelationValue(value);
+                }
+                break;
+            case ConnectivityCorrelationModeEnum::COVARIANCE:
+                value = (xySum / static_cast<double>(a.m_numDataElements));
+                break;
+        }
+        
+        return value;
+    }
+    
+    /*
+     * Strided data is used in place
+     */
+    const bool demeanFlag( ! m_settings.isCorrelationNoDemeanEnabled());
     switch (m_settings.getMode()) {
         case ConnectivityCorrelationModeEnum::CORRELATION:
         {
-            double xySum(0.0);
-            
-            if ((a.m_dataStride == 1)
-                && (b.m_dataStride == 1)) {
-                /*
-                 * "dsdot" requires contiguous data
-                 */
-                xySum = dsdot(a.m_dataElements,
-                              b.m_dataElements,
-                              m_numberOfDataElements);
-            }
-            else {
-                for (int64_t i = 0; i < a.m_numDataElements; i++) {
-                    xySum += (a.get(i) * b.get(i));
-                }
-            }
-            
-            const double ssxy(m_settings.isCorrelationNoDemeanEnabled()
-                              ? xySum
-                              : (xySum - (m_numberOfDataElements
-                                          * a.m_mean
-                                          * b.m_mean)));
-            
             const double denom(a.m_sqrtSumSquared * b.m_sqrtSumSquared);
             if (denom != 0.0) {
-                value = (ssxy / denom);
-
-                if (m_settings.isCorrelationFisherZEnabled()) {
-                    if (value > 0.999999) value = 0.999999;   /*prevent inf */
-                    if (value < -0.999999) value = -0.999999; /*prevent -inf*/
-                    value = 0.5 * std::log((1 + value) / (1 - value));
+                double xySum(0.0);
+                if (demeanFlag) {
+                    for (int64_t i = 0; i < a.m_numDataElements; i++) {
+                        xySum += ((a.get(i) - a.m_mean)
+                                  * (b.get(i) - b.m_mean));
+                    }
                 }
                 else {
-                    if (value > 1.0) value = 1.0; /*don't output anything silly*/
-                    if (value < -1.0) value = -1.0;
+                    for (int64_t i = 0; i < a.m_numDataElements; i++) {
+                        xySum += (a.get(i) * b.get(i));
+                    }
                 }
+                value = (xySum / denom);
+                limitCorrelationValue(value);
             }
         }
             break;
@@ -407,7 +478,7 @@ ConnectivityCorrelationTwo::computeForDataSets(const DataSet& a,
                 sum += ((a.get(i) - a.m_mean)
                         * (b.get(i) - b.m_mean));
             }
-
+            
             value = (sum / static_cast<double>(a.m_numDataElements));
         }
             break;
@@ -416,6 +487,26 @@ ConnectivityCorrelationTwo::computeForDataSets(const DataSet& a,
     return value;
 }
 
+/**
+ * Limit a correlation value to the valid range or apply the Fisher-Z
+ * transform if it is enabled.
+ * @param valueInOut
+ *    The correlation value.
+ */
+void
+ConnectivityCorrelationTwo::limitCorrelationValue(float& valueInOut) const
+{
+    if (m_settings.isCorrelationFisherZEnabled()) {
+        if (valueInOut > 0.999999) valueInOut = 0.999999;   /*prevent inf */
+        if (valueInOut < -0.999999) valueInOut = -0.999999; /*prevent -inf*/
+        valueInOut = 0.5 * std::log((1 + valueInOut) / (1 - valueInOut));
+    }
+    else {
+        if (valueInOut > 1.0) valueInOut = 1.0; /*don't output anything silly*/
+        if (valueInOut < -1.0) valueInOut = -1.0;
+    }
+}
+
 void
 ConnectivityCorrelationTwo::printDebugData()
 {
@@ -99,11 +99,14 @@ namespace caret {
         float computeForDataSets(const DataSet& a,
                                  const DataSet& b) const;
         
-        void computeMeanAndSumSquared(const float* dataPtr,
-                                      const int64_t numberOfDataElements,
-                                      const int64_t dataStride,
-                                      float& meanOut,
-                                      float& sqrtSumSquaredOut) const;
+        void limitCorrelationValue(float& valueInOut) const;
+        
+        void normalizeDataSet(const float* dataPtr,
+                              const int64_t numberOfDataElements,
+                              const int64_t dataStride,
+                              float* normalizedDataOut,
+                              float& meanOut,
+                              float& sqrtSumSquaredOut) const;
         
         void printDebugData();
         
@@ -119,6 +122,9 @@ namespace caret {
         
         std::vector<DataSet*> m_dataSets;
         
+        /** Normalized data for all data sets, one contiguous row per data set, empty if data is strided */
+        std::vector<float> m_normalizedData;
+        
         bool m_debugFlag = false;
         
         // ADD_NEW_MEMBERS_HERE
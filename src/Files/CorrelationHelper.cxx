@@ -0,0 +1,108 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+
+#include "CorrelationHelper.h"
+
+#include "CaretAssert.h"
+#include "CaretOMP.h"
+#include "dot_wrapper.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+using namespace caret;
+using namespace std;
+
+void CorrelationHelper::rankTransform(float* data, const int64_t& length)
+{
+    vector<pair<float, int64_t> > sorted(length);
+    for (int64_t i = 0; i < length; ++i)
+    {
+        sorted[i] = make_pair(data[i], i);
+    }
+    sort(sorted.begin(), sorted.end());
+    int64_t tieStart = 0;
+    while (tieStart < length)
+    {
+        int64_t tieEnd = tieStart + 1;
+        while (tieEnd < length && sorted[tieEnd].first == sorted[tieStart].first) ++tieEnd;
+        float rank = (tieStart + 1 + tieEnd) / 2.0f;//average of 1-based ranks tieStart + 1 through tieEnd
+        for (int64_t i = tieStart; i < tieEnd; ++i)
+        {
+            data[sorted[i].second] = rank;
+        }
+        tieStart = tieEnd;
+    }
+}
+
+void CorrelationHelper::normalize(float* data, const int64_t& length)
+{
+    double accum = 0.0;
+    for (int64_t i = 0; i < length; ++i)
+    {
+        accum += data[i];
+    }
+    float mean = accum / length;
+    accum = 0.0;
+    for (int64_t i = 0; i < length; ++i)
+    {
+        data[i] -= mean;
+        accum += data[i] * data[i];
+    }
+    float scale = 1.0 / sqrt(accum);
+    for (int64_t i = 0; i < length; ++i)
+    {
+        data[i] *= scale;
+    }
+}
+
+float CorrelationHelper::correlate(const float* rowA, const float* rowB, const int64_t& length, const bool& fisherZ)
+{
+    double r = dsdot(rowA, rowB, length);
+    if (fisherZ)
+    {
+        if (r > 0.999999) r = 0.999999;//prevent inf
+        if (r < -0.999999) r = -0.999999;//prevent -inf
+        return 0.5 * log((1 + r) / (1 - r));
+    } else {
+        if (r > 1.0) r = 1.0;//don't output anything silly
+        if (r < -1.0) r = -1.0;
+        return r;
+    }
+}
+
+void CorrelationHelper::correlateBlock(const vector<const float*>& rowsA, const vector<const float*>& rowsB, const int64_t& length,
+                                       const vector<float*>& outRows, const bool& fisherZ)
+{
+    CaretAssert(outRows.size() == rowsA.size());
+    const int64_t numRowsA = (int64_t)rowsA.size(), numRowsB = (int64_t)rowsB.size();
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int64_t i = 0; i < numRowsA; ++i)
+    {//each A row is reused against the whole B block while it is in cache
+        const float* rowA = rowsA[i];
+        float* outRow = outRows[i];
+        for (int64_t j = 0; j < numRowsB; ++j)
+        {
+            outRow[j] = correlate(rowA, rowsB[j], length, fisherZ);
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef __CORRELATION_HELPER_H__
+#define __CORRELATION_HELPER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+
+#include <vector>
+#include <stdint.h>
+
+namespace caret {
+
+    //shared row correlation kernel for the cifti correlation commands: prepare each row once, then every correlation is a single SIMD dot product
+    class CorrelationHelper
+    {
+        CorrelationHelper();//static functions only
+    public:
+        ///replace the values with their ranks starting from 1, tied values get the average of the ranks they span, for spearman correlation
+        static void rankTransform(float* data, const int64_t& length);
+
+        ///subtract the mean and scale to unit length, so the correlation of two normalized rows is their dot product
+        ///a constant row has nothing to scale, and becomes NaN, like the division by zero it would otherwise get
+        static void normalize(float* data, const int64_t& length);
+
+        ///correlation of two normalized rows, clamped to [-1, 1], or artanh of it (clamped to avoid infinity) with fisherZ
+        static float correlate(const float* rowA, const float* rowB, const int64_t& length, const bool& fisherZ);
+
+        ///correlate every normalized row in rowsA with every normalized row in rowsB, outRows[i][j] gets rowsA[i] with rowsB[j]
+        ///parallel over rowsA, keep the rowsB block small enough to stay in cache
+        static void correlateBlock(const std::vector<const float*>& rowsA, const std::vector<const float*>& rowsB, const int64_t& length,
+                                   const std::vector<float*>& outRows, const bool& fisherZ);
+    };
+
+}
+
+#endif //__CORRELATION_HELPER_H__
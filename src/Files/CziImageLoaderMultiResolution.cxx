@@ -59,6 +59,7 @@ CziImageLoaderMultiResolution::CziImageLoaderMultiResolution()
 CziImageLoaderMultiResolution::~CziImageLoaderMultiResolution()
 {
     m_cziImage.reset();
+    m_imageCache.clear();
 }
 
 /**
@@ -162,6 +163,11 @@ CziImageLoaderMultiResolution::updateImage(const CziImage* cziImage,
     
     if (m_forceImageReloadFlag) {
         m_reloadImageFlag = true;
+        
+        /*
+         * Cached images may be out of date (preferences changed, etc.)
+         */
+        m_imageCache.clear();
     }
     
     const CziImageFile::CziSceneInfo& cziSceneInfo = (allFramesFlag
@@ -226,6 +232,7 @@ CziImageLoaderMultiResolution::updateImage(const CziImage* cziImage,
     }
     
     if (m_reloadImageFlag) {
+        m_loadedImageName.clear();
         CziImage* newImage(loadImageForPyrmaidLayer(cziImage,
                                                     cziSceneInfo,
                                                     transform,
@@ -235,7 +242,9 @@ CziImageLoaderMultiResolution::updateImage(const CziImage* cziImage,
                                                     zoomLayerIndex));
         if (newImage != NULL) {
             if (newImage != m_cziImage.get()) {
-                m_cziImage.reset(newImage);
+                m_cziImage = addImageToCache(newImage,
+                                             m_loadedImageName,
+                                             channelIndex);
             }
         }
         else {
@@ -263,6 +272,74 @@ CziImageLoaderMultiResolution::forceImageReloading()
     m_forceImageReloadFlag = true;
 }
 
+/**
+ * @return An image from the cache that was loaded from the given pyramid layer/channel and that
+ * contains the given region or NULL if no image in the cache contains the region.
+ * @param cziName
+ *    Name of the image (contains frame and pyramid layer)
+ * @param channelIndex
+ *    Index of channel
+ * @param logicalRegionRect
+ *    Region of the image (logical coordinates) that must be in the cached image
+ */
+CziImage*
+CziImageLoaderMultiResolution::getCachedImage(const AString& cziName,
+                                              const int32_t channelIndex,
+                                              const QRectF& logicalRegionRect) const
+{
+    for (const auto& ci : m_imageCache) {
+        if ((ci.m_cziName == cziName)
+            && (ci.m_channelIndex == channelIndex)) {
+            CaretAssert(ci.m_cziImage);
+            if (ci.m_cziImage->getImageDataLogicalRect().contains(logicalRegionRect)) {
+                return ci.m_cziImage.get();
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Add an image to the cache.  If the image is already in the cache, it is moved to the front
+ * of the cache.  If the cache is full, the least recently used image is removed.
+ * @param cziImage
+ *    Image added to the cache.  If not already in the cache, the cache takes ownership of the image.
+ * @param cziName
+ *    Name of the image (contains frame and pyramid layer)
+ * @param channelIndex
+ *    Index of channel
+ * @return
+ *    Shared pointer to the image.
+ */
+std::shared_ptr<CziImage>
+CziImageLoaderMultiResolution::addImageToCache(CziImage* cziImage,
+                                               const AString& cziName,
+                                               const int32_t channelIndex)
+{
+    CaretAssert(cziImage);
+    
+    for (auto iter = m_imageCache.begin();
+         iter != m_imageCache.end();
+         iter++) {
+        if (iter->m_cziImage.get() == cziImage) {
+            const CachedImage cachedImage(*iter);
+            m_imageCache.erase(iter);
+            m_imageCache.push_front(cachedImage);
+            return cachedImage.m_cziImage;
+        }
+    }
+    
+    std::shared_ptr<CziImage> imagePointer(cziImage);
+    m_imageCache.push_front(CachedImage(cziName,
+                                        channelIndex,
+                                        imagePointer));
+    while (static_cast<int32_t>(m_imageCache.size()) > s_maximumNumberOfCachedImages) {
+        m_imageCache.pop_back();
+    }
+    
+    return imagePointer;
+}
+
 /**
  * Get best layer index
  * @param cziSceneInfo
@@ -852,6 +929,11 @@ CziImageLoaderMultiResolution::loadImageForPyrmaidLayerForPixelCoords(const CziI
     
     CaretAssert(rectToLoad.isValid());
     
+    /*
+     * Region of the image that is within the viewport
+     */
+    const QRectF viewportRegionRect(rectToLoad);
+    
     CaretAssertVectorIndex(allPyramidLayers, pyramidLayerIndex);
     const auto& selectedPyramidLayer(allPyramidLayers[pyramidLayerIndex]);
     if ((selectedPyramidLayer.m_logicalWidthForImageReading == cziSceneInfo.m_logicalRectangle.width())
@@ -919,13 +1001,27 @@ CziImageLoaderMultiResolution::loadImageForPyrmaidLayerForPixelCoords(const CziI
         }
     }
     
-    ElapsedTimer timer;
-    timer.start();
-    
     const AString cziName(cziSceneInfo.getName()
                           + " PyramidLayer="
                           + AString::number(pyramidLayerIndex));
+    
+    /*
+     * An image recently loaded from the same pyramid layer may
+     * contain the region in the viewport (user panned or zoomed back)
+     */
+    CziImage* cachedImage(getCachedImage(cziName,
+                                         channelIndex,
+                                         viewportRegionRect));
+    if (cachedImage != NULL) {
+        if (cziDebugFlag) std::cout << "Using cached image for pyramid index=" << pyramidLayerIndex << std::endl;
+        return cachedImage;
+    }
+    
+    ElapsedTimer timer;
+    timer.start();
+    
     if (cziDebugFlag) std::cout << "Loading pyramid index=" << pyramidLayerIndex << ", rect=" << CziUtilities::qRectToString(rectToLoad) << std::endl;
+    m_loadedImageName = cziName;
     AString errorMessage;
     CziImage* cziImageOut = m_cziImageFile->readFromCziImageFile(s_imageDataFormatForReading,
                                                                  cziName,
@@ -1030,6 +1126,11 @@ CziImageLoaderMultiResolution::loadImageForPyrmaidLayerForPlaneCoords(const CziI
      */
     QRectF logicalRectToLoad = m_cziImageFile->planeRectToLogicalRect(planeRectToLoad);
     
+    /*
+     * Region of the image that is within the viewport
+     */
+    const QRectF viewportRegionRect(logicalRectToLoad);
+    
     CaretAssertVectorIndex(allPyramidLayers, pyramidLayerIndex);
     const auto& selectedPyramidLayer(allPyramidLayers[pyramidLayerIndex]);
     if ((selectedPyramidLayer.m_logicalWidthForImageReading == cziSceneInfo.m_logicalRectangle.width())
@@ -1097,14 +1198,27 @@ CziImageLoaderMultiResolution::loadImageForPyrmaidLayerForPlaneCoords(const CziI
         }
     }
     
-    ElapsedTimer timer;
-    timer.start();
-    
-    
     const AString cziName(cziSceneInfo.getName()
                           + " PyramidLayer="
                           + AString::number(pyramidLayerIndex));
+    
+    /*
+     * An image recently loaded from the same pyramid layer may
+     * contain the region in the viewport (user panned or zoomed back)
+     */
+    CziImage* cachedImage(getCachedImage(cziName,
+                                         channelIndex,
+                                         viewportRegionRect));
+    if (cachedImage != NULL) {
+        if (cziDebugFlag) std::cout << "Using cached image for pyramid index=" << pyramidLayerIndex << std::endl;
+        return cachedImage;
+    }
+    
+    ElapsedTimer timer;
+    timer.start();
+    
     if (cziDebugFlag) std::cout << "Loading pyramid index=" << pyramidLayerIndex << ", rect=" << CziUtilities::qRectToString(logicalRectToLoad) << std::endl;
+    m_loadedImageName = cziName;
     AString errorMessage;
     CziImage* cziImageOut = m_cziImageFile->readFromCziImageFile(s_imageDataFormatForReading,
                                                                  cziName,
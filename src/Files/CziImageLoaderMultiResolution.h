@@ -23,6 +23,7 @@
 
 
 #include <QRectF>
+#include <deque>
 #include <memory>
 
 #include "CziImageFile.h"
@@ -116,8 +117,43 @@ namespace caret {
         
         QRectF getViewportStereotaxicCoordinates(const GraphicsObjectToWindowTransform* transform) const;
         
+        CziImage* getCachedImage(const AString& cziName,
+                                 const int32_t channelIndex,
+                                 const QRectF& logicalRegionRect) const;
+        
+        std::shared_ptr<CziImage> addImageToCache(CziImage* cziImage,
+                                                  const AString& cziName,
+                                                  const int32_t channelIndex);
+        
+        /**
+         * An image that was recently loaded and may be reused when
+         * the user pans or zooms back to a previously viewed region
+         */
+        class CachedImage {
+        public:
+            CachedImage(const AString& cziName,
+                        const int32_t channelIndex,
+                        std::shared_ptr<CziImage> cziImage)
+            : m_cziName(cziName),
+            m_channelIndex(channelIndex),
+            m_cziImage(cziImage) { }
+            
+            AString m_cziName;
+            
+            int32_t m_channelIndex;
+            
+            std::shared_ptr<CziImage> m_cziImage;
+        };
+        
         std::shared_ptr<CziImage> m_cziImage;
 
+        /** Recently loaded images, most recently used at front */
+        std::deque<CachedImage> m_imageCache;
+        
+        /** Name of image most recently loaded by this loader */
+        AString m_loadedImageName;
+        
+
         int32_t m_tabIndex;
         
         int32_t m_overlayIndex;
@@ -167,6 +203,12 @@ namespace caret {
          */
         static const CziImageFile::ImageDataFormat s_imageDataFormatForReading = CziImageFile::ImageDataFormat::CZI_BITMAP;
 
+        /**
+         * Maximum number of images in the cache.  Images are limited in size by the
+         * image dimension in the preferences so memory use is bounded.
+         */
+        static const int32_t s_maximumNumberOfCachedImages = 4;
+
         // ADD_NEW_MEMBERS_HERE
 
     };
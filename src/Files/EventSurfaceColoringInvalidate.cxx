@@ -29,7 +29,23 @@ using namespace caret;
  * Construct an event for invalidating surface coloring.
  */
 EventSurfaceColoringInvalidate::EventSurfaceColoringInvalidate()
-: Event(EventTypeEnum::EVENT_SURFACE_COLORING_INVALIDATE)
+: Event(EventTypeEnum::EVENT_SURFACE_COLORING_INVALIDATE),
+m_mapFile(NULL)
+{
+}
+
+/**
+ * Construct an event for invalidating surface coloring after
+ * the coloring of a map file has changed (palette, thresholding,
+ * label drawing, etc.).  Cached coloring from other files remains
+ * valid and is not recomputed.
+ *
+ * @param mapFile
+ *     File whose coloring has changed.
+ */
+EventSurfaceColoringInvalidate::EventSurfaceColoringInvalidate(const CaretMappableDataFile* mapFile)
+: Event(EventTypeEnum::EVENT_SURFACE_COLORING_INVALIDATE),
+m_mapFile(mapFile)
 {
 }
 
@@ -41,3 +57,13 @@ EventSurfaceColoringInvalidate::~EventSurfaceColoringInvalidate()
     
 }
 
+/**
+ * @return File whose coloring has changed or NULL if coloring
+ * of all files is invalid.
+ */
+const CaretMappableDataFile*
+EventSurfaceColoringInvalidate::getMapFile() const
+{
+    return m_mapFile;
+}
+
@@ -26,6 +26,7 @@
 namespace caret {
 
     class BrainStructure;
+    class CaretMappableDataFile;
     
     /// Invalidate all surface coloring
     class EventSurfaceColoringInvalidate : public Event {
@@ -33,12 +34,18 @@ namespace caret {
     public:
         EventSurfaceColoringInvalidate();
         
+        EventSurfaceColoringInvalidate(const CaretMappableDataFile* mapFile);
+        
         virtual ~EventSurfaceColoringInvalidate();
         
+        const CaretMappableDataFile* getMapFile() const;
+        
     private:
         EventSurfaceColoringInvalidate(const EventSurfaceColoringInvalidate&);
         
         EventSurfaceColoringInvalidate& operator=(const EventSurfaceColoringInvalidate&);      
+        
+        const CaretMappableDataFile* m_mapFile;
     };
 
 } // namespace
@@ -35,8 +35,8 @@ using namespace std;
 
 GeodesicHelperBase::GeodesicHelperBase(const SurfaceFile* surfaceIn, const float* correctedAreas)
 {
-    CaretPointer<TopologyHelperBase> topoBase(new TopologyHelperBase(surfaceIn));
-    TopologyHelper topoHelpIn(topoBase);//leave this building one privately, to not introduce even worse dependencies regarding SurfaceFile
+    CaretPointer<TopologyHelperBase> topoBase(TopologyHelperBase::getSharedBase(surfaceIn));
+    TopologyHelper topoHelpIn(topoBase);//use the shared base rather than asking SurfaceFile, to not introduce even worse dependencies regarding SurfaceFile
     m_corrAreaSmallestFactor = 1.0f;
     numNodes = surfaceIn->getNumberOfNodes();
     nodeNeighbors.resize(numNodes);
@@ -18,12 +18,17 @@
  */
 /*LICENSE_END*/
 
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
+#include <vector>
 
 #include <QBuffer>
 #include <QColor>
+#include <QDateTime>
 #include <QDir>
+#include <QFile>
 #include <QImage>
 #include <QImageReader>
 #include <QImageWriter>
@@ -35,8 +40,12 @@
 
 #include "ApplicationInformation.h"
 #include "BoundingBox.h"
+#include "ByteOrderEnum.h"
+#include "ByteSwapping.h"
 #include "CaretAssert.h"
+#include "CaretBinaryFile.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "CaretPreferences.h"
 #include "ControlPointFile.h"
 #include "ControlPoint3D.h"
@@ -53,6 +62,7 @@
 #include "Matrix4x4.h"
 #include "MathFunctions.h"
 #include "RectangleTransform.h"
+#include "RibbonMappingHelper.h"
 #include "SceneClass.h"
 #include "UnitsConversion.h"
 #include "VolumeFile.h"
@@ -60,6 +70,14 @@
 
 using namespace caret;
 
+namespace {
+    const char reducedSizeImageCacheMagic[] = "\0\0\0\0wri\1";
+    
+    //reduced size image sidecar: magic, source file keys (size, modification time, content hash, reduced width, reduced height),
+    //image format, width, height, compressed pixel byte count, zlib compressed pixel rows, text count, then length prefixed
+    //utf-8 text keys and values, all little endian
+}
+
 static bool imageDebugFlag = false;
 
 /**
@@ -172,27 +190,26 @@ ImageFile::ImageFile(const unsigned char* imageDataRGBA,
     /*
      * Documentation for QImage states that setPixel may be very costly
      * and recommends using the scanLine() method to access pixel data.
+     * Get the pixel data pointer once (bits() may detach the image) so
+     * that the rows can be converted in parallel, which matters for the
+     * very large images produced by offscreen scene rendering.
      */
+    uchar* imageBits = m_image->bits();
+    const int64_t bytesPerLine = m_image->bytesPerLine();
+#pragma omp CARET_PARFOR schedule(static)
     for (int y = 0; y < imageHeight; y++) {
         const int scanLineIndex = (isOriginAtTop
                                    ? y
                                    : imageHeight -y - 1);
-        QRgb* rgbScanLine = (QRgb*)m_image->scanLine(scanLineIndex);
+        QRgb* rgbScanLine = (QRgb*)(imageBits + (scanLineIndex * bytesPerLine));
+        const unsigned char* rowRGBA = imageDataRGBA + (static_cast<int64_t>(y) * imageWidth * 4);
         
         for (int x = 0; x < imageWidth; x++) {
-            const int32_t contentOffset = (((y * imageWidth) * 4)
-                                           + (x * 4));
-            const int red   = imageDataRGBA[contentOffset];
-            const int green = imageDataRGBA[contentOffset+1];
-            const int blue  = imageDataRGBA[contentOffset+2];
-            const int alpha  = imageDataRGBA[contentOffset+3];
-            QColor color(red,
-                         green,
-                         blue,
-                         alpha);
-            
-            QRgb* pixel = &rgbScanLine[x];
-            *pixel = color.rgba();
+            const int32_t contentOffset = (x * 4);
+            rgbScanLine[x] = qRgba(rowRGBA[contentOffset],
+                                   rowRGBA[contentOffset+1],
+                                   rowRGBA[contentOffset+2],
+                                   rowRGBA[contentOffset+3]);
         }
     }
     readFileMetaDataFromQImage();
@@ -716,18 +733,65 @@ ImageFile::readFile(const AString& filename)
     
     this->setFileName(filename);
     
-    if ( ! m_image->load(filename)) {
-        clear();
-        throw DataFileException(filename + "Unable to load file.");
+    /*
+     * If the image will be reduced in size by limitImageDimensions(),
+     * have the reader decode to the reduced size.  Some formats (JPEG)
+     * decode directly at a reduced size which is much faster and avoids
+     * holding the full resolution image in memory.  The reduced image
+     * is saved in a sidecar file so that later reads of the same image
+     * do not need to decode the full resolution image.
+     */
+    QImageReader imageReader(filename);
+    const QSize imageFileSize(imageReader.size());
+    const QSize scaledSize(getLimitedImageDimensionsForReading(imageFileSize));
+    bool readFromCacheFlag(false);
+    if (scaledSize.isValid()) {
+        readFromCacheFlag = readReducedSizeImageCache(filename,
+                                                      scaledSize,
+                                                      *m_image);
+    }
+    if ( ! readFromCacheFlag) {
+        if (scaledSize.isValid()) {
+            imageReader.setScaledSize(scaledSize);
+        }
+        if ( ! imageReader.read(m_image)) {
+            clear();
+            throw DataFileException(filename + "Unable to load file.");
+        }
+    }
+    if (scaledSize.isValid()) {
+        CaretLogWarning("Rescaled image "
+                        + filename
+                        + " from size ("
+                        + AString::number(imageFileSize.width())
+                        + ", "
+                        + AString::number(imageFileSize.height())
+                        + ") to ("
+                        + AString::number(m_image->width())
+                        + ", "
+                        + AString::number(m_image->height())
+                        + ")"
+                        + (readFromCacheFlag
+                           ? AString(" using " + getReducedSizeImageCacheFileName(filename))
+                           : AString("")));
     }
     
-    m_image = limitImageDimensions(m_image,
-                                   filename);
+    if ( ! readFromCacheFlag) {
+        m_image = limitImageDimensions(m_image,
+                                       filename);
+    }
     
     /*
      * Format must be RGB or ARGB for compatibility with OpenGL
      */
     verifyFormatCompatibleWithOpenGL();
+    
+    if (scaledSize.isValid()
+        && ( ! readFromCacheFlag)) {
+        writeReducedSizeImageCache(filename,
+                                   scaledSize,
+                                   *m_image);
+    }
 
     readFileMetaDataFromQImage();
     
@@ -793,6 +857,314 @@ ImageFile::limitImageDimensions(QImage* image,
     return imageOut;
 }
 
+/**
+ * Get the dimensions for reading an image so that the image read does not
+ * exceed the limits applied by limitImageDimensions()
+ * @param imageSize
+ *    Size of the image in the file (invalid if the reader could not determine size)
+ * @return
+ *    Reduced dimensions for reading the image or an invalid size if the
+ *    image does not need to be reduced in size.
+ */
+QSize
+ImageFile::getLimitedImageDimensionsForReading(const QSize& imageSize)
+{
+    QSize sizeOut;
+    
+    if (imageSize.isValid()) {
+        switch (ApplicationInformation::getApplicationType()) {
+            case ApplicationTypeEnum::APPLICATION_TYPE_COMMAND_LINE:
+                break;
+            case ApplicationTypeEnum::APPLICATION_TYPE_GRAPHICAL_USER_INTERFACE:
+            {
+                const int32_t width(imageSize.width());
+                const int32_t height(imageSize.height());
+                const int32_t maxDim(GraphicsUtilitiesOpenGL::getTextureWidthHeightMaximumDimension());
+                if ((maxDim > 0)
+                    && ((width > maxDim)
+                        || (height > maxDim))) {
+                    sizeOut = imageSize.scaled(maxDim,
+                                               maxDim,
+                                               Qt::KeepAspectRatio);
+                }
+            }
+                break;
+            case ApplicationTypeEnum::APPLICATION_TYPE_INVALID:
+                break;
+        }
+    }
+    
+    return sizeOut;
+}
+
+/**
+ * @return Name of the sidecar file containing the reduced size version of an image file
+ * @param filename
+ *    Name of image file
+ */
+AString
+ImageFile::getReducedSizeImageCacheFileName(const AString& filename)
+{
+    return (filename + ".wbreduced");
+}
+
+/**
+ * Get the values that identify the content of an image file for validating
+ * its reduced size sidecar file.  Hashing all of a very large image would
+ * take much of the time that the sidecar saves, so only the first and last
+ * megabyte are hashed; the file size and modification time catch most
+ * other changes.
+ *
+ * @param filename
+ *    Name of image file
+ * @param scaledSize
+ *    Size of the reduced image
+ * @param keysOut
+ *    Output with file size, modification time, content hash, reduced width, reduced height
+ */
+void
+ImageFile::getReducedSizeImageCacheKeys(const AString& filename,
+                                        const QSize& scaledSize,
+                                        int64_t keysOut[5])
+{
+    const int64_t sampleBytes(1024 * 1024);
+    FileInformation fileInfo(filename);
+    const int64_t fileSize(fileInfo.size());
+    std::vector<char> buffer(std::min(fileSize, sampleBytes));
+    CaretBinaryFile sourceFile(filename);
+    sourceFile.read(buffer.data(), buffer.size());
+    uint64_t contentHash(RibbonMappingHelper::hashBytes(buffer.data(), buffer.size()));
+    if (fileSize > sampleBytes) {
+        const int64_t tailBytes(std::min(fileSize - sampleBytes, sampleBytes));
+        sourceFile.seek(fileSize - tailBytes);
+        sourceFile.read(buffer.data(), tailBytes);
+        contentHash = RibbonMappingHelper::hashBytes(buffer.data(), tailBytes, contentHash);
+    }
+    keysOut[0] = fileSize;
+    keysOut[1] = fileInfo.getLastModified().toMSecsSinceEpoch();
+    keysOut[2] = static_cast<int64_t>(contentHash);
+    keysOut[3] = scaledSize.width();
+    keysOut[4] = scaledSize.height();
+}
+
+/**
+ * Read the reduced size version of an image from its sidecar file.
+ *
+ * @param filename
+ *    Name of image file
+ * @param scaledSize
+ *    Size of the reduced image
+ * @param imageOut
+ *    Output with the reduced image
+ * @return
+ *    True if the sidecar exists and matches the image file and reduced size,
+ *    else false and the sidecar should be rebuilt.
+ */
+bool
+ImageFile::readReducedSizeImageCache(const AString& filename,
+                                     const QSize& scaledSize,
+                                     QImage& imageOut)
+{
+    const AString cacheFileName(getReducedSizeImageCacheFileName(filename));
+    if ( ! FileInformation(cacheFileName).exists()) {
+        return false;
+    }
+    
+    try {
+        int64_t keys[5];
+        getReducedSizeImageCacheKeys(filename,
+                                     scaledSize,
+                                     keys);
+        
+        CaretBinaryFile cacheFile(cacheFileName);
+        char magic[8];
+        cacheFile.read(magic, 8);
+        if (memcmp(magic, reducedSizeImageCacheMagic, 8) != 0) {
+            return false;
+        }
+        int64_t cacheKeys[5];
+        int64_t header[4];
+        cacheFile.read(cacheKeys, 5 * sizeof(int64_t));
+        cacheFile.read(header, 4 * sizeof(int64_t));
+        if (ByteOrderEnum::isSystemBigEndian()) {
+            ByteSwapping::swapBytes(cacheKeys, 5);
+            ByteSwapping::swapBytes(header, 4);
+        }
+        if ( ! std::equal(keys, keys + 5, cacheKeys)) {
+            return false;
+        }
+        
+        const QImage::Format format(static_cast<QImage::Format>(header[0]));
+        const int64_t width(header[1]);
+        const int64_t height(header[2]);
+        const int64_t compressedByteCount(header[3]);
+        if (((format != QImage::Format_RGB888)
+             && (format != QImage::Format_ARGB32))
+            || (width <= 0)
+            || (height <= 0)
+            || (compressedByteCount <= 0)
+            || (compressedByteCount > cacheFile.size())) {
+            return false;
+        }
+        QByteArray compressedBytes(static_cast<int>(compressedByteCount), 0);
+        cacheFile.read(compressedBytes.data(), compressedByteCount);
+        QByteArray pixelBytes(qUncompress(compressedBytes));
+        compressedBytes.clear();
+        
+        QImage image(static_cast<int>(width), static_cast<int>(height), format);
+        const int64_t rowByteCount(width * (image.depth() / 8));
+        if (image.isNull()
+            || (pixelBytes.size() != rowByteCount * height)) {
+            return false;
+        }
+        if ((format == QImage::Format_ARGB32)
+            && ByteOrderEnum::isSystemBigEndian()) {
+            ByteSwapping::swapBytes(reinterpret_cast<uint32_t*>(pixelBytes.data()), width * height);
+        }
+        for (int64_t j = 0; j < height; j++) {
+            memcpy(image.scanLine(j), pixelBytes.constData() + (j * rowByteCount), rowByteCount);
+        }
+        
+        /*
+         * Text contains the metadata
+         */
+        const int64_t cacheFileSize(cacheFile.size());
+        int64_t textCount(0);
+        cacheFile.read(&textCount, sizeof(int64_t));
+        if (ByteOrderEnum::isSystemBigEndian()) {
+            ByteSwapping::swapBytes(&textCount, 1);
+        }
+        if ((textCount < 0)
+            || (textCount > cacheFileSize)) {
+            return false;
+        }
+        for (int64_t i = 0; i < textCount; i++) {
+            AString keyAndValue[2];
+            for (int32_t k = 0; k < 2; k++) {
+                int64_t byteCount(0);
+                cacheFile.read(&byteCount, sizeof(int64_t));
+                if (ByteOrderEnum::isSystemBigEndian()) {
+                    ByteSwapping::swapBytes(&byteCount, 1);
+                }
+                if ((byteCount < 0)
+                    || (byteCount > cacheFileSize)) {
+                    return false;
+                }
+                QByteArray textBytes(static_cast<int>(byteCount), 0);
+                cacheFile.read(textBytes.data(), byteCount);
+                keyAndValue[k] = QString::fromUtf8(textBytes);
+            }
+            image.setText(keyAndValue[0], keyAndValue[1]);
+        }
+        
+        imageOut = image;
+    }
+    catch (const DataFileException& e) {
+        CaretLogInfo("Reduced size image file "
+                     + cacheFileName
+                     + " is not usable: "
+                     + e.whatString());
+        return false;
+    }
+    
+    return true;
+}
+
+/**
+ * Write the reduced size version of an image to its sidecar file so that
+ * later reads do not need to decode the full resolution image.  Failure
+ * to write (such as a read-only directory) is not an error.
+ *
+ * @param filename
+ *    Name of image file
+ * @param scaledSize
+ *    Size of the reduced image
+ * @param image
+ *    The reduced image
+ */
+void
+ImageFile::writeReducedSizeImageCache(const AString& filename,
+                                      const QSize& scaledSize,
+                                      const QImage& image)
+{
+    if ((image.format() != QImage::Format_RGB888)
+        && (image.format() != QImage::Format_ARGB32)) {
+        return;
+    }
+    
+    const AString cacheFileName(getReducedSizeImageCacheFileName(filename));
+    const AString tempFileName(cacheFileName + ".tmp");
+    try {
+        int64_t keys[5];
+        getReducedSizeImageCacheKeys(filename,
+                                     scaledSize,
+                                     keys);
+        
+        const int64_t width(image.width());
+        const int64_t height(image.height());
+        const int64_t rowByteCount(width * (image.depth() / 8));
+        QByteArray pixelBytes(static_cast<int>(rowByteCount * height), 0);
+        for (int64_t j = 0; j < height; j++) {
+            memcpy(pixelBytes.data() + (j * rowByteCount), image.constScanLine(j), rowByteCount);
+        }
+        if ((image.format() == QImage::Format_ARGB32)
+            && ByteOrderEnum::isSystemBigEndian()) {
+            ByteSwapping::swapBytes(reinterpret_cast<uint32_t*>(pixelBytes.data()), width * height);
+        }
+        const QByteArray compressedBytes(qCompress(pixelBytes, 1));//fastest compression, reading speed matters more than size
+        pixelBytes.clear();
+        
+        int64_t header[4] = {
+            static_cast<int64_t>(image.format()),
+            width,
+            height,
+            compressedBytes.size()
+        };
+        const QStringList textKeys(image.textKeys());
+        int64_t textCount(textKeys.size());
+        if (ByteOrderEnum::isSystemBigEndian()) {
+            ByteSwapping::swapBytes(keys, 5);
+            ByteSwapping::swapBytes(header, 4);
+            ByteSwapping::swapBytes(&textCount, 1);
+        }
+        
+        /*
+         * Write to a temporary file and then rename so that
+         * a partially written sidecar is never read
+         */
+        CaretBinaryFile cacheFile(tempFileName, CaretBinaryFile::WRITE_TRUNCATE);
+        cacheFile.write(reducedSizeImageCacheMagic, 8);
+        cacheFile.write(keys, 5 * sizeof(int64_t));
+        cacheFile.write(header, 4 * sizeof(int64_t));
+        cacheFile.write(compressedBytes.constData(), compressedBytes.size());
+        cacheFile.write(&textCount, sizeof(int64_t));
+        for (const QString& key : textKeys) {
+            const QByteArray keyAndValue[2] = { key.toUtf8(), image.text(key).toUtf8() };
+            for (int32_t k = 0; k < 2; k++) {
+                int64_t byteCount(keyAndValue[k].size());
+                if (ByteOrderEnum::isSystemBigEndian()) {
+                    ByteSwapping::swapBytes(&byteCount, 1);
+                }
+                cacheFile.write(&byteCount, sizeof(int64_t));
+                cacheFile.write(keyAndValue[k].constData(), keyAndValue[k].size());
+            }
+        }
+        cacheFile.close();
+        
+        QFile::remove(cacheFileName);
+        if ( ! QFile::rename(tempFileName, cacheFileName)) {
+            QFile::remove(tempFileName);
+        }
+    }
+    catch (const DataFileException& e) {
+        QFile::remove(tempFileName);
+        CaretLogInfo("Unable to write reduced size image file "
+                     + cacheFileName
+                     + ": "
+                     + e.whatString());
+    }
+}
+
 /**
  * Insert an image into this image which must be large enough for insertion of image.
  * @param otherImage
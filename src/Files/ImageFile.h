@@ -261,6 +261,22 @@ private:
     static QImage* limitImageDimensions(QImage* image,
                                         const AString& filename);
 
+    static QSize getLimitedImageDimensionsForReading(const QSize& imageSize);
+
+    static AString getReducedSizeImageCacheFileName(const AString& filename);
+    
+    static void getReducedSizeImageCacheKeys(const AString& filename,
+                                             const QSize& scaledSize,
+                                             int64_t keysOut[5]);
+    
+    static bool readReducedSizeImageCache(const AString& filename,
+                                          const QSize& scaledSize,
+                                          QImage& imageOut);
+    
+    static void writeReducedSizeImageCache(const AString& filename,
+                                           const QSize& scaledSize,
+                                           const QImage& image);
+
     void readFileMetaDataFromQImage();
     
     void writeFileMetaDataToQImage() const;
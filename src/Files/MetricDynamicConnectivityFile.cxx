@@ -478,16 +478,17 @@ MetricDynamicConnectivityFile::getConnectivityCorrelationTwo() const
                  */
                 CaretAssert(m_parentMetricFile);
                 const int64_t dataSize(numberOfVertices * numberOfTimePoints);
-                m_metricDataCopy.reserve(dataSize);
+                std::vector<float> metricDataCopy; /* only needed until normalized by ConnectivityCorrelationTwo */
+                metricDataCopy.reserve(dataSize);
                 std::vector<const float*> brainordinateDataPointers;
                 for (int64_t i = 0; i < numberOfVertices; i++) {
                     for (int64_t j = 0; j < numberOfTimePoints; j++) {
-                        m_metricDataCopy.push_back(m_parentMetricFile->getValue(i, j));
+                        metricDataCopy.push_back(m_parentMetricFile->getValue(i, j));
                     }
                     
                     const int64_t offset(i * numberOfTimePoints);
-                    CaretAssertVectorIndex(m_metricDataCopy, offset);
-                    const float* dataPtr(&m_metricDataCopy[offset]);
+                    CaretAssertVectorIndex(metricDataCopy, offset);
+                    const float* dataPtr(&metricDataCopy[offset]);
                     CaretAssert(dataPtr);
                     brainordinateDataPointers.push_back(dataPtr);
                 }
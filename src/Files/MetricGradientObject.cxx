@@ -0,0 +1,258 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+
+#include "MetricGradientObject.h"
+
+#include "CaretAssert.h"
+#include "CaretLogger.h"
+#include "CaretOMP.h"
+#include "SurfaceFile.h"
+#include "TopologyHelper.h"
+#include "Vector3D.h"
+
+#include <cmath>
+#include <limits>
+
+using namespace std;
+using namespace caret;
+
+MetricGradientObject::MetricGradientObject(SurfaceFile* mySurf, const float* roiData, const bool& avgNormals, const float* corrAreas)
+{
+    CaretAssert(mySurf != NULL);
+    m_numNodes = mySurf->getNumberOfNodes();
+    const float* myNormals = NULL;
+    vector<float> avgNormalStorage;
+    if (avgNormals)
+    {
+        avgNormalStorage = mySurf->computeAverageNormals();
+        myNormals = avgNormalStorage.data();
+    } else {
+        mySurf->computeNormals();
+        myNormals = mySurf->getNormalData();
+    }
+    vector<float> sqrtCorrAreas;//same logic as GeodesicHelper
+    vector<float> sqrtVertAreas;
+    const float* vertAreas = NULL;
+    vector<float> areaData;
+    if (corrAreas != NULL)
+    {
+        sqrtCorrAreas.resize(m_numNodes);
+        mySurf->computeNodeAreas(sqrtVertAreas);
+        for (int32_t i = 0; i < m_numNodes; ++i)
+        {
+            sqrtCorrAreas[i] = sqrt(corrAreas[i]);
+            sqrtVertAreas[i] = sqrt(sqrtVertAreas[i]);
+        }
+        vertAreas = corrAreas;
+    } else {
+        mySurf->computeNodeAreas(areaData);
+        vertAreas = areaData.data();
+    }
+    m_inRoi.resize(m_numNodes);
+    for (int32_t i = 0; i < m_numNodes; ++i)
+    {
+        m_inRoi[i] = (roiData == NULL || roiData[i] > 0.0f ? 1 : 0);
+    }
+    const float* myCoords = mySurf->getCoordinateData();
+    CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper();
+    vector<vector<int32_t> > nodeNeighbors(m_numNodes);//built in parallel, then packed
+    vector<vector<float> > nodeCoefs(m_numNodes);
+    bool haveWarned = false, haveFailed = false;//print warning or failure messages only once
+#pragma omp CARET_PAR
+    {
+        vector<float> xmags, ymags, weights, fallbackX, fallbackY;
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int32_t i = 0; i < m_numNodes; ++i)
+        {
+            if (m_inRoi[i] == 0) continue;
+            int32_t numNeigh;
+            int32_t i3 = i * 3;
+            const int32_t* myNeighbors = myTopoHelp->getNodeNeighbors(i, numNeigh);
+            Vector3D myNormal = Vector3D(myNormals + i3).normal();//should already be normalized, but just in case
+            Vector3D myCoord = myCoords + i3;
+            Vector3D somevec, xhat, yhat;
+            somevec[2] = 0.0;
+            if (abs(myNormal[0]) > abs(myNormal[1]))
+            {//generate a vector not parallel to normal
+                somevec[0] = 0.0;
+                somevec[1] = 1.0;
+            } else {
+                somevec[0] = 1.0;
+                somevec[1] = 0.0;
+            }
+            xhat = myNormal.cross(somevec).normal();
+            yhat = myNormal.cross(xhat).normal();//xhat, yhat are orthogonal unit vectors describing a coord system with k = surface normal
+            vector<int32_t>& usedNeighbors = nodeNeighbors[i];
+            xmags.clear();
+            ymags.clear();
+            weights.clear();
+            fallbackX.clear();
+            fallbackY.clear();
+            if (numNeigh >= 2)
+            {
+                for (int32_t j = 0; j < numNeigh; ++j)
+                {
+                    int32_t whichNode = myNeighbors[j];
+                    if (m_inRoi[whichNode] == 0) continue;
+                    somevec = Vector3D(myCoords + whichNode * 3) - myCoord;
+                    float origMag = somevec.length();//save the original length
+                    float unrollMag = origMag;
+                    float opposite = somevec.dot(myNormal);//check for division by close to zero
+                    if (abs(opposite) > 0.035f * origMag)//do not do unrolling on very small angles - this is ~2 degrees
+                    {
+                        unrollMag = origMag * asin(opposite / origMag) * origMag / opposite;
+                    }
+                    if (corrAreas != NULL)
+                    {
+                        unrollMag *= (sqrtCorrAreas[i] + sqrtCorrAreas[whichNode]) / (sqrtVertAreas[i] + sqrtVertAreas[whichNode]);
+                    }
+                    float xmag = xhat.dot(somevec);//dot product to get the direction in 2d
+                    float ymag = yhat.dot(somevec);
+                    float mag2d = sqrt(xmag * xmag + ymag * ymag);//get the new magnitude, to divide out
+                    usedNeighbors.push_back(whichNode);
+                    xmags.push_back(xmag * unrollMag / mag2d);//normalize the 2d vector and multiply by unrolled length
+                    ymags.push_back(ymag * unrollMag / mag2d);
+                    weights.push_back(vertAreas[whichNode]);
+                    fallbackX.push_back(xmag / (unrollMag * mag2d));//difference divided by distance gives point estimate of gradient magnitude, also divide by magnitude of 2d vector to normalize the direction
+                    fallbackY.push_back(ymag / (unrollMag * mag2d));
+                }
+            }//with fewer than 2 surface neighbors, this vertex is left with no neighbors, and outputs zero
+            int32_t neighCount = (int32_t)usedNeighbors.size();
+            vector<float>& myCoefs = nodeCoefs[i];
+            myCoefs.resize(neighCount * 3);
+            bool regressionOk = false;
+            if (neighCount >= 2)
+            {//the regression solution is linear in the neighbor differences, so precompute the rows of inverse(A'WA) * A'W that give the x and y slopes
+                double m00 = 0.0, m01 = 0.0, m02 = 0.0, m11 = 0.0, m12 = 0.0, m22 = vertAreas[i];//include center (metric and coord differences will be zero, so this is all that is needed)
+                for (int32_t j = 0; j < neighCount; ++j)
+                {
+                    m00 += xmags[j] * xmags[j] * weights[j];
+                    m01 += xmags[j] * ymags[j] * weights[j];
+                    m02 += xmags[j] * weights[j];
+                    m11 += ymags[j] * ymags[j] * weights[j];
+                    m12 += ymags[j] * weights[j];
+                    m22 += weights[j];
+                }
+                double c00 = m11 * m22 - m12 * m12, c01 = m02 * m12 - m01 * m22, c02 = m01 * m12 - m02 * m11;//first two rows of the adjugate, it is symmetric
+                double c11 = m00 * m22 - m02 * m02, c12 = m01 * m02 - m00 * m12;
+                double det = m00 * c00 + m01 * c01 + m02 * c02;
+                if (det != 0.0)
+                {
+                    regressionOk = true;
+                    for (int32_t j = 0; j < neighCount; ++j)
+                    {
+                        double xslope = weights[j] * (c00 * xmags[j] + c01 * ymags[j] + c02) / det;
+                        double yslope = weights[j] * (c01 * xmags[j] + c11 * ymags[j] + c12) / det;
+                        Vector3D coef = xhat * xslope + yhat * yslope;
+                        for (int k = 0; k < 3; ++k)
+                        {
+                            if (!(abs(coef[k]) <= numeric_limits<float>::max())) regressionOk = false;//NaN or inf
+                            myCoefs[j * 3 + k] = coef[k];
+                        }
+                    }
+                }
+            }
+            if (neighCount > 0 && !regressionOk)
+            {
+                if (!haveWarned && roiData == NULL)
+                {//don't issue this warning with an ROI, because it is somewhat expected
+                    haveWarned = true;
+                    CaretLogWarning("WARNING: gradient calculation found a NaN/inf with regression method for at least vertex " + AString::number(i));
+                }
+                float totalWeight = 0.0f;
+                for (int32_t j = 0; j < neighCount; ++j)
+                {
+                    totalWeight += weights[j];
+                }
+                for (int32_t j = 0; j < neighCount; ++j)
+                {//weighted average of the point estimates
+                    Vector3D coef = xhat * (fallbackX[j] * weights[j] / totalWeight) + yhat * (fallbackY[j] * weights[j] / totalWeight);
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        myCoefs[j * 3 + k] = coef[k];
+                    }
+                }
+            }
+            if (neighCount <= 0 && !haveFailed && roiData == NULL)
+            {//don't warn with an roi, they can be strange
+                haveFailed = true;
+                CaretLogWarning("Failed to compute gradient for at least vertex " + AString::number(i) +
+                " with standard and fallback methods, outputting ZERO, check your surface for disconnected vertices or other strangeness");
+            }
+        }
+    }
+    m_offsets.resize(m_numNodes + 1);
+    m_offsets[0] = 0;
+    for (int32_t i = 0; i < m_numNodes; ++i)
+    {
+        m_offsets[i + 1] = m_offsets[i] + (int64_t)nodeNeighbors[i].size();
+    }
+    m_neighbors.resize(m_offsets[m_numNodes]);
+    m_coefs.resize(m_offsets[m_numNodes] * 3);
+    for (int32_t i = 0; i < m_numNodes; ++i)
+    {
+        for (int64_t j = 0; j < (int64_t)nodeNeighbors[i].size(); ++j)
+        {
+            m_neighbors[m_offsets[i] + j] = nodeNeighbors[i][j];
+            for (int k = 0; k < 3; ++k)
+            {
+                m_coefs[(m_offsets[i] + j) * 3 + k] = nodeCoefs[i][j * 3 + k];
+            }
+        }
+    }
+}
+
+bool MetricGradientObject::computeGradient(const float* dataIn, float* magnitudeOut, float* vectorsOut) const
+{
+    CaretAssert(dataIn != NULL && magnitudeOut != NULL);
+    bool allOk = true;
+#pragma omp CARET_PARFOR schedule(dynamic, 1024)
+    for (int32_t i = 0; i < m_numNodes; ++i)
+    {
+        float grad[3] = { 0.0f, 0.0f, 0.0f };
+        const float centerValue = dataIn[i];
+        const int64_t end = m_offsets[i + 1];
+        for (int64_t j = m_offsets[i]; j < end; ++j)
+        {
+            const float diff = dataIn[m_neighbors[j]] - centerValue;
+            const float* coef = m_coefs.data() + j * 3;
+            grad[0] += coef[0] * diff;
+            grad[1] += coef[1] * diff;
+            grad[2] += coef[2] * diff;
+        }
+        float sanity = grad[0] + grad[1] + grad[2];
+        if (sanity != sanity)
+        {
+            if (m_inRoi[i] != 0) allOk = false;//only ever set to false, so the race is harmless
+            grad[0] = 0.0f;
+            grad[1] = 0.0f;
+            grad[2] = 0.0f;
+        }
+        if (vectorsOut != NULL)
+        {
+            vectorsOut[i] = grad[0];//split them up far, so that they can be set to columns easily
+            vectorsOut[m_numNodes + i] = grad[1];
+            vectorsOut[m_numNodes * 2 + i] = grad[2];
+        }
+        magnitudeOut[i] = sqrt(grad[0] * grad[0] + grad[1] * grad[1] + grad[2] * grad[2]);
+    }
+    return allOk;
+}
@@ -0,0 +1,62 @@
+#ifndef __METRIC_GRADIENT_OBJECT_H__
+#define __METRIC_GRADIENT_OBJECT_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+//NOTE: this precomputes the area-weighted least squares regression of every vertex against its neighbors, so that the gradient of each column
+//      is just a short weighted sum over the neighbors.  If you are taking the gradient of many columns (or many metric objects) on the same surface
+//      with the same roi, construct one of these and reuse it.  If you just want the gradient of one metric file, use AlgorithmMetricGradient.
+//
+//NOTE: this object contains no mutable members, multiple threads can call computeGradient on the same instance concurrently, as long as the outputs don't overlap
+//
+//NOTE: the roi can't be changed after construction, because it decides which neighbors each vertex uses
+
+#include "stdint.h"
+#include "stddef.h"
+#include <vector>
+
+namespace caret {
+    
+    class SurfaceFile;
+    
+    class MetricGradientObject
+    {
+    public:
+        ///roiData and corrAreas are one value per vertex, corrAreas replaces the vertex areas for both unrolling distances and regression weights
+        MetricGradientObject(SurfaceFile* mySurf, const float* roiData = NULL, const bool& avgNormals = false, const float* corrAreas = NULL);
+        
+        ///vectorsOut, if not NULL, gets all x components, then all y components, then all z components, output is zero outside the roi
+        ///returns false if the gradient of any vertex inside the roi was NaN or inf (from the data), those vertices are set to zero
+        bool computeGradient(const float* dataIn, float* magnitudeOut, float* vectorsOut = NULL) const;
+        
+        int32_t getNumberOfNodes() const { return m_numNodes; }
+    private:
+        int32_t m_numNodes;
+        std::vector<int64_t> m_offsets;//where each vertex's neighbors start, one extra at the end, vertices outside the roi (or without usable neighbors) have none
+        std::vector<int32_t> m_neighbors;
+        std::vector<float> m_coefs;//3 per neighbor, gradient = sum(coef * (neighbor value - center value))
+        std::vector<char> m_inRoi;
+        MetricGradientObject();
+    };
+    
+}
+
+#endif //__METRIC_GRADIENT_OBJECT_H__
@@ -374,7 +374,7 @@ void MetricSmoothingObject::precomputeWeightsGeoGaussArea(const SurfaceFile* myS
         for (int32_t i = 0; i < numNodes; ++i)
         {
             myGeoHelp->getNodesToGeoDist(i, myGeoDist, tempList[i].m_nodes, distances, true);
-            const vector<int32_t>& tempneighbors = myTopoHelp->getNodeNeighbors(i);
+            const TopologyIndexList tempneighbors = myTopoHelp->getNodeNeighbors(i);
             if (distances.size() <= tempneighbors.size())//because neighbors doesn't include center, so if they are equal, geo is missing a neighbor
             {
                 tempList[i].m_nodes = tempneighbors;
@@ -441,7 +441,7 @@ void MetricSmoothingObject::precomputeWeightsROIGeoGaussArea(const SurfaceFile*
             if (myRoiColumn[i] > 0.0f)//we don't need to scatter from things outside the ROI
             {
                 myGeoHelp->getNodesToGeoDist(i, myGeoDist, nodes, distances, true);
-                const vector<int32_t>& tempneighbors = myTopoHelp->getNodeNeighbors(i);
+                const TopologyIndexList tempneighbors = myTopoHelp->getNodeNeighbors(i);
                 if (distances.size() <= tempneighbors.size())//because neighbors doesn't include center, so if they are equal, geo is missing a neighbor
                 {
                     nodes = tempneighbors;
@@ -509,7 +509,7 @@ void MetricSmoothingObject::precomputeWeightsGeoGaussEqual(const SurfaceFile* my
         for (int32_t i = 0; i < numNodes; ++i)
         {
             myGeoHelp->getNodesToGeoDist(i, myGeoDist, tempList[i].m_nodes, distances, true);
-            const vector<int32_t>& tempneighbors = myTopoHelp->getNodeNeighbors(i);
+            const TopologyIndexList tempneighbors = myTopoHelp->getNodeNeighbors(i);
             if (distances.size() <= tempneighbors.size())//because neighbors doesn't include center, so if they are equal, geo is missing a neighbor
             {
                 tempList[i].m_nodes = tempneighbors;
@@ -576,7 +576,7 @@ void MetricSmoothingObject::precomputeWeightsROIGeoGaussEqual(const SurfaceFile*
             if (myRoiColumn[i] > 0.0f)//we don't need to scatter from things outside the ROI
             {
                 myGeoHelp->getNodesToGeoDist(i, myGeoDist, nodes, distances, true);
-                const vector<int32_t>& tempneighbors = myTopoHelp->getNodeNeighbors(i);
+                const TopologyIndexList tempneighbors = myTopoHelp->getNodeNeighbors(i);
                 if (distances.size() <= tempneighbors.size())//because neighbors doesn't include center, so if they are equal, geo is missing a neighbor
                 {
                     nodes = tempneighbors;
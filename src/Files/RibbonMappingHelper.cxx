@@ -47,7 +47,11 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SO
 
 #include "RibbonMappingHelper.h"
 
+#include "ByteOrderEnum.h"
+#include "ByteSwapping.h"
+#include "CaretBinaryFile.h"
 #include "CaretException.h"
+#include "FileInformation.h"
 #include "FloatMatrix.h"
 #include "MathFunctions.h"
 #include "SurfaceFile.h"
@@ -55,6 +59,7 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SO
 #include "VolumeSpace.h"
 
 #include <cmath>
+#include <cstring>
 
 using namespace caret;
 using namespace std;
@@ -469,3 +474,151 @@ void RibbonMappingHelper::computeWeightsRibbon(vector<vector<VoxelWeight> >& myW
         }
     }
 }
+
+namespace
+{
+    const char weightsMagic[] = "\0\0\0\0rbw\1";
+    
+    //header: magic, number of vertices, volume dims, surface/volume/options keys, total number of weights
+    //then int32 weight count per vertex, int64 voxel index (into a frame) per weight, float weight per weight, all little endian
+}
+
+uint64_t RibbonMappingHelper::hashBytes(const void* data, const int64_t& numBytes, const uint64_t& seed)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    uint64_t ret = seed;
+    for (int64_t i = 0; i < numBytes; ++i)
+    {
+        ret ^= bytes[i];
+        ret *= 1099511628211ULL;
+    }
+    return ret;
+}
+
+uint64_t RibbonMappingHelper::hashSurface(const SurfaceFile* mySurf, const uint64_t& seed)
+{
+    int64_t numNodes = mySurf->getNumberOfNodes(), numTris = mySurf->getNumberOfTriangles();
+    uint64_t ret = hashBytes(&numNodes, sizeof(int64_t), seed);
+    ret = hashBytes(mySurf->getCoordinateData(), numNodes * 3 * sizeof(float), ret);
+    ret = hashBytes(&numTris, sizeof(int64_t), ret);
+    for (int32_t i = 0; i < (int32_t)numTris; ++i)
+    {
+        ret = hashBytes(mySurf->getTriangle(i), 3 * sizeof(int32_t), ret);
+    }
+    return ret;
+}
+
+uint64_t RibbonMappingHelper::hashVolumeSpace(const VolumeSpace& myVolSpace, const uint64_t& seed)
+{
+    uint64_t ret = hashBytes(myVolSpace.getDims(), 3 * sizeof(int64_t), seed);
+    const vector<vector<float> >& sform = myVolSpace.getSform();
+    for (int i = 0; i < 3; ++i)
+    {
+        ret = hashBytes(sform[i].data(), 4 * sizeof(float), ret);
+    }
+    return ret;
+}
+
+void RibbonMappingHelper::writeWeights(const AString& filename, const vector<vector<VoxelWeight> >& myWeights, const VolumeSpace& myVolSpace,
+                                       const uint64_t& surfaceKey, const uint64_t& volumeKey, const uint64_t& optionsKey)
+{
+    const int64_t numNodes = (int64_t)myWeights.size();
+    const int64_t* dims = myVolSpace.getDims();
+    int64_t totalWeights = 0;
+    vector<int32_t> counts(numNodes);
+    for (int64_t i = 0; i < numNodes; ++i)
+    {
+        counts[i] = (int32_t)myWeights[i].size();
+        totalWeights += counts[i];
+    }
+    vector<int64_t> indices(totalWeights);
+    vector<float> weights(totalWeights);
+    int64_t curWeight = 0;
+    for (int64_t i = 0; i < numNodes; ++i)
+    {
+        for (int32_t j = 0; j < counts[i]; ++j)
+        {
+            indices[curWeight] = myVolSpace.getIndex(myWeights[i][j].ijk);
+            weights[curWeight] = myWeights[i][j].weight;
+            ++curWeight;
+        }
+    }
+    int64_t header[5] = { numNodes, dims[0], dims[1], dims[2], totalWeights };
+    uint64_t keys[3] = { surfaceKey, volumeKey, optionsKey };
+    if (ByteOrderEnum::isSystemBigEndian())
+    {
+        ByteSwapping::swapBytes(header, 5);
+        ByteSwapping::swapBytes(keys, 3);
+        ByteSwapping::swapBytes(counts.data(), counts.size());
+        ByteSwapping::swapBytes(indices.data(), indices.size());
+        ByteSwapping::swapBytes(weights.data(), weights.size());
+    }
+    CaretBinaryFile myFile(filename, CaretBinaryFile::WRITE_TRUNCATE);
+    myFile.write(weightsMagic, 8);
+    myFile.write(header, 4 * sizeof(int64_t));
+    myFile.write(keys, 3 * sizeof(uint64_t));
+    myFile.write(header + 4, sizeof(int64_t));
+    myFile.write(counts.data(), numNodes * sizeof(int32_t));
+    myFile.write(indices.data(), totalWeights * sizeof(int64_t));
+    myFile.write(weights.data(), totalWeights * sizeof(float));
+    myFile.close();
+}
+
+bool RibbonMappingHelper::readWeights(const AString& filename, vector<vector<VoxelWeight> >& myWeightsOut, const VolumeSpace& myVolSpace, const int64_t& numNodes,
+                                      const uint64_t& surfaceKey, const uint64_t& volumeKey, const uint64_t& optionsKey)
+{
+    if (!FileInformation(filename).exists()) return false;
+    CaretBinaryFile myFile(filename);
+    char buf[8];
+    myFile.read(buf, 8);
+    if (memcmp(buf, weightsMagic, 8) != 0) throw CaretException("file '" + filename + "' is not a ribbon weights file");
+    int64_t header[5];
+    uint64_t keys[3];
+    myFile.read(header, 4 * sizeof(int64_t));
+    myFile.read(keys, 3 * sizeof(uint64_t));
+    myFile.read(header + 4, sizeof(int64_t));
+    if (ByteOrderEnum::isSystemBigEndian())
+    {
+        ByteSwapping::swapBytes(header, 5);
+        ByteSwapping::swapBytes(keys, 3);
+    }
+    const int64_t* dims = myVolSpace.getDims();
+    if (header[0] != numNodes || header[1] != dims[0] || header[2] != dims[1] || header[3] != dims[2]) return false;
+    if (keys[0] != surfaceKey || keys[1] != volumeKey || keys[2] != optionsKey) return false;
+    const int64_t totalWeights = header[4];
+    if (totalWeights < 0) throw CaretException("ribbon weights file '" + filename + "' has a negative number of weights");
+    vector<int32_t> counts(numNodes);
+    vector<int64_t> indices(totalWeights);
+    vector<float> weights(totalWeights);
+    myFile.read(counts.data(), numNodes * sizeof(int32_t));
+    myFile.read(indices.data(), totalWeights * sizeof(int64_t));
+    myFile.read(weights.data(), totalWeights * sizeof(float));
+    if (ByteOrderEnum::isSystemBigEndian())
+    {
+        ByteSwapping::swapBytes(counts.data(), counts.size());
+        ByteSwapping::swapBytes(indices.data(), indices.size());
+        ByteSwapping::swapBytes(weights.data(), weights.size());
+    }
+    const int64_t frameSize = dims[0] * dims[1] * dims[2];
+    myWeightsOut.clear();
+    myWeightsOut.resize(numNodes);
+    int64_t curWeight = 0;
+    for (int64_t i = 0; i < numNodes; ++i)
+    {
+        if (counts[i] < 0 || curWeight + counts[i] > totalWeights) throw CaretException("ribbon weights file '" + filename + "' has inconsistent weight counts");
+        myWeightsOut[i].resize(counts[i]);
+        for (int32_t j = 0; j < counts[i]; ++j)
+        {
+            int64_t index = indices[curWeight];
+            if (index < 0 || index >= frameSize) throw CaretException("ribbon weights file '" + filename + "' has a voxel index out of range");
+            VoxelWeight& thisWeight = myWeightsOut[i][j];
+            thisWeight.weight = weights[curWeight];
+            thisWeight.ijk[0] = index % dims[0];
+            thisWeight.ijk[1] = (index / dims[0]) % dims[1];
+            thisWeight.ijk[2] = index / (dims[0] * dims[1]);
+            ++curWeight;
+        }
+    }
+    if (curWeight != totalWeights) throw CaretException("ribbon weights file '" + filename + "' has inconsistent weight counts");
+    return true;
+}
@@ -30,6 +30,7 @@
 namespace caret
 {
     
+    class AString;
     class SurfaceFile;
     class VolumeSpace;
     
@@ -67,6 +68,23 @@ namespace caret
         static std::vector<std::vector<PointWeight> > computePointsRibbon(const VolumeSpace& myVolSpace,
                                          const SurfaceFile* innerSurf, const SurfaceFile* outerSurf,
                                          const float* roiFrame = NULL, const int& numDivisions = 3, const bool& thinColumn = false);
+        
+        ///64-bit FNV-1a hash of raw bytes, chain calls by passing the previous result as the seed
+        static uint64_t hashBytes(const void* data, const int64_t& numBytes, const uint64_t& seed = 14695981039346656037ULL);
+        
+        ///hash of the coordinates and topology of a surface, for checking that saved weights are still valid
+        static uint64_t hashSurface(const SurfaceFile* mySurf, const uint64_t& seed = 14695981039346656037ULL);
+        
+        ///hash of the dimensions and sform of a volume space
+        static uint64_t hashVolumeSpace(const VolumeSpace& myVolSpace, const uint64_t& seed = 14695981039346656037ULL);
+        
+        ///save weights in a compact binary sparse format, the keys are stored in the header to be compared when reading
+        static void writeWeights(const AString& filename, const std::vector<std::vector<VoxelWeight> >& myWeights, const VolumeSpace& myVolSpace,
+                                 const uint64_t& surfaceKey, const uint64_t& volumeKey, const uint64_t& optionsKey);
+        
+        ///returns false if the file doesn't exist, or was made with different dimensions or keys - throws if the file is malformed
+        static bool readWeights(const AString& filename, std::vector<std::vector<VoxelWeight> >& myWeightsOut, const VolumeSpace& myVolSpace, const int64_t& numNodes,
+                                const uint64_t& surfaceKey, const uint64_t& volumeKey, const uint64_t& optionsKey);
     };
 
 }
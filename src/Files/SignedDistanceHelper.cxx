@@ -71,129 +71,123 @@ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FO
 DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
 OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
 
-#include "BoundingBox.h"
-#include "CaretHeap.h"
+#include "CaretAssert.h"
+#include "CaretOMP.h"
+#include "MathFunctions.h"
 #include "SignedDistanceHelper.h"
 #include "SurfaceFile.h"
 #include "TopologyHelper.h"
+
+#include <algorithm>
 #include <cmath>
+#include <limits>
 
 using namespace std;
 using namespace caret;
 
-float SignedDistanceHelper::dist(const float coord[3], WindingLogic myWinding)
+namespace
 {
-    CaretMutexLocker locked(&m_mutex);
-    CaretSimpleMinHeap<Oct<SignedDistanceHelperBase::TriVector>*, float> myHeap;
-    myHeap.push(m_base->m_indexRoot, m_base->m_indexRoot->distToPoint(coord));
-    ClosestPointInfo tempInfo, bestInfo;
-    float tempf = -1.0f, bestTriDist = -1.0f;
-    bool first = true;
-    int numChanged = 0;
-    while (!myHeap.isEmpty())
+    //box distances and the distance kernel are only used to screen triangles, so allow for them rounding differently than unsignedDistToTri
+    const float SCREEN_SLACK = 1.0001f;
+    
+    float boxArea(const float bounds[6])
     {
-        Oct<SignedDistanceHelperBase::TriVector>* curOct = myHeap.pop(&tempf);
-        if (first || tempf < bestTriDist)
+        float dx = bounds[3] - bounds[0], dy = bounds[4] - bounds[1], dz = bounds[5] - bounds[2];
+        return dx * dy + dy * dz + dz * dx;//half the surface area, only relative values matter
+    }
+    
+    void growBox(float bounds[6], const float minCoord[3], const float maxCoord[3])
+    {
+        for (int i = 0; i < 3; ++i)
         {
-            if (curOct->m_leaf)
-            {
-                vector<int32_t>& myVecRef = *(curOct->m_data.m_triList);
-                int numTris = (int)myVecRef.size();
-                for (int i = 0; i < numTris; ++i)
-                {
-                    if (m_triMarked[myVecRef[i]] != 1)
-                    {
-                        m_triMarked[myVecRef[i]] = 1;
-                        m_triMarkChanged[numChanged++] = myVecRef[i];
-                        tempf = unsignedDistToTri(coord, myVecRef[i], tempInfo);
-                        if (first || tempf < bestTriDist)
-                        {
-                            bestInfo = tempInfo;
-                            bestTriDist = tempf;
-                            first = false;
-                        }
-                    }
-                }
-            } else {
-                for (int ci = 0; ci < 2; ++ci)
-                {
-                    for (int cj = 0; cj < 2; ++cj)
-                    {
-                        for (int ck = 0; ck < 2; ++ck)
-                        {
-                            tempf = curOct->m_children[ci][cj][ck]->distToPoint(coord);
-                            if (first || tempf < bestTriDist)
-                            {
-                                myHeap.push(curOct->m_children[ci][cj][ck], tempf);
-                            }
-                        }
-                    }
-                }
-            }
+            if (minCoord[i] < bounds[i]) bounds[i] = minCoord[i];
+            if (maxCoord[i] > bounds[i + 3]) bounds[i + 3] = maxCoord[i];
         }
     }
-    while (numChanged)
+    
+    void emptyBox(float bounds[6])
     {
-        m_triMarked[m_triMarkChanged[--numChanged]] = 0;//need to do this before computeSign
+        for (int i = 0; i < 3; ++i)
+        {
+            bounds[i] = numeric_limits<float>::max();
+            bounds[i + 3] = -numeric_limits<float>::max();
+        }
     }
-    return bestTriDist * computeSign(coord, bestInfo, myWinding);
 }
 
-float SignedDistanceHelper::distLimited(const float coord[3], const float limit, bool& validOut, SignedDistanceHelper::WindingLogic myWinding)
+bool SignedDistanceHelper::findClosest(const float coord[3], float& bestDistInOut, ClosestPointInfo& bestInfo) const
 {
-    CaretMutexLocker locked(&m_mutex);
-    validOut = false;
-    CaretSimpleMinHeap<Oct<SignedDistanceHelperBase::TriVector>*, float> myHeap;
-    myHeap.push(m_base->m_indexRoot, m_base->m_indexRoot->distToPoint(coord));
-    ClosestPointInfo tempInfo, bestInfo;
-    float tempf = -1.0f, bestTriDist = limit;
-    int numChanged = 0;
-    while (!myHeap.isEmpty())
+    const SignedDistanceHelperBase& myBase = *m_base;
+    if (myBase.m_nodeCount.empty()) return false;
+    ClosestPointInfo tempInfo;
+    bool found = false;
+    float bestSq = bestDistInOut * bestDistInOut * SCREEN_SLACK;
+    int32_t nodeStack[SignedDistanceHelperBase::BVH_MAX_DEPTH + 2];//depth first, with at most one pending sibling per level
+    float nodeDistStack[SignedDistanceHelperBase::BVH_MAX_DEPTH + 2];
+    float leafDistSq[SignedDistanceHelperBase::BVH_LEAF_SIZE];
+    int stackSize = 1;
+    nodeStack[0] = 0;
+    nodeDistStack[0] = myBase.nodeDistSquared(0, coord);
+    while (stackSize > 0)
     {
-        Oct<SignedDistanceHelperBase::TriVector>* curOct = myHeap.pop(&tempf);
-        if (tempf < bestTriDist)
+        --stackSize;
+        if (!(nodeDistStack[stackSize] < bestSq)) continue;//the bound may have tightened since it was pushed
+        const int32_t node = nodeStack[stackSize];
+        const int32_t count = myBase.m_nodeCount[node];
+        if (count > 0)
         {
-            if (curOct->m_leaf)
+            const int32_t first = myBase.m_nodeStart[node];
+            for (int32_t chunk = 0; chunk < count; chunk += SignedDistanceHelperBase::BVH_LEAF_SIZE)
             {
-                vector<int32_t>& myVecRef = *(curOct->m_data.m_triList);
-                int numTris = (int)myVecRef.size();
-                for (int i = 0; i < numTris; ++i)
+                const int32_t chunkCount = min((int32_t)SignedDistanceHelperBase::BVH_LEAF_SIZE, count - chunk);
+                myBase.leafDistSquared(first + chunk, chunkCount, coord, leafDistSq);
+                for (int32_t i = 0; i < chunkCount; ++i)
                 {
-                    if (m_triMarked[myVecRef[i]] != 1)
-                    {
-                        m_triMarked[myVecRef[i]] = 1;
-                        m_triMarkChanged[numChanged++] = myVecRef[i];
-                        tempf = unsignedDistToTri(coord, myVecRef[i], tempInfo);
-                        if (tempf < bestTriDist)
+                    if (leafDistSq[i] < bestSq)
+                    {//only compute the full closest point info for triangles that can win
+                        float tempf = unsignedDistToTri(coord, myBase.m_leafTris[first + chunk + i], tempInfo);
+                        if (tempf < bestDistInOut)
                         {
                             bestInfo = tempInfo;
-                            bestTriDist = tempf;
-                            validOut = true;
+                            bestDistInOut = tempf;
+                            bestSq = tempf * tempf * SCREEN_SLACK;
+                            found = true;
                         }
                     }
                 }
+            }
+        } else {
+            const int32_t left = node + 1, right = myBase.m_nodeStart[node];
+            const float leftDist = myBase.nodeDistSquared(left, coord), rightDist = myBase.nodeDistSquared(right, coord);
+            if (leftDist < rightDist)
+            {//push the farther child first, so the nearer one is searched first and tightens the bound sooner
+                if (rightDist < bestSq) { nodeStack[stackSize] = right; nodeDistStack[stackSize] = rightDist; ++stackSize; }
+                if (leftDist < bestSq) { nodeStack[stackSize] = left; nodeDistStack[stackSize] = leftDist; ++stackSize; }
             } else {
-                for (int ci = 0; ci < 2; ++ci)
-                {
-                    for (int cj = 0; cj < 2; ++cj)
-                    {
-                        for (int ck = 0; ck < 2; ++ck)
-                        {
-                            tempf = curOct->m_children[ci][cj][ck]->distToPoint(coord);
-                            if (tempf < bestTriDist)
-                            {
-                                myHeap.push(curOct->m_children[ci][cj][ck], tempf);
-                            }
-                        }
-                    }
-                }
+                if (leftDist < bestSq) { nodeStack[stackSize] = left; nodeDistStack[stackSize] = leftDist; ++stackSize; }
+                if (rightDist < bestSq) { nodeStack[stackSize] = right; nodeDistStack[stackSize] = rightDist; ++stackSize; }
             }
         }
     }
-    while (numChanged)
+    return found;
+}
+
+float SignedDistanceHelper::dist(const float coord[3], WindingLogic myWinding)
+{
+    ClosestPointInfo bestInfo;
+    float bestTriDist = numeric_limits<float>::infinity();
+    if (!findClosest(coord, bestTriDist, bestInfo))
     {
-        m_triMarked[m_triMarkChanged[--numChanged]] = 0;//need to do this before computeSign
+        return NAN;//surface has no triangles
     }
+    return bestTriDist * computeSign(coord, bestInfo, myWinding);
+}
+
+float SignedDistanceHelper::distLimited(const float coord[3], const float limit, bool& validOut, SignedDistanceHelper::WindingLogic myWinding)
+{
+    ClosestPointInfo bestInfo;
+    float bestTriDist = limit;
+    validOut = findClosest(coord, bestTriDist, bestInfo);
     if (validOut)
     {
         return bestTriDist * computeSign(coord, bestInfo, myWinding);
@@ -202,61 +196,31 @@ float SignedDistanceHelper::distLimited(const float coord[3], const float limit,
     }
 }
 
-void SignedDistanceHelper::barycentricWeights(const float coord[3], BarycentricInfo& baryInfoOut)
+void SignedDistanceHelper::distBatch(const float* coords, const int64_t& numPoints, float* distOut, WindingLogic myWinding)
 {
-    CaretMutexLocker locked(&m_mutex);
-    CaretSimpleMinHeap<Oct<SignedDistanceHelperBase::TriVector>*, float> myHeap;
-    myHeap.push(m_base->m_indexRoot, m_base->m_indexRoot->distToPoint(coord));
-    ClosestPointInfo tempInfo, bestInfo;
-    float tempf = -1.0f, bestTriDist = -1.0f;
-    bool first = true;
-    int numChanged = 0;
-    while (!myHeap.isEmpty())
+#pragma omp CARET_PARFOR schedule(dynamic, 64)
+    for (int64_t i = 0; i < numPoints; ++i)
     {
-        Oct<SignedDistanceHelperBase::TriVector>* curOct = myHeap.pop(&tempf);
-        if (first || tempf < bestTriDist)
-        {
-            if (curOct->m_leaf)
-            {
-                vector<int32_t>& myVecRef = *(curOct->m_data.m_triList);
-                int numTris = (int)myVecRef.size();
-                for (int i = 0; i < numTris; ++i)
-                {
-                    if (m_triMarked[myVecRef[i]] != 1)
-                    {
-                        m_triMarked[myVecRef[i]] = 1;
-                        m_triMarkChanged[numChanged++] = myVecRef[i];
-                        tempf = unsignedDistToTri(coord, myVecRef[i], tempInfo);
-                        if (first || tempf < bestTriDist)
-                        {
-                            bestInfo = tempInfo;
-                            bestTriDist = tempf;
-                            first = false;
-                        }
-                    }
-                }
-            } else {
-                for (int ci = 0; ci < 2; ++ci)
-                {
-                    for (int cj = 0; cj < 2; ++cj)
-                    {
-                        for (int ck = 0; ck < 2; ++ck)
-                        {
-                            tempf = curOct->m_children[ci][cj][ck]->distToPoint(coord);
-                            if (first || tempf < bestTriDist)
-                            {
-                                myHeap.push(curOct->m_children[ci][cj][ck], tempf);
-                            }
-                        }
-                    }
-                }
-            }
-        }
+        distOut[i] = dist(coords + i * 3, myWinding);
     }
-    while (numChanged)
+}
+
+void SignedDistanceHelper::distLimitedBatch(const float* coords, const int64_t& numPoints, const float limit, float* distOut, char* validOut, WindingLogic myWinding)
+{
+#pragma omp CARET_PARFOR schedule(dynamic, 64)
+    for (int64_t i = 0; i < numPoints; ++i)
     {
-        m_triMarked[m_triMarkChanged[--numChanged]] = 0;//clean up
+        bool valid = false;
+        distOut[i] = distLimited(coords + i * 3, limit, valid, myWinding);
+        validOut[i] = (valid ? 1 : 0);
     }
+}
+
+void SignedDistanceHelper::barycentricWeights(const float coord[3], BarycentricInfo& baryInfoOut)
+{
+    ClosestPointInfo bestInfo;
+    float bestTriDist = numeric_limits<float>::infinity();
+    findClosest(coord, bestTriDist, bestInfo);
     baryInfoOut.triangle = bestInfo.triangle;
     baryInfoOut.point = bestInfo.tempPoint;
     baryInfoOut.absDistance = bestTriDist;
@@ -330,7 +294,68 @@ void SignedDistanceHelper::barycentricWeights(const float coord[3], BarycentricI
     }
 }
 
-int SignedDistanceHelper::computeSign(const float coord[3], SignedDistanceHelper::ClosestPointInfo myInfo, WindingLogic myWinding)
+bool SignedDistanceHelper::firstHitBySegment(const float start[3], const float end[3], int32_t& triangleOut, float& fractionOut) const
+{
+    const SignedDistanceHelperBase& myBase = *m_base;
+    if (myBase.m_nodeCount.empty()) return false;
+    const float direction[3] = { end[0] - start[0], end[1] - start[1], end[2] - start[2] };
+    float best = 1.0f;//only hits before the end of the segment count
+    bool found = false;
+    int32_t nodeStack[SignedDistanceHelperBase::BVH_MAX_DEPTH + 2];//depth first, with at most one pending sibling per level
+    float nodeEntryStack[SignedDistanceHelperBase::BVH_MAX_DEPTH + 2];
+    int stackSize = 0;
+    float rootEntry = myBase.nodeSegmentEntry(0, start, direction);
+    if (rootEntry <= best) { nodeStack[0] = 0; nodeEntryStack[0] = rootEntry; stackSize = 1; }
+    while (stackSize > 0)
+    {
+        --stackSize;
+        if (nodeEntryStack[stackSize] > best) continue;//a closer hit was found since it was pushed
+        const int32_t node = nodeStack[stackSize];
+        const int32_t count = myBase.m_nodeCount[node];
+        if (count > 0)
+        {
+            const int32_t first = myBase.m_nodeStart[node];
+            for (int32_t i = first; i < first + count; ++i)
+            {//Moller-Trumbore, without culling either side
+                const float ax = myBase.m_leafVerts[0][i], ay = myBase.m_leafVerts[1][i], az = myBase.m_leafVerts[2][i];
+                const float e1x = myBase.m_leafVerts[3][i] - ax, e1y = myBase.m_leafVerts[4][i] - ay, e1z = myBase.m_leafVerts[5][i] - az;
+                const float e2x = myBase.m_leafVerts[6][i] - ax, e2y = myBase.m_leafVerts[7][i] - ay, e2z = myBase.m_leafVerts[8][i] - az;
+                const float px = direction[1] * e2z - direction[2] * e2y, py = direction[2] * e2x - direction[0] * e2z, pz = direction[0] * e2y - direction[1] * e2x;
+                const float det = e1x * px + e1y * py + e1z * pz;
+                if (det == 0.0f) continue;//segment parallel to triangle, or degenerate triangle
+                const float invDet = 1.0f / det;
+                const float tx = start[0] - ax, ty = start[1] - ay, tz = start[2] - az;
+                const float u = (tx * px + ty * py + tz * pz) * invDet;
+                if (u < 0.0f || u > 1.0f) continue;
+                const float qx = ty * e1z - tz * e1y, qy = tz * e1x - tx * e1z, qz = tx * e1y - ty * e1x;
+                const float v = (direction[0] * qx + direction[1] * qy + direction[2] * qz) * invDet;
+                if (v < 0.0f || u + v > 1.0f) continue;
+                const float t = (e2x * qx + e2y * qy + e2z * qz) * invDet;
+                if (t >= 0.0f && t <= best)
+                {
+                    best = t;
+                    triangleOut = myBase.m_leafTris[i];
+                    found = true;
+                }
+            }
+        } else {
+            const int32_t left = node + 1, right = myBase.m_nodeStart[node];
+            const float leftEntry = myBase.nodeSegmentEntry(left, start, direction), rightEntry = myBase.nodeSegmentEntry(right, start, direction);
+            if (leftEntry < rightEntry)
+            {//push the farther child first, so the nearer one is searched first and shortens the segment sooner
+                if (rightEntry <= best) { nodeStack[stackSize] = right; nodeEntryStack[stackSize] = rightEntry; ++stackSize; }
+                if (leftEntry <= best) { nodeStack[stackSize] = left; nodeEntryStack[stackSize] = leftEntry; ++stackSize; }
+            } else {
+                if (leftEntry <= best) { nodeStack[stackSize] = left; nodeEntryStack[stackSize] = leftEntry; ++stackSize; }
+                if (rightEntry <= best) { nodeStack[stackSize] = right; nodeEntryStack[stackSize] = rightEntry; ++stackSize; }
+            }
+        }
+    }
+    if (found) fractionOut = best;
+    return found;
+}
+
+int SignedDistanceHelper::computeSign(const float coord[3], SignedDistanceHelper::ClosestPointInfo myInfo, WindingLogic myWinding) const
 {
     Vector3D point = coord;
     Vector3D result = point - myInfo.tempPoint;
@@ -341,68 +366,48 @@ int SignedDistanceHelper::computeSign(const float coord[3], SignedDistanceHelper
         case NEGATIVE:
         case NONZERO:
             {
-                int numChanged = 0;
                 float positiveZ[3] = {0, 0, 1};
                 Vector3D point2 = point + positiveZ;
                 int crossCount = 0;
-                vector<Oct<SignedDistanceHelperBase::TriVector>*> myStack;
-                myStack.push_back(m_base->m_indexRoot);
-                while (!myStack.empty())
+                int32_t nodeStack[SignedDistanceHelperBase::BVH_MAX_DEPTH + 2];
+                int stackSize = 0;
+                if (!m_base->m_nodeCount.empty()) nodeStack[stackSize++] = 0;
+                while (stackSize > 0)
                 {
-                    Oct<SignedDistanceHelperBase::TriVector>* curOct = myStack[myStack.size() - 1];
-                    myStack.pop_back();
-                    if (curOct->m_leaf)
+                    const int32_t node = nodeStack[--stackSize];
+                    if (!m_base->nodeHitByRay(node, coord, point2, false)) continue;
+                    const int32_t count = m_base->m_nodeCount[node];
+                    if (count > 0)
                     {
-                        vector<int32_t>& myVecRef = *(curOct->m_data.m_triList);
-                        int numTris = (int)myVecRef.size();
-                        for (int i = 0; i < numTris; ++i)
-                        {
-                            if (m_triMarked[myVecRef[i]] != 1)
+                        const int32_t first = m_base->m_nodeStart[node];
+                        for (int32_t i = first; i < first + count; ++i)
+                        {//each triangle is in exactly one leaf, so no need to mark which ones we have tested
+                            const int32_t* myTileNodes = m_base->getTriangle(m_base->m_leafTris[i]);
+                            Vector3D verts[3];
+                            verts[0] = m_base->getCoordinate(myTileNodes[0]);
+                            verts[1] = m_base->getCoordinate(myTileNodes[1]);
+                            verts[2] = m_base->getCoordinate(myTileNodes[2]);
+                            Vector3D triNormal;
+                            MathFunctions::normalVector(verts[0], verts[1], verts[2], triNormal);
+                            float factor = triNormal[2];//equivalent to dot product with positiveZ
+                            if (factor != 0.0f)
                             {
-                                m_triMarked[myVecRef[i]] = 1;
-                                m_triMarkChanged[numChanged++] = myVecRef[i];
-                                const int32_t* myTileNodes = m_base->getTriangle(myVecRef[i]);
-                                Vector3D verts[3];
-                                verts[0] = m_base->getCoordinate(myTileNodes[0]);
-                                verts[1] = m_base->getCoordinate(myTileNodes[1]);
-                                verts[2] = m_base->getCoordinate(myTileNodes[2]);
-                                Vector3D triNormal;
-                                MathFunctions::normalVector(verts[0], verts[1], verts[2], triNormal);
-                                float factor = triNormal[2];//equivalent to dot product with positiveZ
-                                if (factor != 0.0f)
+                                if (triNormal.dot(verts[0] - point) / factor > 0.0f && pointInTri(verts, point, 0, 1))
                                 {
-                                    if (triNormal.dot(verts[0] - point) / factor > 0.0f && pointInTri(verts, point, 0, 1))
+                                    if (triNormal[2] < 0.0f)
                                     {
-                                        if (triNormal[2] < 0.0f)
-                                        {
-                                            ++crossCount;
-                                        } else {
-                                            --crossCount;
-                                        }
+                                        ++crossCount;
+                                    } else {
+                                        --crossCount;
                                     }
                                 }
                             }
                         }
                     } else {
-                        for (int ci = 0; ci < 2; ++ci)
-                        {
-                            for (int cj = 0; cj < 2; ++cj)
-                            {
-                                for (int ck = 0; ck < 2; ++ck)
-                                {
-                                    if (curOct->m_children[ci][cj][ck]->rayIntersects(coord, point2))
-                                    {
-                                        myStack.push_back(curOct->m_children[ci][cj][ck]);
-                                    }
-                                }
-                            }
-                        }
+                        nodeStack[stackSize++] = node + 1;
+                        nodeStack[stackSize++] = m_base->m_nodeStart[node];
                     }
                 }
-                while (numChanged)
-                {
-                    m_triMarked[m_triMarkChanged[--numChanged]] = 0;
-                }
                 switch (myWinding)
                 {
                     case EVEN_ODD:
@@ -428,8 +433,7 @@ int SignedDistanceHelper::computeSign(const float coord[3], SignedDistanceHelper
                 case 0://node
                     {
                         int curSign = 0;
-                        int numChanged = 0;
-                        const vector<int>& myTiles = m_base->m_topoHelp->getNodeTiles(myInfo.node1);
+                        const TopologyIndexList myTiles = m_base->m_topoHelp->getNodeTiles(myInfo.node1);
                         bool first = true;
                         float bestNorm = 0;
                         Vector3D tempvec, tempvec2, bestCent;
@@ -471,78 +475,59 @@ int SignedDistanceHelper::computeSign(const float coord[3], SignedDistanceHelper
                         {
                             midAxis = 2;
                         }
-                        vector<Oct<SignedDistanceHelperBase::TriVector>*> myStack;
-                        myStack.push_back(m_base->m_indexRoot);
-                        while (!myStack.empty())
+                        int32_t nodeStack[SignedDistanceHelperBase::BVH_MAX_DEPTH + 2];
+                        int stackSize = 0;
+                        if (!m_base->m_nodeCount.empty()) nodeStack[stackSize++] = 0;
+                        while (stackSize > 0)
                         {
-                            Oct<SignedDistanceHelperBase::TriVector>* curOct = myStack[myStack.size() - 1];
-                            myStack.pop_back();
-                            if (curOct->m_leaf)
+                            const int32_t node = nodeStack[--stackSize];
+                            if (!m_base->nodeHitByRay(node, coord, bestCent, true)) continue;
+                            const int32_t count = m_base->m_nodeCount[node];
+                            if (count > 0)
                             {
-                                vector<int32_t>& myVecRef = *(curOct->m_data.m_triList);
-                                int numTris = (int)myVecRef.size();
-                                for (int i = 0; i < numTris; ++i)
+                                const int32_t first = m_base->m_nodeStart[node];
+                                for (int32_t i = first; i < first + count; ++i)
                                 {
-                                    if (m_triMarked[myVecRef[i]] != 1)
+                                    const int32_t* myTileNodes = m_base->getTriangle(m_base->m_leafTris[i]);
+                                    Vector3D verts[3];
+                                    verts[0] = m_base->getCoordinate(myTileNodes[0]);
+                                    verts[1] = m_base->getCoordinate(myTileNodes[1]);
+                                    verts[2] = m_base->getCoordinate(myTileNodes[2]);
+                                    Vector3D triNormal;
+                                    MathFunctions::normalVector(verts[0], verts[1], verts[2], triNormal);
+                                    float factor = triNormal.dot(segNormal);
+                                    if (factor == 0.0f)
                                     {
-                                        m_triMarked[myVecRef[i]] = 1;
-                                        m_triMarkChanged[numChanged++] = myVecRef[i];
-                                        const int32_t* myTileNodes = m_base->getTriangle(myVecRef[i]);
-                                        Vector3D verts[3];
-                                        verts[0] = m_base->getCoordinate(myTileNodes[0]);
-                                        verts[1] = m_base->getCoordinate(myTileNodes[1]);
-                                        verts[2] = m_base->getCoordinate(myTileNodes[2]);
-                                        Vector3D triNormal;
-                                        MathFunctions::normalVector(verts[0], verts[1], verts[2], triNormal);
-                                        float factor = triNormal.dot(segNormal);
-                                        if (factor == 0.0f)
-                                        {
-                                            continue;//skip triangles parallel to the line segment
-                                        }
-                                        float intersectDist = triNormal.dot(point - verts[0]) / factor;
-                                        if (intersectDist > 0.0f && intersectDist < bestDist)
-                                        {
-                                            Vector3D inPlane = point - intersectDist * segNormal;
-                                            if (pointInTri(verts, inPlane, majAxis, midAxis))
-                                            {
-                                                bestDist = intersectDist;
-                                                if (triNormal.dot(mySeg) > 0.0f)
-                                                {
-                                                    curSign = 1;
-                                                } else {
-                                                    curSign = -1;
-                                                }
-                                            }
-                                        }
+                                        continue;//skip triangles parallel to the line segment
                                     }
-                                }
-                            } else {
-                                for (int ci = 0; ci < 2; ++ci)
-                                {
-                                    for (int cj = 0; cj < 2; ++cj)
+                                    float intersectDist = triNormal.dot(point - verts[0]) / factor;
+                                    if (intersectDist > 0.0f && intersectDist < bestDist)
                                     {
-                                        for (int ck = 0; ck < 2; ++ck)
+                                        Vector3D inPlane = point - intersectDist * segNormal;
+                                        if (pointInTri(verts, inPlane, majAxis, midAxis))
                                         {
-                                            if (curOct->m_children[ci][cj][ck]->lineSegmentIntersects(coord, bestCent))
+                                            bestDist = intersectDist;
+                                            if (triNormal.dot(mySeg) > 0.0f)
                                             {
-                                                myStack.push_back(curOct->m_children[ci][cj][ck]);
+                                                curSign = 1;
+                                            } else {
+                                                curSign = -1;
                                             }
                                         }
                                     }
                                 }
+                            } else {
+                                nodeStack[stackSize++] = node + 1;
+                                nodeStack[stackSize++] = m_base->m_nodeStart[node];
                             }
                         }
-                        while (numChanged)
-                        {
-                            m_triMarked[m_triMarkChanged[--numChanged]] = 0;
-                        }
                         return curSign;
                     }
                     break;
                 case 1://edge
                     {
                         const vector<TopologyEdgeInfo>& edgeInfo = m_base->m_topoHelp->getEdgeInfo();
-                        const vector<int>& edges = m_base->m_topoHelp->getNodeEdges(myInfo.node1);
+                        const TopologyIndexList edges = m_base->m_topoHelp->getNodeEdges(myInfo.node1);
                         int whichEdge = -1, numEdges = (int)edges.size();
                         for (int i = 0; i < numEdges; ++i)
                         {
@@ -596,7 +581,7 @@ int SignedDistanceHelper::computeSign(const float coord[3], SignedDistanceHelper
     return 1;
 }
 
-bool SignedDistanceHelper::pointInTri(Vector3D verts[3], Vector3D inPlane, int majAxis, int midAxis)
+bool SignedDistanceHelper::pointInTri(Vector3D verts[3], Vector3D inPlane, int majAxis, int midAxis) const
 {
     bool inside = false;
     for (int j = 2, i = 0; i < 3; ++i)//start with the wraparound case
@@ -622,7 +607,7 @@ bool SignedDistanceHelper::pointInTri(Vector3D verts[3], Vector3D inPlane, int m
 
 ///"dumb" implementation, projects to plane, test if inside while finding closest point on each edge
 ///there are faster implementations out there, but this is easier to follow
-float SignedDistanceHelper::unsignedDistToTri(const float coord[3], int32_t triangle, ClosestPointInfo& myInfo)
+float SignedDistanceHelper::unsignedDistToTri(const float coord[3], int32_t triangle, ClosestPointInfo& myInfo) const
 {
     const int32_t* triNodes = m_base->getTriangle(triangle);
     Vector3D point = coord;
@@ -802,24 +787,11 @@ float SignedDistanceHelper::unsignedDistToTri(const float coord[3], int32_t tria
 SignedDistanceHelper::SignedDistanceHelper(CaretPointer<SignedDistanceHelperBase> myBase)
 {
     m_base = myBase;
-    int32_t numTris = m_base->m_numTris;
-    m_triMarked = CaretArray<int>(numTris);
-    m_triMarkChanged = CaretArray<int>(numTris);
-    for (int32_t i = 0; i < numTris; ++i)
-    {
-        m_triMarked[i] = 0;
-    }
 }
 
 SignedDistanceHelperBase::SignedDistanceHelperBase(const SurfaceFile* mySurf)
 {
     m_topoHelp = mySurf->getTopologyHelper();
-    const float* myBB = mySurf->getBoundingBox()->getBounds();
-    Vector3D minCoord, maxCoord;
-    minCoord[0] = myBB[0]; maxCoord[0] = myBB[1];
-    minCoord[1] = myBB[2]; maxCoord[1] = myBB[3];
-    minCoord[2] = myBB[4]; maxCoord[2] = myBB[5];
-    m_indexRoot.grabNew(new Oct<TriVector>(minCoord, maxCoord));
     const float* myCoordData = mySurf->getCoordinateData();
     m_numNodes = mySurf->getNumberOfNodes();
     int32_t numNodes3 = m_numNodes * 3;
@@ -830,6 +802,7 @@ SignedDistanceHelperBase::SignedDistanceHelperBase(const SurfaceFile* mySurf)
     }
     m_numTris = mySurf->getNumberOfTriangles();
     m_triangleList.resize(m_numTris * 3);
+    vector<BuildTri> buildTris(m_numTris);
     for (int32_t i = 0; i < m_numTris; ++i)
     {
         int32_t i3 = i * 3;
@@ -837,106 +810,260 @@ SignedDistanceHelperBase::SignedDistanceHelperBase(const SurfaceFile* mySurf)
         m_triangleList[i3] = thisTri[0];
         m_triangleList[i3 + 1] = thisTri[1];
         m_triangleList[i3 + 2] = thisTri[2];
-        maxCoord = minCoord = myCoordData + thisTri[0] * 3;//set both to the coordinates of the first node in the triangle
+        BuildTri& thisBuild = buildTris[i];
+        thisBuild.m_triangle = i;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            thisBuild.m_minCoord[axis] = thisBuild.m_maxCoord[axis] = myCoordData[thisTri[0] * 3 + axis];
+        }
         for (int j = 1; j < 3; ++j)
         {
-            int32_t thisNode3 = thisTri[j] * 3;
-            if (myCoordData[thisNode3] < minCoord[0]) minCoord[0] = myCoordData[thisNode3];
-            if (myCoordData[thisNode3 + 1] < minCoord[1]) minCoord[1] = myCoordData[thisNode3 + 1];
-            if (myCoordData[thisNode3 + 2] < minCoord[2]) minCoord[2] = myCoordData[thisNode3 + 2];
-            if (myCoordData[thisNode3] > maxCoord[0]) maxCoord[0] = myCoordData[thisNode3];
-            if (myCoordData[thisNode3 + 1] > maxCoord[1]) maxCoord[1] = myCoordData[thisNode3 + 1];
-            if (myCoordData[thisNode3 + 2] > maxCoord[2]) maxCoord[2] = myCoordData[thisNode3 + 2];
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                float thisCoord = myCoordData[thisTri[j] * 3 + axis];
+                if (thisCoord < thisBuild.m_minCoord[axis]) thisBuild.m_minCoord[axis] = thisCoord;
+                if (thisCoord > thisBuild.m_maxCoord[axis]) thisBuild.m_maxCoord[axis] = thisCoord;
+            }
+        }
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            thisBuild.m_centroid[axis] = (thisBuild.m_minCoord[axis] + thisBuild.m_maxCoord[axis]) * 0.5f;
         }
-        addTriangle(m_indexRoot, i, minCoord, maxCoord);//use bounding box for now as an easy test to capture any chance of the triangle intersecting the Oct
+    }
+    m_leafTris.reserve(m_numTris);
+    for (int i = 0; i < 9; ++i)
+    {
+        m_leafVerts[i].reserve(m_numTris);
+    }
+    if (m_numTris > 0)
+    {
+        buildNode(buildTris, 0, m_numTris, 0);
     }
 }
 
-void SignedDistanceHelperBase::addTriangle(Oct<TriVector>* thisOct, int32_t triangle, float minCoord[3], float maxCoord[3])
+int32_t SignedDistanceHelperBase::buildNode(vector<BuildTri>& buildTris, const int32_t start, const int32_t end, const int depth)
 {
-    if (thisOct->m_leaf)
+    const int32_t node = (int32_t)m_nodeStart.size();
+    m_nodeStart.push_back(0);
+    m_nodeCount.push_back(0);
+    float bounds[6], centBounds[6];
+    emptyBox(bounds);
+    emptyBox(centBounds);
+    for (int32_t i = start; i < end; ++i)
+    {
+        growBox(bounds, buildTris[i].m_minCoord, buildTris[i].m_maxCoord);
+        growBox(centBounds, buildTris[i].m_centroid, buildTris[i].m_centroid);
+    }
+    for (int i = 0; i < 6; ++i)
+    {
+        m_nodeBounds[i].push_back(bounds[i]);
+    }
+    const int32_t count = end - start;
+    if (count <= BVH_LEAF_SIZE || depth >= BVH_MAX_DEPTH)
+    {
+        makeLeaf(node, buildTris, start, end);
+        return node;
+    }
+    int axis = 0;
+    for (int i = 1; i < 3; ++i)
     {
-        thisOct->m_data.m_triList->push_back(triangle);
-        int numTris = (int)thisOct->m_data.m_triList->size();
-        if (numTris >= NUM_TRIS_TO_TEST && numTris % NUM_TRIS_TEST_INCR == NUM_TRIS_TO_TEST % NUM_TRIS_TEST_INCR)//the second modulus should const out
+        if (centBounds[i + 3] - centBounds[i] > centBounds[axis + 3] - centBounds[axis]) axis = i;
+    }
+    const float axisMin = centBounds[axis], extent = centBounds[axis + 3] - centBounds[axis];
+    int32_t mid = start;
+    if (extent > 0.0f)
+    {//binned surface area heuristic: minimize (area * count) summed over both sides
+        const float binScale = BVH_NUM_BINS / extent;
+        int32_t binCount[BVH_NUM_BINS];
+        float binBounds[BVH_NUM_BINS][6];
+        for (int b = 0; b < BVH_NUM_BINS; ++b)
+        {
+            binCount[b] = 0;
+            emptyBox(binBounds[b]);
+        }
+        for (int32_t i = start; i < end; ++i)
+        {
+            int b = min((int)((buildTris[i].m_centroid[axis] - axisMin) * binScale), BVH_NUM_BINS - 1);
+            ++binCount[b];
+            growBox(binBounds[b], buildTris[i].m_minCoord, buildTris[i].m_maxCoord);
+        }
+        float rightCost[BVH_NUM_BINS];//cost of everything at or after bin b
+        float accum[6];
+        emptyBox(accum);
+        int32_t accumCount = 0;
+        for (int b = BVH_NUM_BINS - 1; b > 0; --b)
         {
-            Vector3D tempMinCoord, tempMaxCoord;
-            const float* myCoordData = m_coordList.data();
-            int totalSize = 0;
-            int numSplit = 0;
-            for (int i = 0; i < numTris; ++i)//gather data on how it would end up splitting
+            if (binCount[b] > 0)
             {
-                const int32_t* tempTri = getTriangle((*(thisOct->m_data.m_triList))[i]);
-                tempMaxCoord = tempMinCoord = myCoordData + tempTri[0] * 3;//set both to the coordinates of the first node in the triangle
-                for (int j = 1; j < 3; ++j)
-                {
-                    int32_t thisNode3 = tempTri[j] * 3;
-                    if (myCoordData[thisNode3] < tempMinCoord[0]) tempMinCoord[0] = myCoordData[thisNode3];
-                    if (myCoordData[thisNode3 + 1] < tempMinCoord[1]) tempMinCoord[1] = myCoordData[thisNode3 + 1];
-                    if (myCoordData[thisNode3 + 2] < tempMinCoord[2]) tempMinCoord[2] = myCoordData[thisNode3 + 2];
-                    if (myCoordData[thisNode3] > tempMaxCoord[0]) tempMaxCoord[0] = myCoordData[thisNode3];
-                    if (myCoordData[thisNode3 + 1] > tempMaxCoord[1]) tempMaxCoord[1] = myCoordData[thisNode3 + 1];
-                    if (myCoordData[thisNode3 + 2] > tempMaxCoord[2]) tempMaxCoord[2] = myCoordData[thisNode3 + 2];
-                }
-                int minOct[3], maxOct[3];
-                thisOct->containingChild(tempMinCoord, minOct);
-                thisOct->containingChild(tempMaxCoord, maxOct);
-                int splitSize = 8;
-                if (minOct[0] == maxOct[0]) splitSize >>= 1;
-                if (minOct[1] == maxOct[1]) splitSize >>= 1;
-                if (minOct[2] == maxOct[2]) splitSize >>= 1;
-                totalSize += splitSize;
-                if (splitSize != 8) ++numSplit;
+                growBox(accum, binBounds[b], binBounds[b] + 3);
+                accumCount += binCount[b];
+            }
+            rightCost[b] = (accumCount > 0 ? boxArea(accum) * accumCount : 0.0f);
+        }
+        emptyBox(accum);
+        accumCount = 0;
+        int bestBin = -1;
+        float bestCost = 0.0f;
+        for (int b = 0; b < BVH_NUM_BINS - 1; ++b)
+        {//split plane after bin b
+            if (binCount[b] > 0)
+            {
+                growBox(accum, binBounds[b], binBounds[b] + 3);
+                accumCount += binCount[b];
             }
-            if (numSplit > 0 && totalSize < 3.0f * numTris)//don't split if all triangles end up in all child octs, and try to balance speedup with memory usage
+            if (accumCount == 0 || accumCount == count) continue;
+            float cost = boxArea(accum) * accumCount + rightCost[b + 1];
+            if (bestBin == -1 || cost < bestCost)
             {
-                thisOct->makeChildren();//do the split
-                for (int i = 0; i < numTris; ++i)//gather data on how it would end up splitting
+                bestBin = b;
+                bestCost = cost;
+            }
+        }
+        if (bestBin != -1)
+        {
+            mid = (int32_t)(partition(buildTris.begin() + start, buildTris.begin() + end, [&](const BuildTri& tri)
                 {
-                    const int32_t* tempTri = getTriangle((*(thisOct->m_data.m_triList))[i]);
-                    tempMaxCoord = tempMinCoord = myCoordData + tempTri[0] * 3;//set both to the coordinates of the first node in the triangle
-                    for (int j = 1; j < 3; ++j)
-                    {
-                        int32_t thisNode3 = tempTri[j] * 3;
-                        if (myCoordData[thisNode3] < tempMinCoord[0]) tempMinCoord[0] = myCoordData[thisNode3];
-                        if (myCoordData[thisNode3 + 1] < tempMinCoord[1]) tempMinCoord[1] = myCoordData[thisNode3 + 1];
-                        if (myCoordData[thisNode3 + 2] < tempMinCoord[2]) tempMinCoord[2] = myCoordData[thisNode3 + 2];
-                        if (myCoordData[thisNode3] > tempMaxCoord[0]) tempMaxCoord[0] = myCoordData[thisNode3];
-                        if (myCoordData[thisNode3 + 1] > tempMaxCoord[1]) tempMaxCoord[1] = myCoordData[thisNode3 + 1];
-                        if (myCoordData[thisNode3 + 2] > tempMaxCoord[2]) tempMaxCoord[2] = myCoordData[thisNode3 + 2];
-                    }
-                    for (int ci = 0; ci < 2; ++ci)
-                    {
-                        for (int cj = 0; cj < 2; ++cj)
-                        {
-                            for (int ck = 0; ck < 2; ++ck)
-                            {
-                                if (thisOct->m_children[ci][cj][ck]->boundsOverlaps(tempMinCoord, tempMaxCoord))
-                                {
-                                    addTriangle(thisOct->m_children[ci][cj][ck], (*(thisOct->m_data.m_triList))[i], tempMinCoord, tempMaxCoord);
-                                }
-                            }
-                        }
-                    }
-                }
-                thisOct->m_data.freeData();//and free up some memory
+                    return min((int)((tri.m_centroid[axis] - axisMin) * binScale), BVH_NUM_BINS - 1) <= bestBin;
+                }) - buildTris.begin());
+        }
+    }
+    if (mid <= start || mid >= end)
+    {//all centroids in one bin (or identical), split in the middle by count instead
+        mid = start + count / 2;
+        nth_element(buildTris.begin() + start, buildTris.begin() + mid, buildTris.begin() + end, [&](const BuildTri& left, const BuildTri& right)
+            {
+                return left.m_centroid[axis] < right.m_centroid[axis];
+            });
+    }
+    buildNode(buildTris, start, mid, depth + 1);//left child is always the next node
+    int32_t rightChild = buildNode(buildTris, mid, end, depth + 1);//don't index into m_nodeStart before this, the recursion reallocates it
+    m_nodeStart[node] = rightChild;
+    return node;
+}
+
+void SignedDistanceHelperBase::makeLeaf(const int32_t node, const vector<BuildTri>& buildTris, const int32_t start, const int32_t end)
+{
+    m_nodeStart[node] = (int32_t)m_leafTris.size();
+    m_nodeCount[node] = end - start;
+    for (int32_t i = start; i < end; ++i)
+    {
+        const int32_t triangle = buildTris[i].m_triangle;
+        m_leafTris.push_back(triangle);
+        const int32_t* triNodes = getTriangle(triangle);
+        for (int j = 0; j < 3; ++j)
+        {
+            const float* thisCoord = getCoordinate(triNodes[j]);
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                m_leafVerts[j * 3 + axis].push_back(thisCoord[axis]);
             }
         }
-    } else {
-        for (int ci = 0; ci < 2; ++ci)
+    }
+}
+
+float SignedDistanceHelperBase::nodeDistSquared(const int32_t node, const float coord[3]) const
+{
+    float ret = 0.0f;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        float below = m_nodeBounds[axis][node] - coord[axis], above = coord[axis] - m_nodeBounds[axis + 3][node];
+        float diff = max(max(below, above), 0.0f);
+        ret += diff * diff;
+    }
+    return ret;
+}
+
+void SignedDistanceHelperBase::leafDistSquared(const int32_t first, const int32_t count, const float coord[3], float* distSqOut) const
+{//squared distance to each triangle in the range, computed without data-dependent branches (everything is evaluated, then selected) so the compiler can vectorize it
+    CaretAssert(count <= BVH_LEAF_SIZE);
+    const float px = coord[0], py = coord[1], pz = coord[2];
+    const float* ax = m_leafVerts[0].data() + first, *ay = m_leafVerts[1].data() + first, *az = m_leafVerts[2].data() + first;
+    const float* bx = m_leafVerts[3].data() + first, *by = m_leafVerts[4].data() + first, *bz = m_leafVerts[5].data() + first;
+    const float* cx = m_leafVerts[6].data() + first, *cy = m_leafVerts[7].data() + first, *cz = m_leafVerts[8].data() + first;
+    const float tiny = numeric_limits<float>::min();
+    for (int32_t i = 0; i < count; ++i)
+    {
+        const float abx = bx[i] - ax[i], aby = by[i] - ay[i], abz = bz[i] - az[i];
+        const float bcx = cx[i] - bx[i], bcy = cy[i] - by[i], bcz = cz[i] - bz[i];
+        const float cax = ax[i] - cx[i], cay = ay[i] - cy[i], caz = az[i] - cz[i];
+        const float apx = px - ax[i], apy = py - ay[i], apz = pz - az[i];
+        const float bpx = px - bx[i], bpy = py - by[i], bpz = pz - bz[i];
+        const float cpx = px - cx[i], cpy = py - cy[i], cpz = pz - cz[i];
+        //closest point on each edge
+        const float t0 = min(max((apx * abx + apy * aby + apz * abz) / max(abx * abx + aby * aby + abz * abz, tiny), 0.0f), 1.0f);
+        const float t1 = min(max((bpx * bcx + bpy * bcy + bpz * bcz) / max(bcx * bcx + bcy * bcy + bcz * bcz, tiny), 0.0f), 1.0f);
+        const float t2 = min(max((cpx * cax + cpy * cay + cpz * caz) / max(cax * cax + cay * cay + caz * caz, tiny), 0.0f), 1.0f);
+        const float d0x = apx - t0 * abx, d0y = apy - t0 * aby, d0z = apz - t0 * abz;
+        const float d1x = bpx - t1 * bcx, d1y = bpy - t1 * bcy, d1z = bpz - t1 * bcz;
+        const float d2x = cpx - t2 * cax, d2y = cpy - t2 * cay, d2z = cpz - t2 * caz;
+        const float edgeSq = min(min(d0x * d0x + d0y * d0y + d0z * d0z, d1x * d1x + d1y * d1y + d1z * d1z), d2x * d2x + d2y * d2y + d2z * d2z);
+        //face, if the projection of the point is inside the triangle
+        const float nx = aby * (-caz) - abz * (-cay), ny = abz * (-cax) - abx * (-caz), nz = abx * (-cay) - aby * (-cax);//ab cross ac
+        const float nn = nx * nx + ny * ny + nz * nz;
+        const float s0 = (aby * apz - abz * apy) * nx + (abz * apx - abx * apz) * ny + (abx * apy - aby * apx) * nz;
+        const float s1 = (bcy * bpz - bcz * bpy) * nx + (bcz * bpx - bcx * bpz) * ny + (bcx * bpy - bcy * bpx) * nz;
+        const float s2 = (cay * cpz - caz * cpy) * nx + (caz * cpx - cax * cpz) * ny + (cax * cpy - cay * cpx) * nz;
+        const float planeDist = apx * nx + apy * ny + apz * nz;
+        const float faceSq = planeDist * planeDist / max(nn, tiny);
+        const bool inside = (s0 >= 0.0f) & (s1 >= 0.0f) & (s2 >= 0.0f) & (nn > 0.0f);
+        distSqOut[i] = (inside ? min(faceSq, edgeSq) : edgeSq);
+    }
+}
+
+bool SignedDistanceHelperBase::nodeHitByRay(const int32_t node, const float start[3], const float end[3], const bool segment) const
+{//same logic as Oct::rayIntersects and Oct::lineSegmentIntersects
+    float curlow = 1.0f, curhigh = -1.0f;
+    bool first = true;
+    for (int i = 0; i < 3; ++i)
+    {
+        const float direction = end[i] - start[i];
+        const float boundLow = m_nodeBounds[i][node], boundHigh = m_nodeBounds[i + 3][node];
+        if (direction != 0.0f)
         {
-            for (int cj = 0; cj < 2; ++cj)
+            float templow, temphigh;
+            if (direction > 0.0f)
             {
-                for (int ck = 0; ck < 2; ++ck)
-                {
-                    if (thisOct->m_children[ci][cj][ck]->boundsOverlaps(minCoord, maxCoord))
-                    {
-                        addTriangle(thisOct->m_children[ci][cj][ck], triangle, minCoord, maxCoord);
-                    }
-                }
+                templow = (boundLow - start[i]) / direction;//compute the range of t over which this line lies between the planes for this axis
+                temphigh = (boundHigh - start[i]) / direction;
+            } else {
+                templow = (boundHigh - start[i]) / direction;
+                temphigh = (boundLow - start[i]) / direction;
+            }
+            if (first)
+            {
+                first = false;
+                curlow = templow;
+                curhigh = temphigh;
+            } else {
+                if (templow > curlow) curlow = templow;//intersect the ranges
+                if (temphigh < curhigh) curhigh = temphigh;
             }
+            if (curhigh < curlow || curhigh < 0.0f || (segment && curlow > 1.0f)) return false;
+        } else {
+            if (start[i] < boundLow || start[i] > boundHigh) return false;
+        }
+    }
+    return true;
+}
+
+float SignedDistanceHelperBase::nodeSegmentEntry(const int32_t node, const float start[3], const float direction[3]) const
+{//slab test, restricted to the segment
+    float curlow = 0.0f, curhigh = 1.0f;
+    for (int i = 0; i < 3; ++i)
+    {
+        const float boundLow = m_nodeBounds[i][node], boundHigh = m_nodeBounds[i + 3][node];
+        if (direction[i] != 0.0f)
+        {
+            float templow = (boundLow - start[i]) / direction[i], temphigh = (boundHigh - start[i]) / direction[i];
+            if (direction[i] < 0.0f) swap(templow, temphigh);
+            if (templow > curlow) curlow = templow;
+            if (temphigh < curhigh) curhigh = temphigh;
+            if (curhigh < curlow) return numeric_limits<float>::infinity();
+        } else {
+            if (start[i] < boundLow || start[i] > boundHigh) return numeric_limits<float>::infinity();
         }
     }
+    return curlow;
 }
 
 const float* SignedDistanceHelperBase::getCoordinate(const int32_t nodeIndex) const
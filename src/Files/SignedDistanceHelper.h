@@ -48,10 +48,9 @@
  */
 
 #include "Vector3D.h"
-#include "CaretMutex.h"
 #include "CaretPointer.h"
-#include "OctTree.h"
 #include <vector>
+#include <stdint.h>
 
 namespace caret {
 
@@ -60,29 +59,31 @@ namespace caret {
     
     class SignedDistanceHelperBase
     {
-        struct TriVector
-        {//specifically so we can cleanly deallocate the vector from non-leaf nodes when they split
-            std::vector<int32_t>* m_triList;
-            TriVector() { m_triList = new std::vector<int32_t>(); }
-            ~TriVector() { freeData(); }
-            void freeData()
-            {
-                if (m_triList != NULL)
-                {
-                    delete m_triList;
-                    m_triList = NULL;
-                }
-            }
+        struct BuildTri
+        {
+            float m_minCoord[3], m_maxCoord[3], m_centroid[3];
+            int32_t m_triangle;
         };
-        static const int NUM_TRIS_TO_TEST = 50;//test for whether to split leaf at this number
-        static const int NUM_TRIS_TEST_INCR = 50;//and again at further multiples of this
-        CaretPointer<Oct<TriVector> > m_indexRoot;
+        static const int BVH_LEAF_SIZE = 8;//nodes with more triangles than this are split, also the chunk size for the distance kernel
+        static const int BVH_NUM_BINS = 16;//number of candidate split planes per node for the surface area heuristic
+        static const int BVH_MAX_DEPTH = 64;//forced leaf beyond this, so queries can use a fixed size stack
+        //flat bounding volume hierarchy, nodes are in depth-first order, so the left child of an internal node is the next node
+        std::vector<float> m_nodeBounds[6];//SoA node bounding boxes: min x, y, z, then max x, y, z
+        std::vector<int32_t> m_nodeStart;//leaf: first position in m_leafTris, internal: index of right child
+        std::vector<int32_t> m_nodeCount;//leaf: number of triangles, internal: 0
+        std::vector<int32_t> m_leafTris;//triangle indices, ordered so that each leaf's triangles are contiguous
+        std::vector<float> m_leafVerts[9];//SoA vertex coordinates in m_leafTris order (x, y, z of first vertex, then second, then third), for the distance kernel
         int32_t m_numTris, m_numNodes;
         std::vector<float> m_coordList;//make a copy of what we need from SurfaceFile so that if the SurfaceFile gets destroyed, we don't crash
         std::vector<int32_t> m_triangleList;
         CaretPointer<TopologyHelper> m_topoHelp;
         SignedDistanceHelperBase();
-        void addTriangle(Oct<TriVector>* thisOct, int32_t triangle, float minCoord[3], float maxCoord[3]);
+        int32_t buildNode(std::vector<BuildTri>& buildTris, const int32_t start, const int32_t end, const int depth);
+        void makeLeaf(const int32_t node, const std::vector<BuildTri>& buildTris, const int32_t start, const int32_t end);
+        float nodeDistSquared(const int32_t node, const float coord[3]) const;
+        void leafDistSquared(const int32_t first, const int32_t count, const float coord[3], float* distSqOut) const;
+        bool nodeHitByRay(const int32_t node, const float start[3], const float end[3], const bool segment) const;
+        float nodeSegmentEntry(const int32_t node, const float start[3], const float direction[3]) const;//fraction along the segment where it enters the box, infinity if it misses
         const float* getCoordinate(const int32_t nodeIndex) const;//make these public? probably don't want them to be widely used, that is what SurfaceFile is for (but we don't want to store a SurfaceFile pointer)
         const int32_t* getTriangle(const int32_t tileIndex) const;
     public:
@@ -118,10 +119,7 @@ namespace caret {
             NORMALS
         };
     private:
-        CaretMutex m_mutex;
         CaretPointer<SignedDistanceHelperBase> m_base;
-        CaretArray<int> m_triMarked;
-        CaretArray<int> m_triMarkChanged;
         SignedDistanceHelper();
         struct ClosestPointInfo
         {
@@ -129,19 +127,31 @@ namespace caret {
             int32_t node1, node2, triangle;
             Vector3D tempPoint;
         };
-        float unsignedDistToTri(const float coord[3], int32_t triangle, ClosestPointInfo& myInfo);
-        int computeSign(const float coord[3], ClosestPointInfo myInfo, WindingLogic myWinding);
-        bool pointInTri(Vector3D verts[3], Vector3D inPlane, int majAxis, int midAxis);
+        bool findClosest(const float coord[3], float& bestDistInOut, ClosestPointInfo& bestInfo) const;//only finds triangles closer than the initial value of bestDistInOut
+        float unsignedDistToTri(const float coord[3], int32_t triangle, ClosestPointInfo& myInfo) const;
+        int computeSign(const float coord[3], ClosestPointInfo myInfo, WindingLogic myWinding) const;
+        bool pointInTri(Vector3D verts[3], Vector3D inPlane, int majAxis, int midAxis) const;
     public:
         SignedDistanceHelper(CaretPointer<SignedDistanceHelperBase> myBase);
         
         ///return the signed distance value at the point
+        ///queries don't modify the helper, so one helper can be used from multiple threads
         float dist(const float coord[3], WindingLogic myWinding);
         float distLimited(const float coord[3], const float limit, bool& validOut, WindingLogic myWinding);
         
+        ///signed distance for many points (xyz triples) at once, computed in parallel
+        void distBatch(const float* coords, const int64_t& numPoints, float* distOut, WindingLogic myWinding);
+        
+        ///limited signed distance for many points, validOut is set to 1 for points that had a triangle within the limit, NaN is output for the others
+        void distLimitedBatch(const float* coords, const int64_t& numPoints, const float limit, float* distOut, char* validOut, WindingLogic myWinding);
+        
         ///find the closest point ON the surface, and return information about it
         ///will never have negative barycentric weights, or a point outside the triangle
         void barycentricWeights(const float coordIn[3], BarycentricInfo& baryInfoOut);
+        
+        ///find the first triangle hit by the line segment from start to end, fractionOut is where along the segment the hit is (0 is start, 1 is end)
+        ///triangles are hit from either side, returns false if the segment doesn't hit the surface
+        bool firstHitBySegment(const float start[3], const float end[3], int32_t& triangleOut, float& fractionOut) const;
     };
 
 }
@@ -38,7 +38,7 @@
 #include "EventSurfaceColoringInvalidate.h"
 #include "GiftiFile.h"
 #include "GiftiMetaDataXmlElements.h"
-#include "GraphicsPrimitiveV3fN3fC4f.h"
+#include "GraphicsPrimitiveV3fN3fC4ub.h"
 #include "MathFunctions.h"
 #include "Matrix4x4.h"
 #include "Vector3D.h"
@@ -47,10 +47,20 @@
 #include "GeodesicHelper.h"
 #include "PlainTextStringBuilder.h"
 #include "SignedDistanceHelper.h"
+#include "SurfaceTriangleSpanIndex.h"
 #include "TopologyHelper.h"
 
 using namespace caret;
 
+namespace {
+    /*
+     * Overlay coloring layers use 16 bytes per vertex for each tab, view,
+     * and overlay that has been drawn.  With many tabs this becomes very
+     * large, so the least recently drawn are released above this.
+     */
+    const int64_t MAXIMUM_OVERLAY_COLORING_LAYERS_BYTES = (int64_t)256 * 1024 * 1024;
+}
+
 /**
  * Constructor.
  */
@@ -111,6 +121,15 @@ SurfaceFile::~SurfaceFile()
     }
     
     this->invalidateNodeColoringForBrowserTabs();
+    
+    /*
+     * Release this surface's topology before the members are
+     * destroyed so that a shared topology base no longer used
+     * by any surface is freed now.
+     */
+    m_topoHelpers.clear();
+    m_topoBase.grabNew(NULL);
+    TopologyHelperBase::releaseUnusedSharedBases();
 }
 
 void SurfaceFile::writeFile(const AString& filename)
@@ -138,6 +157,7 @@ SurfaceFile::clear()
     trianglePointer = NULL;
     GiftiTypeFile::clear();
     invalidateHelpers();
+    invalidateNormals();
     this->invalidateNodeColoringForBrowserTabs();
 }
 
@@ -319,6 +339,7 @@ void SurfaceFile::setNumberOfNodesAndTriangles(const int32_t& nodes, const int32
     trianglePointer = NULL;
     giftiFile->clearAndKeepMetadata();
     invalidateHelpers();
+    invalidateNormals();
     this->invalidateNodeColoringForBrowserTabs();
     std::vector<int64_t> dims(2);
     dims[1] = 3;
@@ -582,6 +603,7 @@ void
 SurfaceFile::invalidateNormals()
 {
     m_normalsComputed = false;
+    m_graphicsPrimitive.reset();//contains coordinates and normals
 }
 /**
  * Compute surface normals.
@@ -664,7 +686,7 @@ std::vector<float> SurfaceFile::computeAverageNormals()
     {
         int i3 = i * 3;
         Vector3D accum;
-        const std::vector<int32_t>& neighbors = myTopoHelp->getNodeNeighbors(i);
+        const TopologyIndexList neighbors = myTopoHelp->getNodeNeighbors(i);
         int numNeigh = (int)neighbors.size();
         for (int j = 0; j < numNeigh; ++j)
         {
@@ -822,7 +844,7 @@ void SurfaceFile::getTopologyHelper(CaretPointer<TopologyHelper>& helpOut, bool
         }
         if (m_topoBase == NULL || (infoSorted && !m_topoBase->isNodeInfoSorted()))
         {
-            m_topoBase.grabNew(new TopologyHelperBase(this, infoSorted));
+            m_topoBase = TopologyHelperBase::getSharedBase(this, infoSorted);//surfaces with identical triangles share one base
         }
     }
     CaretPointer<TopologyHelper> ret(new TopologyHelper(m_topoBase));
@@ -888,6 +910,7 @@ void SurfaceFile::invalidateHelpers()
         m_topoHelperIndex = 0;
         m_topoHelpers.clear();
         m_topoBase.grabNew(NULL);
+        TopologyHelperBase::releaseUnusedSharedBases();
     }
     if (m_distBase != NULL)
     {
@@ -901,6 +924,11 @@ void SurfaceFile::invalidateHelpers()
         CaretMutexLocker myLock3(&m_locatorMutex);
         m_locator.grabNew(NULL);
     }
+    if (m_triangleSpanIndex != NULL)
+    {
+        CaretMutexLocker myLock5(&m_triangleSpanIndexMutex);
+        m_triangleSpanIndex.grabNew(NULL);
+    }
 }
 
 /**
@@ -1396,6 +1424,21 @@ CaretPointer<const CaretPointLocator> SurfaceFile::getPointLocator() const
     return m_locator;
 }
 
+CaretPointer<const SurfaceTriangleSpanIndex> SurfaceFile::getTriangleSpanIndex() const
+{
+    if (m_triangleSpanIndex == NULL)//try to avoid locking even once
+    {
+        CaretMutexLocker myLock(&m_triangleSpanIndexMutex);
+        if (m_triangleSpanIndex == NULL)//test again AFTER lock to avoid race conditions
+        {
+            const int32_t numTriangles = getNumberOfTriangles();
+            m_triangleSpanIndex.grabNew(new SurfaceTriangleSpanIndex(getCoordinateData(), getNumberOfNodes(),
+                                                                     (numTriangles > 0 ? getTriangle(0) : NULL), numTriangles));
+        }
+    }
+    return m_triangleSpanIndex;
+}
+
 void SurfaceFile::clearCachedHelpers() const
 {
     {
@@ -1403,6 +1446,7 @@ void SurfaceFile::clearCachedHelpers() const
         m_topoHelperIndex = 0;
         m_topoHelpers.clear();
         m_topoBase.grabNew(NULL);
+        TopologyHelperBase::releaseUnusedSharedBases();
     }
     {
         CaretMutexLocker locked(&m_geoHelperMutex);
@@ -1420,6 +1464,10 @@ void SurfaceFile::clearCachedHelpers() const
         CaretMutexLocker locked(&m_locatorMutex);
         m_locator.grabNew(NULL);
     }
+    {
+        CaretMutexLocker locked(&m_triangleSpanIndexMutex);
+        m_triangleSpanIndex.grabNew(NULL);
+    }
 }
 
 /**
@@ -1547,9 +1595,14 @@ SurfaceFile::getNodesSpacingStatistics(FastStatistics& statsOut) const
 
 /**
  * Invalidate surface coloring.
+ *
+ * @param mapFile
+ *    If not NULL, only the coloring of this file has changed so
+ *    overlay coloring layers displaying other files remain valid.
+ *    If NULL, all overlay coloring layers are removed.
  */
 void
-SurfaceFile::invalidateNodeColoringForBrowserTabs()
+SurfaceFile::invalidateNodeColoringForBrowserTabs(const CaretMappableDataFile* mapFile)
 {
     /*
      * Free memory since could have many tabs and many surfaces equals lots of memory
@@ -1560,9 +1613,27 @@ SurfaceFile::invalidateNodeColoringForBrowserTabs()
         this->wholeBrainNodeColoringForBrowserTabs[i].clear();
     }
     
-    m_surfaceGraphicsPrimitives.clear();
-    m_surfaceMontageGraphicsPrimitives.clear();
-    m_wholeBrainGraphicsPrimitives.clear();
+    if (mapFile != NULL) {
+        /*
+         * Keep memory of invalid layers since they are likely
+         * to be recomputed when the surface is drawn
+         */
+        for (auto& layers : m_overlayColoringLayers) {
+            for (auto& layer : layers) {
+                if (layer.m_mapFile == mapFile) {
+                    layer.m_validFlag = false;
+                }
+            }
+        }
+    }
+    else {
+        m_overlayColoringLayers.clear();
+    }
+    
+    /*
+     * Graphics primitive color streams are kept so that only the
+     * vertices whose colors change are reloaded when colored again
+     */
 }
 
 /**
@@ -1692,10 +1763,7 @@ SurfaceFile::setSurfaceNodeColoringRgbaForBrowserTab(const int32_t browserTabInd
         rgba[i] = rgbaNodeColorComponents[i];
     }
     
-    if ((browserTabIndex >= 0)
-        && (browserTabIndex < static_cast<int32_t>(m_surfaceGraphicsPrimitives.size()))) {
-        m_surfaceGraphicsPrimitives[browserTabIndex].reset();
-    }
+    setGraphicsPrimitiveColorStreamModified(browserTabIndex);
 }
 
 /**
@@ -1744,10 +1812,7 @@ SurfaceFile::setSurfaceMontageNodeColoringRgbaForBrowserTab(const int32_t browse
         rgba[i] = rgbaNodeColorComponents[i];
     }
     
-    if ((browserTabIndex >= 0)
-        && (browserTabIndex < static_cast<int32_t>(m_surfaceMontageGraphicsPrimitives.size()))) {
-        m_surfaceMontageGraphicsPrimitives[browserTabIndex].reset();
-    }
+    setGraphicsPrimitiveColorStreamModified(BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS + browserTabIndex);
 }
 
 
@@ -1796,9 +1861,105 @@ SurfaceFile::setWholeBrainNodeColoringRgbaForBrowserTab(const int32_t browserTab
         rgba[i] = rgbaNodeColorComponents[i];
     }
     
-    if ((browserTabIndex >= 0)
-        && (browserTabIndex < static_cast<int32_t>(m_wholeBrainGraphicsPrimitives.size()))) {
-        m_wholeBrainGraphicsPrimitives[browserTabIndex].reset();
+    setGraphicsPrimitiveColorStreamModified((BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS * 2) + browserTabIndex);
+}
+
+/**
+ * @return The overlay coloring layers for this single surface in the given tab.
+ * @param browserTabIndex
+ *    Index of browser tab.
+ */
+std::vector<SurfaceFile::OverlayColoringLayer>&
+SurfaceFile::getSurfaceOverlayColoringLayersForBrowserTab(const int32_t browserTabIndex)
+{
+    return getOverlayColoringLayers(browserTabIndex);
+}
+
+/**
+ * @return The overlay coloring layers for this surface montage in the given tab.
+ * @param browserTabIndex
+ *    Index of browser tab.
+ */
+std::vector<SurfaceFile::OverlayColoringLayer>&
+SurfaceFile::getSurfaceMontageOverlayColoringLayersForBrowserTab(const int32_t browserTabIndex)
+{
+    return getOverlayColoringLayers(BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS + browserTabIndex);
+}
+
+/**
+ * @return The overlay coloring layers for this whole brain surface in the given tab.
+ * @param browserTabIndex
+ *    Index of browser tab.
+ */
+std::vector<SurfaceFile::OverlayColoringLayer>&
+SurfaceFile::getWholeBrainOverlayColoringLayersForBrowserTab(const int32_t browserTabIndex)
+{
+    return getOverlayColoringLayers((BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS * 2) + browserTabIndex);
+}
+
+/**
+ * @return The overlay coloring layers for the given color stream.
+ * @param colorStreamIndex
+ *    Index of the color stream
+ */
+std::vector<SurfaceFile::OverlayColoringLayer>&
+SurfaceFile::getOverlayColoringLayers(const int32_t colorStreamIndex)
+{
+    if (m_overlayColoringLayers.empty()) {
+        m_overlayColoringLayers.resize(BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS * 3);
+        m_overlayColoringLayersLastUsed.assign(BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS * 3,
+                                               0);
+    }
+    
+    CaretAssertVectorIndex(m_overlayColoringLayers, colorStreamIndex);
+    CaretAssertVectorIndex(m_overlayColoringLayersLastUsed, colorStreamIndex);
+    ++m_overlayColoringLayersUseCounter;
+    m_overlayColoringLayersLastUsed[colorStreamIndex] = m_overlayColoringLayersUseCounter;
+    
+    limitOverlayColoringLayersMemory(colorStreamIndex);
+    
+    return m_overlayColoringLayers[colorStreamIndex];
+}
+
+/**
+ * Release the overlay coloring layers of the least recently used color
+ * streams until the memory used by all layers is within the limit.
+ * Layers of the stream that is about to be colored are always kept.
+ *
+ * @param keepColorStreamIndex
+ *    Index of the color stream whose layers are kept.
+ */
+void
+SurfaceFile::limitOverlayColoringLayersMemory(const int32_t keepColorStreamIndex)
+{
+    const int32_t numStreams = static_cast<int32_t>(m_overlayColoringLayers.size());
+    std::vector<int64_t> streamBytes(numStreams, 0);
+    int64_t totalBytes = 0;
+    for (int32_t iStream = 0; iStream < numStreams; iStream++) {
+        for (const auto& layer : m_overlayColoringLayers[iStream]) {
+            streamBytes[iStream] += layer.m_rgbv.capacity() * sizeof(float);
+        }
+        totalBytes += streamBytes[iStream];
+    }
+    
+    while (totalBytes > MAXIMUM_OVERLAY_COLORING_LAYERS_BYTES) {
+        int32_t oldestStreamIndex = -1;
+        for (int32_t iStream = 0; iStream < numStreams; iStream++) {
+            if ((iStream != keepColorStreamIndex)
+                && (streamBytes[iStream] > 0)) {
+                if ((oldestStreamIndex < 0)
+                    || (m_overlayColoringLayersLastUsed[iStream] < m_overlayColoringLayersLastUsed[oldestStreamIndex])) {
+                    oldestStreamIndex = iStream;
+                }
+            }
+        }
+        if (oldestStreamIndex < 0) {
+            break;
+        }
+        
+        totalBytes -= streamBytes[oldestStreamIndex];
+        streamBytes[oldestStreamIndex] = 0;
+        std::vector<OverlayColoringLayer>().swap(m_overlayColoringLayers[oldestStreamIndex]);
     }
 }
 
@@ -1808,91 +1969,112 @@ SurfaceFile::setWholeBrainNodeColoringRgbaForBrowserTab(const int32_t browserTab
  * @param browserTabIndex
  *    Index of the tab
  */
-GraphicsPrimitiveV3fN3fC4f*
+GraphicsPrimitiveV3fN3fC4ub*
 SurfaceFile::getSurfaceGraphicsPrimitiveForBrowserTab(const int32_t browserTabIndex)
 {
     const float* allRGBA(getSurfaceNodeColoringRgbaForBrowserTab(browserTabIndex));
-    GraphicsPrimitiveV3fN3fC4f* primitiveOut(getGraphicsPrimitive(m_surfaceGraphicsPrimitives,
-                                                                  browserTabIndex,
-                                                                  allRGBA));
+    GraphicsPrimitiveV3fN3fC4ub* primitiveOut(getGraphicsPrimitive(browserTabIndex,
+                                                                   allRGBA));
     return primitiveOut;
 }
 
 /**
- * @return the graphics primitive for drawing this surface for a single surface view
- * in the given tab index
- * @param primitives
- *    Primitives for each tab index
- * @param browserTabIndex
- *    Index of the tab
+ * @return the graphics primitive for drawing this surface with the given
+ * color stream active.  The primitive is shared by all tabs and views.
+ * @param colorStreamIndex
+ *    Index of the color stream
  * @param rgba
  *    The RGBA coloring for the surface
  */
-GraphicsPrimitiveV3fN3fC4f*
-SurfaceFile::getGraphicsPrimitive(std::vector<std::unique_ptr<GraphicsPrimitiveV3fN3fC4f>>& primitives,
-                                                                     const int32_t browserTabIndex,
-                                                                     const float* rgba)
+GraphicsPrimitiveV3fN3fC4ub*
+SurfaceFile::getGraphicsPrimitive(const int32_t colorStreamIndex,
+                                  const float* rgba)
 {
-    GraphicsPrimitiveV3fN3fC4f* primitiveOut(NULL);
-    
-    if ((browserTabIndex >= 0)
-        && (browserTabIndex < static_cast<int32_t>(primitives.size()))) {
-        primitiveOut = primitives[browserTabIndex].get();
+    if (m_graphicsPrimitive == NULL) {
+        m_graphicsPrimitive.reset(createSurfaceGraphicsPrimitive());
+        m_graphicsPrimitiveColorStreamModified.assign(BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS * 3,
+                                                      true);
     }
     
-    if (primitiveOut == NULL) {
-        primitiveOut = createSurfaceGraphicsPrimitive(rgba);
-        
-        if (primitiveOut != NULL) {
-            if (browserTabIndex >= static_cast<int32_t>(primitives.size())) {
-                primitives.resize(browserTabIndex + 1);
-            }
-            primitives[browserTabIndex].reset(primitiveOut);
-        }
+    CaretAssertVectorIndex(m_graphicsPrimitiveColorStreamModified, colorStreamIndex);
+    if ((rgba != NULL)
+        && m_graphicsPrimitiveColorStreamModified[colorStreamIndex]) {
+        m_graphicsPrimitive->replaceColorStreamFromFloatRGBA(colorStreamIndex,
+                                                             rgba);
+        m_graphicsPrimitiveColorStreamModified[colorStreamIndex] = false;
     }
+    m_graphicsPrimitive->setActiveColorStream(colorStreamIndex);
     
-    return primitiveOut;
+    return m_graphicsPrimitive.get();
+}
 
+/**
+ * Indicate that coloring for a color stream in the graphics primitive has changed.
+ * @param colorStreamIndex
+ *    Index of the color stream
+ */
+void
+SurfaceFile::setGraphicsPrimitiveColorStreamModified(const int32_t colorStreamIndex)
+{
+    if ((colorStreamIndex >= 0)
+        && (colorStreamIndex < static_cast<int32_t>(m_graphicsPrimitiveColorStreamModified.size()))) {
+        m_graphicsPrimitiveColorStreamModified[colorStreamIndex] = true;
+    }
 }
 
 /*
- * @return Graphics primitive for drawing this surface in the given RGBA colors
- * @param rgba
- *     The RGBA coloring
- * @return
- *     The graphics primitive
+ * @return Graphics primitive for drawing this surface.  Each vertex in the
+ * primitive is a surface vertex and the triangles are drawn with element indices.
+ * Coloring is added to the primitive's color streams.
  */
-GraphicsPrimitiveV3fN3fC4f*
-SurfaceFile::createSurfaceGraphicsPrimitive(const float* rgba)
+GraphicsPrimitiveV3fN3fC4ub*
+SurfaceFile::createSurfaceGraphicsPrimitive()
 {
-    GraphicsPrimitiveV3fN3fC4f* primitiveOut(GraphicsPrimitive::newPrimitiveV3fN3fC4f(GraphicsPrimitive::PrimitiveType::OPENGL_TRIANGLES));
+    GraphicsPrimitiveV3fN3fC4ub* primitiveOut(GraphicsPrimitive::newPrimitiveV3fN3fC4ub(GraphicsPrimitive::PrimitiveType::OPENGL_TRIANGLES));
+    primitiveOut->setUsageTypeCoordinates(GraphicsPrimitive::UsageType::MODIFIED_ONCE_DRAWN_MANY_TIMES);
+    primitiveOut->setUsageTypeNormals(GraphicsPrimitive::UsageType::MODIFIED_ONCE_DRAWN_MANY_TIMES);
+    
+    computeNormals();
+    
+    const int32_t numberOfVertices(getNumberOfNodes());
+    primitiveOut->reserveForNumberOfVertices(numberOfVertices);
+    const uint8_t defaultRGBA[4] { 170, 170, 170, 255 };
+    for (int32_t i = 0; i < numberOfVertices; i++) {
+        primitiveOut->addVertex(getCoordinate(i),
+                                getNormalVector(i),
+                                defaultRGBA);
+    }
     
     const int32_t numberOfTriangles(getNumberOfTriangles());
+    std::vector<uint32_t> elementIndices;
+    elementIndices.reserve(numberOfTriangles * 3);
     for (int32_t i = 0; i < numberOfTriangles; i++) {
         const int32_t* triangleIndices(getTriangle(i));
-        for (int32_t j = 0; j < 3; j++) {
-            const int32_t vertexIndex(triangleIndices[j]);
-            const float* xyz(getCoordinate(vertexIndex));
-            const float* normalXYZ(getNormalVector(vertexIndex));
-            const float* vertexRgba(&rgba[vertexIndex * 4]);
-            primitiveOut->addVertex(xyz, normalXYZ, vertexRgba);
+        if ((triangleIndices[0] >= 0)
+            && (triangleIndices[1] >= 0)
+            && (triangleIndices[2] >= 0)) {
+            elementIndices.insert(elementIndices.end(),
+                                  triangleIndices,
+                                  triangleIndices + 3);
         }
     }
+    primitiveOut->replaceElementIndices(elementIndices);
+    
     return primitiveOut;
 }
+
 /**
  * @return the graphics primitive for drawing this surface for a  surface montage view
  * in the given tab index
  * @param browserTabIndex
  *    Index of the tab
  */
-GraphicsPrimitiveV3fN3fC4f*
+GraphicsPrimitiveV3fN3fC4ub*
 SurfaceFile::getSurfaceMontageGraphicsPrimitiveForBrowserTab(const int32_t browserTabIndex)
 {
     const float* allRGBA(getSurfaceMontageNodeColoringRgbaForBrowserTab(browserTabIndex));
-    GraphicsPrimitiveV3fN3fC4f* primitiveOut(getGraphicsPrimitive(m_surfaceMontageGraphicsPrimitives,
-                                                                  browserTabIndex,
-                                                                  allRGBA));
+    GraphicsPrimitiveV3fN3fC4ub* primitiveOut(getGraphicsPrimitive(BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS + browserTabIndex,
+                                                                   allRGBA));
     return primitiveOut;
 }
 
@@ -1902,13 +2084,12 @@ SurfaceFile::getSurfaceMontageGraphicsPrimitiveForBrowserTab(const int32_t brows
  * @param browserTabIndex
  *    Index of the tab
  */
-GraphicsPrimitiveV3fN3fC4f*
+GraphicsPrimitiveV3fN3fC4ub*
 SurfaceFile::getWholeBrainGraphicsPrimitiveForBrowserTab(const int32_t browserTabIndex)
 {
     const float* allRGBA(getWholeBrainNodeColoringRgbaForBrowserTab(browserTabIndex));
-    GraphicsPrimitiveV3fN3fC4f* primitiveOut(getGraphicsPrimitive(m_wholeBrainGraphicsPrimitives,
-                                                                  browserTabIndex,
-                                                                  allRGBA));
+    GraphicsPrimitiveV3fN3fC4ub* primitiveOut(getGraphicsPrimitive((BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS * 2) + browserTabIndex,
+                                                                   allRGBA));
     return primitiveOut;
 }
 
@@ -1928,7 +2109,7 @@ SurfaceFile::receiveEvent(Event* event)
         
         invalidateEvent->setEventProcessed();
         
-        this->invalidateNodeColoringForBrowserTabs();
+        this->invalidateNodeColoringForBrowserTabs(invalidateEvent->getMapFile());
     }    
 }
 
@@ -1956,8 +2137,8 @@ bool SurfaceFile::hasNodeCorrespondence(const SurfaceFile& rhs) const
     CaretPointer<TopologyHelper> myHelp = getTopologyHelper(), rightHelp = rhs.getTopologyHelper();
     for (int i = 0; i < numNodes; ++i)
     {
-        const std::vector<int32_t>& myNeigh = myHelp->getNodeNeighbors(i);
-        const std::vector<int32_t>& rightNeigh = rightHelp->getNodeNeighbors(i);
+        const TopologyIndexList myNeigh = myHelp->getNodeNeighbors(i);
+        const TopologyIndexList rightNeigh = rightHelp->getNodeNeighbors(i);
         int mySize = (int)myNeigh.size();
         if (mySize != (int)rightNeigh.size()) return false;
         std::set<int32_t> myUsed;
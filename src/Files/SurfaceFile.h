@@ -36,17 +36,19 @@
 namespace caret {
 
     class BoundingBox;
+    class CaretMappableDataFile;
     class CaretPointLocator;
     class DescriptiveStatistics;
     class FastStatistics;
     class GeodesicHelper;
     class GeodesicHelperBase;
     class GiftiDataArray;
-    class GraphicsPrimitiveV3fN3fC4f;
+    class GraphicsPrimitiveV3fN3fC4ub;
     class Matrix4x4;
     class PlainTextStringBuilder;
     class SignedDistanceHelper;
     class SignedDistanceHelperBase;
+    class SurfaceTriangleSpanIndex;
     class TopologyHelper;
     class TopologyHelperBase;
     
@@ -64,6 +66,29 @@ namespace caret {
         
         virtual ~SurfaceFile();
         
+        /**
+         * Coloring assigned by one overlay to the vertices of this surface
+         * in a tab.  Layers are kept so that when the coloring of one file
+         * changes only the layers displaying that file are recomputed.
+         */
+        class OverlayColoringLayer {
+        public:
+            /** File that was colored */
+            const CaretMappableDataFile* m_mapFile = NULL;
+            
+            /** Index of map that was colored */
+            int32_t m_mapIndex = -1;
+            
+            /** True if the overlay assigned coloring to any vertices */
+            bool m_coloringAssignedFlag = false;
+            
+            /** True if the coloring is valid for the file and map */
+            bool m_validFlag = false;
+            
+            /** Red, green, blue, and valid components for each vertex (valid is zero if not colored) */
+            std::vector<float> m_rgbv;
+        };
+        
         virtual void addToDataFileContentInformation(DataFileContentInformation& dataFileInformation);
         
         virtual void receiveEvent(Event* event);
@@ -142,6 +167,8 @@ namespace caret {
         
         CaretPointer<const CaretPointLocator> getPointLocator() const;
         
+        CaretPointer<const SurfaceTriangleSpanIndex> getTriangleSpanIndex() const;
+        
         void clearCachedHelpers() const;
         
         const BoundingBox* getBoundingBox() const;
@@ -185,11 +212,17 @@ namespace caret {
         void setWholeBrainNodeColoringRgbaForBrowserTab(const int32_t browserTabIndex,
                                               const float* rgbaNodeColorComponents);
 
-        GraphicsPrimitiveV3fN3fC4f* getSurfaceGraphicsPrimitiveForBrowserTab(const int32_t browserTabIndex);
+        std::vector<OverlayColoringLayer>& getSurfaceOverlayColoringLayersForBrowserTab(const int32_t browserTabIndex);
         
-        GraphicsPrimitiveV3fN3fC4f* getSurfaceMontageGraphicsPrimitiveForBrowserTab(const int32_t browserTabIndex);
+        std::vector<OverlayColoringLayer>& getSurfaceMontageOverlayColoringLayersForBrowserTab(const int32_t browserTabIndex);
         
-        GraphicsPrimitiveV3fN3fC4f* getWholeBrainGraphicsPrimitiveForBrowserTab(const int32_t browserTabIndex);
+        std::vector<OverlayColoringLayer>& getWholeBrainOverlayColoringLayersForBrowserTab(const int32_t browserTabIndex);
+        
+        GraphicsPrimitiveV3fN3fC4ub* getSurfaceGraphicsPrimitiveForBrowserTab(const int32_t browserTabIndex);
+        
+        GraphicsPrimitiveV3fN3fC4ub* getSurfaceMontageGraphicsPrimitiveForBrowserTab(const int32_t browserTabIndex);
+        
+        GraphicsPrimitiveV3fN3fC4ub* getWholeBrainGraphicsPrimitiveForBrowserTab(const int32_t browserTabIndex);
         
         
         void invalidateNormals();
@@ -226,7 +259,7 @@ namespace caret {
         void initializeMembersSurfaceFile();
         
     private:
-        void invalidateNodeColoringForBrowserTabs();
+        void invalidateNodeColoringForBrowserTabs(const CaretMappableDataFile* mapFile = NULL);
         
         void allocateSurfaceNodeColoringForBrowserTab(const int32_t browserTabIndex,
                                                       const bool zeroizeColorsFlag);
@@ -237,11 +270,16 @@ namespace caret {
         void allocateWholeBrainNodeColoringForBrowserTab(const int32_t browserTabIndex,
                                                          const bool zeroizeColorsFlag);
         
-        GraphicsPrimitiveV3fN3fC4f* createSurfaceGraphicsPrimitive(const float* rgba);
+        GraphicsPrimitiveV3fN3fC4ub* createSurfaceGraphicsPrimitive();
 
-        GraphicsPrimitiveV3fN3fC4f* getGraphicsPrimitive(std::vector<std::unique_ptr<GraphicsPrimitiveV3fN3fC4f>>& primitives,
-                                                         const int32_t browserTabIndex,
-                                                         const float* rgba);
+        GraphicsPrimitiveV3fN3fC4ub* getGraphicsPrimitive(const int32_t colorStreamIndex,
+                                                          const float* rgba);
+        
+        void setGraphicsPrimitiveColorStreamModified(const int32_t colorStreamIndex);
+        
+        std::vector<OverlayColoringLayer>& getOverlayColoringLayers(const int32_t colorStreamIndex);
+        
+        void limitOverlayColoringLayersMemory(const int32_t keepColorStreamIndex);
 
         /** Data array containing the coordinates. */
         GiftiDataArray* coordinateDataArray;
@@ -271,17 +309,30 @@ namespace caret {
         std::vector<float> wholeBrainNodeColoringForBrowserTabs[BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS];
         
         /**
-         * Graphics primitive for single surface in a tab
+         * Graphics primitive containing the coordinates and normals once for all tabs.
+         * The coloring for single surface, surface montage, and whole brain in
+         * each tab is a color stream in the primitive.  Streams for single surface
+         * are at the tab index, surface montage offset by the number of tabs, and
+         * whole brain offset by twice the number of tabs.
          */
-        std::vector<std::unique_ptr<GraphicsPrimitiveV3fN3fC4f>> m_surfaceGraphicsPrimitives;
+        std::unique_ptr<GraphicsPrimitiveV3fN3fC4ub> m_graphicsPrimitive;
+        
         /**
-         * Graphics primitive for  surface montage int a tab
+         * Color streams in the graphics primitive that need to be updated from the node coloring
          */
-        std::vector<std::unique_ptr<GraphicsPrimitiveV3fN3fC4f>> m_surfaceMontageGraphicsPrimitives;
+        std::vector<bool> m_graphicsPrimitiveColorStreamModified;
+        
         /**
-         * Graphics primitive for whole brain surface int a tab
+         * Coloring of each overlay indexed by color stream (same indexing as
+         * color streams in the graphics primitive) and then by overlay.
          */
-        std::vector<std::unique_ptr<GraphicsPrimitiveV3fN3fC4f>> m_wholeBrainGraphicsPrimitives;
+        std::vector<std::vector<OverlayColoringLayer>> m_overlayColoringLayers;
+        
+        /** Value of m_overlayColoringLayersUseCounter when each color stream's layers were last used */
+        std::vector<int64_t> m_overlayColoringLayersLastUsed;
+        
+        /** Incremented each time overlay coloring layers are used */
+        int64_t m_overlayColoringLayersUseCounter = 0;
         
         
         /** Points to memory containing the coordinates. */
@@ -333,12 +384,15 @@ namespace caret {
         ///used to search for the closest point in the surface
         mutable CaretPointer<CaretPointLocator> m_locator;
         
+        ///used to find the triangles that may intersect an axis-aligned plane
+        mutable CaretPointer<SurfaceTriangleSpanIndex> m_triangleSpanIndex;
+        
         ///used to track when the surface file gets changed
         void invalidateHelpers();
         
         mutable BoundingBox* boundingBox;
         
-        mutable CaretMutex m_topoHelperMutex, m_geoHelperMutex, m_locatorMutex, m_distHelperMutex;
+        mutable CaretMutex m_topoHelperMutex, m_geoHelperMutex, m_locatorMutex, m_distHelperMutex, m_triangleSpanIndexMutex;
     };
 
 } // namespace
@@ -19,6 +19,8 @@
  */
 /*LICENSE_END*/
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 #define __SURFACE_PLANE_INTERSECTION_TO_CONTOUR_DECLARE__
@@ -33,6 +35,7 @@
 #include "GraphicsPrimitiveV3fC4f.h"
 #include "Plane.h"
 #include "SurfaceFile.h"
+#include "SurfaceTriangleSpanIndex.h"
 #include "TopologyHelper.h"
 
 using namespace caret;
@@ -112,6 +115,8 @@ SurfacePlaneIntersectionToContour::SurfacePlaneIntersectionToContour(const Surfa
                                                                      const float contourThicknessPercentOfViewportHeight)
 : CaretObject(),
 m_surfaceFile(surfaceFile),
+m_coordinateData(surfaceFile->getCoordinateData()),
+m_numberOfVertices(surfaceFile->getNumberOfNodes()),
 m_intersectionPlane(intersectionPlane),
 m_drawOnPlane(drawOnPlane),
 m_caretColor(caretColor),
@@ -124,6 +129,59 @@ m_contourThicknessPercentOfViewportHeight(contourThicknessPercentOfViewportHeigh
                                 m_solidRGBA.data());
 }
 
+/**
+ * Constructor for use when the surface file may be modified or destroyed
+ * while the contours are created (such as on a background thread).  The
+ * coordinates, topology helper, and triangle span index must remain valid
+ * until contours are created.
+ *
+ * @param coordinateData
+ *     The surface's coordinates.
+ * @param numberOfVertices
+ *     Number of vertices in the surface.
+ * @param topologyHelper
+ *     Topology helper for the surface (must have sorted node info).
+ * @param triangleSpanIndex
+ *     Triangle span index for the surface (may be NULL).
+ * @param intersectionPlane
+ *     Plane intersected with the surface.
+ * @param drawOnPlane
+ *     Intersected points are projected to this plane
+ * @param caretColor
+ *     Solid coloring or, if value is CUSTOM, use the vertex coloring
+ * @param vertexColoringRGBA
+ *     The per-vertex coloring if 'caretColor' is CUSTOM
+ * @param contourThicknessPercentOfViewportHeight
+ *     Thickness for the contour as a percentage of viewport height.
+ */
+SurfacePlaneIntersectionToContour::SurfacePlaneIntersectionToContour(const float* coordinateData,
+                                                                     const int32_t numberOfVertices,
+                                                                     const CaretPointer<TopologyHelper>& topologyHelper,
+                                                                     const CaretPointer<const SurfaceTriangleSpanIndex>& triangleSpanIndex,
+                                                                     const Plane& intersectionPlane,
+                                                                     const Plane& drawOnPlane,
+                                                                     const CaretColorEnum::Enum caretColor,
+                                                                     const float* vertexColoringRGBA,
+                                                                     const float contourThicknessPercentOfViewportHeight)
+: CaretObject(),
+m_surfaceFile(NULL),
+m_coordinateData(coordinateData),
+m_numberOfVertices(numberOfVertices),
+m_intersectionPlane(intersectionPlane),
+m_drawOnPlane(drawOnPlane),
+m_caretColor(caretColor),
+m_vertexColoringRGBA(vertexColoringRGBA),
+m_contourThicknessPercentOfViewportHeight(contourThicknessPercentOfViewportHeight),
+m_topologyHelper(topologyHelper),
+m_triangleSpanIndex(triangleSpanIndex)
+{
+    CaretAssert(m_coordinateData);
+    CaretAssert(m_topologyHelper);
+    
+    CaretColorEnum::toRGBAFloat(caretColor,
+                                m_solidRGBA.data());
+}
+
 /**
  * Destructor.
  */
@@ -149,7 +207,7 @@ SurfacePlaneIntersectionToContour::createContours(std::vector<GraphicsPrimitive*
     errorMessageOut.clear();
     
     try {
-        if (m_surfaceFile->getNumberOfNodes() <= 2) {
+        if (m_numberOfVertices <= 2) {
             throw CaretException("Surface has an invalid number of vertices.");
         }
         if ( ! m_intersectionPlane.isValidPlane()) {
@@ -159,12 +217,15 @@ SurfacePlaneIntersectionToContour::createContours(std::vector<GraphicsPrimitive*
             throw CaretException("Draw on plane is invalid.");
         }
         
-        m_topologyHelper = m_surfaceFile->getTopologyHelper(true);
+        if (m_topologyHelper == NULL) {
+            CaretAssert(m_surfaceFile);
+            m_topologyHelper = m_surfaceFile->getTopologyHelper(true);
+        }
         if (m_topologyHelper->getNumberOfNodes() <= 2) {
             throw CaretException("Toplogy helper has an invalid number of vertices.");
         }
         
-        if (m_surfaceFile->getNumberOfNodes() != m_topologyHelper->getNumberOfNodes()) {
+        if (m_numberOfVertices != m_topologyHelper->getNumberOfNodes()) {
             throw CaretException("Surface File and its Topology contain a different number of vertices.");
         }
         static bool timingFlag = false;
@@ -173,6 +234,8 @@ SurfacePlaneIntersectionToContour::createContours(std::vector<GraphicsPrimitive*
             timer.start();
         }
         
+        findElementsNearPlane();
+        
         prepareVertices();
         const float verticesTime = (timingFlag ? timer.getElapsedTimeMilliseconds(): 0.0f);
 
@@ -197,6 +260,105 @@ SurfacePlaneIntersectionToContour::createContours(std::vector<GraphicsPrimitive*
     return true;
 }
 
+/**
+ * When the intersection plane is perpendicular to an axis (orthogonal
+ * slices), use the surface's triangle span index to find the vertices
+ * and edges in triangles that may intersect the plane so that only
+ * these vertices and edges are examined.  Oblique planes examine all
+ * vertices and edges.
+ */
+void
+SurfacePlaneIntersectionToContour::findElementsNearPlane()
+{
+    m_nearPlaneElementsValidFlag = false;
+    m_nearPlaneVertexIndices.clear();
+    m_nearPlaneEdgeIndices.clear();
+    
+    float planeNormalVector[3];
+    m_intersectionPlane.getNormalVector(planeNormalVector);
+    const float alignedTolerance(0.000001f);
+    int32_t axisIndex(-1);
+    for (int32_t i = 0; i < 3; i++) {
+        if (std::fabs(std::fabs(planeNormalVector[i]) - 1.0f) < alignedTolerance) {
+            axisIndex = i;
+        }
+    }
+    if (axisIndex < 0) {
+        return;
+    }
+    for (int32_t i = 0; i < 3; i++) {
+        if (i != axisIndex) {
+            if (std::fabs(planeNormalVector[i]) > alignedTolerance) {
+                return;
+            }
+        }
+    }
+    
+    if (m_triangleSpanIndex == NULL) {
+        if (m_surfaceFile == NULL) {
+            return;
+        }
+        m_triangleSpanIndex = m_surfaceFile->getTriangleSpanIndex();
+    }
+    
+    const std::vector<TopologyTileInfo>& allTileInfo = m_topologyHelper->getTileInfo();
+    if (m_triangleSpanIndex->getNumberOfTriangles() != static_cast<int32_t>(allTileInfo.size())) {
+        return;
+    }
+    
+    /*
+     * Plane is Ax + By + Cz + D = 0 with only one of A, B, C non-zero
+     */
+    double planeABCD[4];
+    m_intersectionPlane.getPlane(planeABCD[0], planeABCD[1], planeABCD[2], planeABCD[3]);
+    const float planeCoordinate = static_cast<float>(-planeABCD[3] / planeABCD[axisIndex]);
+    
+    /*
+     * Include triangles that barely miss the plane since vertices
+     * very close to the plane are moved away from the plane
+     */
+    const float spanTolerance(0.0001f);
+    std::vector<int32_t> triangleIndices;
+    m_triangleSpanIndex->getTrianglesSpanningCoordinate(axisIndex,
+                                                        planeCoordinate,
+                                                        spanTolerance,
+                                                        triangleIndices);
+    
+    const std::vector<TopologyEdgeInfo>& allEdgeInfo = m_topologyHelper->getEdgeInfo();
+    m_nearPlaneEdgeIndices.reserve(triangleIndices.size() * 3);
+    for (const int32_t triangleIndex : triangleIndices) {
+        CaretAssertVectorIndex(allTileInfo, triangleIndex);
+        const TopologyTileInfo& tileInfo = allTileInfo[triangleIndex];
+        for (int32_t iEdge = 0; iEdge < 3; iEdge++) {
+            m_nearPlaneEdgeIndices.push_back(tileInfo.edges[iEdge].edge);
+        }
+    }
+    
+    /*
+     * Sort edges so that edges are processed in the same order
+     * as when all edges are examined
+     */
+    std::sort(m_nearPlaneEdgeIndices.begin(),
+              m_nearPlaneEdgeIndices.end());
+    m_nearPlaneEdgeIndices.erase(std::unique(m_nearPlaneEdgeIndices.begin(),
+                                             m_nearPlaneEdgeIndices.end()),
+                                 m_nearPlaneEdgeIndices.end());
+    
+    m_nearPlaneVertexIndices.reserve(m_nearPlaneEdgeIndices.size() * 2);
+    for (const int32_t edgeIndex : m_nearPlaneEdgeIndices) {
+        CaretAssertVectorIndex(allEdgeInfo, edgeIndex);
+        m_nearPlaneVertexIndices.push_back(allEdgeInfo[edgeIndex].node1);
+        m_nearPlaneVertexIndices.push_back(allEdgeInfo[edgeIndex].node2);
+    }
+    std::sort(m_nearPlaneVertexIndices.begin(),
+              m_nearPlaneVertexIndices.end());
+    m_nearPlaneVertexIndices.erase(std::unique(m_nearPlaneVertexIndices.begin(),
+                                               m_nearPlaneVertexIndices.end()),
+                                   m_nearPlaneVertexIndices.end());
+    
+    m_nearPlaneElementsValidFlag = true;
+}
+
 /**
  * Prepare the vertices by computing their signed distance from the plane.
  * If vertex is on of very, very close to the plane, move the vertex
@@ -208,20 +370,30 @@ SurfacePlaneIntersectionToContour::prepareVertices()
 {
     const float epsilon = 0.0000001f;
     
-    CaretAssert(m_surfaceFile);
+    CaretAssert(m_coordinateData);
     
     float planeNormalVector[3];
     m_intersectionPlane.getNormalVector(planeNormalVector);
     const float abovePlaneOffset[3] = { planeNormalVector[0] * epsilon, planeNormalVector[1] * epsilon, planeNormalVector[2] * epsilon };
     
-    const float* surfaceXYZ = m_surfaceFile->getCoordinateData();
+    const float* surfaceXYZ = m_coordinateData;
     
-    const int32_t numberOfVertices = m_surfaceFile->getNumberOfNodes();
+    const int32_t numberOfVertices = m_numberOfVertices;
     
+    /*
+     * When only vertices near the plane are used, the other vertices remain NULL
+     */
     m_vertices.resize(numberOfVertices);
     
+    const int32_t numberOfVerticesToPrepare = (m_nearPlaneElementsValidFlag
+                                               ? static_cast<int32_t>(m_nearPlaneVertexIndices.size())
+                                               : numberOfVertices);
+    
 #pragma omp CARET_PARFOR
-    for (int32_t i = 0; i < numberOfVertices; i++) {
+    for (int32_t iPrepare = 0; iPrepare < numberOfVerticesToPrepare; iPrepare++) {
+        const int32_t i = (m_nearPlaneElementsValidFlag
+                           ? m_nearPlaneVertexIndices[iPrepare]
+                           : iPrepare);
         const int32_t i3 = i * 3;
         std::array<float, 3> xyz = {{ surfaceXYZ[i3], surfaceXYZ[i3 + 1], surfaceXYZ[i3 + 2] }};
         
@@ -263,9 +435,16 @@ SurfacePlaneIntersectionToContour::prepareEdges()
     
     const int32_t numEdges = static_cast<int32_t>(allEdgeInfo.size());
     
-    m_topoHelperEdgeToIntersectingEdgeIndices.reserve(numEdges);
+    m_topoHelperEdgeToIntersectingEdgeIndices.assign(numEdges, -1);
+    
+    const int32_t numberOfEdgesToExamine = (m_nearPlaneElementsValidFlag
+                                            ? static_cast<int32_t>(m_nearPlaneEdgeIndices.size())
+                                            : numEdges);
     
-    for (int32_t i = 0; i < numEdges; i++) {
+    for (int32_t iExamine = 0; iExamine < numberOfEdgesToExamine; iExamine++) {
+        const int32_t i = (m_nearPlaneElementsValidFlag
+                           ? m_nearPlaneEdgeIndices[iExamine]
+                           : iExamine);
         CaretAssertVectorIndex(allEdgeInfo, i);
         const TopologyEdgeInfo& edgeInfo = allEdgeInfo[i];
         const int32_t indexOne = edgeInfo.node1;
@@ -321,7 +500,7 @@ SurfacePlaneIntersectionToContour::prepareEdges()
             }
         }
         
-        m_topoHelperEdgeToIntersectingEdgeIndices.push_back(intersectingEdgeIndex);
+        m_topoHelperEdgeToIntersectingEdgeIndices[i] = intersectingEdgeIndex;
     }
     
     CaretAssert(static_cast<int32_t>(m_topoHelperEdgeToIntersectingEdgeIndices.size()) == numEdges);
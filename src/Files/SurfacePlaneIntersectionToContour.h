@@ -35,6 +35,7 @@ namespace caret {
     class GraphicsPrimitive;
     class Plane;
     class SurfaceFile;
+    class SurfaceTriangleSpanIndex;
     
     class SurfacePlaneIntersectionToContour : public CaretObject {
         
@@ -52,6 +53,16 @@ namespace caret {
                                           const float* vertexColoringRGBA,
                                           const float contourThicknessMillimeters);
         
+        SurfacePlaneIntersectionToContour(const float* coordinateData,
+                                          const int32_t numberOfVertices,
+                                          const CaretPointer<TopologyHelper>& topologyHelper,
+                                          const CaretPointer<const SurfaceTriangleSpanIndex>& triangleSpanIndex,
+                                          const Plane& intersectionPlane,
+                                          const Plane& drawOnPlane,
+                                          const CaretColorEnum::Enum caretColor,
+                                          const float* vertexColoringRGBA,
+                                          const float contourThicknessMillimeters);
+        
         virtual ~SurfacePlaneIntersectionToContour();
 
         bool createContours(std::vector<GraphicsPrimitive*>& graphicsPrimitivesOut,
@@ -181,6 +192,8 @@ namespace caret {
 
         SurfacePlaneIntersectionToContour& operator=(const SurfacePlaneIntersectionToContour&);
         
+        void findElementsNearPlane();
+        
         void prepareVertices();
         
         void prepareEdges();
@@ -191,6 +204,10 @@ namespace caret {
         
         const SurfaceFile* m_surfaceFile;
         
+        const float* m_coordinateData;
+        
+        const int32_t m_numberOfVertices;
+        
         const Plane& m_intersectionPlane;
         
         const Plane& m_drawOnPlane;
@@ -205,6 +222,17 @@ namespace caret {
         
         CaretPointer<TopologyHelper> m_topologyHelper;
         
+        CaretPointer<const SurfaceTriangleSpanIndex> m_triangleSpanIndex;
+        
+        /** True if only the vertices and edges near the plane are examined */
+        bool m_nearPlaneElementsValidFlag = false;
+        
+        /** When plane is aligned with an axis, vertices in triangles that may intersect the plane */
+        std::vector<int32_t> m_nearPlaneVertexIndices;
+        
+        /** When plane is aligned with an axis, edges in triangles that may intersect the plane */
+        std::vector<int32_t> m_nearPlaneEdgeIndices;
+        
         std::vector<std::unique_ptr<Vertex>> m_vertices;
         
         std::vector<std::unique_ptr<IntersectionEdge>> m_intersectingEdges;
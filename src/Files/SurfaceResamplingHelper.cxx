@@ -271,7 +271,7 @@ void SurfaceResamplingHelper::resampleCutSurface(const SurfaceFile* cutSurfaceIn
                 break;
             case BarycentricInfo::EDGE:
             {
-                const vector<int32_t>& cutEdges = cutTopoHelp->getNodeEdges(largestNode[i]);
+                const TopologyIndexList cutEdges = cutTopoHelp->getNodeEdges(largestNode[i]);
                 for (int j = 0; j < (int)cutEdges.size(); ++j)
                 {
                     const TopologyEdgeInfo& myInfo = cutEdgeInfo[cutEdges[j]];
@@ -311,7 +311,7 @@ void SurfaceResamplingHelper::resampleCutSurface(const SurfaceFile* cutSurfaceIn
 #pragma omp CARET_FOR schedule(dynamic)
         for (int32_t i = 0; i < newNodes; ++i)
         {
-            const vector<int32_t>& neighbors = newTopoHelp->getNodeNeighbors(i);
+            const TopologyIndexList neighbors = newTopoHelp->getNodeNeighbors(i);
             if (isOnEdge[i])
             {
                 bool hasInteriorNeighbor = false;
@@ -333,7 +333,7 @@ void SurfaceResamplingHelper::resampleCutSurface(const SurfaceFile* cutSurfaceIn
                         cutGeoHelp->getPathToNode(largestNode[i], largestNode[neighbors[j]], cutPath, cutPathDists);
                         if (cutPathDists.size() == 0 || cutPathDists.back() > 2.0f * closedPathDists.back())//maybe this cutoff should be tunable
                         {
-                            const vector<int32_t>& myTiles = newTopoHelp->getNodeTiles(i);//find tiles on new mesh that share this edge, remove them
+                            const TopologyIndexList myTiles = newTopoHelp->getNodeTiles(i);//find tiles on new mesh that share this edge, remove them
                             for (int k = 0; k < (int)myTiles.size(); ++k)
                             {
                                 const int32_t* thisTile = newSphere->getTriangle(myTiles[k]);
@@ -346,7 +346,7 @@ void SurfaceResamplingHelper::resampleCutSurface(const SurfaceFile* cutSurfaceIn
                     }
                 } else {
                     nodeDisconnect[i] = 1;//disconnect it completely if it has no interior neighbors
-                    const vector<int32_t>& nodeTiles = newTopoHelp->getNodeTiles(i);
+                    const TopologyIndexList nodeTiles = newTopoHelp->getNodeTiles(i);
                     for (int j = 0; j < (int)nodeTiles.size(); ++j)
                     {
                         triRemove[nodeTiles[j]] = 1;
@@ -361,7 +361,7 @@ void SurfaceResamplingHelper::resampleCutSurface(const SurfaceFile* cutSurfaceIn
                     cutGeoHelp->getPathToNode(largestNode[i], largestNode[neighbors[j]], cutPath, cutPathDists);//note: path length of zero means no connection
                     if (cutPathDists.size() == 0 || cutPathDists.back() > 2.0f * closedPathDists.back())//maybe this cutoff should be tunable
                     {
-                        const vector<int32_t>& myTiles = newTopoHelp->getNodeTiles(i);//find tiles on new mesh that share this edge, remove them
+                        const TopologyIndexList myTiles = newTopoHelp->getNodeTiles(i);//find tiles on new mesh that share this edge, remove them
                         for (int k = 0; k < (int)myTiles.size(); ++k)
                         {
                             const int32_t* thisTile = newSphere->getTriangle(myTiles[k]);
@@ -0,0 +1,167 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "SurfaceTriangleSpanIndex.h"
+
+#include "CaretAssert.h"
+#include "CaretOMP.h"
+
+#include <algorithm>
+
+using namespace caret;
+using namespace std;
+
+SurfaceTriangleSpanIndex::SurfaceTriangleSpanIndex(const float* coordsIn, const int32_t numNodes, const int32_t* trianglesIn, const int32_t numTriangles)
+{
+    CaretAssert(numTriangles == 0 || (coordsIn != NULL && trianglesIn != NULL));
+    m_numTriangles = numTriangles;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        vector<float>& spans = m_triangleSpans[axis];
+        spans.resize(2 * (int64_t)numTriangles);
+        float axisMin = 0.0f, axisMax = 0.0f;
+        bool haveExtent = false;
+        double totalSpan = 0.0;
+#pragma omp CARET_PAR
+        {
+            float myMin = 0.0f, myMax = 0.0f;
+            bool myFirst = true;
+            double mySpan = 0.0;
+#pragma omp CARET_FOR
+            for (int32_t i = 0; i < numTriangles; ++i)
+            {
+                const int32_t* tri = trianglesIn + 3 * (int64_t)i;
+                CaretAssert(tri[0] >= 0 && tri[0] < numNodes && tri[1] >= 0 && tri[1] < numNodes && tri[2] >= 0 && tri[2] < numNodes);
+                float triMin = coordsIn[3 * (int64_t)tri[0] + axis], triMax = triMin;
+                for (int j = 1; j < 3; ++j)
+                {
+                    const float value = coordsIn[3 * (int64_t)tri[j] + axis];
+                    if (value < triMin) triMin = value;
+                    if (value > triMax) triMax = value;
+                }
+                spans[2 * (int64_t)i] = triMin;
+                spans[2 * (int64_t)i + 1] = triMax;
+                mySpan += triMax - triMin;
+                if (myFirst)
+                {
+                    myMin = triMin;
+                    myMax = triMax;
+                    myFirst = false;
+                } else {
+                    if (triMin < myMin) myMin = triMin;
+                    if (triMax > myMax) myMax = triMax;
+                }
+            }
+#pragma omp critical
+            {
+                if (!myFirst)
+                {
+                    if (haveExtent)
+                    {
+                        axisMin = min(axisMin, myMin);
+                        axisMax = max(axisMax, myMax);
+                    } else {
+                        axisMin = myMin;
+                        axisMax = myMax;
+                        haveExtent = true;
+                    }
+                }
+                totalSpan += mySpan;
+            }
+        }
+        m_minimum[axis] = axisMin;
+        //size the buckets near the average span of a triangle, so that most triangles land in one or two buckets
+        const float extent = axisMax - axisMin;
+        int32_t numBuckets = 1;
+        if (numTriangles > 0 && extent > 0.0f)
+        {
+            const double averageSpan = totalSpan / numTriangles;
+            double idealBuckets = (averageSpan > 0.0) ? extent / averageSpan : numTriangles;
+            idealBuckets = min(idealBuckets, (double)numTriangles);
+            idealBuckets = min(idealBuckets, 65536.0);
+            numBuckets = max(1, (int32_t)idealBuckets);
+        }
+        m_numBuckets[axis] = numBuckets;
+        m_bucketSize[axis] = (extent > 0.0f) ? extent / numBuckets : 1.0f;
+        //count, then fill, so each bucket is contiguous and triangles stay in increasing order
+        vector<int32_t>& bucketStart = m_bucketStart[axis];
+        bucketStart.assign(numBuckets + 1, 0);
+        for (int32_t i = 0; i < numTriangles; ++i)
+        {
+            const int32_t first = findBucket(axis, spans[2 * (int64_t)i]), last = findBucket(axis, spans[2 * (int64_t)i + 1]);
+            for (int32_t b = first; b <= last; ++b)
+            {
+                ++bucketStart[b + 1];
+            }
+        }
+        for (int32_t b = 0; b < numBuckets; ++b)
+        {
+            bucketStart[b + 1] += bucketStart[b];
+        }
+        vector<int32_t>& bucketTriangles = m_bucketTriangles[axis];
+        bucketTriangles.resize(bucketStart[numBuckets]);
+        vector<int32_t> nextPosition(bucketStart.begin(), bucketStart.end() - 1);
+        for (int32_t i = 0; i < numTriangles; ++i)
+        {
+            const int32_t first = findBucket(axis, spans[2 * (int64_t)i]), last = findBucket(axis, spans[2 * (int64_t)i + 1]);
+            for (int32_t b = first; b <= last; ++b)
+            {
+                bucketTriangles[nextPosition[b]] = i;
+                ++nextPosition[b];
+            }
+        }
+    }
+}
+
+int32_t SurfaceTriangleSpanIndex::findBucket(const int axis, const float coordinate) const
+{
+    const float position = (coordinate - m_minimum[axis]) / m_bucketSize[axis];
+    if (!(position > 0.0f)) return 0;//also catches NaN
+    const int32_t bucket = (int32_t)min(position, (float)(m_numBuckets[axis] - 1));
+    return bucket;
+}
+
+void SurfaceTriangleSpanIndex::getTrianglesSpanningCoordinate(const int axis, const float coordinate, const float tolerance, vector<int32_t>& trianglesOut) const
+{
+    CaretAssert(axis >= 0 && axis < 3);
+    trianglesOut.clear();
+    if (m_numTriangles == 0) return;
+    const vector<float>& spans = m_triangleSpans[axis];
+    const vector<int32_t>& bucketStart = m_bucketStart[axis];
+    const vector<int32_t>& bucketTriangles = m_bucketTriangles[axis];
+    //with a tolerance, the coordinate may be near a bucket boundary, so merge neighboring buckets that the tolerance reaches
+    const int32_t firstBucket = findBucket(axis, coordinate - tolerance), lastBucket = findBucket(axis, coordinate + tolerance);
+    for (int32_t b = firstBucket; b <= lastBucket; ++b)
+    {
+        for (int32_t j = bucketStart[b]; j < bucketStart[b + 1]; ++j)
+        {
+            const int32_t triangle = bucketTriangles[j];
+            if (spans[2 * (int64_t)triangle] - tolerance <= coordinate && spans[2 * (int64_t)triangle + 1] + tolerance >= coordinate)
+            {
+                trianglesOut.push_back(triangle);
+            }
+        }
+    }
+    if (firstBucket != lastBucket)
+    {//triangles spanning several of the buckets were added more than once
+        sort(trianglesOut.begin(), trianglesOut.end());
+        trianglesOut.erase(unique(trianglesOut.begin(), trianglesOut.end()), trianglesOut.end());
+    }
+}
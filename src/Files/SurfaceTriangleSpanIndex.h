@@ -0,0 +1,53 @@
+#ifndef __SURFACE_TRIANGLE_SPAN_INDEX_H__
+#define __SURFACE_TRIANGLE_SPAN_INDEX_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <vector>
+#include <stdint.h>
+
+namespace caret {
+
+    //buckets the triangles of a surface by the range of coordinates they span along each axis
+    //used to find the triangles that may intersect an axis-aligned plane without testing every triangle
+    class SurfaceTriangleSpanIndex
+    {
+        std::vector<float> m_triangleSpans[3];//minimum and maximum of each triangle along each axis
+        std::vector<int32_t> m_bucketStart[3];//start of each bucket in m_bucketTriangles, with one extra element for the end of the last bucket
+        std::vector<int32_t> m_bucketTriangles[3];//triangles in each bucket, in increasing index order
+        float m_minimum[3], m_bucketSize[3];
+        int32_t m_numBuckets[3];
+        int32_t m_numTriangles;
+        int32_t findBucket(const int axis, const float coordinate) const;
+        SurfaceTriangleSpanIndex();
+    public:
+        ///index the triangles using the given coordinates
+        SurfaceTriangleSpanIndex(const float* coordsIn, const int32_t numNodes, const int32_t* trianglesIn, const int32_t numTriangles);
+
+        int32_t getNumberOfTriangles() const { return m_numTriangles; }
+
+        ///get the triangles whose range along the axis (0 = x, 1 = y, 2 = z), expanded by the tolerance, contains the coordinate, in increasing index order
+        void getTrianglesSpanningCoordinate(const int axis, const float coordinate, const float tolerance, std::vector<int32_t>& trianglesOut) const;
+    };
+
+}
+
+#endif //__SURFACE_TRIANGLE_SPAN_INDEX_H__
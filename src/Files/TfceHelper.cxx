@@ -0,0 +1,280 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "TfceHelper.h"
+
+#include "CaretAssert.h"
+#include "CaretOMP.h"
+#include "TopologyHelper.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+using namespace caret;
+using namespace std;
+
+void TfceHelper::ClusterInfo::update(const float& bottomVal, const float& param_e, const float& param_h)
+{
+    if (bottomVal != lastVal)//skip computing if there is no difference
+    {
+        CaretAssert(bottomVal < lastVal);
+        double integrated_h = param_h + 1.0f;//integral(x^h) = (x^(h + 1))/(h + 1) + C
+        double newSlice = pow(totalArea, (double)param_e) * (pow((double)lastVal, integrated_h) - pow((double)bottomVal, integrated_h)) / integrated_h;
+        accumVal += newSlice;
+        lastVal = bottomVal;//computing in double precision, with float for inputs, puts the smallest difference between values far greater than the instability of the computation
+    }
+}
+
+TfceHelper::Scratch::Scratch(const int64_t& numElements)
+{
+    m_parent.resize(numElements, -1);
+    m_offset.resize(numElements, 0.0);
+    m_accum.resize(numElements, 0.0);
+}
+
+TfceHelper::TfceHelper(const CaretPointer<TopologyHelper>& topoHelp, const float* areas, const float* roiData, const float& param_e, const float& param_h)
+{
+    CaretAssert(topoHelp != NULL);
+    CaretAssert(areas != NULL);
+    m_topoHelp = topoHelp;
+    m_numElements = topoHelp->getNumberOfNodes();
+    m_dims[0] = m_numElements;
+    m_dims[1] = 1;
+    m_dims[2] = 1;
+    m_areas.assign(areas, areas + m_numElements);
+    m_voxelVolume = 0.0f;
+    m_param_e = param_e;
+    m_param_h = param_h;
+    setRoi(roiData);
+}
+
+TfceHelper::TfceHelper(const int64_t dims[3], const float& voxelVolume, const float* roiData, const float& param_e, const float& param_h)
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        m_dims[i] = dims[i];
+    }
+    m_numElements = dims[0] * dims[1] * dims[2];
+    m_voxelVolume = voxelVolume;
+    m_param_e = param_e;
+    m_param_h = param_h;
+    setRoi(roiData);
+}
+
+void TfceHelper::setRoi(const float* roiData)
+{
+    if (roiData == NULL) return;
+    m_roi.resize(m_numElements);
+    for (int64_t i = 0; i < m_numElements; ++i)
+    {
+        m_roi[i] = (roiData[i] > 0.0f ? 1 : 0);
+    }
+}
+
+int64_t TfceHelper::findRoot(Scratch& myScratch, const int64_t& element) const
+{
+    int64_t root = element;
+    while (myScratch.m_parent[root] >= 0)
+    {
+        root = myScratch.m_parent[root];
+    }
+    myScratch.m_path.clear();
+    for (int64_t cur = element; myScratch.m_parent[cur] >= 0; cur = myScratch.m_parent[cur])
+    {
+        myScratch.m_path.push_back(cur);
+    }
+    for (int64_t i = (int64_t)myScratch.m_path.size() - 2; i >= 0; --i)//the last one on the path already points to the root
+    {//compress from the top down, so the parent's offset is already relative to the root
+        int64_t cur = myScratch.m_path[i];
+        myScratch.m_offset[cur] += myScratch.m_offset[myScratch.m_parent[cur]];
+        myScratch.m_parent[cur] = root;
+    }
+    return root;
+}
+
+void TfceHelper::addToClusters(Scratch& myScratch, const int64_t& element, const float& value) const
+{
+    vector<int64_t>& touching = myScratch.m_touching;
+    touching.clear();
+    if (m_topoHelp != NULL)
+    {
+        int32_t numNeigh;
+        const int32_t* neighbors = m_topoHelp->getNodeNeighbors((int32_t)element, numNeigh);
+        for (int32_t i = 0; i < numNeigh; ++i)
+        {
+            if (myScratch.m_parent[neighbors[i]] == -1) continue;
+            int64_t root = findRoot(myScratch, neighbors[i]);
+            if (find(touching.begin(), touching.end(), root) == touching.end()) touching.push_back(root);
+        }
+    } else {
+        const int64_t ijk[3] = { element % m_dims[0], (element / m_dims[0]) % m_dims[1], element / (m_dims[0] * m_dims[1]) };
+        const int64_t strides[3] = { 1, m_dims[0], m_dims[0] * m_dims[1] };
+        for (int axis = 0; axis < 3; ++axis)
+        {//face neighbors only
+            for (int dir = -1; dir <= 1; dir += 2)
+            {
+                int64_t neighIJK = ijk[axis] + dir;
+                if (neighIJK < 0 || neighIJK >= m_dims[axis]) continue;
+                int64_t neighbor = element + dir * strides[axis];
+                if (myScratch.m_parent[neighbor] == -1) continue;
+                int64_t root = findRoot(myScratch, neighbor);
+                if (find(touching.begin(), touching.end(), root) == touching.end()) touching.push_back(root);
+            }
+        }
+    }
+    const float area = (m_topoHelp != NULL ? m_areas[element] : m_voxelVolume);
+    vector<ClusterInfo>& clusters = myScratch.m_clusters;
+    if (touching.empty())
+    {//make new cluster
+        myScratch.m_parent[element] = -2 - (int64_t)clusters.size();
+        myScratch.m_offset[element] = 0.0;
+        clusters.push_back(ClusterInfo(value, area));
+        return;
+    }
+    int64_t mergedRoot = touching[0];
+    for (size_t i = 1; i < touching.size(); ++i)
+    {//use the biggest cluster as the merged cluster, so its members get shorter paths
+        if (clusters[-2 - myScratch.m_parent[touching[i]]].numMembers > clusters[-2 - myScratch.m_parent[mergedRoot]].numMembers)
+        {
+            mergedRoot = touching[i];
+        }
+    }
+    ClusterInfo& mergedCluster = clusters[-2 - myScratch.m_parent[mergedRoot]];
+    mergedCluster.update(value, m_param_e, m_param_h);//recalculate to align cluster bottoms
+    for (size_t i = 0; i < touching.size(); ++i)
+    {
+        if (touching[i] == mergedRoot) continue;
+        ClusterInfo& thisCluster = clusters[-2 - myScratch.m_parent[touching[i]]];
+        thisCluster.update(value, m_param_e, m_param_h);
+        mergedCluster.totalArea += thisCluster.totalArea;
+        mergedCluster.numMembers += thisCluster.numMembers;
+        myScratch.m_offset[touching[i]] = thisCluster.accumVal - mergedCluster.accumVal;//the correction value that used to be added to every member, now stored once on the old root
+        myScratch.m_parent[touching[i]] = mergedRoot;
+    }
+    mergedCluster.totalArea += area;
+    ++mergedCluster.numMembers;
+    myScratch.m_parent[element] = mergedRoot;
+    myScratch.m_offset[element] = -mergedCluster.accumVal;//the element must not get the part of the integral above its own value
+}
+
+void TfceHelper::tfcePositive(Scratch& myScratch, const float* data, const bool& negate) const
+{
+    vector<pair<float, int64_t> >& order = myScratch.m_order;
+    order.clear();
+    for (int64_t i = 0; i < m_numElements; ++i)
+    {
+        if (!m_roi.empty() && m_roi[i] == 0) continue;
+        float value = (negate ? -data[i] : data[i]);
+        if (value > 0.0f)
+        {
+            order.push_back(make_pair(value, i));
+        }
+    }
+    sort(order.begin(), order.end(), greater<pair<float, int64_t> >());
+    myScratch.m_clusters.clear();
+    const int64_t numOrdered = (int64_t)order.size();
+    for (int64_t i = 0; i < numOrdered; ++i)
+    {
+        addToClusters(myScratch, order[i].second, order[i].first);
+    }
+    for (size_t i = 0; i < myScratch.m_clusters.size(); ++i)
+    {
+        myScratch.m_clusters[i].update(0.0f, m_param_e, m_param_h);//update to include the to-zero slice
+    }
+    for (int64_t i = 0; i < numOrdered; ++i)
+    {
+        int64_t element = order[i].second;
+        int64_t root = findRoot(myScratch, element);
+        double value = myScratch.m_clusters[-2 - myScratch.m_parent[root]].accumVal;
+        if (root != element) value += myScratch.m_offset[element];
+        myScratch.m_accum[element] += value;
+    }
+    for (int64_t i = 0; i < numOrdered; ++i)
+    {//reset only what we touched, so the next call doesn't need to clear everything
+        myScratch.m_parent[order[i].second] = -1;
+    }
+}
+
+CaretPointer<TfceHelper::Scratch> TfceHelper::acquireScratch() const
+{
+    CaretPointer<Scratch> ret;
+    {
+        CaretMutexLocker locked(&m_scratchMutex);
+        if (!m_scratchPool.empty())
+        {
+            ret = m_scratchPool.back();
+            m_scratchPool.pop_back();
+        }
+    }
+    if (ret == NULL)
+    {
+        ret.grabNew(new Scratch(m_numElements));
+    }
+    return ret;
+}
+
+void TfceHelper::releaseScratch(const CaretPointer<Scratch>& myScratch) const
+{
+    CaretMutexLocker locked(&m_scratchMutex);
+    m_scratchPool.push_back(myScratch);
+}
+
+void TfceHelper::enhanceScratch(Scratch& myScratch, const float* dataIn, float* dataOut) const
+{
+    tfcePositive(myScratch, dataIn, false);
+    tfcePositive(myScratch, dataIn, true);//negatives and positives don't overlap, so reuse the accum array
+    vector<double>& accum = myScratch.m_accum;
+    for (int64_t i = 0; i < m_numElements; ++i)
+    {
+        if (!m_roi.empty() && m_roi[i] == 0)
+        {
+            dataOut[i] = 0.0f;
+        } else if (dataIn[i] < 0.0f) {
+            dataOut[i] = (float)-accum[i];
+        } else {
+            dataOut[i] = (float)accum[i];
+        }
+        accum[i] = 0.0;
+    }
+}
+
+void TfceHelper::enhance(const float* dataIn, float* dataOut) const
+{
+    CaretPointer<Scratch> myScratch = acquireScratch();
+    enhanceScratch(*myScratch, dataIn, dataOut);
+    releaseScratch(myScratch);
+}
+
+void TfceHelper::enhanceBatch(const vector<const float*>& dataIn, const vector<float*>& dataOut) const
+{
+    CaretAssert(dataIn.size() == dataOut.size());
+    const int64_t numMaps = (int64_t)dataIn.size();
+#pragma omp CARET_PAR
+    {
+        CaretPointer<Scratch> myScratch = acquireScratch();//take it from the pool once per thread, not once per map
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int64_t i = 0; i < numMaps; ++i)
+        {
+            enhanceScratch(*myScratch, dataIn[i], dataOut[i]);
+        }
+        releaseScratch(myScratch);
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef __TFCE_HELPER_H__
+#define __TFCE_HELPER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+#include "CaretMutex.h"
+#include "CaretPointer.h"
+
+namespace caret {
+
+    class TopologyHelper;
+
+    //NOTE: like GeodesicHelper, this takes a snapshot of the areas and roi in the constructor, and is designed to be fast on repeated calls
+    //(permutation testing), so construct it once and then call enhance() or enhanceBatch() on every map
+
+    class TfceHelper
+    {
+        struct ClusterInfo
+        {
+            double accumVal, totalArea;
+            int64_t numMembers;
+            float lastVal;
+            ClusterInfo(const float& value, const float& area)
+            {
+                accumVal = 0.0;
+                totalArea = area;
+                numMembers = 1;
+                lastVal = value;
+            }
+            void update(const float& bottomVal, const float& param_e, const float& param_h);
+        };
+
+        struct Scratch
+        {//reusable per-call state, so a call doesn't allocate anything once the scratch exists
+            std::vector<int64_t> m_parent;//-1 for not in a cluster yet, >= 0 for parent element, <= -2 for root of cluster (-2 - parent)
+            std::vector<double> m_offset;//integral value relative to parent, the union-find version of the "correct every member on merge" trick
+            std::vector<double> m_accum;
+            std::vector<std::pair<float, int64_t> > m_order;
+            std::vector<ClusterInfo> m_clusters;
+            std::vector<int64_t> m_touching, m_path;
+            Scratch(const int64_t& numElements);
+        };
+
+        TfceHelper();
+        TfceHelper(const TfceHelper&);
+        TfceHelper& operator=(const TfceHelper&);
+
+        CaretPointer<TopologyHelper> m_topoHelp;//set for surface, NULL for volume
+        int64_t m_dims[3];
+        int64_t m_numElements;
+        std::vector<float> m_areas;//per vertex, empty for volume
+        float m_voxelVolume;
+        std::vector<char> m_roi;//empty for no roi
+        float m_param_e, m_param_h;
+        mutable std::vector<CaretPointer<Scratch> > m_scratchPool;
+        mutable CaretMutex m_scratchMutex;
+
+        void setRoi(const float* roiData);
+        int64_t findRoot(Scratch& myScratch, const int64_t& element) const;
+        void addToClusters(Scratch& myScratch, const int64_t& element, const float& value) const;
+        void tfcePositive(Scratch& myScratch, const float* data, const bool& negate) const;
+        CaretPointer<Scratch> acquireScratch() const;
+        void releaseScratch(const CaretPointer<Scratch>& myScratch) const;
+        void enhanceScratch(Scratch& myScratch, const float* dataIn, float* dataOut) const;
+    public:
+        ///surface TFCE, areas should be the vertex areas (or corrected areas), one per vertex
+        TfceHelper(const CaretPointer<TopologyHelper>& topoHelp, const float* areas, const float* roiData = NULL, const float& param_e = 1.0f, const float& param_h = 2.0f);
+
+        ///volume TFCE with face neighbors, dims is the first 3 dimensions of the volume
+        TfceHelper(const int64_t dims[3], const float& voxelVolume, const float* roiData = NULL, const float& param_e = 0.5f, const float& param_h = 2.0f);
+
+        ///enhance positives and negatives of one map, output is zero outside the roi, can be called from multiple threads at once
+        void enhance(const float* dataIn, float* dataOut) const;
+
+        ///enhance many maps (such as permutations) in parallel, each thread reuses one set of cluster and sort state for all the maps it does
+        void enhanceBatch(const std::vector<const float*>& dataIn, const std::vector<float*>& dataOut) const;
+    };
+
+}
+
+#endif //__TFCE_HELPER_H__
@@ -21,57 +21,136 @@
 #include "SurfaceFile.h"
 #include "TopologyHelper.h"
 #include "CaretAssert.h"
+#include "CaretMutex.h"
+#include <algorithm>
 #include <cmath>
 
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    ///topology base that is shared by surfaces that have identical triangles
+    struct SharedTopologyBase
+    {
+        int32_t m_numNodes;
+        vector<int32_t> m_triangles;//copy of the triangles, so a match is exact and doesn't depend on the surface it was built from still existing
+        CaretPointer<TopologyHelperBase> m_base;
+    };
+    
+    CaretMutex s_sharedBaseMutex;
+    vector<SharedTopologyBase> s_sharedBases;
+    
+    CaretPointer<TopologyHelperBase> findSharedBase(const int32_t& numNodes, const int32_t* triangles, const int64_t& numTriValues, const bool& sortNeighbors)
+    {//must be called with s_sharedBaseMutex locked
+        for (size_t i = 0; i < s_sharedBases.size(); ++i)
+        {
+            const SharedTopologyBase& thisShared = s_sharedBases[i];
+            if (thisShared.m_numNodes != numNodes || (int64_t)thisShared.m_triangles.size() != numTriValues) continue;
+            if (sortNeighbors && !thisShared.m_base->isNodeInfoSorted()) continue;//sorted info can be given to something that doesn't ask for sorted, but not the reverse
+            if (equal(thisShared.m_triangles.begin(), thisShared.m_triangles.end(), triangles))
+            {
+                return thisShared.m_base;
+            }
+        }
+        return CaretPointer<TopologyHelperBase>();
+    }
+    
+    void pruneSharedBases()
+    {//must be called with s_sharedBaseMutex locked, drops bases whose only reference is the registry, so their memory is freed once no surface uses them
+        for (size_t i = 0; i < s_sharedBases.size();)
+        {
+            if (s_sharedBases[i].m_base.getReferenceCount() == 1)
+            {
+                s_sharedBases.erase(s_sharedBases.begin() + i);
+            } else {
+                ++i;
+            }
+        }
+    }
+}
+
+CaretPointer<TopologyHelperBase> TopologyHelperBase::getSharedBase(const SurfaceFile* surfIn, bool sortNeighbors)
+{
+    const int32_t numNodes = surfIn->getNumberOfNodes();
+    const int32_t numTris = surfIn->getNumberOfTriangles();
+    const int64_t numTriValues = int64_t(numTris) * 3;
+    const int32_t* triangles = (numTris > 0 ? surfIn->getTriangle(0) : NULL);
+    {
+        CaretMutexLocker myLock(&s_sharedBaseMutex);
+        pruneSharedBases();
+        CaretPointer<TopologyHelperBase> ret = findSharedBase(numNodes, triangles, numTriValues, sortNeighbors);
+        if (ret != NULL) return ret;
+    }//UNLOCK while building, so that different topologies can be built in parallel
+    CaretPointer<TopologyHelperBase> ret(new TopologyHelperBase(surfIn, sortNeighbors));
+    CaretMutexLocker myLock(&s_sharedBaseMutex);
+    CaretPointer<TopologyHelperBase> other = findSharedBase(numNodes, triangles, numTriValues, sortNeighbors);
+    if (other != NULL) return other;//another thread built an identical one while we were building, use theirs so there is only one
+    SharedTopologyBase newShared;
+    newShared.m_numNodes = numNodes;
+    if (numTris > 0) newShared.m_triangles.assign(triangles, triangles + numTriValues);
+    newShared.m_base = ret;
+    s_sharedBases.push_back(newShared);
+    return ret;
+}
+
+void TopologyHelperBase::releaseUnusedSharedBases()
+{
+    CaretMutexLocker myLock(&s_sharedBaseMutex);
+    pruneSharedBases();
+}
+
 TopologyHelperBase::TopologyHelperBase(const SurfaceFile* surfIn, bool sortFlag)
 {
     m_numNodes = surfIn->getNumberOfNodes();
     m_numTris = surfIn->getNumberOfTriangles();
-    m_nodeInfo.resize(m_numNodes);
-    m_boundaryCount.resize(m_numNodes);
+    m_boundaryCount.resize(m_numNodes, 0);
     m_tileInfo.resize(m_numTris);
-    vector<TopologyEdgeInfo> tempEdgeInfo;
-    tempEdgeInfo.reserve(m_numTris * 3);//worst case, to prevent reallocs, we will copy it over later to the exact right size
+    m_tileOffsets.resize(m_numNodes + 1, 0);
+    for (int32_t i = 0; i < m_numTris; ++i)
+    {//count tiles per node first, so the packed tile lists can be allocated exactly
+        const int32_t* thisTri = surfIn->getTriangle(i);
+        ++m_tileOffsets[thisTri[0] + 1];
+        ++m_tileOffsets[thisTri[1] + 1];
+        ++m_tileOffsets[thisTri[2] + 1];
+    }
     for (int32_t i = 0; i < m_numNodes; ++i)
-    {//preallocate what should be enough size for most nodes on most surfaces, including freesurfer
-        m_nodeInfo[i].m_edges.reserve(8);
-        m_nodeInfo[i].m_neighbors.reserve(8);
-        m_nodeInfo[i].m_tiles.reserve(8);
-        m_nodeInfo[i].m_whichVertex.reserve(8);
+    {
+        m_tileOffsets[i + 1] += m_tileOffsets[i];
     }
-    for (int32_t i = 0; i < m_numTris; ++i)
+    m_tiles.resize(m_tileOffsets[m_numNodes]);
+    m_whichVertex.resize(m_tileOffsets[m_numNodes]);
     {
-        const int32_t* thisTri = surfIn->getTriangle(i);
-        m_nodeInfo[thisTri[0]].addTileInfo(i, 0);
-        m_nodeInfo[thisTri[1]].addTileInfo(i, 1);
-        m_nodeInfo[thisTri[2]].addTileInfo(i, 2);
-    }//node tiles complete, now we can sweep over nodes instead of triangles, making it easier to build node info
-    m_maxNeigh = -1;
-    m_maxTiles = -1;
+        vector<int64_t> tileFill(m_tileOffsets.begin(), m_tileOffsets.end() - 1);
+        for (int32_t i = 0; i < m_numTris; ++i)
+        {//fill in triangle order, so each node's tile list is in the same order as before the packed layout
+            const int32_t* thisTri = surfIn->getTriangle(i);
+            for (int k = 0; k < 3; ++k)
+            {
+                int64_t& position = tileFill[thisTri[k]];
+                m_tiles[position] = i;
+                m_whichVertex[position] = k;
+                ++position;
+            }
+        }
+    }//node tiles complete, now we can sweep over nodes instead of triangles, making it easier to build edge info
+    vector<TopologyEdgeInfo> tempEdgeInfo;
+    tempEdgeInfo.reserve(int64_t(m_numTris) * 3);//worst case, to prevent reallocs, we will copy it over later to the exact right size
     CaretArray<int32_t> scratch(m_numNodes, -1);//mark array for added neighbors
     for (int32_t i = 0; i < m_numNodes; ++i)
     {
-        vector<int32_t>& tileList = m_nodeInfo[i].m_tiles;
-        vector<int32_t>& vertexList = m_nodeInfo[i].m_whichVertex;
-        int neighTiles = (int)tileList.size();
-        if (neighTiles > m_maxTiles)
-        {
-            m_maxTiles = neighTiles;
-        }
-        for (int j = 0; j < neighTiles; ++j)
+        int64_t edgesBefore = (int64_t)tempEdgeInfo.size();
+        for (int64_t j = m_tileOffsets[i]; j < m_tileOffsets[i + 1]; ++j)
         {
-            int32_t myTile = tileList[j];
+            int32_t myTile = m_tiles[j];
             const int32_t* thisTri = surfIn->getTriangle(myTile);
-            int32_t myVert = vertexList[j];
+            int32_t myVert = m_whichVertex[j];
             switch (myVert)
             {
                 case 0:
                     if (thisTri[1] > i) processTileNeighbor(tempEdgeInfo, scratch, i, thisTri[1], thisTri[2], myTile, 0, false);//boolean signifies if root, neighbor is same ordering as the cycle of tile nodes
                     if (thisTri[2] > i) processTileNeighbor(tempEdgeInfo, scratch, i, thisTri[2], thisTri[1], myTile, 2, true);
-                    break;//the if statement is a trick: processTileNeighbor adds neighbor to both nodes, so by checking that root is less, it does every edge/tile pair exactly once
+                    break;//the if statement is a trick: only creating edges from the lesser node does every edge/tile pair exactly once
                 case 1://this allows edge info building in a linear pass
                     if (thisTri[2] > i) processTileNeighbor(tempEdgeInfo, scratch, i, thisTri[2], thisTri[0], myTile, 1, false);
                     if (thisTri[0] > i) processTileNeighbor(tempEdgeInfo, scratch, i, thisTri[0], thisTri[2], myTile, 0, true);
@@ -81,27 +160,60 @@ TopologyHelperBase::TopologyHelperBase(const SurfaceFile* surfIn, bool sortFlag)
                     if (thisTri[1] > i) processTileNeighbor(tempEdgeInfo, scratch, i, thisTri[1], thisTri[0], myTile, 1, true);
             }
         }
-        vector<int32_t>& myNeighList = m_nodeInfo[i].m_neighbors;
-        vector<int32_t>& myEdgeList = m_nodeInfo[i].m_edges;
-        int numNeigh = (int)myNeighList.size();
-        if (numNeigh > m_maxNeigh)
-        {
-            m_maxNeigh = numNeigh;
+        for (int64_t j = edgesBefore; j < (int64_t)tempEdgeInfo.size(); ++j)
+        {//the only marks made while processing this node are the edges it created
+            scratch[tempEdgeInfo[j].node2] = -1;//NOTE: -1 as sentinel because 0 is a valid edge number
         }
-        m_boundaryCount[i] = 0;
-        for (int j = 0; j < numNeigh; ++j)
+    }//edge and tile info done
+    m_edgeInfo = tempEdgeInfo;//copy edge info into member to get allocation correct
+    int64_t numEdges = (int64_t)m_edgeInfo.size();
+    m_neighborOffsets.resize(m_numNodes + 1, 0);
+    for (int64_t i = 0; i < numEdges; ++i)
+    {
+        ++m_neighborOffsets[m_edgeInfo[i].node1 + 1];
+        ++m_neighborOffsets[m_edgeInfo[i].node2 + 1];
+        if (m_edgeInfo[i].numTiles == 1)
         {
-            if (tempEdgeInfo[myEdgeList[j]].numTiles == 1) ++m_boundaryCount[i];
-            scratch[myNeighList[j]] = -1;//NOTE: -1 as sentinel because 0 is a valid edge number
+            ++m_boundaryCount[m_edgeInfo[i].node1];
+            ++m_boundaryCount[m_edgeInfo[i].node2];
         }
-    }//neighbor, edge and tile info done
-    m_edgeInfo = tempEdgeInfo;//copy edge info into member to get allocation correct
+    }
+    for (int32_t i = 0; i < m_numNodes; ++i)
+    {
+        m_neighborOffsets[i + 1] += m_neighborOffsets[i];
+    }
+    m_neighbors.resize(m_neighborOffsets[m_numNodes]);
+    m_neighborEdges.resize(m_neighborOffsets[m_numNodes]);
+    {
+        vector<int64_t> neighFill(m_neighborOffsets.begin(), m_neighborOffsets.end() - 1);
+        for (int64_t i = 0; i < numEdges; ++i)
+        {//edges were created in order of their lesser node, so this gives the same neighbor order as adding them during the sweep
+            const TopologyEdgeInfo& thisEdge = m_edgeInfo[i];
+            int64_t& pos1 = neighFill[thisEdge.node1];
+            m_neighbors[pos1] = thisEdge.node2;
+            m_neighborEdges[pos1] = (int32_t)i;
+            ++pos1;
+            int64_t& pos2 = neighFill[thisEdge.node2];
+            m_neighbors[pos2] = thisEdge.node1;
+            m_neighborEdges[pos2] = (int32_t)i;
+            ++pos2;
+        }
+    }
+    m_maxNeigh = -1;
+    m_maxTiles = -1;
+    for (int32_t i = 0; i < m_numNodes; ++i)
+    {
+        int32_t numNeigh = (int32_t)(m_neighborOffsets[i + 1] - m_neighborOffsets[i]);
+        if (numNeigh > m_maxNeigh) m_maxNeigh = numNeigh;
+        int32_t numTiles = (int32_t)(m_tileOffsets[i + 1] - m_tileOffsets[i]);
+        if (numTiles > m_maxTiles) m_maxTiles = numTiles;
+    }
     CaretArray<int32_t> scratch2(m_numTris, -1);
     if (sortFlag)
     {
         for (int32_t i = 0; i < m_numNodes; ++i)
         {
-            sortNeighbors(surfIn, i, scratch, scratch2);//not a member function of node info object because I need m_edgeInfo and m_nodeInfo
+            sortNeighbors(surfIn, i, scratch, scratch2);
         }
         m_neighborsSorted = true;
     } else {
@@ -111,7 +223,7 @@ TopologyHelperBase::TopologyHelperBase(const SurfaceFile* surfIn, bool sortFlag)
 
 //1) check mark array
 //      a) if marked, find edge, add triangle to edge
-//      b) if unmarked, make edge from triangle, add neighbor, add reverse neighbor
+//      b) if unmarked, make edge from triangle (neighbor lists are generated from the edges afterwards)
 void TopologyHelperBase::processTileNeighbor(vector<TopologyEdgeInfo>& tempEdgeInfo, CaretArray<int32_t>& scratch, const int32_t& root, const int32_t& neighbor, const int32_t& thirdNode, const int32_t& tile, const int32_t& tileEdge, const bool& reversed)
 {
     if (scratch[neighbor] == -1)
@@ -119,8 +231,6 @@ void TopologyHelperBase::processTileNeighbor(vector<TopologyEdgeInfo>& tempEdgeI
         TopologyEdgeInfo tempInfo(root, neighbor, thirdNode, tile, tileEdge, reversed);
         int32_t myEdge = (int32_t)tempEdgeInfo.size();
         tempEdgeInfo.push_back(tempInfo);
-        m_nodeInfo[root].addNeighborInfo(neighbor, myEdge);
-        m_nodeInfo[neighbor].addNeighborInfo(root, myEdge);
         scratch[neighbor] = myEdge;//use mark array both as "have this neighbor" AND "this is this neighbor's edge"
         m_tileInfo[tile].edges[tileEdge].edge = myEdge;
     } else {
@@ -132,12 +242,17 @@ void TopologyHelperBase::processTileNeighbor(vector<TopologyEdgeInfo>& tempEdgeI
 
 void TopologyHelperBase::sortNeighbors(const SurfaceFile* mySurf, const int32_t& node, CaretArray<int32_t>& nodeScratch, CaretArray<int32_t>& tileScratch)
 {
-    TopologyHelperBase::NodeInfo& myNodeInfo = m_nodeInfo[node];
-    if (myNodeInfo.m_neighbors.size() == 0) return;
-    int firstIndex = 0, numNeigh = (int)myNodeInfo.m_neighbors.size();
+    int32_t* myNeighbors = m_neighbors.data() + m_neighborOffsets[node];
+    int32_t* myEdges = m_neighborEdges.data() + m_neighborOffsets[node];
+    int32_t* myTiles = m_tiles.data() + m_tileOffsets[node];
+    int32_t* myWhichVertex = m_whichVertex.data() + m_tileOffsets[node];
+    int numNeigh = (int)(m_neighborOffsets[node + 1] - m_neighborOffsets[node]);
+    int numTiles = (int)(m_tileOffsets[node + 1] - m_tileOffsets[node]);
+    if (numNeigh == 0) return;
+    int firstIndex = 0;
     for (int i = 0; i < numNeigh; ++i)
     {
-        int32_t thisEdge = myNodeInfo.m_edges[i];
+        int32_t thisEdge = myEdges[i];
         if (m_edgeInfo[thisEdge].numTiles == 1)//there cannot be edge info with zero tiles, we are looking for the edge of a cut
         {
             firstIndex = i;
@@ -149,12 +264,11 @@ void TopologyHelperBase::sortNeighbors(const SurfaceFile* mySurf, const int32_t&
     }
     vector<int32_t> tempNeigh;
     vector<int32_t> tempEdges, tempTiles;//why not sort everything? verts get regenerated in place
-    int numTiles = myNodeInfo.m_tiles.size();
     tempNeigh.reserve(numNeigh);
     tempEdges.reserve(numNeigh);
     tempTiles.reserve(numTiles);
-    int32_t nextNode = myNodeInfo.m_neighbors[firstIndex];
-    int32_t nextEdge = myNodeInfo.m_edges[firstIndex];
+    int32_t nextNode = myNeighbors[firstIndex];
+    int32_t nextEdge = myEdges[firstIndex];
     int32_t nextTile;
     bool foundNext = true;
     int tileToUse = 0;
@@ -206,49 +320,54 @@ void TopologyHelperBase::sortNeighbors(const SurfaceFile* mySurf, const int32_t&
     } while (foundNext);
     for (int i = 0; i < numNeigh; ++i)//clean up scratch array, find any neighbors that are gap-separated or on third+ tile of an edge
     {
-        if (nodeScratch[myNodeInfo.m_neighbors[i]] == 0)
+        if (nodeScratch[myNeighbors[i]] == 0)
         {
-            nodeScratch[myNodeInfo.m_neighbors[i]] = -1;
+            nodeScratch[myNeighbors[i]] = -1;
         } else {
-            tempNeigh.push_back(myNodeInfo.m_neighbors[i]);
-            tempEdges.push_back(myNodeInfo.m_edges[i]);
+            tempNeigh.push_back(myNeighbors[i]);
+            tempEdges.push_back(myEdges[i]);
         }
     }
-    CaretAssert(tempNeigh.size() == myNodeInfo.m_neighbors.size());//check against original size
-    CaretAssert(tempEdges.size() == myNodeInfo.m_edges.size());
-    myNodeInfo.m_neighbors = tempNeigh;//copy over
-    myNodeInfo.m_edges = tempEdges;
+    CaretAssert((int)tempNeigh.size() == numNeigh);//check against original size
+    CaretAssert((int)tempEdges.size() == numNeigh);
+    copy(tempNeigh.begin(), tempNeigh.end(), myNeighbors);//copy over, in place in the packed arrays
+    copy(tempEdges.begin(), tempEdges.end(), myEdges);
     for (int i = 0; i < numTiles; ++i)//and find similar tiles
     {
-        if (tileScratch[myNodeInfo.m_tiles[i]] == 0)
+        if (tileScratch[myTiles[i]] == 0)
         {
-            tileScratch[myNodeInfo.m_tiles[i]] = -1;
+            tileScratch[myTiles[i]] = -1;
         } else {
-            tempTiles.push_back(myNodeInfo.m_tiles[i]);
+            tempTiles.push_back(myTiles[i]);
         }
     }
-    CaretAssert(tempTiles.size() == myNodeInfo.m_tiles.size());
-    myNodeInfo.m_tiles = tempTiles;
+    CaretAssert((int)tempTiles.size() == numTiles);
+    copy(tempTiles.begin(), tempTiles.end(), myTiles);
     for (int i = 0; i < numTiles; ++i)//finally, regenerate verts
     {
-        const int32_t* myTri = mySurf->getTriangle(myNodeInfo.m_tiles[i]);
+        const int32_t* myTri = mySurf->getTriangle(myTiles[i]);
         if (myTri[0] == node)
         {
-            myNodeInfo.m_whichVertex[i] = 0;
+            myWhichVertex[i] = 0;
         } else if (myTri[1] == node) {
-            myNodeInfo.m_whichVertex[i] = 1;
+            myWhichVertex[i] = 1;
         } else {
-            myNodeInfo.m_whichVertex[i] = 2;
+            myWhichVertex[i] = 2;
         }
     }
 }
 
-TopologyHelper::TopologyHelper(CaretPointer<TopologyHelperBase> myBase) : m_base(myBase), m_nodeInfo(myBase->m_nodeInfo), m_edgeInfo(myBase->m_edgeInfo),
+TopologyHelper::TopologyHelper(CaretPointer<TopologyHelperBase> myBase) : m_base(myBase), m_edgeInfo(myBase->m_edgeInfo),
                                                                                     m_tileInfo(myBase->m_tileInfo), m_boundaryCount(myBase->m_boundaryCount)
 {//pointer is by-value so that it makes a private copy that can't be pointed elsewhere during this constructor
     m_maxNeigh = m_base->m_maxNeigh;
     m_neighborsSorted = m_base->m_neighborsSorted;
     m_numNodes = m_base->m_numNodes;
+    m_neighborOffsets = m_base->m_neighborOffsets.data();
+    m_neighbors = m_base->m_neighbors.data();
+    m_neighborEdges = m_base->m_neighborEdges.data();
+    m_tileOffsets = m_base->m_tileOffsets.data();
+    m_tiles = m_base->m_tiles.data();
 }
 
 const vector<int32_t>& TopologyHelper::getNumberOfBoundaryEdgesForAllNodes() const
@@ -263,46 +382,46 @@ int32_t TopologyHelper::getMaximumNumberOfNeighbors() const
 
 bool TopologyHelper::getNodeHasNeighbors(const int32_t nodeNum) const
 {
-    CaretAssertVectorIndex(m_nodeInfo, nodeNum);
-    return m_nodeInfo[nodeNum].m_neighbors.size() != 0;
+    CaretAssert(nodeNum >= 0 && nodeNum < m_numNodes);
+    return m_neighborOffsets[nodeNum + 1] != m_neighborOffsets[nodeNum];
 }
 
-const vector<int32_t>& TopologyHelper::getNodeNeighbors(const int32_t nodeNum) const
+TopologyIndexList TopologyHelper::getNodeNeighbors(const int32_t nodeNum) const
 {
-    CaretAssertVectorIndex(m_nodeInfo, nodeNum);
-    return m_nodeInfo[nodeNum].m_neighbors;
+    CaretAssert(nodeNum >= 0 && nodeNum < m_numNodes);
+    return TopologyIndexList(m_neighbors + m_neighborOffsets[nodeNum], (int32_t)(m_neighborOffsets[nodeNum + 1] - m_neighborOffsets[nodeNum]));
 }
 
 const int32_t* TopologyHelper::getNodeNeighbors(const int32_t nodeNum, int32_t& numNeighborsOut) const
 {
-    CaretAssertVectorIndex(m_nodeInfo, nodeNum);
-    numNeighborsOut = (int32_t)m_nodeInfo[nodeNum].m_neighbors.size();
-    return m_nodeInfo[nodeNum].m_neighbors.data();
+    CaretAssert(nodeNum >= 0 && nodeNum < m_numNodes);
+    numNeighborsOut = (int32_t)(m_neighborOffsets[nodeNum + 1] - m_neighborOffsets[nodeNum]);
+    return m_neighbors + m_neighborOffsets[nodeNum];
 }
 
 int32_t TopologyHelper::getNodeNumberOfNeighbors(const int32_t nodeNum) const
 {
-    CaretAssertVectorIndex(m_nodeInfo, nodeNum);
-    return m_nodeInfo[nodeNum].m_neighbors.size();
+    CaretAssert(nodeNum >= 0 && nodeNum < m_numNodes);
+    return (int32_t)(m_neighborOffsets[nodeNum + 1] - m_neighborOffsets[nodeNum]);
 }
 
-const vector<int32_t>& TopologyHelper::getNodeTiles(const int32_t nodeNum) const
+TopologyIndexList TopologyHelper::getNodeTiles(const int32_t nodeNum) const
 {
-    CaretAssertVectorIndex(m_nodeInfo, nodeNum);
-    return m_nodeInfo[nodeNum].m_tiles;
+    CaretAssert(nodeNum >= 0 && nodeNum < m_numNodes);
+    return TopologyIndexList(m_tiles + m_tileOffsets[nodeNum], (int32_t)(m_tileOffsets[nodeNum + 1] - m_tileOffsets[nodeNum]));
 }
 
 const int32_t* TopologyHelper::getNodeTiles(const int32_t nodeNum, int32_t& numTilesOut) const
 {
-    CaretAssertVectorIndex(m_nodeInfo, nodeNum);
-    numTilesOut = (int32_t)m_nodeInfo[nodeNum].m_tiles.size();
-    return m_nodeInfo[nodeNum].m_tiles.data();
+    CaretAssert(nodeNum >= 0 && nodeNum < m_numNodes);
+    numTilesOut = (int32_t)(m_tileOffsets[nodeNum + 1] - m_tileOffsets[nodeNum]);
+    return m_tiles + m_tileOffsets[nodeNum];
 }
 
-const vector<int32_t>& TopologyHelper::getNodeEdges(const int32_t nodeNum) const
+TopologyIndexList TopologyHelper::getNodeEdges(const int32_t nodeNum) const
 {
-    CaretAssertVectorIndex(m_nodeInfo, nodeNum);
-    return m_nodeInfo[nodeNum].m_edges;
+    CaretAssert(nodeNum >= 0 && nodeNum < m_numNodes);
+    return TopologyIndexList(m_neighborEdges + m_neighborOffsets[nodeNum], (int32_t)(m_neighborOffsets[nodeNum + 1] - m_neighborOffsets[nodeNum]));
 }
 
 void TopologyHelper::checkArrays() const
@@ -319,7 +438,8 @@ void TopologyHelper::getNodeNeighborsToDepth(const int32_t nodeNum, const int32_
 {
     if (depth < 2)
     {
-        neighborsOut = getNodeNeighbors(nodeNum);
+        TopologyIndexList nodeNeighbors = getNodeNeighbors(nodeNum);
+        neighborsOut.assign(nodeNeighbors.begin(), nodeNeighbors.end());
         return;
     }
     int32_t expected = (7 * depth * (depth + 1)) / 2;
@@ -336,11 +456,10 @@ void TopologyHelper::getNodeNeighborsToDepth(const int32_t nodeNum, const int32_
     {
         for (int32_t i = 0; i < curNum; ++i)
         {
-            const vector<int32_t>& nodeNeighbors = m_nodeInfo[(*curlist)[i]].m_neighbors;
-            int numNeigh = (int)nodeNeighbors.size();
-            for (int j = 0; j < numNeigh; ++j)
+            const int32_t curNode = (*curlist)[i];
+            for (int64_t j = m_neighborOffsets[curNode]; j < m_neighborOffsets[curNode + 1]; ++j)
             {
-                int32_t thisNode = nodeNeighbors[j];
+                int32_t thisNode = m_neighbors[j];
                 if (m_markNodes[thisNode] == 0)
                 {
                     m_markNodes[thisNode] = 1;
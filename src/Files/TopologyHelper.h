@@ -22,6 +22,7 @@
 /*LICENSE_END*/
 
 #include <vector>
+#include "CaretAssert.h"
 #include "CaretPointer.h"
 
 namespace caret {
@@ -77,6 +78,29 @@ namespace caret {
         Edge edges[3];
     };
     
+    ///read-only view of one node's neighbors, edges or tiles, which are stored contiguously for all nodes in TopologyHelperBase
+    class TopologyIndexList
+    {
+        const int32_t* m_data;
+        int32_t m_size;
+    public:
+        TopologyIndexList(const int32_t* data, const int32_t size) : m_data(data), m_size(size) { }
+        const int32_t* begin() const { return m_data; }
+        const int32_t* end() const { return m_data + m_size; }
+        const int32_t* data() const { return m_data; }
+        size_t size() const { return m_size; }
+        bool empty() const { return m_size == 0; }
+        const int32_t& operator[](const int64_t index) const
+        {
+            CaretAssert(index >= 0 && index < m_size);
+            return m_data[index];
+        }
+        const int32_t& front() const { return (*this)[0]; }
+        const int32_t& back() const { return (*this)[m_size - 1]; }
+        ///for code that needs its own copy (to modify, or to keep after the helper is gone)
+        operator std::vector<int32_t>() const { return std::vector<int32_t>(m_data, m_data + m_size); }
+    };
+    
     class TopologyHelperBase
     {
         TopologyHelperBase();//prevent default, copy, assign
@@ -84,24 +108,15 @@ namespace caret {
         TopologyHelperBase& operator=(const TopologyHelperBase&);
         void processTileNeighbor(std::vector<TopologyEdgeInfo>& tempEdgeInfo, CaretArray<int32_t>& scratch, const int32_t& root, const int32_t& neighbor, const int32_t& thirdNode, const int32_t& tile, const int32_t& tileEdge, const bool& reversed);
         void sortNeighbors(const SurfaceFile* mySurf, const int32_t& node, CaretArray<int32_t>& nodeScratch, CaretArray<int32_t>& tileScratch);
-        struct NodeInfo
-        {
-            std::vector<int32_t> m_neighbors;
-            std::vector<int32_t> m_edges;//index into the topology edges vector, matched with neighbors
-            std::vector<int32_t> m_tiles;
-            std::vector<int32_t> m_whichVertex;//stores which tile vertex this node is, matched to m_tiles
-            void addTileInfo(int32_t tile, int32_t vertexNum)//don't take edge info yet because it is built after neighbor info
-            {
-                m_tiles.push_back(tile);
-                m_whichVertex.push_back(vertexNum);
-            }
-            void addNeighborInfo(int32_t neighbor, int32_t edge)//after we have tile info, we then generate neighbor info with the help of a mark array
-            {
-                m_neighbors.push_back(neighbor);
-                m_edges.push_back(edge);
-            }
-        };
-        std::vector<NodeInfo> m_nodeInfo;
+        //compressed sparse row layout: the neighbors (and matched edges) of node i are at [m_neighborOffsets[i], m_neighborOffsets[i + 1])
+        //in m_neighbors and m_neighborEdges, the tiles (and matched vertex numbers) at [m_tileOffsets[i], m_tileOffsets[i + 1]) in m_tiles and m_whichVertex
+        //this is one allocation per array instead of four per node, and a traversal of nearby nodes reads nearby memory
+        std::vector<int64_t> m_neighborOffsets;
+        std::vector<int32_t> m_neighbors;
+        std::vector<int32_t> m_neighborEdges;//index into the topology edges vector, matched with neighbors
+        std::vector<int64_t> m_tileOffsets;
+        std::vector<int32_t> m_tiles;
+        std::vector<int32_t> m_whichVertex;//stores which tile vertex this node is, matched to m_tiles
         std::vector<TopologyEdgeInfo> m_edgeInfo;
         std::vector<TopologyTileInfo> m_tileInfo;
         std::vector<int32_t> m_boundaryCount;
@@ -109,6 +124,10 @@ namespace caret {
         bool m_neighborsSorted;
     public:
         TopologyHelperBase(const SurfaceFile* surfIn, bool sortNeighbors = false);
+        ///get a base shared by all surfaces with identical triangles (all surfaces of a hemisphere), building it if needed
+        static CaretPointer<TopologyHelperBase> getSharedBase(const SurfaceFile* surfIn, bool sortNeighbors = false);
+        ///free shared bases that are no longer used by any surface or helper, call after releasing a reference to one
+        static void releaseUnusedSharedBases();
         bool isNodeInfoSorted() const {
             return m_neighborsSorted;
         }
@@ -122,7 +141,11 @@ namespace caret {
         mutable CaretMutex m_usingMarkNodes;
         bool m_neighborsSorted;
         int32_t m_numNodes, m_maxNeigh;
-        const std::vector<TopologyHelperBase::NodeInfo>& m_nodeInfo;//references for convenience instead of using the m_base pointer
+        const int64_t* m_neighborOffsets;//pointers into the base for convenience instead of using the m_base pointer
+        const int32_t* m_neighbors;
+        const int32_t* m_neighborEdges;
+        const int64_t* m_tileOffsets;
+        const int32_t* m_tiles;
         const std::vector<TopologyEdgeInfo>& m_edgeInfo;
         const std::vector<TopologyTileInfo>& m_tileInfo;
         const std::vector<int32_t>& m_boundaryCount;
@@ -148,14 +171,14 @@ namespace caret {
         int32_t getNodeNumberOfNeighbors(const int32_t nodeNum) const;
 
         /// Get the neighbors of a node
-        const std::vector<int32_t>& getNodeNeighbors(const int32_t nodeNum) const;
+        TopologyIndexList getNodeNeighbors(const int32_t nodeNum) const;
 
         /// Get the neighboring nodes for a node.  Returns a pointer to an array
         /// containing the neighbors.
         const int32_t* getNodeNeighbors(const int32_t nodeNum, int32_t& numNeighborsOut) const;
         
         ///get the edges of a node
-        const std::vector<int32_t>& getNodeEdges(const int32_t nodeNum) const;
+        TopologyIndexList getNodeEdges(const int32_t nodeNum) const;
 
         /// Get the neighbors to a specified depth
         void getNodeNeighborsToDepth(const int32_t nodeNum,
@@ -169,7 +192,7 @@ namespace caret {
         int32_t getMaximumNumberOfNeighbors() const;
 
         /// Get the tiles used by a node
-        const std::vector<int32_t>& getNodeTiles(const int32_t nodeNum) const;
+        TopologyIndexList getNodeTiles(const int32_t nodeNum) const;
 
         /// Get the tiles for a node.  Returns a pointer to an array
         /// containing the tiles.
@@ -1884,6 +1884,67 @@ VolumeFile::getVoxelColorsForSubSliceInMap(const int32_t mapIndex,
                                                      rgbaOut);
 }
 
+/**
+ * Get the voxel colors for several parallel sub-slices in the map that
+ * have the same corners in the plane of the slice (such as the slices
+ * in a montage).  The slices are colored in parallel.
+ *
+ * @param mapIndex
+ *    Index of the map.
+ * @param slicePlane
+ *    The slice plane.
+ * @param sliceIndices
+ *    Indices of the slices.
+ * @param firstCornerVoxelIndex
+ *    Indices of voxel for first corner of sub-slices (inclusive).
+ * @param lastCornerVoxelIndex
+ *    Indices of voxel for last corner of sub-slices (inclusive).
+ * @param voxelCountIJK
+ *    Voxel counts for each axis of one sub-slice.
+ * @param displayGroup
+ *    The selected display group.
+ * @param tabIndex
+ *    Index of selected tab.
+ * @param rgbaOut
+ *    Output containing the rgba values of the slices one after the other
+ *    (must have been allocated by caller for all of the slices).
+ * @param validVoxelCountsOut
+ *    Output containing number of voxels with alpha greater than zero
+ *    in each slice (must have been allocated by caller).
+ */
+void
+VolumeFile::getVoxelColorsForSubSlicesInMap(const int32_t mapIndex,
+                                            const VolumeSliceViewPlaneEnum::Enum slicePlane,
+                                            const std::vector<int64_t>& sliceIndices,
+                                            const int64_t firstCornerVoxelIndex[3],
+                                            const int64_t lastCornerVoxelIndex[3],
+                                            const int64_t voxelCountIJK[3],
+                                            const DisplayGroupEnum::Enum displayGroup,
+                                            const int32_t tabIndex,
+                                            uint8_t* rgbaOut,
+                                            int64_t* validVoxelCountsOut) const
+{
+    if (s_voxelColoringEnabled == false) {
+        std::fill(validVoxelCountsOut,
+                  validVoxelCountsOut + sliceIndices.size(),
+                  0);
+        return;
+    }
+    
+    CaretAssert(m_voxelColorizer);
+    
+    m_voxelColorizer->getVoxelColorsForSubSlicesInMap(mapIndex,
+                                                      slicePlane,
+                                                      sliceIndices,
+                                                      firstCornerVoxelIndex,
+                                                      lastCornerVoxelIndex,
+                                                      voxelCountIJK,
+                                                      displayGroup,
+                                                      tabIndex,
+                                                      rgbaOut,
+                                                      validVoxelCountsOut);
+}
+
 /**
  * Get the graphics primitive for drawing this volume using a graphics primitive
  *
@@ -361,6 +361,17 @@ namespace caret {
                                                     const int32_t tabIndex,
                                                     uint8_t* rgbaOut) const override;
         
+        virtual void getVoxelColorsForSubSlicesInMap(const int32_t mapIndex,
+                                                     const VolumeSliceViewPlaneEnum::Enum slicePlane,
+                                                     const std::vector<int64_t>& sliceIndices,
+                                                     const int64_t firstCornerVoxelIndex[3],
+                                                     const int64_t lastCornerVoxelIndex[3],
+                                                     const int64_t voxelCountIJK[3],
+                                                     const DisplayGroupEnum::Enum displayGroup,
+                                                     const int32_t tabIndex,
+                                                     uint8_t* rgbaOut,
+                                                     int64_t* validVoxelCountsOut) const override;
+        
         virtual GraphicsPrimitiveV3fT3f* getVolumeDrawingTriangleStripPrimitive(const int32_t mapIndex,
                                                                            const DisplayGroupEnum::Enum displayGroup,
                                                                            const int32_t tabIndex) const override;
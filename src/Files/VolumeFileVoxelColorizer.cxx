@@ -25,6 +25,7 @@
 
 #include "CaretAssert.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "ElapsedTimer.h"
 #include "GiftiLabel.h"
 #include "GroupAndNameHierarchyItem.h"
@@ -33,6 +34,7 @@
 #include "VolumeFile.h"
 #include "VoxelColorUpdate.h"
 
+#include <algorithm>
 #include <cmath>
 
 using namespace caret;
@@ -42,6 +44,11 @@ using namespace caret;
 /**
  * \class caret::VolumeFileVoxelColorizer 
  * \brief Delegate for coloring a volumes voxels.
+ *
+ * A map's RGBA buffer is allocated when the map is first colored.  All
+ * colorizers share one byte budget, and when it is exceeded the least
+ * recently used map colorings (from any volume file) are released.  A
+ * released map is recolored from its data the next time it is drawn.
  */
 
 /**
@@ -67,10 +74,10 @@ VolumeFileVoxelColorizer::VolumeFileVoxelColorizer(VolumeFile* volumeFile)
     m_voxelCountPerMap = m_dimI * m_dimJ * m_dimK;
     m_mapRGBACount = m_voxelCountPerMap * 4;
     
-    for (int64_t i = 0; i < m_mapCount; i++) {
-        m_mapRGBA.push_back(new uint8_t[m_mapRGBACount]);
-        m_mapColoringValid.push_back(false);
-    }
+    m_mapRGBA.resize(m_mapCount, NULL);
+    m_mapLruIterator.resize(m_mapCount);
+    m_mapLruTouchCount.resize(m_mapCount, -1);
+    m_mapColoringValid.resize(m_mapCount, false);
 }
 
 /**
@@ -78,12 +85,150 @@ VolumeFileVoxelColorizer::VolumeFileVoxelColorizer(VolumeFile* volumeFile)
  */
 VolumeFileVoxelColorizer::~VolumeFileVoxelColorizer()
 {
+    CaretMutexLocker locker(&s_coloringMutex);
     for (int64_t i = 0; i < m_mapCount; i++) {
-        delete[] m_mapRGBA[i];
+        releaseMapRGBA(i);
     }
     m_mapRGBA.clear();
 }
 
+/**
+ * @return The maximum number of bytes used for voxel coloring by all volume files.
+ */
+int64_t
+VolumeFileVoxelColorizer::getColoringMemoryBudget()
+{
+    CaretMutexLocker locker(&s_coloringMutex);
+    return s_coloringBytesBudget;
+}
+
+/**
+ * Set the maximum number of bytes used for voxel coloring by all volume files.
+ * Map colorings over the new budget are released immediately.  The map that
+ * is being drawn is always kept, even if it alone is larger than the budget.
+ *
+ * @param budgetBytes
+ *    New budget in bytes.
+ */
+void
+VolumeFileVoxelColorizer::setColoringMemoryBudget(const int64_t budgetBytes)
+{
+    CaretMutexLocker locker(&s_coloringMutex);
+    s_coloringBytesBudget = budgetBytes;
+    evictColoringOverBudget(NULL, -1);
+}
+
+/**
+ * @return The number of bytes currently used for voxel coloring by all volume files.
+ */
+int64_t
+VolumeFileVoxelColorizer::getColoringMemoryAllocated()
+{
+    CaretMutexLocker locker(&s_coloringMutex);
+    return s_coloringBytesAllocated;
+}
+
+/**
+ * Get the RGBA buffer for a map, allocating it if needed, and mark it as
+ * the most recently used coloring.  A newly allocated buffer is not valid
+ * until the map is colored.
+ *
+ * The buffer is not pinned: the returned pointer is only valid until the
+ * next call that may evict colorings (this method for any other map of any
+ * volume, setColoringMemoryBudget(), or destroying a colorizer).  Colorings
+ * are only used from the drawing thread, which does not make those calls
+ * while it holds the pointer.
+ *
+ * @param mapIndex
+ *     Index of map.
+ * @return
+ *     Pointer to the map's RGBA.
+ */
+uint8_t*
+VolumeFileVoxelColorizer::getMapRGBA(const int64_t mapIndex) const
+{
+    CaretAssertVectorIndex(m_mapRGBA, mapIndex);
+    CaretMutexLocker locker(&s_coloringMutex);
+    if (m_mapRGBA[mapIndex] != NULL) {
+        s_coloringLruList.splice(s_coloringLruList.begin(),
+                                 s_coloringLruList,
+                                 m_mapLruIterator[mapIndex]);
+        ++s_coloringLruChangeCount;
+        m_mapLruTouchCount[mapIndex] = s_coloringLruChangeCount;
+        return m_mapRGBA[mapIndex];
+    }
+    
+    m_mapRGBA[mapIndex] = new uint8_t[m_mapRGBACount];
+    m_mapColoringValid[mapIndex] = false;
+    s_coloringLruList.push_front(std::make_pair(this, mapIndex));
+    m_mapLruIterator[mapIndex] = s_coloringLruList.begin();
+    s_coloringBytesAllocated += m_mapRGBACount;
+    
+    evictColoringOverBudget(this, mapIndex);
+    
+    ++s_coloringLruChangeCount;
+    m_mapLruTouchCount[mapIndex] = s_coloringLruChangeCount;
+    
+    return m_mapRGBA[mapIndex];
+}
+
+/**
+ * Release the RGBA buffer for a map, if it is allocated.
+ * Caller must hold the coloring mutex.
+ *
+ * @param mapIndex
+ *     Index of map.
+ */
+void
+VolumeFileVoxelColorizer::releaseMapRGBA(const int64_t mapIndex) const
+{
+    CaretAssertVectorIndex(m_mapRGBA, mapIndex);
+    if (m_mapRGBA[mapIndex] == NULL) {
+        return;
+    }
+    
+    delete[] m_mapRGBA[mapIndex];
+    m_mapRGBA[mapIndex] = NULL;
+    m_mapColoringValid[mapIndex] = false;
+    s_coloringLruList.erase(m_mapLruIterator[mapIndex]);
+    ++s_coloringLruChangeCount;
+    s_coloringBytesAllocated -= m_mapRGBACount;
+}
+
+/**
+ * Release least recently used map colorings until the allocated
+ * bytes fit the budget.  Caller must hold the coloring mutex.
+ *
+ * @param keepColorizer
+ *     Colorizer containing a map that must not be released (may be NULL).
+ * @param keepMapIndex
+ *     Index of map in keepColorizer that must not be released.
+ */
+void
+VolumeFileVoxelColorizer::evictColoringOverBudget(const VolumeFileVoxelColorizer* keepColorizer,
+                                                  const int64_t keepMapIndex)
+{
+    ColoringLruList::iterator iter = s_coloringLruList.end();
+    while ((s_coloringBytesAllocated > s_coloringBytesBudget)
+           && (iter != s_coloringLruList.begin())) {
+        --iter;
+        if ((iter->first == keepColorizer)
+            && (iter->second == keepMapIndex)) {
+            continue;
+        }
+        
+        /*
+         * Releasing erases the list entry, so first step past it
+         * toward the less recently used end (only the kept map or the
+         * end remains there).  The next decrement then moves to the
+         * entry's more recently used neighbor.
+         */
+        ColoringLruList::iterator evictIter = iter;
+        ++iter;
+        evictIter->first->releaseMapRGBA(evictIter->second);
+    }
+}
+
 /**
  * Assign voxel coloring for a map.
  *
@@ -93,7 +238,7 @@ VolumeFileVoxelColorizer::~VolumeFileVoxelColorizer()
 void
 VolumeFileVoxelColorizer::assignVoxelColorsForMap(const int32_t mapIndex) const
 {
-    CaretAssertVectorIndex(m_mapRGBA, mapIndex);
+    uint8_t* mapRGBA = getMapRGBA(mapIndex);
     
     CaretAssertVectorIndex(m_mapColoringValid, mapIndex);
     if ( ! m_mapColoringValid[mapIndex]) {
@@ -203,7 +348,7 @@ VolumeFileVoxelColorizer::assignVoxelColorsForMap(const int32_t mapIndex) const
                                                           thresholdPaletteColorMapping,
                                                           thresholdDataPointer,
                                                           m_voxelCountPerMap,
-                                                          m_mapRGBA[mapIndex],
+                                                          mapRGBA,
                                                           ignoreThresholding);
             m_mapColoringValid[mapIndex] = true;
         }
@@ -213,7 +358,7 @@ VolumeFileVoxelColorizer::assignVoxelColorsForMap(const int32_t mapIndex) const
                 NodeAndVoxelColoring::colorIndicesWithLabelTable(m_volumeFile->getMapLabelTable(mapIndex),
                                                                  &mapDataPointer[0],
                                                                  m_voxelCountPerMap,
-                                                                 m_mapRGBA[mapIndex]);
+                                                                 mapRGBA);
                 m_mapColoringValid[mapIndex] = true;
             }
             break;
@@ -233,7 +378,7 @@ VolumeFileVoxelColorizer::assignVoxelColorsForMap(const int32_t mapIndex) const
                                                            alphaComponents,
                                                            m_voxelCountPerMap,
                                                            thresholdRGB,
-                                                           m_mapRGBA[mapIndex]);
+                                                           mapRGBA);
                 m_mapColoringValid[mapIndex] = true;
             }
             else {
@@ -255,7 +400,7 @@ VolumeFileVoxelColorizer::assignVoxelColorsForMap(const int32_t mapIndex) const
                                                            alphaComponents,
                                                            m_voxelCountPerMap,
                                                            thresholdRGB,
-                                                           m_mapRGBA[mapIndex]);
+                                                           mapRGBA);
                 m_mapColoringValid[mapIndex] = true;
             }
             else {
@@ -353,7 +498,7 @@ VolumeFileVoxelColorizer::getVoxelColorsForSliceInMap(const int32_t mapIndex,
     /*
      * Pointer to maps RGBA values
      */
-    const uint8_t* mapRGBA = m_mapRGBA[mapIndex];
+    const uint8_t* mapRGBA = getMapRGBA(mapIndex);
     
     const GiftiLabelTable* labelTable = (m_volumeFile->isMappedWithLabelTable()
                                          ? m_volumeFile->getMapLabelTable(mapIndex)
@@ -456,7 +601,7 @@ VolumeFileVoxelColorizer::getVoxelColorsForSliceInMap(const int32_t mapIndex,
     /*
      * Pointer to maps RGBA values
      */
-    const uint8_t* mapRGBA = m_mapRGBA[mapIndex];
+    const uint8_t* mapRGBA = getMapRGBA(mapIndex);
     
     const GiftiLabelTable* labelTable = (m_volumeFile->isMappedWithLabelTable()
                                          ? m_volumeFile->getMapLabelTable(mapIndex)
@@ -622,7 +767,7 @@ VolumeFileVoxelColorizer::getVoxelColorsForSubSliceInMap(const int32_t mapIndex,
     /*
      * Pointer to maps RGBA values
      */
-    const uint8_t* mapRGBA = m_mapRGBA[mapIndex];
+    const uint8_t* mapRGBA = getMapRGBA(mapIndex);
     
     const GiftiLabelTable* labelTable = (m_volumeFile->isMappedWithLabelTable()
                                          ? m_volumeFile->getMapLabelTable(mapIndex)
@@ -692,6 +837,228 @@ VolumeFileVoxelColorizer::getVoxelColorsForSubSliceInMap(const int32_t mapIndex,
     return validVoxelCount;
 }
 
+/**
+ * Get voxel coloring for several parallel sub-slices in a map, such as the
+ * slices in a montage.  All sub-slices use the same corners in the plane
+ * of the slice.  The label display status is looked up once for each label
+ * and the slices are colored in parallel.
+ *
+ * @param mapIndex
+ *     Index of map.
+ * @param slicePlane
+ *    Plane of the slices.
+ * @param sliceIndices
+ *    Indices of the slices (all must be valid).
+ * @param firstCornerVoxelIndex
+ *    Indices of voxel for first corner of sub-slices (inclusive).
+ * @param lastCornerVoxelIndex
+ *    Indices of voxel for last corner of sub-slices (inclusive).
+ * @param voxelCountIJK
+ *    Voxel counts for each axis of one sub-slice.
+ * @param displayGroup
+ *    The selected display group.
+ * @param tabIndex
+ *    Index of selected tab.
+ * @param rgbaOut
+ *    RGBA color components out with the slices one after the other.
+ * @param validVoxelCountsOut
+ *    Number of voxels with alpha greater than zero in each slice.
+ */
+void
+VolumeFileVoxelColorizer::getVoxelColorsForSubSlicesInMap(const int32_t mapIndex,
+                                                          const VolumeSliceViewPlaneEnum::Enum slicePlane,
+                                                          const std::vector<int64_t>& sliceIndices,
+                                                          const int64_t firstCornerVoxelIndex[3],
+                                                          const int64_t lastCornerVoxelIndex[3],
+                                                          const int64_t voxelCountIJK[3],
+                                                          const DisplayGroupEnum::Enum displayGroup,
+                                                          const int32_t tabIndex,
+                                                          uint8_t* rgbaOut,
+                                                          int64_t* validVoxelCountsOut) const
+{
+    CaretAssertVectorIndex(m_mapRGBA, mapIndex);
+    CaretAssert(rgbaOut);
+    CaretAssert(validVoxelCountsOut);
+    
+    const int64_t numberOfSlices = static_cast<int64_t>(sliceIndices.size());
+    if (numberOfSlices <= 0) {
+        return;
+    }
+    
+    CaretAssertVectorIndex(m_mapColoringValid, mapIndex);
+    if ( ! m_mapColoringValid[mapIndex]) {
+        assignVoxelColorsForMap(mapIndex);
+    }
+    
+    VolumeSpace::OrientTypes orient[3];
+    m_volumeFile->getOrientation(orient);
+    int orient2dim[3];
+    int64_t incrementijk[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        incrementijk[i] = (lastCornerVoxelIndex[i] > firstCornerVoxelIndex[i]) ? 1 : -1;
+        switch (orient[i])
+        {
+            case VolumeSpace::LEFT_TO_RIGHT:
+            case VolumeSpace::RIGHT_TO_LEFT:
+                orient2dim[0] = i;
+                break;
+            case VolumeSpace::POSTERIOR_TO_ANTERIOR:
+            case VolumeSpace::ANTERIOR_TO_POSTERIOR:
+                orient2dim[1] = i;
+                break;
+            case VolumeSpace::INFERIOR_TO_SUPERIOR:
+            case VolumeSpace::SUPERIOR_TO_INFERIOR:
+                orient2dim[2] = i;
+                break;
+        }
+    }
+    
+    int outerLoop = -1, innerLoop = -1, sliceDim = -1;
+    switch (slicePlane)
+    {
+        case VolumeSliceViewPlaneEnum::PARASAGITTAL:
+            outerLoop = orient2dim[2];
+            innerLoop = orient2dim[1];
+            sliceDim  = orient2dim[0];
+            break;
+        case VolumeSliceViewPlaneEnum::CORONAL:
+            outerLoop = orient2dim[2];
+            innerLoop = orient2dim[0];
+            sliceDim  = orient2dim[1];
+            break;
+        case VolumeSliceViewPlaneEnum::AXIAL:
+            outerLoop = orient2dim[1];
+            innerLoop = orient2dim[0];
+            sliceDim  = orient2dim[2];
+            break;
+        default:
+            CaretAssert(false);
+            return;
+    }
+    
+    /*
+     * Offsets between adjacent voxels along each axis
+     */
+    const int64_t voxelStride[3] = { 1, m_dimI, m_dimI * m_dimJ };
+    const int64_t outerCount = std::abs(lastCornerVoxelIndex[outerLoop] - firstCornerVoxelIndex[outerLoop]) + 1;
+    const int64_t innerCount = std::abs(lastCornerVoxelIndex[innerLoop] - firstCornerVoxelIndex[innerLoop]) + 1;
+    const int64_t outerStep  = incrementijk[outerLoop] * voxelStride[outerLoop];
+    const int64_t innerStep  = incrementijk[innerLoop] * voxelStride[innerLoop];
+    const int64_t firstVoxelInPlaneOffset = ((firstCornerVoxelIndex[outerLoop] * voxelStride[outerLoop])
+                                             + (firstCornerVoxelIndex[innerLoop] * voxelStride[innerLoop]));
+    
+    const int64_t sliceRgbaCount = voxelCountIJK[0] * voxelCountIJK[1] * voxelCountIJK[2] * 4;
+    CaretAssert(sliceRgbaCount == (outerCount * innerCount * 4));
+    
+    /*
+     * Pointer to maps RGBA values
+     */
+    const uint8_t* mapRGBA = getMapRGBA(mapIndex);
+    
+    const GiftiLabelTable* labelTable = (m_volumeFile->isMappedWithLabelTable()
+                                         ? m_volumeFile->getMapLabelTable(mapIndex)
+                                         : NULL);
+    if (m_volumeFile->isMappedWithLabelTable()) {
+        CaretAssert(labelTable);
+    }
+    
+    /*
+     * For label data, look up the display status of each label once
+     * instead of for every voxel.  Keys outside the table are displayed.
+     * Label keys can be sparse over a huge range, so above a limit on
+     * the range, the hidden keys are searched instead.
+     */
+    const int64_t maximumLabelLookupCount = 1024 * 1024;
+    const float* labelData = NULL;
+    std::vector<uint8_t> labelDisplayedLookup;
+    std::vector<int32_t> hiddenLabelKeys;
+    int32_t minimumLabelKey = 0;
+    if (labelTable != NULL) {
+        labelData = m_volumeFile->getFrame(mapIndex);
+        std::vector<int32_t> labelKeys;
+        labelTable->getKeys(labelKeys);
+        if ( ! labelKeys.empty()) {
+            minimumLabelKey = *std::min_element(labelKeys.begin(), labelKeys.end());
+            const int32_t maximumLabelKey = *std::max_element(labelKeys.begin(), labelKeys.end());
+            const int64_t labelKeyRange = static_cast<int64_t>(maximumLabelKey) - minimumLabelKey + 1;
+            const bool useLookupFlag = (labelKeyRange <= maximumLabelLookupCount);
+            if (useLookupFlag) {
+                labelDisplayedLookup.resize(labelKeyRange, 1);
+            }
+            for (const int32_t key : labelKeys) {
+                const GiftiLabel* label = labelTable->getLabel(key);
+                if (label != NULL) {
+                    const GroupAndNameHierarchyItem* item = label->getGroupNameSelectionItem();
+                    if (item != NULL) {
+                        if (item->isSelected(displayGroup, tabIndex) == false) {
+                            if (useLookupFlag) {
+                                labelDisplayedLookup[static_cast<int64_t>(key) - minimumLabelKey] = 0;
+                            }
+                            else {
+                                hiddenLabelKeys.push_back(key);
+                            }
+                        }
+                    }
+                }
+            }
+            std::sort(hiddenLabelKeys.begin(), hiddenLabelKeys.end());
+        }
+    }
+    const int64_t labelLookupCount = static_cast<int64_t>(labelDisplayedLookup.size());
+    
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int64_t iSlice = 0; iSlice < numberOfSlices; iSlice++) {
+        CaretAssert((sliceIndices[iSlice] >= 0)
+                    && (sliceIndices[iSlice] < ((sliceDim == 0) ? m_dimI : ((sliceDim == 1) ? m_dimJ : m_dimK))));
+        uint8_t* sliceRGBA = rgbaOut + (iSlice * sliceRgbaCount);
+        int64_t validVoxelCount = 0;
+        int64_t rgbaOutIndex = 0;
+        
+        int64_t rowVoxelOffset = (sliceIndices[iSlice] * voxelStride[sliceDim]) + firstVoxelInPlaneOffset;
+        for (int64_t iOuter = 0; iOuter < outerCount; iOuter++) {
+            int64_t voxelOffset = rowVoxelOffset;
+            for (int64_t iInner = 0; iInner < innerCount; iInner++) {
+                const int64_t rgbaOffset = voxelOffset * 4;
+                CaretAssertArrayIndex(mapRGBA, m_mapRGBACount, rgbaOffset + 3);
+                sliceRGBA[rgbaOutIndex]   = mapRGBA[rgbaOffset];
+                sliceRGBA[rgbaOutIndex+1] = mapRGBA[rgbaOffset+1];
+                sliceRGBA[rgbaOutIndex+2] = mapRGBA[rgbaOffset+2];
+                uint8_t alpha = mapRGBA[rgbaOffset+3];
+                
+                if ((alpha > 0)
+                    && (labelLookupCount > 0)) {
+                    const int64_t lookupIndex = static_cast<int64_t>(static_cast<int32_t>(labelData[voxelOffset])) - minimumLabelKey;
+                    if ((lookupIndex >= 0)
+                        && (lookupIndex < labelLookupCount)) {
+                        if (labelDisplayedLookup[lookupIndex] == 0) {
+                            alpha = 0;
+                        }
+                    }
+                }
+                else if ((alpha > 0)
+                         && ( ! hiddenLabelKeys.empty())) {
+                    if (std::binary_search(hiddenLabelKeys.begin(),
+                                           hiddenLabelKeys.end(),
+                                           static_cast<int32_t>(labelData[voxelOffset]))) {
+                        alpha = 0;
+                    }
+                }
+                
+                if (alpha > 0) {
+                    ++validVoxelCount;
+                }
+                sliceRGBA[rgbaOutIndex+3] = alpha;
+                rgbaOutIndex += 4;
+                voxelOffset  += innerStep;
+            }
+            rowVoxelOffset += outerStep;
+        }
+        
+        validVoxelCountsOut[iSlice] = validVoxelCount;
+    }
+}
+
 /**
  * Get the RGBA color components for voxel.
  *
@@ -725,10 +1092,16 @@ VolumeFileVoxelColorizer::getVoxelColorInMap(const int64_t i,
     }
     
     /*
-     * Pointer to maps RGBA values
+     * Ray casting calls this for every step along a ray, so only lock and
+     * touch the LRU list when some other map was used since this map was
+     * last touched, which is about once per map per draw.  Otherwise the
+     * map is still the most recently used and its coloring is valid, so
+     * it is read without locking (drawing is single threaded).
      */
-    CaretAssertVectorIndex(m_mapRGBA, mapIndex);
-    const uint8_t* mapRGBA = m_mapRGBA[mapIndex];
+    CaretAssertVectorIndex(m_mapLruTouchCount, mapIndex);
+    const uint8_t* mapRGBA = ((m_mapLruTouchCount[mapIndex] == s_coloringLruChangeCount)
+                              ? getMapRGBANoTouch(mapIndex)
+                              : getMapRGBA(mapIndex));
     const int64_t rgbaOffset = getRgbaOffsetForVoxelIndex(i, j, k);
     CaretAssertArrayIndex(mapRGBA, m_mapRGBACount, rgbaOffset);
     rgbaOut[0] = mapRGBA[rgbaOffset];
@@ -775,8 +1148,13 @@ VolumeFileVoxelColorizer::clearVoxelColoringForMap(const int64_t mapIndex) const
     CaretAssertVectorIndex(m_mapRGBA, mapIndex);
     uint8_t* mapRGBA = m_mapRGBA[mapIndex];
     
-    for (int64_t i = 0; i < m_mapRGBACount; i++) {
-        mapRGBA[i] = 0.0;
+    /*
+     * Nothing to clear if the map's coloring was never allocated or was evicted
+     */
+    if (mapRGBA != NULL) {
+        for (int64_t i = 0; i < m_mapRGBACount; i++) {
+            mapRGBA[i] = 0.0;
+        }
     }
     
     CaretAssertVectorIndex(m_mapColoringValid, mapIndex);
@@ -796,8 +1174,7 @@ VolumeFileVoxelColorizer::updateVoxelColorsInMap(const VoxelColorUpdate& voxelCo
     CaretAssertVectorIndex(m_mapColoringValid, mapIndex);
     
     if (m_mapColoringValid[mapIndex]) {
-        CaretAssertVectorIndex(m_mapRGBA, mapIndex);
-        uint8_t* mapRGBA = m_mapRGBA[mapIndex];
+        uint8_t* mapRGBA = getMapRGBA(mapIndex);
         
         const std::array<uint8_t, 4> rgba(voxelColorUpdate.getRGBA());
         const int32_t numVoxels(voxelColorUpdate.getNumberOfVoxels());
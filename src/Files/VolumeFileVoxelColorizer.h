@@ -22,6 +22,12 @@
 /*LICENSE_END*/
 
 
+#include <list>
+#include <utility>
+#include <vector>
+
+#include "CaretAssert.h"
+#include "CaretMutex.h"
 #include "CaretObject.h"
 #include "DisplayGroupEnum.h"
 #include "VolumeSliceViewPlaneEnum.h"
@@ -68,6 +74,17 @@ namespace caret {
                                             const int32_t tabIndex,
                                             uint8_t* rgbaOut) const;
         
+        void getVoxelColorsForSubSlicesInMap(const int32_t mapIndex,
+                                             const VolumeSliceViewPlaneEnum::Enum slicePlane,
+                                             const std::vector<int64_t>& sliceIndices,
+                                             const int64_t firstCornerVoxelIndex[3],
+                                             const int64_t lastCornerVoxelIndex[3],
+                                             const int64_t voxelCountIJK[3],
+                                             const DisplayGroupEnum::Enum displayGroup,
+                                             const int32_t tabIndex,
+                                             uint8_t* rgbaOut,
+                                             int64_t* validVoxelCountsOut) const;
+        
         void getVoxelColorInMap(const int64_t i,
                                 const int64_t j,
                                 const int64_t k,
@@ -82,7 +99,16 @@ namespace caret {
         
         void invalidateColoring();
         
+        static int64_t getColoringMemoryBudget();
+        
+        static void setColoringMemoryBudget(const int64_t budgetBytes);
+        
+        static int64_t getColoringMemoryAllocated();
+        
     private:
+        /** Entry in the least recently used list of allocated map colorings, shared by all volume files */
+        typedef std::list<std::pair<const VolumeFileVoxelColorizer*, int64_t> > ColoringLruList;
+        
         VolumeFileVoxelColorizer(const VolumeFileVoxelColorizer&);
 
         VolumeFileVoxelColorizer& operator=(const VolumeFileVoxelColorizer&);
@@ -107,6 +133,26 @@ namespace caret {
                          + ((ijk[2] * m_dimI * m_dimJ))));
         }
         
+        uint8_t* getMapRGBA(const int64_t mapIndex) const;
+        
+        /**
+         * Get the RGBA buffer for a map without locking or touching the LRU list.
+         * Only for the drawing thread, for a map whose coloring is valid.  The
+         * pointer is invalid after anything that may evict colorings (getMapRGBA()
+         * for any map of any volume, setColoringMemoryBudget(), or destroying
+         * this colorizer), so do not keep it across those calls.
+         */
+        inline const uint8_t* getMapRGBANoTouch(const int64_t mapIndex) const {
+            CaretAssertVectorIndex(m_mapRGBA, mapIndex);
+            CaretAssert(m_mapRGBA[mapIndex] != NULL);
+            return m_mapRGBA[mapIndex];
+        }
+        
+        void releaseMapRGBA(const int64_t mapIndex) const;
+        
+        static void evictColoringOverBudget(const VolumeFileVoxelColorizer* keepColorizer,
+                                            const int64_t keepMapIndex);
+        
         // ADD_NEW_MEMBERS_HERE
 
         VolumeFile* m_volumeFile;
@@ -119,11 +165,34 @@ namespace caret {
         int64_t m_mapRGBACount;
         
         mutable std::vector<bool> m_mapColoringValid;
+        
+        /** RGBA for each map, NULL until the map is first colored or after it is evicted */
         mutable std::vector<uint8_t*> m_mapRGBA;
+        
+        /** Position of each allocated map in the LRU list */
+        mutable std::vector<ColoringLruList::iterator> m_mapLruIterator;
+        
+        /** Value of s_coloringLruChangeCount when each map was last moved to the front of the LRU list */
+        mutable std::vector<int64_t> m_mapLruTouchCount;
+        
+        static ColoringLruList s_coloringLruList;
+        
+        /** Incremented whenever the LRU list changes, so a map whose touch count matches is still the most recently used */
+        static int64_t s_coloringLruChangeCount;
+        
+        static int64_t s_coloringBytesAllocated;
+        
+        static int64_t s_coloringBytesBudget;
+        
+        static CaretMutex s_coloringMutex;
     };
     
 #ifdef __VOLUME_FILE_VOXEL_COLORIZER_DECLARE__
-    // <PLACE DECLARATIONS OF STATIC MEMBERS HERE>
+    VolumeFileVoxelColorizer::ColoringLruList VolumeFileVoxelColorizer::s_coloringLruList;
+    int64_t VolumeFileVoxelColorizer::s_coloringLruChangeCount = 0;
+    int64_t VolumeFileVoxelColorizer::s_coloringBytesAllocated = 0;
+    int64_t VolumeFileVoxelColorizer::s_coloringBytesBudget = (int64_t)1024 * 1024 * 1024;
+    CaretMutex VolumeFileVoxelColorizer::s_coloringMutex;
 #endif // __VOLUME_FILE_VOXEL_COLORIZER_DECLARE__
 
 } // namespace
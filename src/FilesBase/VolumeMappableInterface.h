@@ -21,6 +21,8 @@
  */
 /*LICENSE_END*/
 
+#include <vector>
+
 #include "DisplayGroupEnum.h"
 #include "Vector3D.h"
 #include "VolumeSliceViewPlaneEnum.h"
@@ -400,6 +402,17 @@ namespace caret {
                                                        const int32_t tabIndex,
                                                        uint8_t* rgbaOut) const = 0;
         
+        virtual void getVoxelColorsForSubSlicesInMap(const int32_t mapIndex,
+                                                     const VolumeSliceViewPlaneEnum::Enum slicePlane,
+                                                     const std::vector<int64_t>& sliceIndices,
+                                                     const int64_t firstCornerVoxelIndex[3],
+                                                     const int64_t lastCornerVoxelIndex[3],
+                                                     const int64_t voxelCountIJK[3],
+                                                     const DisplayGroupEnum::Enum displayGroup,
+                                                     const int32_t tabIndex,
+                                                     uint8_t* rgbaOut,
+                                                     int64_t* validVoxelCountsOut) const;
+        
         /**
          * Get the voxel coloring for the voxel at the given indices.
          *
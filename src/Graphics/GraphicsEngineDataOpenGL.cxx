@@ -38,12 +38,16 @@
 #include "GraphicsPrimitive.h"
 #include "GraphicsPrimitiveSelectionHelper.h"
 #include "GraphicsPrimitiveV3f.h"
+#include "GraphicsRenderProfiler.h"
 #include "GraphicsShape.h"
 #include "GraphicsUtilitiesOpenGL.h"
 #include "Matrix4x4.h"
 
 using namespace caret;
 
+/** Name of stage for profiling the loading of buffers and textures */
+static const char* s_profileUploadStageName = "Graphics Primitive Upload";
+
 
     
 /**
@@ -111,6 +115,16 @@ GraphicsEngineDataOpenGL::invalidateTextureCoordinates()
     m_reloadTextureCoordinatesFlag = true;
 }
 
+/**
+ * Invalidate the element indices after they have
+ * changed in the graphics primitive.
+ */
+void
+GraphicsEngineDataOpenGL::invalidateElementIndices()
+{
+    m_reloadElementIndicesFlag = true;
+}
+
 
 /**
  * Get the OpenGL Buffer Usage Hint from the primitive.
@@ -149,6 +163,7 @@ void
 GraphicsEngineDataOpenGL::loadCoordinateBuffer(GraphicsPrimitive* primitive)
 {
     CaretAssert(primitive);
+    GraphicsRenderProfiler::ScopedTimer profileTimer(s_profileUploadStageName);
     
     GLenum usageHint = getOpenGLBufferUsageHint(primitive->getUsageTypeCoordinates());
     
@@ -206,6 +221,7 @@ void
 GraphicsEngineDataOpenGL::loadNormalVectorBuffer(GraphicsPrimitive* primitive)
 {
     CaretAssert(primitive);
+    GraphicsRenderProfiler::ScopedTimer profileTimer(s_profileUploadStageName);
     
     GLenum usageHint = getOpenGLBufferUsageHint(primitive->getUsageTypeNormals());
     
@@ -245,6 +261,7 @@ void
 GraphicsEngineDataOpenGL::loadColorBuffer(GraphicsPrimitive* primitive)
 {
     CaretAssert(primitive);
+    GraphicsRenderProfiler::ScopedTimer profileTimer(s_profileUploadStageName);
     
     GLenum usageHint = getOpenGLBufferUsageHint(primitive->getUsageTypeColors());
     
@@ -309,6 +326,7 @@ void
 GraphicsEngineDataOpenGL::loadTextureCoordinateBuffer(GraphicsPrimitive* primitive)
 {
     CaretAssert(primitive);
+    GraphicsRenderProfiler::ScopedTimer profileTimer(s_profileUploadStageName);
  
     GLenum usageHint = getOpenGLBufferUsageHint(primitive->getUsageTypeTextureCoordinates());
     
@@ -349,6 +367,121 @@ GraphicsEngineDataOpenGL::loadTextureCoordinateBuffer(GraphicsPrimitive* primiti
 }
 
 
+/**
+ * Load the element index buffer.
+ * @param primitive
+ *     The graphics primitive that will be drawn.
+ */
+void
+GraphicsEngineDataOpenGL::loadElementIndexBuffer(GraphicsPrimitive* primitive)
+{
+    CaretAssert(primitive);
+    GraphicsRenderProfiler::ScopedTimer profileTimer(s_profileUploadStageName);
+    
+    m_elementIndicesCount = primitive->m_elementIndices.size();
+    if (m_elementIndicesCount > 0) {
+        GLenum usageHint = getOpenGLBufferUsageHint(primitive->getUsageTypeCoordinates());
+        
+        if (m_elementIndexBufferObject == NULL) {
+            EventGraphicsOpenGLCreateBufferObject createEvent;
+            EventManager::get()->sendEvent(createEvent.getPointer());
+            m_elementIndexBufferObject.reset(createEvent.getOpenGLBufferObject());
+            CaretAssert(m_elementIndexBufferObject);
+        }
+        CaretAssert(m_elementIndexBufferObject->getBufferObjectName());
+        
+        const GLuint indicesSizeBytes = m_elementIndicesCount * sizeof(uint32_t);
+        const GLvoid* indicesDataPointer = (const GLvoid*)&primitive->m_elementIndices[0];
+        
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                     m_elementIndexBufferObject->getBufferObjectName());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                     indicesSizeBytes,
+                     indicesDataPointer,
+                     usageHint);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                     0);
+    }
+    else {
+        m_elementIndexBufferObject.reset();
+    }
+    
+    m_reloadElementIndicesFlag = false;
+}
+
+/**
+ * Load a color stream buffer.  The buffer is loaded completely when it
+ * is first created or all of its colors change.  Otherwise, only the
+ * modified range of vertices is loaded.
+ *
+ * @param primitive
+ *     The graphics primitive that will be drawn.
+ * @param streamIndex
+ *     Index of the color stream.
+ */
+void
+GraphicsEngineDataOpenGL::loadColorStreamBuffer(GraphicsPrimitive* primitive,
+                                                const int32_t streamIndex)
+{
+    CaretAssert(primitive);
+    CaretAssertVectorIndex(primitive->m_colorStreams, streamIndex);
+    
+    GraphicsPrimitive::ColorStream& colorStream = primitive->m_colorStreams[streamIndex];
+    if (colorStream.m_unsignedByteRGBA.empty()) {
+        return;
+    }
+    
+    if (streamIndex >= static_cast<int32_t>(m_colorStreamBufferObjects.size())) {
+        m_colorStreamBufferObjects.resize(streamIndex + 1);
+    }
+    std::unique_ptr<GraphicsOpenGLBufferObject>& bufferObject = m_colorStreamBufferObjects[streamIndex];
+    if ((bufferObject != NULL)
+        && (colorStream.m_modifiedFirstVertex < 0)) {
+        /* No colors have been modified */
+        return;
+    }
+    
+    GraphicsRenderProfiler::ScopedTimer profileTimer(s_profileUploadStageName);
+    
+    const uint8_t* rgbaPointer = &colorStream.m_unsignedByteRGBA[0];
+    const int32_t numberOfVertices = colorStream.m_unsignedByteRGBA.size() / 4;
+    const bool allModifiedFlag = ((colorStream.m_modifiedFirstVertex == 0)
+                                  && (colorStream.m_modifiedEndVertex == numberOfVertices));
+    if ((bufferObject == NULL)
+        || allModifiedFlag) {
+        if (bufferObject == NULL) {
+            EventGraphicsOpenGLCreateBufferObject createEvent;
+            EventManager::get()->sendEvent(createEvent.getPointer());
+            bufferObject.reset(createEvent.getOpenGLBufferObject());
+        }
+        CaretAssert(bufferObject->getBufferObjectName());
+        
+        /*
+         * Colors are expected to change so ignore the primitive's usage
+         */
+        glBindBuffer(GL_ARRAY_BUFFER,
+                     bufferObject->getBufferObjectName());
+        glBufferData(GL_ARRAY_BUFFER,
+                     colorStream.m_unsignedByteRGBA.size() * sizeof(uint8_t),
+                     (const GLvoid*)rgbaPointer,
+                     GL_DYNAMIC_DRAW);
+    }
+    else if (colorStream.m_modifiedFirstVertex >= 0) {
+        const GLintptr offsetBytes = colorStream.m_modifiedFirstVertex * 4 * sizeof(uint8_t);
+        const GLsizeiptr sizeBytes = (colorStream.m_modifiedEndVertex
+                                      - colorStream.m_modifiedFirstVertex) * 4 * sizeof(uint8_t);
+        glBindBuffer(GL_ARRAY_BUFFER,
+                     bufferObject->getBufferObjectName());
+        glBufferSubData(GL_ARRAY_BUFFER,
+                        offsetBytes,
+                        sizeBytes,
+                        (const GLvoid*)(rgbaPointer + offsetBytes));
+    }
+    
+    colorStream.m_modifiedFirstVertex = -1;
+    colorStream.m_modifiedEndVertex   = -1;
+}
+
 /**
  * Load the buffers with data from the grpahics primitive.
  *
@@ -362,6 +495,7 @@ GraphicsEngineDataOpenGL::loadAllBuffers(GraphicsPrimitive* primitive)
     loadNormalVectorBuffer(primitive);
     loadColorBuffer(primitive);
     loadTextureCoordinateBuffer(primitive);    
+    loadElementIndexBuffer(primitive);
 }
 
 /**
@@ -432,6 +566,8 @@ GraphicsEngineDataOpenGL::loadTextureImageDataBuffer(GraphicsPrimitive* primitiv
 void
 GraphicsEngineDataOpenGL::loadTextureImageDataBuffer2D(GraphicsPrimitive* primitive)
 {
+    GraphicsRenderProfiler::ScopedTimer profileTimer(s_profileUploadStageName);
+    
     const bool useGraphicsSettingsFlag(true);
     if (useGraphicsSettingsFlag) {
 
@@ -685,6 +821,8 @@ void
 GraphicsEngineDataOpenGL::loadTextureImageDataBuffer3D(GraphicsPrimitive* primitive,
                                                        const TextureLoadMode textureLoadMode)
 {
+    GraphicsRenderProfiler::ScopedTimer profileTimer(s_profileUploadStageName);
+    
     const GraphicsTextureSettings& textureSettings(primitive->getTextureSettings());
     
     const int64_t imageWidth(textureSettings.getImageWidth());
@@ -1497,6 +1635,14 @@ GraphicsEngineDataOpenGL::drawWithSelection(GraphicsPrimitive* primitive,
     
     selectedPrimitiveIndexOut = -1;
     selectedPrimitiveDepthOut = 0.0;
+    
+    if ( ! primitive->m_elementIndices.empty()) {
+        /*
+         * Selection identifies primitives by consecutive vertices
+         */
+        CaretAssertMessage(0, "Selection not implemented for primitives drawn with element indices");
+        return;
+    }
 
     GLint viewport[4];
     glGetIntegerv(GL_VIEWPORT,
@@ -1688,6 +1834,31 @@ GraphicsEngineDataOpenGL::drawPrivate(const PrivateDrawMode drawMode,
         if (openglData->m_reloadTextureCoordinatesFlag) {
             openglData->loadTextureCoordinateBuffer(primitive);
         }
+        
+        /*
+         * Element indices may get updated
+         */
+        if (openglData->m_reloadElementIndicesFlag) {
+            openglData->loadElementIndexBuffer(primitive);
+        }
+    }
+    
+    /*
+     * Load the active color stream, if any, or its modified colors
+     */
+    GLuint colorStreamBufferName = 0;
+    const int32_t colorStreamIndex = primitive->getActiveColorStream();
+    if ((colorStreamIndex >= 0)
+        && (colorStreamIndex < primitive->getNumberOfColorStreams())) {
+        openglData->loadColorStreamBuffer(primitive,
+                                          colorStreamIndex);
+        if (colorStreamIndex < static_cast<int32_t>(openglData->m_colorStreamBufferObjects.size())) {
+            const GraphicsOpenGLBufferObject* bufferObject = openglData->m_colorStreamBufferObjects[colorStreamIndex].get();
+            if ((bufferObject != NULL)
+                && ( ! primitive->m_colorStreams[colorStreamIndex].m_unsignedByteRGBA.empty())) {
+                colorStreamBufferName = bufferObject->getBufferObjectName();
+            }
+        }
     }
     
     openglData->loadTextureImageDataBuffer(primitive);
@@ -1757,9 +1928,16 @@ GraphicsEngineDataOpenGL::drawPrivate(const PrivateDrawMode drawMode,
             case PrivateDrawMode::DRAW_NORMAL:
             {
                 glEnableClientState(GL_COLOR_ARRAY);
-                CaretAssert(glIsBuffer(openglData->m_colorBufferObject->getBufferObjectName()));
-                glBindBuffer(GL_ARRAY_BUFFER, openglData->m_colorBufferObject->getBufferObjectName());
-                glColorPointer(openglData->m_componentsPerColor, openglData->m_colorDataType, 0, (GLvoid*)0);
+                if (colorStreamBufferName > 0) {
+                    CaretAssert(glIsBuffer(colorStreamBufferName));
+                    glBindBuffer(GL_ARRAY_BUFFER, colorStreamBufferName);
+                    glColorPointer(4, GL_UNSIGNED_BYTE, 0, (GLvoid*)0);
+                }
+                else {
+                    CaretAssert(glIsBuffer(openglData->m_colorBufferObject->getBufferObjectName()));
+                    glBindBuffer(GL_ARRAY_BUFFER, openglData->m_colorBufferObject->getBufferObjectName());
+                    glColorPointer(openglData->m_componentsPerColor, openglData->m_colorDataType, 0, (GLvoid*)0);
+                }
             }
                 break;
             case PrivateDrawMode::DRAW_SELECTION:
@@ -2037,8 +2215,21 @@ GraphicsEngineDataOpenGL::drawPrivate(const PrivateDrawMode drawMode,
     
     int32_t subsetFirstVertexIndex(-1);
     int32_t subsetVertexCount(-1);
-    if (primitive->getDrawArrayIndicesSubset(subsetFirstVertexIndex,
-                                             subsetVertexCount)) {
+    if (openglData->m_elementIndexBufferObject != NULL) {
+        /*
+         * Vertices are shared by primitives, draw using the element indices
+         */
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                     openglData->m_elementIndexBufferObject->getBufferObjectName());
+        glDrawElements(openGLPrimitiveType,
+                       openglData->m_elementIndicesCount,
+                       GL_UNSIGNED_INT,
+                       (GLvoid*)0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                     0);
+    }
+    else if (primitive->getDrawArrayIndicesSubset(subsetFirstVertexIndex,
+                                                  subsetVertexCount)) {
         glDrawArrays(openGLPrimitiveType,
                      subsetFirstVertexIndex,
                      subsetVertexCount);
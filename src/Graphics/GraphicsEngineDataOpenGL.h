@@ -23,6 +23,7 @@
 
 #include <map>
 #include <memory>
+#include <vector>
 
 #include "CaretOpenGLInclude.h"
 #include "GraphicsEngineData.h"
@@ -58,6 +59,8 @@ namespace caret {
         
         void invalidateTextureCoordinates();
         
+        void invalidateElementIndices();
+        
         // ADD_NEW_METHODS_HERE
 
     private:
@@ -95,6 +98,11 @@ namespace caret {
         
         void loadTextureCoordinateBuffer(GraphicsPrimitive* primitive);
         
+        void loadElementIndexBuffer(GraphicsPrimitive* primitive);
+        
+        void loadColorStreamBuffer(GraphicsPrimitive* primitive,
+                                   const int32_t streamIndex);
+        
         void loadTextureImageDataBuffer(GraphicsPrimitive* primitive);
         
         void loadTextureImageDataBuffer2D(GraphicsPrimitive* primitive);
@@ -148,6 +156,8 @@ namespace caret {
         
         bool m_reloadTextureCoordinatesFlag = false;
         
+        bool m_reloadElementIndicesFlag = false;
+        
         std::unique_ptr<GraphicsOpenGLBufferObject> m_normalVectorBufferObject;
         
         GLenum m_normalVectorDataType = GL_FLOAT;
@@ -164,6 +174,12 @@ namespace caret {
         
         GraphicsOpenGLTextureName* m_textureImageDataName = NULL;
         
+        std::unique_ptr<GraphicsOpenGLBufferObject> m_elementIndexBufferObject;
+        
+        GLsizei m_elementIndicesCount = 0;
+        
+        std::vector<std::unique_ptr<GraphicsOpenGLBufferObject>> m_colorStreamBufferObjects;
+        
 // ADD_NEW_MEMBERS_HERE
 
     };
@@ -158,6 +158,9 @@ GraphicsPrimitive::copyHelperGraphicsPrimitive(const GraphicsPrimitive& obj)
     m_floatRGBA                   = obj.m_floatRGBA;
     m_unsignedByteRGBA            = obj.m_unsignedByteRGBA;
     m_floatTextureSTR             = obj.m_floatTextureSTR;
+    m_elementIndices              = obj.m_elementIndices;
+    m_colorStreams                = obj.m_colorStreams;
+    m_activeColorStreamIndex      = obj.m_activeColorStreamIndex;
     m_lineWidthType               = obj.m_lineWidthType;
     m_lineWidthValue              = obj.m_lineWidthValue;
     m_pointSizeType               = obj.m_pointSizeType;
@@ -501,7 +504,12 @@ GraphicsPrimitive::isValid() const
                 }
                 break;
             case PrimitiveType::OPENGL_TRIANGLES:
-                if (numXYZ < 3) {
+                if ( ! m_elementIndices.empty()) {
+                    if ((m_elementIndices.size() % 3) > 0) {
+                        CaretLogWarning("Extra element indices for drawing triangles ignored.");
+                    }
+                }
+                else if (numXYZ < 3) {
                     CaretLogWarning("Triangles must have at least 3 vertices.");
                 }
                 else {
@@ -1554,6 +1562,176 @@ GraphicsPrimitive::setDrawArrayIndicesSubset(const int32_t firstVertexIndex,
     m_boundingBoxValid              = false;
 }
 
+/**
+ * Replace the element indices.  When there are element indices, the
+ * primitive is drawn using the vertices in the order of the element
+ * indices so that vertices shared by many triangles are stored once.
+ * An empty vector of indices draws the vertices in order.
+ *
+ * @param elementIndices
+ *     Indices of the vertices.
+ */
+void
+GraphicsPrimitive::replaceElementIndices(const std::vector<uint32_t>& elementIndices)
+{
+    switch (m_primitiveType) {
+        case PrimitiveType::OPENGL_LINE_LOOP:
+        case PrimitiveType::OPENGL_LINE_STRIP:
+        case PrimitiveType::OPENGL_LINES:
+        case PrimitiveType::OPENGL_POINTS:
+        case PrimitiveType::OPENGL_TRIANGLE_FAN:
+        case PrimitiveType::OPENGL_TRIANGLE_STRIP:
+        case PrimitiveType::OPENGL_TRIANGLES:
+            break;
+        case PrimitiveType::MODEL_SPACE_POLYGONAL_LINE_LOOP_BEVEL_JOIN:
+        case PrimitiveType::MODEL_SPACE_POLYGONAL_LINE_LOOP_MITER_JOIN:
+        case PrimitiveType::MODEL_SPACE_POLYGONAL_LINE_STRIP_BEVEL_JOIN:
+        case PrimitiveType::MODEL_SPACE_POLYGONAL_LINE_STRIP_MITER_JOIN:
+        case PrimitiveType::MODEL_SPACE_POLYGONAL_LINES:
+        case PrimitiveType::POLYGONAL_LINE_LOOP_BEVEL_JOIN:
+        case PrimitiveType::POLYGONAL_LINE_LOOP_MITER_JOIN:
+        case PrimitiveType::POLYGONAL_LINE_STRIP_BEVEL_JOIN:
+        case PrimitiveType::POLYGONAL_LINE_STRIP_MITER_JOIN:
+        case PrimitiveType::POLYGONAL_LINES:
+        case PrimitiveType::SPHERES:
+            CaretAssertMessage(0, "Element indices are only supported for OpenGL primitive types");
+            CaretLogWarning("Element indices are only supported for OpenGL primitive types");
+            return;
+            break;
+    }
+    
+#ifndef NDEBUG
+    const uint32_t numberOfVertices = static_cast<uint32_t>(getNumberOfVertices());
+    for (const auto index : elementIndices) {
+        CaretAssert(index < numberOfVertices);
+    }
+#endif
+    
+    m_elementIndices = elementIndices;
+    m_boundingBoxValid = false;
+    
+    if (m_graphicsEngineDataForOpenGL != NULL) {
+        m_graphicsEngineDataForOpenGL->invalidateElementIndices();
+    }
+}
+
+/**
+ * @return Number of color streams (some may be empty).
+ */
+int32_t
+GraphicsPrimitive::getNumberOfColorStreams() const
+{
+    return m_colorStreams.size();
+}
+
+/**
+ * Replace the coloring in a color stream.  A color stream is byte RGBA
+ * coloring for all vertices that is used in place of the primitive's
+ * coloring when the color stream is active.  Only the range of vertices
+ * whose colors change is reloaded by the graphics engine.
+ *
+ * @param streamIndex
+ *     Index of the color stream, the color stream is created if needed.
+ * @param rgba
+ *     Float RGBA components ranging 0.0 to 1.0 for all vertices.
+ */
+void
+GraphicsPrimitive::replaceColorStreamFromFloatRGBA(const int32_t streamIndex,
+                                                   const float* rgba)
+{
+    CaretAssert(streamIndex >= 0);
+    CaretAssert(rgba);
+    
+    if (streamIndex >= static_cast<int32_t>(m_colorStreams.size())) {
+        m_colorStreams.resize(streamIndex + 1);
+    }
+    ColorStream& colorStream = m_colorStreams[streamIndex];
+    
+    const int32_t numberOfVertices = getNumberOfVertices();
+    const int32_t numberOfComponents = numberOfVertices * 4;
+    if (static_cast<int32_t>(colorStream.m_unsignedByteRGBA.size()) != numberOfComponents) {
+        colorStream.m_unsignedByteRGBA.resize(numberOfComponents);
+        colorStream.m_modifiedFirstVertex = 0;
+        colorStream.m_modifiedEndVertex   = numberOfVertices;
+    }
+    
+    int32_t firstModified = -1;
+    int32_t lastModified  = -1;
+    uint8_t* streamRGBA = colorStream.m_unsignedByteRGBA.data();
+    for (int32_t i = 0; i < numberOfComponents; i++) {
+        const float value = rgba[i];
+        uint8_t byteValue = 0;
+        if (value >= 1.0f) {
+            byteValue = 255;
+        }
+        else if (value > 0.0f) {
+            byteValue = static_cast<uint8_t>(value * 255.0f + 0.5f);
+        }
+        if (streamRGBA[i] != byteValue) {
+            streamRGBA[i] = byteValue;
+            const int32_t vertexIndex = i / 4;
+            if (firstModified < 0) {
+                firstModified = vertexIndex;
+            }
+            lastModified = vertexIndex;
+        }
+    }
+    
+    if (firstModified >= 0) {
+        if (colorStream.m_modifiedFirstVertex >= 0) {
+            colorStream.m_modifiedFirstVertex = std::min(colorStream.m_modifiedFirstVertex,
+                                                         firstModified);
+            colorStream.m_modifiedEndVertex   = std::max(colorStream.m_modifiedEndVertex,
+                                                         lastModified + 1);
+        }
+        else {
+            colorStream.m_modifiedFirstVertex = firstModified;
+            colorStream.m_modifiedEndVertex   = lastModified + 1;
+        }
+    }
+}
+
+/**
+ * Remove the coloring in a color stream to free its memory.
+ *
+ * @param streamIndex
+ *     Index of the color stream.
+ */
+void
+GraphicsPrimitive::removeColorStream(const int32_t streamIndex)
+{
+    if ((streamIndex >= 0)
+        && (streamIndex < static_cast<int32_t>(m_colorStreams.size()))) {
+        ColorStream& colorStream = m_colorStreams[streamIndex];
+        std::vector<uint8_t>().swap(colorStream.m_unsignedByteRGBA);
+        colorStream.m_modifiedFirstVertex = -1;
+        colorStream.m_modifiedEndVertex   = -1;
+    }
+}
+
+/**
+ * @return Index of the color stream used for drawing.  Negative
+ * indicates the primitive's coloring is used.
+ */
+int32_t
+GraphicsPrimitive::getActiveColorStream() const
+{
+    return m_activeColorStreamIndex;
+}
+
+/**
+ * Set the color stream used for drawing.  If the color stream is negative
+ * or empty, the primitive's coloring is used.
+ *
+ * @param streamIndex
+ *     Index of the color stream.
+ */
+void
+GraphicsPrimitive::setActiveColorStream(const int32_t streamIndex) const
+{
+    m_activeColorStreamIndex = streamIndex;
+}
+
 
 /**
  * There may be instances where a primitive should stop and restart at
@@ -2575,6 +2753,7 @@ GraphicsPrimitive::setOpenGLBuffersHaveBeenLoadedByGraphicsEngine()
             std::vector<float>().swap(m_floatNormalVectorXYZ);
             std::vector<uint8_t>().swap(m_unsignedByteRGBA);
             std::vector<float>().swap(m_floatTextureSTR);
+            std::vector<uint32_t>().swap(m_elementIndices);
             
             m_releaseInstanceDataMode = ReleaseInstanceDataMode::COMPLETED;
         }
@@ -461,6 +461,24 @@ namespace caret {
         
         void addPrimitiveRestart();
         
+        /**
+         * @return Indices of vertices for drawing with elements (empty if drawn with arrays)
+         */
+        const std::vector<uint32_t>& getElementIndices() const { return m_elementIndices; }
+        
+        void replaceElementIndices(const std::vector<uint32_t>& elementIndices);
+        
+        int32_t getNumberOfColorStreams() const;
+        
+        void replaceColorStreamFromFloatRGBA(const int32_t streamIndex,
+                                             const float* rgba);
+        
+        void removeColorStream(const int32_t streamIndex);
+        
+        int32_t getActiveColorStream() const;
+        
+        void setActiveColorStream(const int32_t streamIndex) const;
+        
         bool getDrawArrayIndicesSubset(int32_t& firstVertexIndexOut,
                                        int32_t& vertexCountOut) const;
         
@@ -584,6 +602,22 @@ namespace caret {
         int32_t m_triangleStripPrimitiveRestartIndex = -1;
         
     private:
+        /**
+         * Alternative byte coloring for all vertices.  Several colorings
+         * (such as one for each tab) share the coordinates and normals
+         * and only the modified range of vertices is reloaded.
+         */
+        class ColorStream {
+        public:
+            std::vector<uint8_t> m_unsignedByteRGBA;
+            
+            /** First vertex modified since loaded by graphics engine, negative if none */
+            int32_t m_modifiedFirstVertex = -1;
+            
+            /** One past the last vertex modified since loaded by graphics engine */
+            int32_t m_modifiedEndVertex = -1;
+        };
+        
         
         void copyHelperGraphicsPrimitive(const GraphicsPrimitive& obj);
         
@@ -612,6 +646,12 @@ namespace caret {
         
         std::vector<float> m_floatTextureSTR;
         
+        std::vector<uint32_t> m_elementIndices;
+        
+        std::vector<ColorStream> m_colorStreams;
+        
+        mutable int32_t m_activeColorStreamIndex = -1;
+        
         mutable float m_yMean = 0.0;
         
         mutable float m_yStandardDeviation = -1.0;
@@ -0,0 +1,391 @@
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2021 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#define __GRAPHICS_RENDER_PROFILER_DECLARE__
+#include "GraphicsRenderProfiler.h"
+#undef __GRAPHICS_RENDER_PROFILER_DECLARE__
+
+#include <algorithm>
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include "CaretAssert.h"
+
+using namespace caret;
+
+
+
+/**
+ * \class caret::GraphicsRenderProfiler
+ * \brief Accumulates timings of the stages of drawing
+ * \ingroup Graphics
+ *
+ * Stages are timed by placing a ScopedTimer on the stack at the start
+ * of the code that is timed.  Timings are accumulated by stage name, an
+ * optional detail name (typically the name of the file being drawn),
+ * and the index of the tab being drawn.  When a timer is created while
+ * another timer is active, the time of the inner timer is excluded from
+ * the 'self' time of the outer timer.
+ *
+ * When profiling is disabled, a ScopedTimer only tests a flag.
+ *
+ * Times are measured on the CPU and do not include time the
+ * graphics driver spends processing commands after they are issued.
+ * Profiling must only be used from the thread that performs drawing.
+ */
+
+/**
+ * Constructor.
+ */
+GraphicsRenderProfiler::GraphicsRenderProfiler()
+: CaretObject()
+{
+}
+
+/**
+ * Destructor.
+ */
+GraphicsRenderProfiler::~GraphicsRenderProfiler()
+{
+}
+
+/**
+ * Enable or disable profiling.  Timings are not cleared.
+ *
+ * @param enabled
+ *     New enabled status.
+ */
+void
+GraphicsRenderProfiler::setEnabled(const bool enabled)
+{
+    s_enabledFlag = enabled;
+}
+
+/**
+ * Remove all timings.
+ */
+void
+GraphicsRenderProfiler::reset()
+{
+    s_stageTimings.clear();
+}
+
+/**
+ * @return Number of frames that have been timed.
+ */
+int64_t
+GraphicsRenderProfiler::getNumberOfFrames()
+{
+    int64_t numFrames(0);
+    for (const auto& keyTiming : s_stageTimings) {
+        if (keyTiming.first.m_stageName == FRAME_STAGE_NAME) {
+            numFrames += keyTiming.second.m_count;
+        }
+    }
+    return numFrames;
+}
+
+/**
+ * @return All stage timings sorted by decreasing total time.
+ */
+std::vector<GraphicsRenderProfiler::StageTiming>
+GraphicsRenderProfiler::getStageTimings()
+{
+    std::vector<StageTiming> timings;
+    timings.reserve(s_stageTimings.size());
+    for (const auto& keyTiming : s_stageTimings) {
+        timings.push_back(keyTiming.second);
+    }
+
+    std::stable_sort(timings.begin(),
+                     timings.end(),
+                     [](const StageTiming& a, const StageTiming& b) { return (a.m_totalMilliseconds > b.m_totalMilliseconds); });
+    return timings;
+}
+
+/**
+ * @return The stage timings in an HTML table.
+ */
+AString
+GraphicsRenderProfiler::toHtmlTable()
+{
+    const int64_t numFrames(getNumberOfFrames());
+
+    AString html("<html>");
+    html.append("Frames: " + AString::number(numFrames) + "<br>");
+    html.append("Times are in milliseconds.  Self excludes time of stages timed within the stage.<br><br>");
+    html.append("<table border=\"1\" cellpadding=\"3\">");
+    html.append("<tr><th>Stage</th><th>Detail</th><th>Tab</th><th>Calls</th>"
+                "<th>Total</th><th>Self</th><th>Per Frame</th><th>Maximum</th></tr>");
+
+    for (const auto& timing : getStageTimings()) {
+        const double perFrame((numFrames > 0)
+                              ? (timing.m_totalMilliseconds / numFrames)
+                              : 0.0);
+        html.append("<tr>"
+                    "<td>" + timing.m_stageName.toHtmlEscaped() + "</td>"
+                    "<td>" + timing.m_detailName.toHtmlEscaped() + "</td>"
+                    "<td>" + ((timing.m_tabIndex >= 0)
+                              ? AString::number(timing.m_tabIndex + 1)
+                              : AString("")) + "</td>"
+                    "<td align=\"right\">" + AString::number(timing.m_count) + "</td>"
+                    "<td align=\"right\">" + AString::number(timing.m_totalMilliseconds, 'f', 3) + "</td>"
+                    "<td align=\"right\">" + AString::number(timing.m_selfMilliseconds, 'f', 3) + "</td>"
+                    "<td align=\"right\">" + AString::number(perFrame, 'f', 3) + "</td>"
+                    "<td align=\"right\">" + AString::number(timing.m_maximumMilliseconds, 'f', 3) + "</td>"
+                    "</tr>");
+    }
+
+    html.append("</table></html>");
+    return html;
+}
+
+/**
+ * @return The stage timings in JSON format.  Tab numbers start at one
+ * and are omitted for stages drawn outside of a tab.
+ */
+AString
+GraphicsRenderProfiler::toJson()
+{
+    const int64_t numFrames(getNumberOfFrames());
+
+    QJsonArray stagesArray;
+    for (const auto& timing : getStageTimings()) {
+        QJsonObject stageObject;
+        stageObject.insert("stage", timing.m_stageName);
+        if ( ! timing.m_detailName.isEmpty()) {
+            stageObject.insert("detail", timing.m_detailName);
+        }
+        if (timing.m_tabIndex >= 0) {
+            stageObject.insert("tab", timing.m_tabIndex + 1);
+        }
+        stageObject.insert("calls", static_cast<double>(timing.m_count));
+        stageObject.insert("totalMilliseconds", timing.m_totalMilliseconds);
+        stageObject.insert("selfMilliseconds", timing.m_selfMilliseconds);
+        stageObject.insert("maximumMilliseconds", timing.m_maximumMilliseconds);
+        if (numFrames > 0) {
+            stageObject.insert("perFrameMilliseconds", timing.m_totalMilliseconds / numFrames);
+        }
+        stagesArray.append(stageObject);
+    }
+
+    QJsonObject profileObject;
+    profileObject.insert("frames", static_cast<double>(numFrames));
+    profileObject.insert("stages", stagesArray);
+
+    return QJsonDocument(profileObject).toJson(QJsonDocument::Indented);
+}
+
+/**
+ * Write the stage timings in JSON format to a file.
+ *
+ * @param filename
+ *     Name of file.
+ * @param errorMessageOut
+ *     Contains error information if writing failed.
+ * @return
+ *     True if the file was written, else false.
+ */
+bool
+GraphicsRenderProfiler::writeJsonFile(const AString& filename,
+                                      AString& errorMessageOut)
+{
+    errorMessageOut.clear();
+
+    QFile file(filename);
+    if ( ! file.open(QFile::WriteOnly | QFile::Truncate)) {
+        errorMessageOut = ("Unable to open "
+                           + filename
+                           + " for writing render profile: "
+                           + file.errorString());
+        return false;
+    }
+
+    file.write(toJson().toUtf8());
+    file.close();
+
+    return true;
+}
+
+/**
+ * Add a timing for a stage.
+ *
+ * @param stageName
+ *     Name of the stage.
+ * @param detailName
+ *     Name of detail within the stage (may be empty).
+ * @param tabIndex
+ *     Index of tab (negative if not in a tab).
+ * @param totalMilliseconds
+ *     Time of the stage.
+ * @param selfMilliseconds
+ *     Time of the stage excluding stages timed within it.
+ */
+void
+GraphicsRenderProfiler::addTiming(const char* stageName,
+                                  const AString& detailName,
+                                  const int32_t tabIndex,
+                                  const double totalMilliseconds,
+                                  const double selfMilliseconds)
+{
+    const StageKey key(stageName,
+                       detailName,
+                       tabIndex);
+    auto iter = s_stageTimings.find(key);
+    if (iter == s_stageTimings.end()) {
+        StageTiming timing;
+        timing.m_stageName  = key.m_stageName;
+        timing.m_detailName = key.m_detailName;
+        timing.m_tabIndex   = key.m_tabIndex;
+        iter = s_stageTimings.insert(std::make_pair(key,
+                                                    timing)).first;
+    }
+
+    StageTiming& timing = iter->second;
+    timing.m_count++;
+    timing.m_totalMilliseconds += totalMilliseconds;
+    timing.m_selfMilliseconds  += selfMilliseconds;
+    timing.m_maximumMilliseconds = std::max(timing.m_maximumMilliseconds,
+                                            totalMilliseconds);
+}
+
+/**
+ * Get a description of this object's content.
+ * @return String describing this object's content.
+ */
+AString
+GraphicsRenderProfiler::toString() const
+{
+    return "GraphicsRenderProfiler";
+}
+
+/**
+ * @return True if this key is ordered before the other key.
+ * @param rhs
+ *     The other key.
+ */
+bool
+GraphicsRenderProfiler::StageKey::operator<(const StageKey& rhs) const
+{
+    if (m_stageName != rhs.m_stageName) {
+        return (m_stageName < rhs.m_stageName);
+    }
+    if (m_detailName != rhs.m_detailName) {
+        return (m_detailName < rhs.m_detailName);
+    }
+    return (m_tabIndex < rhs.m_tabIndex);
+}
+
+/**
+ * Constructor that starts timing a stage within the tab that is being drawn.
+ *
+ * @param stageName
+ *     Name of the stage.  Must be a string literal or otherwise outlive the timer.
+ */
+GraphicsRenderProfiler::ScopedTimer::ScopedTimer(const char* stageName)
+{
+    if (s_enabledFlag) {
+        start(stageName);
+    }
+}
+
+/**
+ * Constructor that starts timing a stage and sets the tab that is being
+ * drawn for this timer and any timers created while it exists.
+ *
+ * @param stageName
+ *     Name of the stage.  Must be a string literal or otherwise outlive the timer.
+ * @param tabIndex
+ *     Index of the tab.
+ */
+GraphicsRenderProfiler::ScopedTimer::ScopedTimer(const char* stageName,
+                                                 const int32_t tabIndex)
+{
+    if (s_enabledFlag) {
+        m_previousTabIndex = s_currentTabIndex;
+        m_tabIndexChangedFlag = true;
+        s_currentTabIndex = tabIndex;
+        start(stageName);
+    }
+}
+
+/**
+ * Destructor that records the time of the stage.
+ */
+GraphicsRenderProfiler::ScopedTimer::~ScopedTimer()
+{
+    if ( ! m_activeFlag) {
+        return;
+    }
+
+    const double milliseconds(m_timer.getElapsedTimeMilliseconds());
+
+    CaretAssert(s_currentTimer == this);
+    s_currentTimer = m_parentTimer;
+    if (m_parentTimer != NULL) {
+        m_parentTimer->m_childMilliseconds += milliseconds;
+    }
+
+    addTiming(m_stageName,
+              m_detailName,
+              s_currentTabIndex,
+              milliseconds,
+              std::max(milliseconds - m_childMilliseconds, 0.0));
+
+    if (m_tabIndexChangedFlag) {
+        s_currentTabIndex = m_previousTabIndex;
+    }
+}
+
+/**
+ * Set the detail name (typically name of file being drawn) for the stage.
+ * Ignored if the timer is not active.
+ *
+ * @param detailName
+ *     The detail name.
+ */
+void
+GraphicsRenderProfiler::ScopedTimer::setDetailName(const AString& detailName)
+{
+    if (m_activeFlag) {
+        m_detailName = detailName;
+    }
+}
+
+/**
+ * Start timing.
+ *
+ * @param stageName
+ *     Name of the stage.
+ */
+void
+GraphicsRenderProfiler::ScopedTimer::start(const char* stageName)
+{
+    CaretAssert(stageName);
+    m_activeFlag  = true;
+    m_stageName   = stageName;
+    m_parentTimer = s_currentTimer;
+    s_currentTimer = this;
+    m_timer.start();
+}
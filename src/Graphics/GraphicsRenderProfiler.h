@@ -0,0 +1,180 @@
+#ifndef __GRAPHICS_RENDER_PROFILER_H__
+#define __GRAPHICS_RENDER_PROFILER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2021 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+
+#include <map>
+#include <vector>
+
+#include "CaretObject.h"
+#include "ElapsedTimer.h"
+
+
+namespace caret {
+
+    class GraphicsRenderProfiler : public CaretObject {
+
+    public:
+        /**
+         * Times a stage of drawing from construction until destruction.
+         * Does nothing, other than test a flag, when profiling is disabled.
+         */
+        class ScopedTimer {
+        public:
+            ScopedTimer(const char* stageName);
+
+            ScopedTimer(const char* stageName,
+                        const int32_t tabIndex);
+
+            ~ScopedTimer();
+
+            ScopedTimer(const ScopedTimer&) = delete;
+
+            ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+            /**
+             * @return True if this timer is recording (profiling was enabled when it was created).
+             * Use to avoid creating a detail name when profiling is disabled.
+             */
+            inline bool isActive() const { return m_activeFlag; }
+
+            void setDetailName(const AString& detailName);
+
+        private:
+            void start(const char* stageName);
+
+            bool m_activeFlag = false;
+
+            const char* m_stageName = NULL;
+
+            AString m_detailName;
+
+            int32_t m_previousTabIndex = -1;
+
+            bool m_tabIndexChangedFlag = false;
+
+            ScopedTimer* m_parentTimer = NULL;
+
+            double m_childMilliseconds = 0.0;
+
+            ElapsedTimer m_timer;
+        };
+
+        /**
+         * Timings for one stage, detail, and tab
+         */
+        class StageTiming {
+        public:
+            AString m_stageName;
+
+            AString m_detailName;
+
+            int32_t m_tabIndex = -1;
+
+            int64_t m_count = 0;
+
+            double m_totalMilliseconds = 0.0;
+
+            double m_selfMilliseconds = 0.0;
+
+            double m_maximumMilliseconds = 0.0;
+        };
+
+        /** @return True if profiling is enabled */
+        static inline bool isEnabled() { return s_enabledFlag; }
+
+        static void setEnabled(const bool enabled);
+
+        static void reset();
+
+        static int64_t getNumberOfFrames();
+
+        static std::vector<StageTiming> getStageTimings();
+
+        static AString toHtmlTable();
+
+        static AString toJson();
+
+        static bool writeJsonFile(const AString& filename,
+                                  AString& errorMessageOut);
+
+        /** Name of stage that times each frame (all tabs in a window) */
+        static const char* FRAME_STAGE_NAME;
+
+        // ADD_NEW_METHODS_HERE
+
+        virtual AString toString() const;
+
+    private:
+        GraphicsRenderProfiler();
+
+        virtual ~GraphicsRenderProfiler();
+
+        GraphicsRenderProfiler(const GraphicsRenderProfiler&);
+
+        GraphicsRenderProfiler& operator=(const GraphicsRenderProfiler&);
+
+        static void addTiming(const char* stageName,
+                              const AString& detailName,
+                              const int32_t tabIndex,
+                              const double totalMilliseconds,
+                              const double selfMilliseconds);
+
+        /** Key for stage timings, ordered by stage, then detail, then tab */
+        class StageKey {
+        public:
+            StageKey(const AString& stageName,
+                     const AString& detailName,
+                     const int32_t tabIndex)
+            : m_stageName(stageName), m_detailName(detailName), m_tabIndex(tabIndex) { }
+
+            bool operator<(const StageKey& rhs) const;
+
+            AString m_stageName;
+
+            AString m_detailName;
+
+            int32_t m_tabIndex;
+        };
+
+        static bool s_enabledFlag;
+
+        static int32_t s_currentTabIndex;
+
+        static ScopedTimer* s_currentTimer;
+
+        static std::map<StageKey, StageTiming> s_stageTimings;
+
+        // ADD_NEW_MEMBERS_HERE
+
+    };
+
+#ifdef __GRAPHICS_RENDER_PROFILER_DECLARE__
+    const char* GraphicsRenderProfiler::FRAME_STAGE_NAME = "Frame";
+    bool GraphicsRenderProfiler::s_enabledFlag = false;
+    int32_t GraphicsRenderProfiler::s_currentTabIndex = -1;
+    GraphicsRenderProfiler::ScopedTimer* GraphicsRenderProfiler::s_currentTimer = NULL;
+    std::map<GraphicsRenderProfiler::StageKey, GraphicsRenderProfiler::StageTiming> GraphicsRenderProfiler::s_stageTimings;
+#endif // __GRAPHICS_RENDER_PROFILER_DECLARE__
+
+} // namespace
+#endif  //__GRAPHICS_RENDER_PROFILER_H__
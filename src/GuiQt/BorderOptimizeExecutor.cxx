@@ -765,7 +765,7 @@ BorderOptimizeExecutor::run(const InputData& inputData,
             CaretPointer<Border> redrawnSegment(new Border());
             for (int j = 1; j < (int)nodes.size() - 1; ++j)//drop the closest node to the start and end points from the redrawn segment
             {
-                const vector<int32_t>& nodeTiles = myTopoHelp->getNodeTiles(nodes[j]);
+                const TopologyIndexList nodeTiles = myTopoHelp->getNodeTiles(nodes[j]);
                 CaretAssert(!nodeTiles.empty());
                 const int32_t* tileNodes = drawSurf->getTriangle(nodeTiles[0]);
                 int whichNode;
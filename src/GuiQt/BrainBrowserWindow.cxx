@@ -93,6 +93,7 @@
 #include "FileInformation.h"
 #include "FociProjectionDialog.h"
 #include "GapsAndMargins.h"
+#include "GraphicsRenderProfiler.h"
 #include "GuiManager.h"
 #include "LockAspectWarningDialog.h"
 #include "ModelSurface.h"
@@ -1923,6 +1924,28 @@ BrainBrowserWindow::createActions()
                                 this,
                                 SLOT(processDevelopGraphicsTimingDuration()));
     
+    m_developerRenderProfilingAction = new QAction(this);
+    m_developerRenderProfilingAction->setCheckable(true);
+    m_developerRenderProfilingAction->setChecked(GraphicsRenderProfiler::isEnabled());
+    m_developerRenderProfilingAction->setText("Enable Render Profiling");
+    m_developerRenderProfilingAction->setToolTip("Time the stages of graphics drawing (coloring, annotations, text, etc.)");
+    QObject::connect(m_developerRenderProfilingAction, &QAction::toggled,
+                     this, &BrainBrowserWindow::processDevelopRenderProfilingToggled);
+    
+    m_developerShowRenderProfileAction =
+    WuQtUtilities::createAction("Show Render Profile...",
+                                "Show timings of the stages of graphics drawing",
+                                this,
+                                this,
+                                SLOT(processDevelopShowRenderProfile()));
+    
+    m_developerResetRenderProfileAction =
+    WuQtUtilities::createAction("Reset Render Profile",
+                                "Remove all timings of the stages of graphics drawing",
+                                this,
+                                this,
+                                SLOT(processDevelopResetRenderProfile()));
+    
     m_developerOpenMPTestingAction =
     WuQtUtilities::createAction("Test OpenMP...",
                                 "Test OpenMP with a parallel for loop",
@@ -2030,6 +2053,11 @@ BrainBrowserWindow::createMenuDevelop()
     menu->addAction(m_developerGraphicsTimingAction);
     menu->addAction(m_developerGraphicsTimingDurationAction);
     
+    menu->addSeparator();
+    menu->addAction(m_developerRenderProfilingAction);
+    menu->addAction(m_developerShowRenderProfileAction);
+    menu->addAction(m_developerResetRenderProfileAction);
+    
     return menu;
 }
 
@@ -2061,6 +2089,11 @@ BrainBrowserWindow::processParallelTest()
 void
 BrainBrowserWindow::developerMenuAboutToShow()
 {
+    /*
+     * Profiling is shared by all windows
+     */
+    QSignalBlocker blocker(m_developerRenderProfilingAction);
+    m_developerRenderProfilingAction->setChecked(GraphicsRenderProfiler::isEnabled());
 }
 
 /**
@@ -3109,6 +3142,40 @@ BrainBrowserWindow::processDevelopGraphicsTimingDuration()
     }
 }
 
+/**
+ * Called when render profiling is enabled or disabled.
+ *
+ * @param checked
+ *     New checked status.
+ */
+void
+BrainBrowserWindow::processDevelopRenderProfilingToggled(bool checked)
+{
+    GraphicsRenderProfiler::setEnabled(checked);
+}
+
+/**
+ * Show the timings of the stages of graphics drawing.
+ */
+void
+BrainBrowserWindow::processDevelopShowRenderProfile()
+{
+    WuQTextEditorDialog::runNonModal("Render Profile",
+                                     GraphicsRenderProfiler::toHtmlTable(),
+                                     WuQTextEditorDialog::TextMode::HTML,
+                                     WuQTextEditorDialog::WrapMode::NO,
+                                     this);
+}
+
+/**
+ * Remove the timings of the stages of graphics drawing.
+ */
+void
+BrainBrowserWindow::processDevelopResetRenderProfile()
+{
+    GraphicsRenderProfiler::reset();
+}
+
 /**
  * Test OpenMP
  */
@@ -248,6 +248,9 @@ namespace caret {
         
         void processDevelopGraphicsTiming();
         void processDevelopGraphicsTimingDuration();
+        void processDevelopRenderProfilingToggled(bool checked);
+        void processDevelopShowRenderProfile();
+        void processDevelopResetRenderProfile();
         void processDevelopOpenMPTesting();
 
         void processDevelopExportVtkFile();
@@ -446,6 +449,9 @@ namespace caret {
         QAction* m_developMenuAction;
         QAction* m_developerGraphicsTimingAction;
         QAction* m_developerGraphicsTimingDurationAction;
+        QAction* m_developerRenderProfilingAction;
+        QAction* m_developerShowRenderProfileAction;
+        QAction* m_developerResetRenderProfileAction;
         QAction* m_developerExportVtkFileAction;
         QAction* m_developerCziFileTransformTestingAction;
         QAction* m_developerOpenMPTestingAction;
@@ -884,7 +884,7 @@ GiftiLabelTableEditor::processApplyButton()
     if (m_caretMappableDataFile != NULL) {
         m_caretMappableDataFile->updateScalarColoringForMap(m_caretMappableDataFileMapIndex);
     }
-    EventManager::get()->sendEvent(EventSurfaceColoringInvalidate().getPointer());
+    EventManager::get()->sendEvent(EventSurfaceColoringInvalidate(m_caretMappableDataFile).getPointer());
     EventManager::get()->sendEvent(EventGraphicsPaintSoonAllWindows().getPointer());
     EventManager::get()->sendEvent(EventUserInterfaceUpdate().getPointer());
 }
@@ -142,7 +142,7 @@ MapSettingsColorBarPaletteOptionsWidget::applyOptions()
         }
     }
 
-    updateColoringAndGraphics();
+    updateColoringAndGraphics(false);
 }
 
 /**
@@ -178,15 +178,22 @@ MapSettingsColorBarPaletteOptionsWidget::applyToAllFilesToolButtonClicked()
             }
         }
         
-        updateColoringAndGraphics();
+        /*
+         * Palettes of other files may have changed
+         */
+        updateColoringAndGraphics(true);
     }
 }
 
 /**
  * Update coloring and graphics
+ *
+ * @param otherFilesModifiedFlag
+ *     True if palettes of files other than this widget's file may have
+ *     changed, so surface coloring of all files is invalidated.
  */
 void
-MapSettingsColorBarPaletteOptionsWidget::updateColoringAndGraphics()
+MapSettingsColorBarPaletteOptionsWidget::updateColoringAndGraphics(const bool otherFilesModifiedFlag)
 {
     if (m_applyToAllMapsCheckBox->isChecked()) {
         m_mapFile->updateScalarColoringForAllMaps();
@@ -194,7 +201,12 @@ MapSettingsColorBarPaletteOptionsWidget::updateColoringAndGraphics()
     else {
         m_mapFile->updateScalarColoringForMap(m_mapFileIndex);
     }
-    EventManager::get()->sendEvent(EventSurfaceColoringInvalidate().getPointer());
+    if (otherFilesModifiedFlag) {
+        EventManager::get()->sendEvent(EventSurfaceColoringInvalidate().getPointer());
+    }
+    else {
+        EventManager::get()->sendEvent(EventSurfaceColoringInvalidate(m_mapFile).getPointer());
+    }
     EventManager::get()->sendEvent(EventGraphicsPaintSoonAllWindows().getPointer());
 }
 
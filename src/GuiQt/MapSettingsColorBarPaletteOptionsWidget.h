@@ -61,7 +61,7 @@ namespace caret {
 
         MapSettingsColorBarPaletteOptionsWidget& operator=(const MapSettingsColorBarPaletteOptionsWidget&);
         
-        void updateColoringAndGraphics();
+        void updateColoringAndGraphics(const bool otherFilesModifiedFlag);
         
         QCheckBox* m_applyToAllMapsCheckBox;
         
@@ -165,7 +165,7 @@ MapSettingsLabelsWidget::applySelections()
                 labelProps->setOutlineColor(outlineColor);
                 labelProps->setDrawMedialWallFilled(m_drawMedialWallFilledCheckBox->isChecked());
                 
-                EventManager::get()->sendEvent(EventSurfaceColoringInvalidate().getPointer());
+                EventManager::get()->sendEvent(EventSurfaceColoringInvalidate(mapFile).getPointer());
                 EventManager::get()->sendEvent(EventGraphicsPaintSoonAllWindows().getPointer());
             }
         }
@@ -117,7 +117,7 @@ void
 MapSettingsParcelsWidget::parcelColorSelected(const CaretColorEnum::Enum color)
 {
     m_ciftiParcelFile->setSelectedParcelColor(color);
-    EventManager::get()->sendEvent(EventSurfaceColoringInvalidate().getPointer());
+    EventManager::get()->sendEvent(EventSurfaceColoringInvalidate(m_ciftiParcelFile).getPointer());
     EventManager::get()->sendEvent(EventGraphicsPaintSoonAllWindows().getPointer());
 }
 
@@ -129,6 +129,6 @@ MapSettingsParcelsWidget::ciftiParcelColoringModeEnumComboBoxItemActivated()
 {
     const CiftiParcelColoringModeEnum::Enum colorMode = m_parcelColoringModeEnumComboBox->getSelectedItem<CiftiParcelColoringModeEnum,CiftiParcelColoringModeEnum::Enum>();
     m_ciftiParcelFile->setSelectedParcelColoringMode(colorMode);
-    EventManager::get()->sendEvent(EventSurfaceColoringInvalidate().getPointer());
+    EventManager::get()->sendEvent(EventSurfaceColoringInvalidate(m_ciftiParcelFile).getPointer());
     EventManager::get()->sendEvent(EventGraphicsPaintSoonAllWindows().getPointer());
 }
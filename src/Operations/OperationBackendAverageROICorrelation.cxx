@@ -24,10 +24,13 @@
 #include "CaretOMP.h"
 #include "CaretPointer.h"
 #include "CiftiFile.h"
+#include "CorrelationHelper.h"
 #include "FileInformation.h"
 #include "OperationBackendAverageROICorrelation.h"
 #include "OperationException.h"
 
+#include <algorithm>
+#include <exception>
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -116,12 +119,50 @@ void OperationBackendAverageROICorrelation::useParameters(OperationParameters* m
             {
                 throw OperationException("error, cifti header of file #" + AString::number(i + 1) + " doesn't match");
             }
-            processCifti(ciftiList[i], indexList, rowScratch);
-            for (int k = 0; k < rowSize; ++k)
+        }
+        int numThreads = 1;
+#ifdef CARET_OMP
+        numThreads = omp_get_max_threads();
+#endif
+        //with enough subjects, give each thread whole subjects, so that many files are being read at once, otherwise parallelize within each subject
+        const bool subjectParallel = (numThreads > 1 && numCifti >= numThreads);
+        exception_ptr exPtr;
+        int exceptedFile = -1;
+#pragma omp CARET_PAR if(subjectParallel)
+        {
+            vector<float> myResult(rowSize);
+            vector<double> myAccum(rowSize, 0.0);//per thread, summed at the end
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int i = 0; i < numCifti; ++i)
+            {
+                if (exceptedFile > -1) continue;//"abort" the remaining subjects, "break" isn't allowed
+                try
+                {
+                    processCifti(ciftiList[i], indexList, myResult);
+                    for (int k = 0; k < rowSize; ++k)
+                    {
+                        myAccum[k] += myResult[k];
+                    }
+                } catch (...) {
+#pragma omp critical
+                    {
+                        if (exceptedFile < 0 || i < exceptedFile)
+                        {
+                            exceptedFile = i;
+                            exPtr = current_exception();
+                        }
+                    }
+                }
+            }
+#pragma omp critical
             {
-                accum[k] += rowScratch[k];
+                for (int k = 0; k < rowSize; ++k)
+                {
+                    accum[k] += myAccum[k];
+                }
             }
         }
+        if (exceptedFile > -1) rethrow_exception(exPtr);
         for (int k = 0; k < rowSize; ++k)
         {
             rowScratch[k] = accum[k] / numCifti / numStrings;
@@ -164,52 +205,26 @@ void OperationBackendAverageROICorrelation::processCifti(const CiftiFile* myCift
             accumarray[j] += average[j];
         }
     }
-    double accum = 0.0;
     for (int i = 0; i < rowSize; ++i)
     {
         average[i] = accumarray[i] / listSize;
-        accum += average[i];
-    }
-    float mean = accum / rowSize;
-    accum = 0.0;
-    for (int i = 0; i < rowSize; ++i)
-    {
-        average[i] -= mean;
-        accum += average[i] * average[i];
     }
-    float rrs = sqrt(accum);
-    int curRow = 0;
-#pragma omp CARET_PAR
+    CorrelationHelper::normalize(average.data(), rowSize);//only once per subject
+    const int BLOCK_ROWS = 256;
+    vector<vector<float> > rowBlock(min(BLOCK_ROWS, colSize), vector<float>(rowSize));
+    for (int blockStart = 0; blockStart < colSize; blockStart += BLOCK_ROWS)
     {
-        vector<float> rowscratch(rowSize);
-#pragma omp CARET_FOR schedule(dynamic)
-        for (int i = 0; i < colSize; ++i)
+        int blockEnd = min(colSize, blockStart + BLOCK_ROWS);
+        for (int i = blockStart; i < blockEnd; ++i)
+        {//force sequential reading, and never read multiple rows at once from the same file
+            myCifti->getRow(rowBlock[i - blockStart].data(), i);
+        }
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int i = blockStart; i < blockEnd; ++i)
         {
-            int myRow;
-#pragma omp critical
-            {
-                myRow = curRow;//force sequential reading
-                ++curRow;
-                myCifti->getRow(rowscratch.data(), myRow);//but never read multiple rows at once from the same file
-            }
-            double tempaccum = 0.0;//compute mean of new row
-            for (int j = 0; j < rowSize; ++j)
-            {
-                tempaccum += rowscratch[j];
-            }
-            float thismean = tempaccum / rowSize;
-            tempaccum = 0.0;
-            double corraccum = 0.0;//correlate
-            for (int j = 0; j < rowSize; ++j)
-            {
-                float tempf = rowscratch[j] - thismean;
-                tempaccum += tempf * tempf;//compute rrs on the fly
-                corraccum += tempf * average[j];//gather the correlation
-            }
-            corraccum /= rrs * sqrt(tempaccum);
-            if (corraccum > 0.999999) corraccum = 0.999999;
-            if (corraccum < -0.999999) corraccum = -0.999999;
-            output[i] = 0.5 * log((1 + corraccum) / (1 - corraccum));
+            float* rowscratch = rowBlock[i - blockStart].data();
+            CorrelationHelper::normalize(rowscratch, rowSize);
+            output[i] = CorrelationHelper::correlate(rowscratch, average.data(), rowSize, true);
         }
     }
 }
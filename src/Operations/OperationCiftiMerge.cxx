@@ -24,12 +24,15 @@
 #include "CaretAssert.h"
 #include "CaretPointer.h"
 #include "CaretCommandGlobalOptions.h"
+#include "CaretOMP.h"
 #include "CiftiFile.h"
 
 #include <algorithm>
 #include <vector>
 #include <utility>
 
+#include <QtConcurrent/QtConcurrent>
+
 using namespace caret;
 using namespace std;
 
@@ -402,7 +405,6 @@ void OperationCiftiMerge::useParameters(OperationParameters* myParams, ProgressO
     ciftiOut->setCiftiXML(outXML);
     if (direction == CiftiXML::ALONG_ROW)
     {
-        int64_t curRowIndex = 0;
         int64_t chunkRows = -1;//invalid value
         //checking first cifti for "in memory" should catch both -cifti-read-memory and possible future GUI-based operation
         int64_t numRows = 1;
@@ -416,7 +418,7 @@ void OperationCiftiMerge::useParameters(OperationParameters* myParams, ProgressO
         } else {
             if (memLimitGB > 0.0f)
             {
-                int64_t chunkMaxBytes = int64_t(memLimitGB * (1<<30));
+                int64_t chunkMaxBytes = int64_t(memLimitGB * (1<<30)) / 2;//two chunk buffers, so that writing can overlap reading
                 int64_t computeBytes = sizeof(float) * numRows * numOutIndices;
                 int64_t numPasses = (computeBytes - 1) / chunkMaxBytes + 1;
                 chunkRows = (numRows - 1) / numPasses + 1;
@@ -428,72 +430,145 @@ void OperationCiftiMerge::useParameters(OperationParameters* myParams, ProgressO
             }
         }
         CaretAssert(chunkRows > 0);
-        vector<vector<float> > outRows(chunkRows, vector<float>(numOutIndices));
-        vector<float> scratchRow(scratchRowLength);
-        auto outputIterator = ciftiOut->getIteratorOverRows(); //starts at beginning
+        vector<int64_t> fileStartIndex(numInputs + 1, 0);//where each file's columns start in the output row, so the files can be read in parallel
+        for (int i = 0; i < numInputs; ++i)
+        {
+            const CiftiXML& thisXML = myInputs[i]->getCifti(1)->getCiftiXML();
+            const vector<ParameterComponent*>& columnOpts = myInputs[i]->getRepeatableParameterInstances(2);
+            int64_t thisCount = 0;
+            if (columnOpts.empty())
+            {
+                thisCount = thisXML.getDimensionLength(CiftiXML::ALONG_ROW);
+            } else {
+                for (int j = 0; j < (int)columnOpts.size(); ++j)
+                {
+                    OptionalParameter* upToOpt = columnOpts[j]->getOptionalParameter(2);
+                    if (upToOpt->m_present)
+                    {
+                        thisCount += thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(upToOpt->getString(1)) -
+                                     thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(columnOpts[j]->getString(1)) + 1;
+                    } else {
+                        thisCount += 1;
+                    }
+                }
+            }
+            fileStartIndex[i + 1] = fileStartIndex[i] + thisCount;
+        }
+        CaretAssert(fileStartIndex[numInputs] == numOutIndices);
+        //double buffer: while one chunk is being written in the background, the inputs for the next chunk are read
+        vector<vector<float> > outRows[2] = { vector<vector<float> >(chunkRows, vector<float>(numOutIndices)), vector<vector<float> >() };
+        const bool pipelined = !firstCifti->isInMemory();//in-memory inputs use single-row chunks, where threading overhead would dominate
+        if (pipelined && numRows > chunkRows) outRows[1] = outRows[0];
+        auto outputIterator = ciftiOut->getIteratorOverRows(); //starts at beginning, only used by the writing thread
+        auto chunkIterator = outputIterator; //start of the chunk being read
+        QFuture<void> writeFuture;
+        exception_ptr writeExPtr;
+        int curBuffer = 0;
         for (int64_t chunkStart = 0; chunkStart < numRows; chunkStart += chunkRows)
         {
             int64_t chunkEnd = min(chunkStart + chunkRows, numRows);
-            int64_t chunkRowIndex = 0; //track position within the row, to update while looping through input files
-            for (int i = 0; i < numInputs; ++i)
+            vector<vector<float> >& chunkRowsOut = outRows[curBuffer];
+            //NOTE: each input file has its own file handle and its own part of the output rows, so the inputs can be read in parallel
+#pragma omp CARET_PAR if(pipelined) num_threads(min(4, omp_get_max_threads()))
             {
-                auto inputIterator = outputIterator; //start wherever we don't yet have output for
-                const CiftiFile* ciftiIn = myInputs[i]->getCifti(1);
-                const CiftiXML& thisXML = ciftiIn->getCiftiXML();
-                const vector<ParameterComponent*>& columnOpts = myInputs[i]->getRepeatableParameterInstances(2);
-                int numColumnOpts = (int)columnOpts.size();
-                for (int64_t chunkIndex = 0; chunkIndex < chunkEnd - chunkStart; ++chunkIndex)
+                vector<float> scratchRow(scratchRowLength);
+#pragma omp CARET_FOR schedule(dynamic)
+                for (int i = 0; i < numInputs; ++i)
                 {
-                    curRowIndex = chunkRowIndex;
-                    if (numColumnOpts > 0)
+                    if (exceptedFile > -1) continue;
+                    try
                     {
-                        auto inputSelect = *inputIterator;
-                        inputSelect.erase(inputSelect.begin() + (thisXML.getNumberOfDimensions() - 1), inputSelect.end()); //deal with files that are missing a dimension
-                        ciftiIn->getRow(scratchRow.data(), inputSelect); //get a row and...
-                        ++inputIterator; //advance
-                        for (int j = 0; j < numColumnOpts; ++j)
+                        auto inputIterator = chunkIterator; //start wherever we don't yet have output for
+                        const CiftiFile* ciftiIn = myInputs[i]->getCifti(1);
+                        const CiftiXML& thisXML = ciftiIn->getCiftiXML();
+                        const vector<ParameterComponent*>& columnOpts = myInputs[i]->getRepeatableParameterInstances(2);
+                        int numColumnOpts = (int)columnOpts.size();
+                        for (int64_t chunkIndex = 0; chunkIndex < chunkEnd - chunkStart; ++chunkIndex)
                         {
-                            int64_t initialRowIndex = thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(columnOpts[j]->getString(1));//this function has the 1-indexing convention built in
-                            OptionalParameter* upToOpt = columnOpts[j]->getOptionalParameter(2);//we already checked that these strings give a valid index
-                            if (upToOpt->m_present)
+                            int64_t curRowIndex = fileStartIndex[i];
+                            if (numColumnOpts > 0)
                             {
-                                int64_t finalRowIndex = thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(upToOpt->getString(1));//ditto
-                                bool reverse = upToOpt->getOptionalParameter(2)->m_present;
-                                if (reverse)
+                                auto inputSelect = *inputIterator;
+                                inputSelect.erase(inputSelect.begin() + (thisXML.getNumberOfDimensions() - 1), inputSelect.end()); //deal with files that are missing a dimension
+                                ciftiIn->getRow(scratchRow.data(), inputSelect); //get a row and...
+                                ++inputIterator; //advance
+                                for (int j = 0; j < numColumnOpts; ++j)
                                 {
-                                    for (int64_t c = finalRowIndex; c >= initialRowIndex; --c)
-                                    {
-                                        outRows[chunkIndex][curRowIndex] = scratchRow[c];
-                                        ++curRowIndex;
-                                    }
-                                } else {
-                                    for (int64_t c = initialRowIndex; c <= finalRowIndex; ++c)
+                                    int64_t initialRowIndex = thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(columnOpts[j]->getString(1));//this function has the 1-indexing convention built in
+                                    OptionalParameter* upToOpt = columnOpts[j]->getOptionalParameter(2);//we already checked that these strings give a valid index
+                                    if (upToOpt->m_present)
                                     {
-                                        outRows[chunkIndex][curRowIndex] = scratchRow[c];
+                                        int64_t finalRowIndex = thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(upToOpt->getString(1));//ditto
+                                        bool reverse = upToOpt->getOptionalParameter(2)->m_present;
+                                        if (reverse)
+                                        {
+                                            for (int64_t c = finalRowIndex; c >= initialRowIndex; --c)
+                                            {
+                                                chunkRowsOut[chunkIndex][curRowIndex] = scratchRow[c];
+                                                ++curRowIndex;
+                                            }
+                                        } else {
+                                            for (int64_t c = initialRowIndex; c <= finalRowIndex; ++c)
+                                            {
+                                                chunkRowsOut[chunkIndex][curRowIndex] = scratchRow[c];
+                                                ++curRowIndex;
+                                            }
+                                        }
+                                    } else {
+                                        chunkRowsOut[chunkIndex][curRowIndex] = scratchRow[initialRowIndex];
                                         ++curRowIndex;
                                     }
                                 }
                             } else {
-                                outRows[chunkIndex][curRowIndex] = scratchRow[initialRowIndex];
-                                ++curRowIndex;
+                                ciftiIn->getRow(chunkRowsOut[chunkIndex].data() + curRowIndex, *inputIterator); //get a row and...
+                                ++inputIterator; //advance
+                                curRowIndex += thisXML.getDimensionLength(CiftiXML::ALONG_ROW);
+                            }
+                            CaretAssert(curRowIndex == fileStartIndex[i + 1]);
+                        }
+                    } catch (...) {
+#pragma omp critical
+                        {
+                            if (exceptedFile < 0 || i < exceptedFile)
+                            {
+                                exceptedFile = i;
+                                exPtr = current_exception();
                             }
                         }
-                    } else {
-                        ciftiIn->getRow(outRows[chunkIndex].data() + curRowIndex, *inputIterator); //get a row and...
-                        ++inputIterator; //advance
-                        curRowIndex += thisXML.getDimensionLength(CiftiXML::ALONG_ROW);
                     }
                 }
-                chunkRowIndex = curRowIndex;//done with chunk for this file, update position within row for next file
             }
-            CaretAssert(curRowIndex == numOutIndices);
-            for (int64_t row = chunkStart; row < chunkEnd; ++row)
+            writeFuture.waitForFinished();//previous chunk must be written before we start writing this one
+            if (writeExPtr) rethrow_exception(writeExPtr);
+            if (exceptedFile > -1) rethrow_exception(exPtr);
+            for (int64_t chunkIndex = 0; chunkIndex < chunkEnd - chunkStart; ++chunkIndex)
             {
-                int64_t chunkIndex = row - chunkStart;
-                ciftiOut->setRow(outRows[chunkIndex].data(), *outputIterator); //set a row and...
-                ++outputIterator; //advance
+                ++chunkIterator;
+            }
+            auto writeChunk = [&, chunkStart, chunkEnd, curBuffer]()
+            {
+                try
+                {
+                    for (int64_t row = chunkStart; row < chunkEnd; ++row)
+                    {
+                        int64_t chunkIndex = row - chunkStart;
+                        ciftiOut->setRow(outRows[curBuffer][chunkIndex].data(), *outputIterator); //set a row and...
+                        ++outputIterator; //advance
+                    }
+                } catch (...) {
+                    writeExPtr = current_exception();
+                }
+            };
+            if (!outRows[1].empty())
+            {
+                writeFuture = QtConcurrent::run(writeChunk);
+                curBuffer = 1 - curBuffer;
+            } else {
+                writeChunk();//only one buffer, so it must be written before it is reused
             }
         }
+        writeFuture.waitForFinished();
+        if (writeExPtr) rethrow_exception(writeExPtr);
         CaretAssert(outputIterator.atEnd()); //make sure we wrote the whole file
     } else {
         int64_t fileMergeIndex = 0;
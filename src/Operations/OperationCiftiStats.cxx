@@ -21,6 +21,7 @@
 #include "OperationCiftiStats.h"
 #include "OperationException.h"
 
+#include "CaretOMP.h"
 #include "CiftiFile.h"
 #include "ReductionOperation.h"
 
@@ -50,10 +51,10 @@ OperationParameters* OperationCiftiStats::getParameters()
     
     ret->addCiftiParameter(1, "cifti-in", "the input cifti");
     
-    OptionalParameter* reduceOpt = ret->createOptionalParameter(2, "-reduce", "use a reduction operation");
+    ParameterComponent* reduceOpt = ret->createRepeatableParameter(2, "-reduce", "use a reduction operation");
     reduceOpt->addStringParameter(1, "operation", "the reduction operation");
     
-    OptionalParameter* percentileOpt = ret->createOptionalParameter(3, "-percentile", "give the value at a percentile");
+    ParameterComponent* percentileOpt = ret->createRepeatableParameter(3, "-percentile", "give the value at a percentile");
     percentileOpt->addDoubleParameter(1, "percent", "the percentile to find, must be between 0 and 100");
     
     OptionalParameter* columnOpt = ret->createOptionalParameter(4, "-column", "only display output for one column");
@@ -66,10 +67,12 @@ OperationParameters* OperationCiftiStats::getParameters()
     ret->createOptionalParameter(6, "-show-map-name", "print column index and name before each output");
     
     ret->setHelpText(
-        AString("For each column of the input, a line of text is printed, resulting from the specified reduction or percentile operation.  ") +
+        AString("For each column of the input, a line of text is printed, resulting from the specified reduction or percentile operations.  ") +
         "If -roi is specified without -match-maps, then each line will contain as many numbers as there are maps in the ROI file, separated by tab characters.  " +
         "Use -column to only give output for a single data column.  " +
-        "Exactly one of -reduce or -percentile must be specified.\n\n" +
+        "At least one -reduce or -percentile option must be specified.  " +
+        "If more than one is specified, all of them are computed from a single read of each column, and for each ROI map, the results of all -reduce options are printed in the order given, " +
+        "followed by the results of all -percentile options in the order given, separated by tab characters.\n\n" +
         "The argument to the -reduce option must be one of the following:\n\n" +
         ReductionOperation::getHelpInfo());
     return ret;
@@ -77,15 +80,13 @@ OperationParameters* OperationCiftiStats::getParameters()
 
 namespace
 {
-    float reduce(const vector<float>& data, const ReductionEnum::Enum& myop, const vector<float>& roiData)
+    void computeStats(const vector<float>& data, const vector<ReductionEnum::Enum>& myops, const vector<float>& percents, const float* roiData, float* resultsOut)
     {
-        if (roiData.empty())
+        const vector<float>* toUsePtr = &data;
+        vector<float> toUse;
+        if (roiData != NULL)
         {
-            return ReductionOperation::reduce(data.data(), data.size(), myop);
-        } else {
             int64_t numElems = (int64_t)data.size();
-            CaretAssert(numElems == (int64_t)roiData.size());
-            vector<float> toUse;
             toUse.reserve(numElems);
             for (int64_t i = 0; i < numElems; ++i)
             {
@@ -95,37 +96,10 @@ namespace
                 }
             }
             if (toUse.empty()) throw OperationException("roi column is empty");
-            return ReductionOperation::reduce(toUse.data(), toUse.size(), myop);
-        }
-    }
-    
-    float percentile(const vector<float>& data, const float& percent, const vector<float>& roiData)
-    {
-        CaretAssert(percent >= 0.0f && percent <= 100.0f);
-        vector<float> toUse;
-        if (roiData.empty())
-        {
-            toUse = data;
-        } else {
-            int64_t numElems = (int64_t)data.size();
-            CaretAssert(numElems == (int64_t)roiData.size());
-            toUse.reserve(numElems);
-            for (int i = 0; i < numElems; ++i)
-            {
-                if (roiData[i] > 0.0f)
-                {
-                    toUse.push_back(data[i]);
-                }
-            }
+            toUsePtr = &toUse;
         }
-        if (toUse.empty()) throw OperationException("roi is empty");
-        sort(toUse.begin(), toUse.end());
-        const float index = percent / 100.0f * (toUse.size() - 1);
-        if (index <= 0) return toUse[0];
-        if (index >= toUse.size() - 1) return toUse.back();
-        float ipart, fpart;
-        fpart = modf(index, &ipart);
-        return (1.0f - fpart) * toUse[(int)ipart] + fpart * toUse[((int)ipart) + 1];
+        if (!myops.empty()) ReductionOperation::reduceMultiple(toUsePtr->data(), toUsePtr->size(), myops, resultsOut);
+        if (!percents.empty()) ReductionOperation::percentiles(toUsePtr->data(), toUsePtr->size(), percents, resultsOut + myops.size());
     }
 }
 
@@ -137,25 +111,27 @@ void OperationCiftiStats::useParameters(OperationParameters* myParams, ProgressO
     if (myXML.getNumberOfDimensions() != 2) throw OperationException("only 2D cifti are supported in this command");
     int64_t numCols = myXML.getDimensionLength(CiftiXML::ALONG_ROW);
     int64_t colLength = myXML.getDimensionLength(CiftiXML::ALONG_COLUMN);
-    OptionalParameter* reduceOpt = myParams->getOptionalParameter(2);
-    OptionalParameter* percentileOpt = myParams->getOptionalParameter(3);
-    if (reduceOpt->m_present == percentileOpt->m_present)//use == as logical xor
+    const vector<ParameterComponent*>& reduceInstances = myParams->getRepeatableParameterInstances(2);
+    const vector<ParameterComponent*>& percentileInstances = myParams->getRepeatableParameterInstances(3);
+    if (reduceInstances.empty() && percentileInstances.empty())
     {
-        throw OperationException("you must use exactly one of -reduce or -percentile");
+        throw OperationException("you must use at least one of -reduce or -percentile");
     }
-    ReductionEnum::Enum myop = ReductionEnum::INVALID;
-    if (reduceOpt->m_present)
+    vector<ReductionEnum::Enum> myops;
+    for (int i = 0; i < (int)reduceInstances.size(); ++i)
     {
         bool ok = false;
-        myop = ReductionEnum::fromName(reduceOpt->getString(1), &ok);
-        if (!ok) throw OperationException("unrecognized reduction operation: " + reduceOpt->getString(1));
+        myops.push_back(ReductionEnum::fromName(reduceInstances[i]->getString(1), &ok));
+        if (!ok) throw OperationException("unrecognized reduction operation: " + reduceInstances[i]->getString(1));
     }
-    float percent = 0.0f;
-    if (percentileOpt->m_present)
+    vector<float> percents;
+    for (int i = 0; i < (int)percentileInstances.size(); ++i)
     {
-        percent = (float)percentileOpt->getDouble(1);//use not within range to trap NaNs, just in case
+        float percent = (float)percentileInstances[i]->getDouble(1);//use not within range to trap NaNs, just in case
         if (!(percent >= 0.0f && percent <= 100.0f)) throw OperationException("percentile must be between 0 and 100");
+        percents.push_back(percent);
     }
+    const int numStats = (int)(myops.size() + percents.size());
     int useColumn = -1;
     OptionalParameter* columnOpt = myParams->getOptionalParameter(4);
     if (columnOpt->m_present)
@@ -163,7 +139,6 @@ void OperationCiftiStats::useParameters(OperationParameters* myParams, ProgressO
         useColumn = columnOpt->getInteger(1) - 1;
         if (useColumn < 0 || useColumn >= numCols) throw OperationException("invalid column specified");
     }
-    vector<float> roiData;
     bool matchColumnMode = false;
     CiftiFile* roiCifti = NULL;
     int64_t numRois = 1;//trick: pretend we have 1 roi map when we don't have an roi file, for fewer special cases
@@ -175,7 +150,6 @@ void OperationCiftiStats::useParameters(OperationParameters* myParams, ProgressO
         {
             throw OperationException("roi cifti does not match input cifti along columns");
         }
-        roiData.resize(colLength);
         if (roiOpt->getOptionalParameter(2)->m_present)
         {
             if (myXML.getMap(CiftiXML::ALONG_ROW)->getLength() != roiCifti->getCiftiXML().getMap(CiftiXML::ALONG_ROW)->getLength())
@@ -188,7 +162,6 @@ void OperationCiftiStats::useParameters(OperationParameters* myParams, ProgressO
     }
     bool showMapName = myParams->getOptionalParameter(6)->m_present;
     const CiftiMappingType* rowMap = myXML.getMap(CiftiXML::ALONG_ROW);
-    vector<float> colScratch(colLength);
     int64_t columnStart, columnEnd;
     if (useColumn == -1)
     {
@@ -201,42 +174,61 @@ void OperationCiftiStats::useParameters(OperationParameters* myParams, ProgressO
         columnStart = useColumn;
         columnEnd = useColumn + 1;
     }
-    for (int i = columnStart; i < columnEnd; ++i)
+    vector<vector<float> > roiColumns;//without -match-maps, every data column uses every roi column, so only read them once
+    if (roiCifti != NULL && !matchColumnMode)
     {
-        myInput->getColumn(colScratch.data(), i);
-        if (showMapName)
+        roiColumns.resize(numRois, vector<float>(colLength));
+        for (int64_t j = 0; j < numRois; ++j)
         {
-            cout << AString::number(i + 1) << ":\t" << rowMap->getIndexName(i) << ":\t";
+            roiCifti->getColumn(roiColumns[j].data(), j);
         }
-        if (matchColumnMode)
-        {//trick: matchColumn is only true when we have an roi
-            roiCifti->getColumn(roiData.data(), i);
-            float result;
-            if (reduceOpt->m_present)
-            {
-                result = reduce(colScratch, myop, roiData);
-            } else {
-                CaretAssert(percentileOpt->m_present);
-                result = percentile(colScratch, percent, roiData);
-            }
-            stringstream resultsstr;
-            resultsstr << setprecision(7) << result;
-            cout << resultsstr.str() << endl;
-        } else {
-            for (int64_t j = 0; j < numRois; ++j)
+    }
+    const int64_t numOutRois = (matchColumnMode ? 1 : numRois);
+    const int64_t blockSize = 64;//file access isn't thread safe, so read a block of columns, compute in parallel, then print in order
+    vector<vector<float> > colScratch(blockSize, vector<float>(colLength)), matchRoiScratch, results(blockSize, vector<float>(numOutRois * numStats));
+    if (matchColumnMode) matchRoiScratch.resize(blockSize, vector<float>(colLength));
+    for (int64_t blockStart = columnStart; blockStart < columnEnd; blockStart += blockSize)
+    {
+        const int64_t blockEnd = min(columnEnd, blockStart + blockSize);
+        for (int64_t i = blockStart; i < blockEnd; ++i)
+        {
+            myInput->getColumn(colScratch[i - blockStart].data(), i);
+            if (matchColumnMode) roiCifti->getColumn(matchRoiScratch[i - blockStart].data(), i);//trick: matchColumn is only true when we have an roi
+        }
+        vector<AString> columnErrors(blockEnd - blockStart);//keep errors per column, so the columns before the bad one still get printed
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int64_t i = blockStart; i < blockEnd; ++i)
+        {
+            try
             {
-                if (roiCifti != NULL) roiCifti->getColumn(roiData.data(), j);
-                float result;
-                if (reduceOpt->m_present)
+                for (int64_t j = 0; j < numOutRois; ++j)
                 {
-                    result = reduce(colScratch, myop, roiData);
-                } else {
-                    CaretAssert(percentileOpt->m_present);
-                    result = percentile(colScratch, percent, roiData);
+                    const float* roiData = NULL;
+                    if (matchColumnMode)
+                    {
+                        roiData = matchRoiScratch[i - blockStart].data();
+                    } else if (roiCifti != NULL) {
+                        roiData = roiColumns[j].data();
+                    }
+                    computeStats(colScratch[i - blockStart], myops, percents, roiData, results[i - blockStart].data() + j * numStats);
                 }
+            } catch (CaretException& e) {
+                columnErrors[i - blockStart] = e.whatString();
+            }
+        }
+        for (int64_t i = blockStart; i < blockEnd; ++i)
+        {
+            if (columnErrors[i - blockStart] != "") throw OperationException(columnErrors[i - blockStart]);
+            if (showMapName)
+            {
+                cout << AString::number(i + 1) << ":\t" << rowMap->getIndexName(i) << ":\t";
+            }
+            const vector<float>& colResults = results[i - blockStart];
+            for (int64_t k = 0; k < (int64_t)colResults.size(); ++k)
+            {
                 stringstream resultsstr;
-                resultsstr << setprecision(7) << result;
-                if (j != 0) cout << "\t";
+                resultsstr << setprecision(7) << colResults[k];
+                if (k != 0) cout << "\t";
                 cout << resultsstr.str();
             }
             cout << endl;
@@ -64,9 +64,12 @@ OperationParameters* OperationConvertMatrix4ToWorkbenchSparse::getParameters()
     volumeOpt->addCiftiParameter(1, "cifti-template", "cifti file to use the volume mappings from");
     volumeOpt->addStringParameter(2, "direction", "dimension along the cifti file to take the mapping from, ROW or COLUMN");
     
+    ret->createOptionalParameter(9, "-compressed", "write the compressed (version 2) wbsparse format");
+    
     ret->setHelpText(
         AString("Converts the matrix 4 output of probtrackx to workbench sparse file format.  ") +
-        "Exactly one of -surface-seeds and -volume-seeds must be specified."
+        "Exactly one of -surface-seeds and -volume-seeds must be specified.  " +
+        "The -compressed option writes rows in compressed blocks, which is much smaller on disk, and can only be read by newer versions of workbench."
     );
     return ret;
 }
@@ -180,7 +183,7 @@ void OperationConvertMatrix4ToWorkbenchSparse::useParameters(OperationParameters
             rowReorder[i / 3] = tempInd;
         }
     }
-    CaretSparseFileWriter mywriter(outFileName, myXML);//NOTE: CaretSparseFile has a different encoding of fibers, ALWAYS use getFibersRow, etc
+    CaretSparseFileWriter mywriter(outFileName, myXML, myParams->getOptionalParameter(9)->m_present);//NOTE: CaretSparseFile has a different encoding of fibers, ALWAYS use getFibersRow, etc
     vector<int64_t> indicesIn, indicesOut;//this method knows about sparseness, does sorting of indexes in order to avoid scanning full rows
     vector<FiberFractions> fibersIn, fibersOut;//can be slower if matrix isn't very sparse, but that is a problem for other reasons anyway
     CaretMinHeap<FiberFractions, int64_t> myHeap;//use our heap to do heapsort, rather than coding a struct for stl sort
@@ -50,10 +50,10 @@ OperationParameters* OperationMetricStats::getParameters()
     
     ret->addMetricParameter(1, "metric-in", "the input metric");
     
-    OptionalParameter* reduceOpt = ret->createOptionalParameter(2, "-reduce", "use a reduction operation");
+    ParameterComponent* reduceOpt = ret->createRepeatableParameter(2, "-reduce", "use a reduction operation");
     reduceOpt->addStringParameter(1, "operation", "the reduction operation");
     
-    OptionalParameter* percentileOpt = ret->createOptionalParameter(3, "-percentile", "give the value at a percentile");
+    ParameterComponent* percentileOpt = ret->createRepeatableParameter(3, "-percentile", "give the value at a percentile");
     percentileOpt->addDoubleParameter(1, "percent", "the percentile to find, must be between 0 and 100");
     
     OptionalParameter* columnOpt = ret->createOptionalParameter(4, "-column", "only display output for one column");
@@ -66,10 +66,12 @@ OperationParameters* OperationMetricStats::getParameters()
     ret->createOptionalParameter(6, "-show-map-name", "print map index and name before each output");
     
     ret->setHelpText(
-        AString("For each column of the input, a line of text is printed, resulting from the specified reduction or percentile operation.  ") +
+        AString("For each column of the input, a line of text is printed, resulting from the specified reduction or percentile operations.  ") +
         "Use -column to only give output for a single column.  " +
         "If the -roi option is used without -match-maps, then each line will contain as many numbers as there are maps in the ROI file, separated by tab characters.  " +
-        "Exactly one of -reduce or -percentile must be specified.\n\n" +
+        "At least one -reduce or -percentile option must be specified.  " +
+        "If more than one is specified, for each ROI map, the results of all -reduce options are printed in the order given, " +
+        "followed by the results of all -percentile options in the order given, separated by tab characters.\n\n" +
         "The argument to the -reduce option must be one of the following:\n\n" +
         ReductionOperation::getHelpInfo());
     return ret;
@@ -77,15 +79,15 @@ OperationParameters* OperationMetricStats::getParameters()
 
 namespace
 {
-    float reduce(const float* data, const int& numNodes, const ReductionEnum::Enum& myop, const float* roiData)
+    void computeStats(const float* data, const int& numElements, const vector<ReductionEnum::Enum>& myops, const vector<float>& percents, const float* roiData, float* resultsOut)
     {
-        if (roiData == NULL)
+        const float* toUsePtr = data;
+        int64_t toUseSize = numElements;
+        vector<float> toUse;
+        if (roiData != NULL)
         {
-            return ReductionOperation::reduce(data, numNodes, myop);
-        } else {
-            vector<float> toUse;
-            toUse.reserve(numNodes);
-            for (int i = 0; i < numNodes; ++i)
+            toUse.reserve(numElements);
+            for (int i = 0; i < numElements; ++i)
             {
                 if (roiData[i] > 0.0f)
                 {
@@ -93,35 +95,22 @@ namespace
                 }
             }
             if (toUse.empty()) throw OperationException("roi contains no vertices");
-            return ReductionOperation::reduce(toUse.data(), toUse.size(), myop);
+            toUsePtr = toUse.data();
+            toUseSize = toUse.size();
         }
+        if (!myops.empty()) ReductionOperation::reduceMultiple(toUsePtr, toUseSize, myops, resultsOut);
+        if (!percents.empty()) ReductionOperation::percentiles(toUsePtr, toUseSize, percents, resultsOut + myops.size());
     }
     
-    float percentile(const float* data, const int& numNodes, const float& percent, const float* roiData)
+    void printStats(const vector<float>& results)
     {
-        CaretAssert(percent >= 0.0f && percent <= 100.0f);
-        vector<float> toUse;
-        if (roiData == NULL)
+        for (int k = 0; k < (int)results.size(); ++k)
         {
-            toUse = vector<float>(data, data + numNodes);
-        } else {
-            toUse.reserve(numNodes);
-            for (int i = 0; i < numNodes; ++i)
-            {
-                if (roiData[i] > 0.0f)
-                {
-                    toUse.push_back(data[i]);
-                }
-            }
+            stringstream resultsstr;
+            resultsstr << setprecision(7) << results[k];
+            if (k != 0) cout << "\t";
+            cout << resultsstr.str();
         }
-        if (toUse.empty()) throw OperationException("roi contains no vertices");
-        sort(toUse.begin(), toUse.end());
-        const float index = percent / 100.0f * (toUse.size() - 1);
-        if (index <= 0) return toUse[0];
-        if (index >= toUse.size() - 1) return toUse.back();
-        float ipart, fpart;
-        fpart = modf(index, &ipart);
-        return (1.0f - fpart) * toUse[(int)ipart] + fpart * toUse[((int)ipart) + 1];
     }
 }
 
@@ -131,25 +120,27 @@ void OperationMetricStats::useParameters(OperationParameters* myParams, Progress
     MetricFile* input = myParams->getMetric(1);
     int numNodes = input->getNumberOfNodes();
     int numCols = input->getNumberOfColumns();
-    OptionalParameter* reduceOpt = myParams->getOptionalParameter(2);
-    OptionalParameter* percentileOpt = myParams->getOptionalParameter(3);
-    if (reduceOpt->m_present == percentileOpt->m_present)//use == as logical xor
+    const vector<ParameterComponent*>& reduceInstances = myParams->getRepeatableParameterInstances(2);
+    const vector<ParameterComponent*>& percentileInstances = myParams->getRepeatableParameterInstances(3);
+    if (reduceInstances.empty() && percentileInstances.empty())
     {
-        throw OperationException("you must use exactly one of -reduce or -percentile");
+        throw OperationException("you must use at least one of -reduce or -percentile");
     }
-    ReductionEnum::Enum myop = ReductionEnum::INVALID;
-    if (reduceOpt->m_present)
+    vector<ReductionEnum::Enum> myops;
+    for (int i = 0; i < (int)reduceInstances.size(); ++i)
     {
         bool ok = false;
-        myop = ReductionEnum::fromName(reduceOpt->getString(1), &ok);
-        if (!ok) throw OperationException("unrecognized reduction operation: " + reduceOpt->getString(1));
+        myops.push_back(ReductionEnum::fromName(reduceInstances[i]->getString(1), &ok));
+        if (!ok) throw OperationException("unrecognized reduction operation: " + reduceInstances[i]->getString(1));
     }
-    float percent = 0.0f;
-    if (percentileOpt->m_present)
+    vector<float> percents;
+    for (int i = 0; i < (int)percentileInstances.size(); ++i)
     {
-        percent = (float)percentileOpt->getDouble(1);//use not within range to trap NaNs, just in case
+        float percent = (float)percentileInstances[i]->getDouble(1);//use not within range to trap NaNs, just in case
         if (!(percent >= 0.0f && percent <= 100.0f)) throw OperationException("percentile must be between 0 and 100");
+        percents.push_back(percent);
     }
+    vector<float> results(myops.size() + percents.size());
     int column = -1;
     OptionalParameter* columnOpt = myParams->getOptionalParameter(4);
     if (columnOpt->m_present)
@@ -192,34 +183,16 @@ void OperationMetricStats::useParameters(OperationParameters* myParams, Progress
         if (matchColumnMode)
         {//trick: matchColumn is only true when we have an roi
             const float* roiData = myRoi->getValuePointerForColumn(i);
-            float result;
-            if (reduceOpt->m_present)
-            {
-                result = reduce(input->getValuePointerForColumn(i), numNodes, myop, roiData);
-            } else {
-                CaretAssert(percentileOpt->m_present);
-                result = percentile(input->getValuePointerForColumn(i), numNodes, percent, roiData);
-            }
-            stringstream resultsstr;
-            resultsstr << setprecision(7) << result;
-            cout << resultsstr.str();
+            computeStats(input->getValuePointerForColumn(i), numNodes, myops, percents, roiData, results.data());
+            printStats(results);
         } else {
             for (int j = 0; j < numRoiCols; ++j)
             {
                 const float* roiData = NULL;
                 if (myRoi != NULL) roiData = myRoi->getValuePointerForColumn(j);
-                float result;
-                if (reduceOpt->m_present)
-                {
-                    result = reduce(input->getValuePointerForColumn(i), numNodes, myop, roiData);
-                } else {
-                    CaretAssert(percentileOpt->m_present);
-                    result = percentile(input->getValuePointerForColumn(i), numNodes, percent, roiData);
-                }
-                stringstream resultsstr;
-                resultsstr << setprecision(7) << result;
+                computeStats(input->getValuePointerForColumn(i), numNodes, myops, percents, roiData, results.data());
                 if (j != 0) cout << "\t";
-                cout << resultsstr.str();
+                printStats(results);
             }
         }
         cout << endl;
@@ -34,6 +34,8 @@
 #include <QImage>
 #include <QColor>
 
+#include <QtConcurrent/QtConcurrent>
+
 
 #include "Brain.h"
 #include "BrainOpenGLFixedPipeline.h"
@@ -52,6 +54,7 @@
 #include "FileInformation.h"
 #include "DummyFontTextRenderer.h"
 #include "FtglFontTextRenderer.h"
+#include "GraphicsRenderProfiler.h"
 #include "ImageFile.h"
 #include "MapYokingGroupEnum.h"
 #include "OperationShowScene.h"
@@ -71,6 +74,34 @@
 
 using namespace caret;
 
+namespace {
+    /**
+     * Maximum number of images that may be waiting to be written.  Each
+     * pending image holds a copy of the rendered image so limit the
+     * number to avoid excessive memory use with large images.
+     */
+    const int32_t MAXIMUM_PENDING_IMAGE_WRITES = 4;
+    
+    /**
+     * Waits for any images still being written when it goes out of
+     * scope, such as when an exception is thrown during rendering,
+     * so that no image is being written when the operation returns.
+     */
+    class ImageWriteFuturesWaiter {
+    public:
+        ImageWriteFuturesWaiter(std::vector<QFuture<AString>>& imageWriteFutures)
+        : m_imageWriteFutures(imageWriteFutures) { }
+        
+        ~ImageWriteFuturesWaiter() {
+            for (auto& f : m_imageWriteFutures) {
+                f.waitForFinished();
+            }
+        }
+    private:
+        std::vector<QFuture<AString>>& m_imageWriteFutures;
+    };
+}
+
 /**
  *  @return A message indicating that the command is not available due to lack of Mesa3D library
  */
@@ -143,6 +174,9 @@ OperationShowScene::getParameters()
     connDbOpt->addStringParameter(1, "Username", "Connectome DB Username");
     connDbOpt->addStringParameter(2, "Password", "Connectome DB Password");
     
+    OptionalParameter* renderProfileOpt = ret->createOptionalParameter(10, "-render-profile", "Write timings of the drawing stages to a JSON file");
+    renderProfileOpt->addStringParameter(1, "json-file", "output JSON file name");
+    
     AString helpText("DEPRECATED: this command may be removed in a future release, use -scene-capture-image.\n\n"
                      "Render content of browser windows displayed in a scene "
                      "into image file(s).  The image file name should be "
@@ -158,6 +192,11 @@ OperationShowScene::getParameters()
                      "the username and password stored in the user's preferences\n"
                      "is used.\n"
                      "\n"
+                     "The \"-render-profile\" option times the stages of drawing\n"
+                     "(surface coloring, volume slice coloring, annotations, text,\n"
+                     "loading of graphics buffers, etc.) by tab and by file and\n"
+                     "writes the timings to a JSON file.\n"
+                     "\n"
                      "The image format is determined by the image file extension.\n"
                      "The available image formats may vary by operating system.\n"
                      "Image formats available on this system are:\n"
@@ -287,6 +326,12 @@ OperationShowScene::useParameters(OperationParameters* myParams,
     CaretDataFile::setFileReadingUsernameAndPassword(username,
                                                      password);
 
+    AString renderProfileFileName;
+    OptionalParameter* renderProfileOpt = myParams->getOptionalParameter(10);
+    if (renderProfileOpt->m_present) {
+        renderProfileFileName = FileInformation(renderProfileOpt->getString(1)).getAbsoluteFilePath();
+    }
+
     /*
      * Read the scene file and load the scene
      */
@@ -383,6 +428,20 @@ OperationShowScene::useParameters(OperationParameters* myParams,
         throw OperationException("No BrowserWindowContent was found for showing as scene");
     }
     
+    /*
+     * Futures for images that are written by other threads
+     */
+    std::vector<QFuture<AString>> imageWriteFutures;
+    ImageWriteFuturesWaiter imageWriteFuturesWaiter(imageWriteFutures);
+    
+    /*
+     * Only drawing is profiled, not loading of the scene
+     */
+    if ( ! renderProfileFileName.isEmpty()) {
+        GraphicsRenderProfiler::reset();
+        GraphicsRenderProfiler::setEnabled(true);
+    }
+    
     /*
      * Restore windows
      */
@@ -475,7 +534,7 @@ OperationShowScene::useParameters(OperationParameters* myParams,
         //
         // Allocate image buffer
         //
-        const int32_t imageBufferSize =imageWidth * imageHeight * 4 * sizeof(unsigned char);
+        const int64_t imageBufferSize = static_cast<int64_t>(imageWidth) * imageHeight * 4 * sizeof(unsigned char);
         unsigned char* imageBuffer = new unsigned char[imageBufferSize];
         if (imageBuffer == 0) {
             throw OperationException("Allocating image buffer size="
@@ -601,7 +660,8 @@ OperationShowScene::useParameters(OperationParameters* myParams,
                                outputImageIndex,
                                imageBuffer,
                                imageWidth,
-                               imageHeight);
+                               imageHeight,
+                               imageWriteFutures);
                     
                     for (std::vector<BrainOpenGLViewportContent*>::iterator vpIter = viewports.begin();
                          vpIter != viewports.end();
@@ -662,7 +722,8 @@ OperationShowScene::useParameters(OperationParameters* myParams,
                        outputImageIndex,
                        imageBuffer,
                        imageWidth,
-                       imageHeight);
+                       imageHeight,
+                       imageWriteFutures);
         }
         
         /*
@@ -672,6 +733,21 @@ OperationShowScene::useParameters(OperationParameters* myParams,
         OSMesaDestroyContext(mesaContext);
     }
     
+    /*
+     * Images are encoded and written on other threads
+     * while any remaining windows are rendered
+     */
+    waitForImageWrites(imageWriteFutures);
+    
+    if ( ! renderProfileFileName.isEmpty()) {
+        GraphicsRenderProfiler::setEnabled(false);
+        AString errorMessage;
+        if ( ! GraphicsRenderProfiler::writeJsonFile(renderProfileFileName,
+                                                     errorMessage)) {
+            throw OperationException(errorMessage);
+        }
+    }
+    
     /*
      * Print error messages
      */
@@ -878,13 +954,20 @@ OperationShowScene::createBrainOpenGL()
  *     width of image.
  * @param imageHeight
  *     height of image.
+ * @param imageWriteFuturesOut
+ *     Output containing future for the image being written in the background.
+ *     If the maximum number of images are waiting to be written, waits for
+ *     the oldest image to finish writing.
+ * @throw OperationException
+ *     If writing of an earlier image failed.
  */
 void
 OperationShowScene::writeImage(const AString& imageFileName,
                                const int32_t imageIndex,
                                const unsigned char* imageContent,
                                const int32_t imageWidth,
-                               const int32_t imageHeight)
+                               const int32_t imageHeight,
+                               std::vector<QFuture<AString>>& imageWriteFuturesOut)
 {
     /*
      * Create name of image
@@ -906,15 +989,83 @@ OperationShowScene::writeImage(const AString& imageFileName,
         }
     }
     
+    /*
+     * Limit the number of images waiting to be written
+     */
+    while (static_cast<int32_t>(imageWriteFuturesOut.size()) >= MAXIMUM_PENDING_IMAGE_WRITES) {
+        QFuture<AString> oldestFuture = imageWriteFuturesOut.front();
+        imageWriteFuturesOut.erase(imageWriteFuturesOut.begin());
+        oldestFuture.waitForFinished();
+        const AString errorMessage = oldestFuture.result();
+        if ( ! errorMessage.isEmpty()) {
+            throw OperationException(errorMessage);
+        }
+    }
+    
+    /*
+     * The image file copies the content so that the caller may
+     * reuse or delete the rendering buffer while the image file
+     * is encoded and written on another thread.
+     */
+    ImageFile* imageFile = new ImageFile(imageContent,
+                                         imageWidth,
+                                         imageHeight,
+                                         ImageFile::IMAGE_DATA_ORIGIN_AT_BOTTOM);
+    imageWriteFuturesOut.push_back(QtConcurrent::run(&OperationShowScene::writeImageFileInBackground,
+                                                     imageFile,
+                                                     AString(outputName)));
+}
+
+/**
+ * Write an image file.  Called on a thread other than the rendering thread.
+ *
+ * @param imageFile
+ *     Image file that is written and then deleted.
+ * @param outputName
+ *     Name for the image file.
+ * @return
+ *     Empty string if successful, else an error message.
+ */
+AString
+OperationShowScene::writeImageFileInBackground(ImageFile* imageFile,
+                                               const AString outputName)
+{
+    CaretAssert(imageFile);
+    AString errorMessage;
     try {
-        ImageFile imageFile(imageContent,
-                            imageWidth,
-                            imageHeight,
-                            ImageFile::IMAGE_DATA_ORIGIN_AT_BOTTOM);
-        imageFile.writeFile(outputName);
+        imageFile->writeFile(outputName);
     }
     catch (const DataFileException& dfe) {
-        throw OperationException(dfe);
+        errorMessage = dfe.whatString();
+    }
+    delete imageFile;
+    
+    return errorMessage;
+}
+
+/**
+ * Wait for all images being written on other threads to finish.
+ *
+ * @param imageWriteFutures
+ *     Futures for the images being written.
+ * @throw OperationException
+ *     If writing any of the images failed.
+ */
+void
+OperationShowScene::waitForImageWrites(std::vector<QFuture<AString>>& imageWriteFutures)
+{
+    AString errorMessage;
+    for (auto& f : imageWriteFutures) {
+        f.waitForFinished();
+        const AString msg = f.result();
+        if ( ! msg.isEmpty()) {
+            errorMessage.appendWithNewLine(msg);
+        }
+    }
+    imageWriteFutures.clear();
+    
+    if ( ! errorMessage.isEmpty()) {
+        throw OperationException(errorMessage);
     }
 }
 
@@ -22,11 +22,14 @@
 /*LICENSE_END*/
 
 
+#include <QFuture>
+
 #include "AbstractOperation.h"
 
 namespace caret {
 
     class BrainOpenGLFixedPipeline;
+    class ImageFile;
     
     class OperationShowScene : public AbstractOperation {
 
@@ -51,7 +54,13 @@ namespace caret {
                                   const int32_t imageIndex,
                                   const unsigned char* imageContent,
                                   const int32_t imageWidth,
-                                  const int32_t imageHeight);
+                                  const int32_t imageHeight,
+                                  std::vector<QFuture<AString>>& imageWriteFuturesOut);
+        
+        static AString writeImageFileInBackground(ImageFile* imageFile,
+                                                  const AString outputName);
+        
+        static void waitForImageWrites(std::vector<QFuture<AString>>& imageWriteFutures);
         
         static void estimateGraphicsSize(const SceneClass* windowSceneClass,
                                          float& estimatedWidthOut,
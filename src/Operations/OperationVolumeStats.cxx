@@ -50,10 +50,10 @@ OperationParameters* OperationVolumeStats::getParameters()
     
     ret->addVolumeParameter(1, "volume-in", "the input volume");
     
-    OptionalParameter* reduceOpt = ret->createOptionalParameter(2, "-reduce", "use a reduction operation");
+    ParameterComponent* reduceOpt = ret->createRepeatableParameter(2, "-reduce", "use a reduction operation");
     reduceOpt->addStringParameter(1, "operation", "the reduction operation");
     
-    OptionalParameter* percentileOpt = ret->createOptionalParameter(3, "-percentile", "give the value at a percentile");
+    ParameterComponent* percentileOpt = ret->createRepeatableParameter(3, "-percentile", "give the value at a percentile");
     percentileOpt->addDoubleParameter(1, "percent", "the percentile to find, must be between 0 and 100");
     
     OptionalParameter* subvolOpt = ret->createOptionalParameter(4, "-subvolume", "only display output for one subvolume");
@@ -66,10 +66,12 @@ OperationParameters* OperationVolumeStats::getParameters()
     ret->createOptionalParameter(6, "-show-map-name", "print map index and name before each output");
     
     ret->setHelpText(
-        AString("For each subvolume of the input, a line of text is printed, resulting from the specified reduction or percentile operation.  ") +
+        AString("For each subvolume of the input, a line of text is printed, resulting from the specified reduction or percentile operations.  ") +
         "Use -subvolume to only give output for a single subvolume.  " +
         "If the -roi option is used without -match-maps, then each line will contain as many numbers as there are maps in the ROI file, separated by tab characters.  " +
-        "Exactly one of -reduce or -percentile must be specified.\n\n" +
+        "At least one -reduce or -percentile option must be specified.  " +
+        "If more than one is specified, for each ROI map, the results of all -reduce options are printed in the order given, " +
+        "followed by the results of all -percentile options in the order given, separated by tab characters.\n\n" +
         "The argument to the -reduce option must be one of the following:\n\n" +
         ReductionOperation::getHelpInfo());
     return ret;
@@ -77,13 +79,13 @@ OperationParameters* OperationVolumeStats::getParameters()
 
 namespace
 {
-    float reduce(const float* data, const int64_t& numElements, const ReductionEnum::Enum& myop, const float* roiData)
+    void computeStats(const float* data, const int64_t& numElements, const vector<ReductionEnum::Enum>& myops, const vector<float>& percents, const float* roiData, float* resultsOut)
     {
-        if (roiData == NULL)
+        const float* toUsePtr = data;
+        int64_t toUseSize = numElements;
+        vector<float> toUse;
+        if (roiData != NULL)
         {
-            return ReductionOperation::reduce(data, numElements, myop);
-        } else {
-            vector<float> toUse;
             toUse.reserve(numElements);
             for (int64_t i = 0; i < numElements; ++i)
             {
@@ -93,35 +95,22 @@ namespace
                 }
             }
             if (toUse.empty()) throw OperationException("roi contains no voxels");
-            return ReductionOperation::reduce(toUse.data(), toUse.size(), myop);
+            toUsePtr = toUse.data();
+            toUseSize = toUse.size();
         }
+        if (!myops.empty()) ReductionOperation::reduceMultiple(toUsePtr, toUseSize, myops, resultsOut);
+        if (!percents.empty()) ReductionOperation::percentiles(toUsePtr, toUseSize, percents, resultsOut + myops.size());
     }
     
-    float percentile(const float* data, const int64_t& numElements, const float& percent, const float* roiData)
+    void printStats(const vector<float>& results)
     {
-        CaretAssert(percent >= 0.0f && percent <= 100.0f);
-        vector<float> toUse;
-        if (roiData == NULL)
+        for (int k = 0; k < (int)results.size(); ++k)
         {
-            toUse = vector<float>(data, data + numElements);
-        } else {
-            toUse.reserve(numElements);
-            for (int64_t i = 0; i < numElements; ++i)
-            {
-                if (roiData[i] > 0.0f)
-                {
-                    toUse.push_back(data[i]);
-                }
-            }
+            stringstream resultsstr;
+            resultsstr << setprecision(7) << results[k];
+            if (k != 0) cout << "\t";
+            cout << resultsstr.str();
         }
-        if (toUse.empty()) throw OperationException("roi contains no voxels");
-        sort(toUse.begin(), toUse.end());
-        const double index = percent / 100.0f * (toUse.size() - 1);
-        if (index <= 0) return toUse[0];
-        if (index >= toUse.size() - 1) return toUse.back();
-        double ipart, fpart;
-        fpart = modf(index, &ipart);
-        return (1.0f - fpart) * toUse[(int64_t)ipart] + fpart * toUse[((int64_t)ipart) + 1];
     }
 }
 
@@ -132,25 +121,27 @@ void OperationVolumeStats::useParameters(OperationParameters* myParams, Progress
     vector<int64_t> dims = input->getDimensions();
     const int64_t frameSize = dims[0] * dims[1] * dims[2];
     if (input->getNumberOfComponents() != 1) throw OperationException("multi-component volumes are not supported in -volume-stats");
-    OptionalParameter* reduceOpt = myParams->getOptionalParameter(2);
-    OptionalParameter* percentileOpt = myParams->getOptionalParameter(3);
-    if (reduceOpt->m_present == percentileOpt->m_present)//use == as logical xnor
+    const vector<ParameterComponent*>& reduceInstances = myParams->getRepeatableParameterInstances(2);
+    const vector<ParameterComponent*>& percentileInstances = myParams->getRepeatableParameterInstances(3);
+    if (reduceInstances.empty() && percentileInstances.empty())
     {
-        throw OperationException("you must use exactly one of -reduce or -percentile");
+        throw OperationException("you must use at least one of -reduce or -percentile");
     }
-    ReductionEnum::Enum myop = ReductionEnum::INVALID;
-    if (reduceOpt->m_present)
+    vector<ReductionEnum::Enum> myops;
+    for (int i = 0; i < (int)reduceInstances.size(); ++i)
     {
         bool ok = false;
-        myop = ReductionEnum::fromName(reduceOpt->getString(1), &ok);
-        if (!ok) throw OperationException("unrecognized reduction operation: " + reduceOpt->getString(1));
+        myops.push_back(ReductionEnum::fromName(reduceInstances[i]->getString(1), &ok));
+        if (!ok) throw OperationException("unrecognized reduction operation: " + reduceInstances[i]->getString(1));
     }
-    float percent = 0.0f;
-    if (percentileOpt->m_present)
+    vector<float> percents;
+    for (int i = 0; i < (int)percentileInstances.size(); ++i)
     {
-        percent = (float)percentileOpt->getDouble(1);//use not within range to trap NaNs, just in case
+        float percent = (float)percentileInstances[i]->getDouble(1);//use not within range to trap NaNs, just in case
         if (!(percent >= 0.0f && percent <= 100.0f)) throw OperationException("percentile must be between 0 and 100");
+        percents.push_back(percent);
     }
+    vector<float> results(myops.size() + percents.size());
     int subvol = -1;
     OptionalParameter* subvolOpt = myParams->getOptionalParameter(4);
     if (subvolOpt->m_present)
@@ -193,34 +184,16 @@ void OperationVolumeStats::useParameters(OperationParameters* myParams, Progress
         if (matchSubvolMode)
         {//trick: matchSubvolMode is only true when we have an roi
             const float* roiData = myRoi->getFrame(i);
-            float result;
-            if (reduceOpt->m_present)
-            {
-                result = reduce(input->getFrame(i), frameSize, myop, roiData);
-            } else {
-                CaretAssert(percentileOpt->m_present);
-                result = percentile(input->getFrame(i), frameSize, percent, roiData);
-            }
-            stringstream resultsstr;
-            resultsstr << setprecision(7) << result;
-            cout << resultsstr.str();
+            computeStats(input->getFrame(i), frameSize, myops, percents, roiData, results.data());
+            printStats(results);
         } else {
             const float* roiData = NULL;
             for (int j = 0; j < numRoiMaps; ++j)
             {
                 if (myRoi != NULL) roiData = myRoi->getFrame(j);
-                float result;
-                if (reduceOpt->m_present)
-                {
-                    result = reduce(input->getFrame(i), frameSize, myop, roiData);
-                } else {
-                    CaretAssert(percentileOpt->m_present);
-                    result = percentile(input->getFrame(i), frameSize, percent, roiData);
-                }
-                stringstream resultsstr;
-                resultsstr << setprecision(7) << result;
+                computeStats(input->getFrame(i), frameSize, myops, percents, roiData, results.data());
                 if (j != 0) cout << "\t";
-                cout << resultsstr.str();
+                printStats(results);
             }
         }
         cout << endl;
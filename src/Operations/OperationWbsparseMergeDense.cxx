@@ -21,8 +21,12 @@
 #include "OperationWbsparseMergeDense.h"
 #include "OperationException.h"
 
+#include "CaretOMP.h"
 #include "CaretSparseFile.h"
 
+#include <algorithm>
+#include <exception>
+
 using namespace caret;
 using namespace std;
 
@@ -158,71 +162,118 @@ void OperationWbsparseMergeDense::useParameters(OperationParameters* myParams, P
     {
         case CiftiXML::ALONG_ROW:
         {
-            for (int64_t i = 0; i < outColSize; ++i)
+            vector<int64_t> modelStart(numOutModels), modelEnd(numOutModels);//the ranges are the same for every row, so look them up once
+            for (int j = 0; j < numOutModels; ++j)
             {
-                int64_t curOffset = 0;
-                vector<int64_t> outIndices, outValues, inIndices, inValues;
-                int loaded = -1;
-                for (int j = 0; j < numOutModels; ++j)//we could just do the entire row for each file, but doing it by structure could allow structure selection in the future
+                const CiftiBrainModelsMap::ModelInfo& myInfo = outModelInfo[j];
+                const CiftiXML& thisXML = wbsparseList[sourceWbsparse[j]]->getCiftiXML();
+                const CiftiBrainModelsMap& thisDenseMap = thisXML.getBrainModelsMap(myDir);
+                int64_t startIndex = -1, endIndex = -1;
+                switch (myInfo.m_type)
                 {
-                    const CiftiBrainModelsMap::ModelInfo& myInfo = outModelInfo[j];
-                    const CiftiXML& thisXML = wbsparseList[sourceWbsparse[j]]->getCiftiXML();
-                    const CiftiBrainModelsMap& thisDenseMap = thisXML.getBrainModelsMap(myDir);
-                    int64_t startIndex = -1, endIndex = -1;
-                    switch (myInfo.m_type)
+                    case CiftiBrainModelsMap::SURFACE:
                     {
-                        case CiftiBrainModelsMap::SURFACE:
+                        vector<CiftiBrainModelsMap::SurfaceMap> tempMap = thisDenseMap.getSurfaceMap(myInfo.m_structure);
+                        if (tempMap.size() > 0)
                         {
-                            vector<CiftiBrainModelsMap::SurfaceMap> tempMap = thisDenseMap.getSurfaceMap(myInfo.m_structure);
-                            if (tempMap.size() > 0)
-                            {
-                                startIndex = tempMap[0].m_ciftiIndex;//NOTE: CiftiXML guarantees these are ordered by cifti index and contiguous
-                                endIndex = startIndex + tempMap.size();
-                            } else {
-                                startIndex = 0;
-                                endIndex = 0;
-                            }
-                            break;
+                            startIndex = tempMap[0].m_ciftiIndex;//NOTE: CiftiXML guarantees these are ordered by cifti index and contiguous
+                            endIndex = startIndex + tempMap.size();
+                        } else {
+                            startIndex = 0;
+                            endIndex = 0;
                         }
-                        case CiftiBrainModelsMap::VOXELS:
+                        break;
+                    }
+                    case CiftiBrainModelsMap::VOXELS:
+                    {
+                        vector<CiftiBrainModelsMap::VolumeMap> tempMap = thisDenseMap.getVolumeStructureMap(myInfo.m_structure);
+                        if (tempMap.size() > 0)
                         {
-                            vector<CiftiBrainModelsMap::VolumeMap> tempMap = thisDenseMap.getVolumeStructureMap(myInfo.m_structure);
-                            if (tempMap.size() > 0)
-                            {
-                                startIndex = tempMap[0].m_ciftiIndex;//NOTE: CiftiXML guarantees these are ordered by cifti index and contiguous
-                                endIndex = startIndex + tempMap.size();
-                            } else {
-                                startIndex = 0;
-                                endIndex = 0;
-                            }
-                            break;
+                            startIndex = tempMap[0].m_ciftiIndex;//NOTE: CiftiXML guarantees these are ordered by cifti index and contiguous
+                            endIndex = startIndex + tempMap.size();
+                        } else {
+                            startIndex = 0;
+                            endIndex = 0;
                         }
-                        default:
-                            CaretAssert(false);
-                            break;
+                        break;
                     }
-                    if (endIndex > startIndex)
+                    default:
+                        CaretAssert(false);
+                        break;
+                }
+                modelStart[j] = startIndex;
+                modelEnd[j] = endIndex;
+            }
+            vector<int> readFiles;//inputs that contribute nothing to the output don't need their rows read
+            {
+                vector<bool> fileUsed(numCifti, false);
+                for (int j = 0; j < numOutModels; ++j)
+                {
+                    if (modelEnd[j] > modelStart[j]) fileUsed[sourceWbsparse[j]] = true;
+                }
+                for (int f = 0; f < numCifti; ++f)
+                {
+                    if (fileUsed[f]) readFiles.push_back(f);
+                }
+            }
+            const int numReadFiles = (int)readFiles.size();
+            const int64_t BLOCK_ROWS = 64;
+            vector<vector<vector<int64_t> > > blockIndices(numCifti, vector<vector<int64_t> >(BLOCK_ROWS)), blockValues(numCifti, vector<vector<int64_t> >(BLOCK_ROWS));
+            vector<int64_t> outIndices, outValues;
+            for (int64_t blockStart = 0; blockStart < outColSize; blockStart += BLOCK_ROWS)
+            {
+                int64_t blockEnd = min(outColSize, blockStart + BLOCK_ROWS);
+                exception_ptr exPtr;
+                int exceptedFile = -1;
+#pragma omp CARET_PARFOR schedule(dynamic)
+                for (int r = 0; r < numReadFiles; ++r)
+                {//each input is its own reader, so they can be read at the same time
+                    const int f = readFiles[r];
+                    try
                     {
-                        if (loaded != sourceWbsparse[j])
+                        for (int64_t i = blockStart; i < blockEnd; ++i)
+                        {
+                            wbsparseList[f]->getRowSparse(i, blockIndices[f][i - blockStart], blockValues[f][i - blockStart]);
+                        }
+                    } catch (...) {
+#pragma omp critical
                         {
-                            wbsparseList[sourceWbsparse[j]]->getRowSparse(i, inIndices, inValues);
-                            loaded = sourceWbsparse[j];
+                            if (exceptedFile == -1 || f < exceptedFile)
+                            {
+                                exceptedFile = f;
+                                exPtr = current_exception();
+                            }
                         }
-                        int64_t numSparse = (int64_t)inIndices.size();
-                        for (int64_t k = 0; k < numSparse; ++k)
+                    }
+                }
+                if (exPtr) rethrow_exception(exPtr);
+                //the writer takes rows in order into a single uncompressed stream, so writing is sequential I/O, and stays on this thread
+                for (int64_t i = blockStart; i < blockEnd; ++i)
+                {
+                    int64_t curOffset = 0;
+                    for (int j = 0; j < numOutModels; ++j)//we could just do the entire row for each file, but doing it by structure could allow structure selection in the future
+                    {
+                        const int64_t startIndex = modelStart[j], endIndex = modelEnd[j];
+                        if (endIndex > startIndex)
                         {
-                            if (inIndices[k] >= startIndex && inIndices[k] < endIndex)
+                            const vector<int64_t>& inIndices = blockIndices[sourceWbsparse[j]][i - blockStart];
+                            const vector<int64_t>& inValues = blockValues[sourceWbsparse[j]][i - blockStart];
+                            int64_t numSparse = (int64_t)inIndices.size();
+                            for (int64_t k = 0; k < numSparse; ++k)
                             {
-                                outIndices.push_back(inIndices[k] + curOffset);
-                                outValues.push_back(inValues[k]);
+                                if (inIndices[k] >= startIndex && inIndices[k] < endIndex)
+                                {
+                                    outIndices.push_back(inIndices[k] + curOffset);
+                                    outValues.push_back(inValues[k]);
+                                }
                             }
+                            curOffset += endIndex - startIndex;
                         }
-                        curOffset += endIndex - startIndex;
                     }
+                    myWriter.writeRowSparse(i, outIndices, outValues);
+                    outIndices.clear();//reset for next row
+                    outValues.clear();
                 }
-                myWriter.writeRowSparse(i, outIndices, outValues);
-                outIndices.clear();//reset for next row
-                outValues.clear();
             }
             break;
         }
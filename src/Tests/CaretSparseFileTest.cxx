@@ -0,0 +1,230 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "CaretSparseFileTest.h"
+
+#include "CaretSparseFile.h"
+#include "CiftiScalarsMap.h"
+#include "CiftiXML.h"
+
+#include <QTemporaryDir>
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+CaretSparseFileTest::CaretSparseFileTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    const int64_t ROW_LENGTH = 70, NUM_ROWS = 100;//more than one compressed block
+    
+    //mostly zero, with some empty rows, negative values, and values that need long varints
+    int64_t denseValue(const int64_t& row, const int64_t& col)
+    {
+        if (row % 7 == 3) return 0;
+        int64_t hash = (row * 131 + col * 17) % 23;
+        if (hash > 4) return 0;
+        switch (hash)
+        {
+            case 0:
+                return -(row + col) - 1;
+            case 1:
+                return (int64_t)1 << (row % 63);
+            case 2:
+                return -((int64_t)1 << 62) + col;
+            default:
+                return row * ROW_LENGTH + col + 1;
+        }
+    }
+    
+    //fiber values that are exactly representable after encoding: fractions in thousandths, integer distances
+    bool fiberValue(const int64_t& row, const int64_t& col, FiberFractions& valueOut)
+    {
+        valueOut.zero();
+        if (row % 5 == 2 || (row * 29 + col * 11) % 13 > 3) return false;
+        valueOut.totalCount = (uint32_t)(1 + (row * col) % 5000);
+        if (row == 1 && col == 0) valueOut.totalCount = 0xFFFFFFFFu;
+        int f0 = (int)((row * 37 + col) % 1001), f1 = (int)((col * 53 + row) % (1001 - f0));
+        valueOut.fiberFractions.resize(3);
+        valueOut.fiberFractions[0] = f0 / 1000.0f;
+        valueOut.fiberFractions[1] = f1 / 1000.0f;
+        valueOut.fiberFractions[2] = 1.0f - valueOut.fiberFractions[0] - valueOut.fiberFractions[1];
+        valueOut.distance = (float)((row + col) % 1001);
+        return true;
+    }
+    
+    bool fibersMatch(const FiberFractions& left, const FiberFractions& right)
+    {
+        if (left.totalCount != right.totalCount || left.distance != right.distance) return false;
+        if (left.totalCount == 0) return true;//zero() doesn't set fractions
+        if (left.fiberFractions.size() != 3 || right.fiberFractions.size() != 3) return false;
+        for (int i = 0; i < 3; ++i)
+        {
+            if (abs(left.fiberFractions[i] - right.fiberFractions[i]) > 0.0015f) return false;
+        }
+        return true;
+    }
+    
+    CiftiXML makeXML()
+    {
+        CiftiXML ret;
+        ret.setNumberOfDimensions(2);
+        ret.setMap(CiftiXML::ALONG_ROW, CiftiScalarsMap(ROW_LENGTH));
+        ret.setMap(CiftiXML::ALONG_COLUMN, CiftiScalarsMap(NUM_ROWS));
+        return ret;
+    }
+}
+
+void CaretSparseFileTest::execute()
+{
+    QTemporaryDir tempDir;
+    if (!tempDir.isValid())
+    {
+        setFailed("unable to create temporary directory");
+        return;
+    }
+    const CiftiXML myXML = makeXML();
+    for (int compressed = 0; compressed < 2; ++compressed)
+    {
+        const AString suffix = (compressed ? "_v2" : "_v1") + AString(".trajTEMP.wbsparse");
+        const AString denseName = tempDir.path() + "/dense" + suffix, sparseName = tempDir.path() + "/sparse" + suffix;
+        const AString fibersName = tempDir.path() + "/fibers" + suffix, fibersSparseName = tempDir.path() + "/fiberssparse" + suffix;
+        {
+            CaretSparseFileWriter denseWriter(denseName, myXML, compressed != 0), sparseWriter(sparseName, myXML, compressed != 0);
+            CaretSparseFileWriter fibersWriter(fibersName, myXML, compressed != 0), fibersSparseWriter(fibersSparseName, myXML, compressed != 0);
+            vector<int64_t> denseRow(ROW_LENGTH), sparseIndices, sparseValues, fiberIndices;
+            vector<FiberFractions> fiberRow(ROW_LENGTH), fiberValues;
+            for (int64_t row = 0; row < NUM_ROWS; ++row)
+            {
+                sparseIndices.clear();
+                sparseValues.clear();
+                fiberIndices.clear();
+                fiberValues.clear();
+                for (int64_t col = 0; col < ROW_LENGTH; ++col)
+                {
+                    denseRow[col] = denseValue(row, col);
+                    if (denseRow[col] != 0)
+                    {
+                        sparseIndices.push_back(col);
+                        sparseValues.push_back(denseRow[col]);
+                    }
+                    if (fiberValue(row, col, fiberRow[col]))
+                    {
+                        fiberIndices.push_back(col);
+                        fiberValues.push_back(fiberRow[col]);
+                    }
+                }
+                if (row % 10 == 9) continue;//skipped rows must read back as empty
+                denseWriter.writeRow(row, denseRow.data());
+                sparseWriter.writeRowSparse(row, sparseIndices, sparseValues);
+                fibersWriter.writeFibersRow(row, fiberRow.data());
+                fibersSparseWriter.writeFibersRowSparse(row, fiberIndices, fiberValues);
+            }
+            denseWriter.finish();
+            sparseWriter.finish();
+            fibersWriter.finish();
+            fibersSparseWriter.finish();
+        }
+        const AString versionString = (compressed ? "version 2" : "version 1");
+        const AString denseNames[2] = { denseName, sparseName };
+        for (int which = 0; which < 2; ++which)
+        {
+            CaretSparseFile myFile(denseNames[which]);
+            if (myFile.getDimensions()[0] != ROW_LENGTH || myFile.getDimensions()[1] != NUM_ROWS)
+            {
+                setFailed(versionString + " file has wrong dimensions: " + denseNames[which]);
+                return;
+            }
+            vector<int64_t> rowOut(ROW_LENGTH), indicesOut, valuesOut;
+            for (int64_t row = NUM_ROWS - 1; row >= 0; --row)//backwards, so block caching gets exercised in both directions
+            {
+                myFile.getRow(row, rowOut.data());
+                myFile.getRowSparse(row, indicesOut, valuesOut);
+                size_t sparsePos = 0;
+                for (int64_t col = 0; col < ROW_LENGTH; ++col)
+                {
+                    int64_t expected = (row % 10 == 9 ? 0 : denseValue(row, col));
+                    if (rowOut[col] != expected)
+                    {
+                        setFailed(versionString + " getRow mismatch at row " + AString::number(row) + ", column " + AString::number(col));
+                        return;
+                    }
+                    if (expected != 0)
+                    {
+                        if (sparsePos >= indicesOut.size() || indicesOut[sparsePos] != col || valuesOut[sparsePos] != expected)
+                        {
+                            setFailed(versionString + " getRowSparse mismatch at row " + AString::number(row) + ", column " + AString::number(col));
+                            return;
+                        }
+                        ++sparsePos;
+                    }
+                }
+                if (sparsePos != indicesOut.size() || indicesOut.size() != valuesOut.size())
+                {
+                    setFailed(versionString + " getRowSparse returned extra values at row " + AString::number(row));
+                    return;
+                }
+            }
+        }
+        const AString fiberNames[2] = { fibersName, fibersSparseName };
+        for (int which = 0; which < 2; ++which)
+        {
+            CaretSparseFile myFile(fiberNames[which]);
+            vector<FiberFractions> rowOut(ROW_LENGTH), valuesOut;
+            vector<int64_t> indicesOut;
+            FiberFractions expected;
+            for (int64_t row = 0; row < NUM_ROWS; ++row)
+            {
+                myFile.getFibersRow(row, rowOut.data());
+                myFile.getFibersRowSparse(row, indicesOut, valuesOut);
+                size_t sparsePos = 0;
+                for (int64_t col = 0; col < ROW_LENGTH; ++col)
+                {
+                    bool present = fiberValue(row, col, expected) && row % 10 != 9;
+                    if (!present) expected.zero();
+                    if (!fibersMatch(rowOut[col], expected))
+                    {
+                        setFailed(versionString + " getFibersRow mismatch at row " + AString::number(row) + ", column " + AString::number(col));
+                        return;
+                    }
+                    if (present)
+                    {
+                        if (sparsePos >= indicesOut.size() || indicesOut[sparsePos] != col || !fibersMatch(valuesOut[sparsePos], expected))
+                        {
+                            setFailed(versionString + " getFibersRowSparse mismatch at row " + AString::number(row) + ", column " + AString::number(col));
+                            return;
+                        }
+                        ++sparsePos;
+                    }
+                }
+                if (sparsePos != indicesOut.size() || indicesOut.size() != valuesOut.size())
+                {
+                    setFailed(versionString + " getFibersRowSparse returned extra values at row " + AString::number(row));
+                    return;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,92 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "MetricGradientTest.h"
+
+#include "MetricGradientObject.h"
+#include "SurfaceFile.h"
+#include "Vector3D.h"
+
+#include <cmath>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+MetricGradientTest::MetricGradientTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+void MetricGradientTest::execute()
+{
+    const int32_t GRID = 12;
+    const int32_t numNodes = GRID * GRID;
+    //an irregular grid in a tilted plane, so the tangent frames and regression weights vary between vertices
+    const Vector3D origin(3.0f, -2.0f, 5.0f), uAxis = Vector3D(1.0f, 0.5f, 0.25f).normal(), vAxis = uAxis.cross(Vector3D(0.2f, -0.3f, 1.0f)).normal();
+    const Vector3D planeNormal = uAxis.cross(vAxis).normal();
+    SurfaceFile mySurf;
+    mySurf.setNumberOfNodesAndTriangles(numNodes, 2 * (GRID - 1) * (GRID - 1));
+    for (int32_t j = 0; j < GRID; ++j)
+    {
+        for (int32_t i = 0; i < GRID; ++i)
+        {
+            Vector3D coord = origin + uAxis * (i + 0.3f * sin(0.7f * j)) + vAxis * (j + 0.3f * cos(0.9f * i));
+            mySurf.setCoordinate(i + j * GRID, coord[0], coord[1], coord[2]);
+        }
+    }
+    int32_t triangle = 0;
+    for (int32_t j = 0; j < GRID - 1; ++j)
+    {
+        for (int32_t i = 0; i < GRID - 1; ++i)
+        {
+            const int32_t base = i + j * GRID;
+            mySurf.setTriangle(triangle++, base, base + 1, base + GRID + 1);
+            mySurf.setTriangle(triangle++, base, base + GRID + 1, base + GRID);
+        }
+    }
+    //a linear function of position, its gradient on the surface is the in-plane part of its 3D gradient, at every vertex including the boundary
+    const Vector3D linearGradient(0.7f, -1.3f, 0.4f);
+    const Vector3D expected = linearGradient - planeNormal * linearGradient.dot(planeNormal);
+    vector<float> data(numNodes);
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        data[i] = linearGradient.dot(Vector3D(mySurf.getCoordinate(i)) - origin) + 2.0f;
+    }
+    vector<float> magnitude(numNodes), vectors(numNodes * 3);
+    const float TOLERANCE = 0.0005f;
+    for (int avgNormals = 0; avgNormals < 2; ++avgNormals)
+    {
+        MetricGradientObject myGradient(&mySurf, NULL, avgNormals != 0);
+        if (!myGradient.computeGradient(data.data(), magnitude.data(), vectors.data()))
+        {
+            setFailed("gradient of linear function reported NaN");
+            return;
+        }
+        for (int32_t i = 0; i < numNodes; ++i)
+        {
+            Vector3D result(vectors[i], vectors[numNodes + i], vectors[numNodes * 2 + i]);
+            if ((result - expected).length() > TOLERANCE * expected.length() || abs(magnitude[i] - expected.length()) > TOLERANCE * expected.length())
+            {
+                setFailed("linear function gradient at vertex " + AString::number(i) + " should be (" + AString::number(expected[0]) + ", " + AString::number(expected[1]) + ", " + AString::number(expected[2]) +
+                          "), got (" + AString::number(result[0]) + ", " + AString::number(result[1]) + ", " + AString::number(result[2]) + ")");
+                return;
+            }
+        }
+    }
+}
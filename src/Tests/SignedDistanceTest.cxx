@@ -0,0 +1,108 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "SignedDistanceTest.h"
+
+#include "AlgorithmCreateSignedDistanceVolume.h"
+#include "FloatMatrix.h"
+#include "SurfaceFile.h"
+#include "VolumeFile.h"
+
+#include <cmath>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+SignedDistanceTest::SignedDistanceTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    //axis-aligned cube as 8 vertices and 12 triangles, appended to the surface arrays
+    void addCube(const float& halfWidth, vector<float>& coords, vector<int32_t>& triangles)
+    {
+        const int32_t base = (int32_t)(coords.size() / 3);
+        for (int32_t corner = 0; corner < 8; ++corner)
+        {
+            coords.push_back(((corner & 1) ? halfWidth : -halfWidth));
+            coords.push_back(((corner & 2) ? halfWidth : -halfWidth));
+            coords.push_back(((corner & 4) ? halfWidth : -halfWidth));
+        }
+        const int32_t faces[12][3] = { { 0, 2, 1 }, { 1, 2, 3 }, { 4, 5, 6 }, { 5, 7, 6 },//-z, +z
+                                       { 0, 1, 4 }, { 1, 5, 4 }, { 2, 6, 3 }, { 3, 6, 7 },//-y, +y
+                                       { 0, 4, 2 }, { 2, 4, 6 }, { 1, 3, 5 }, { 3, 7, 5 } };//-x, +x
+        for (int f = 0; f < 12; ++f)
+        {
+            for (int v = 0; v < 3; ++v)
+            {
+                triangles.push_back(base + faces[f][v]);
+            }
+        }
+    }
+}
+
+void SignedDistanceTest::execute()
+{
+    //a hollow box with walls thinner than a voxel, so approximate distances can jump across the wall into the cavity if they propagate from voxels that weren't reached through a face
+    vector<float> coords;
+    vector<int32_t> triangles;
+    addCube(5.7f, coords, triangles);
+    addCube(5.0f, coords, triangles);
+    SurfaceFile mySurf;
+    const int32_t numNodes = (int32_t)(coords.size() / 3), numTriangles = (int32_t)(triangles.size() / 3);
+    mySurf.setNumberOfNodesAndTriangles(numNodes, numTriangles);
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        mySurf.setCoordinate(i, coords[i * 3], coords[i * 3 + 1], coords[i * 3 + 2]);
+    }
+    for (int32_t i = 0; i < numTriangles; ++i)
+    {
+        mySurf.setTriangle(i, triangles[i * 3], triangles[i * 3 + 1], triangles[i * 3 + 2]);
+    }
+    vector<int64_t> myDims(3, 32);
+    FloatMatrix indexSpace = FloatMatrix::identity(4);
+    indexSpace[0][3] = -15.7f;//keep voxel centers off the cube faces
+    indexSpace[1][3] = -15.8f;
+    indexSpace[2][3] = -15.9f;
+    const float exactLim = 0.3f, approxLim = 6.0f;
+    const int approxNeighborhood = 2;
+    VolumeFile dijkstraVol, dijkstraRoi, sweepVol, sweepRoi;
+    dijkstraVol.reinitialize(myDims, indexSpace.getMatrix());
+    sweepVol.reinitialize(myDims, indexSpace.getMatrix());
+    AlgorithmCreateSignedDistanceVolume(NULL, &mySurf, &dijkstraVol, &dijkstraRoi, 0.0f, exactLim, approxLim, approxNeighborhood, SignedDistanceHelper::EVEN_ODD, false);
+    AlgorithmCreateSignedDistanceVolume(NULL, &mySurf, &sweepVol, &sweepRoi, 0.0f, exactLim, approxLim, approxNeighborhood, SignedDistanceHelper::EVEN_ODD, true);
+    const float* dijkstraData = dijkstraVol.getFrame(), *dijkstraRoiData = dijkstraRoi.getFrame();
+    const float* sweepData = sweepVol.getFrame(), *sweepRoiData = sweepRoi.getFrame();
+    const int64_t frameSize = myDims[0] * myDims[1] * myDims[2];
+    for (int64_t i = 0; i < frameSize; ++i)
+    {
+        if (dijkstraRoiData[i] != sweepRoiData[i])
+        {
+            setFailed("sweep and dijkstra roi differ at voxel " + AString::number(i));
+            return;
+        }
+        if (abs(dijkstraData[i] - sweepData[i]) > 0.0001f)
+        {
+            setFailed("sweep and dijkstra distances differ at voxel " + AString::number(i) + ", dijkstra " + AString::number(dijkstraData[i]) + ", sweep " + AString::number(sweepData[i]));
+            return;
+        }
+    }
+}
@@ -0,0 +1,236 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "TfceTest.h"
+
+#include "SurfaceFile.h"
+#include "TfceHelper.h"
+#include "TopologyHelper.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+TfceTest::TfceTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    //brute force TFCE: between consecutive data values, the supra-threshold set doesn't change, so label its components and integrate exactly
+    void tfceReference(const vector<vector<int64_t> >& neighbors, const vector<float>& areas, const vector<float>& data, const vector<char>& roi,
+                       const float& param_e, const float& param_h, vector<double>& output)
+    {
+        const int64_t numElements = (int64_t)data.size();
+        output.assign(numElements, 0.0);
+        for (int sign = 1; sign >= -1; sign -= 2)
+        {
+            vector<float> levels;
+            for (int64_t i = 0; i < numElements; ++i)
+            {
+                if (roi[i] != 0 && sign * data[i] > 0.0f) levels.push_back(sign * data[i]);
+            }
+            sort(levels.begin(), levels.end());
+            levels.erase(unique(levels.begin(), levels.end()), levels.end());
+            float lastLevel = 0.0f;
+            for (size_t k = 0; k < levels.size(); ++k)
+            {
+                const float level = levels[k];
+                vector<int64_t> label(numElements, -1);
+                vector<double> componentArea;
+                for (int64_t i = 0; i < numElements; ++i)
+                {
+                    if (label[i] != -1 || roi[i] == 0 || sign * data[i] < level) continue;
+                    const int64_t thisLabel = (int64_t)componentArea.size();
+                    componentArea.push_back(0.0);
+                    vector<int64_t> stack(1, i);
+                    label[i] = thisLabel;
+                    while (!stack.empty())
+                    {
+                        int64_t cur = stack.back();
+                        stack.pop_back();
+                        componentArea[thisLabel] += areas[cur];
+                        for (size_t j = 0; j < neighbors[cur].size(); ++j)
+                        {
+                            int64_t neigh = neighbors[cur][j];
+                            if (label[neigh] != -1 || roi[neigh] == 0 || sign * data[neigh] < level) continue;
+                            label[neigh] = thisLabel;
+                            stack.push_back(neigh);
+                        }
+                    }
+                }
+                const double integrated_h = param_h + 1.0;
+                const double slice = (pow((double)level, integrated_h) - pow((double)lastLevel, integrated_h)) / integrated_h;
+                for (int64_t i = 0; i < numElements; ++i)
+                {
+                    if (label[i] != -1) output[i] += sign * pow(componentArea[label[i]], (double)param_e) * slice;
+                }
+                lastLevel = level;
+            }
+        }
+    }
+    
+    void compareOutputs(TfceTest* theTest, const AString& condition, const vector<float>& helperOut, const vector<double>& referenceOut)
+    {
+        for (size_t i = 0; i < helperOut.size(); ++i)
+        {
+            const double tolerance = 1e-4 * max(1.0, abs(referenceOut[i]));
+            if (abs(helperOut[i] - referenceOut[i]) > tolerance)
+            {
+                theTest->setFailed(condition + ", element " + AString::number(i) + " should be " + AString::number(referenceOut[i]) + ", got " + AString::number(helperOut[i]));
+                return;
+            }
+        }
+    }
+    
+    void randomData(vector<float>& data)
+    {
+        for (size_t i = 0; i < data.size(); ++i)
+        {
+            data[i] = (float)(rand() % 41 - 20) / 4.0f;//few distinct values, so there are ties and plateaus
+        }
+    }
+    
+    void compareBatch(TfceTest* theTest, const AString& condition, const TfceHelper& myTfce, const int64_t& numElements)
+    {//batch output should be identical to one map at a time, since the scratch state is reset between maps
+        const int NUM_MAPS = 12;
+        vector<vector<float> > batchData(NUM_MAPS, vector<float>(numElements)), batchResult(NUM_MAPS, vector<float>(numElements));
+        vector<const float*> batchIn;
+        vector<float*> batchOut;
+        for (int i = 0; i < NUM_MAPS; ++i)
+        {
+            randomData(batchData[i]);
+            batchIn.push_back(batchData[i].data());
+            batchOut.push_back(batchResult[i].data());
+        }
+        myTfce.enhanceBatch(batchIn, batchOut);
+        vector<float> single(numElements);
+        for (int i = 0; i < NUM_MAPS; ++i)
+        {
+            myTfce.enhance(batchData[i].data(), single.data());
+            for (int64_t j = 0; j < numElements; ++j)
+            {
+                if (batchResult[i][j] != single[j])
+                {
+                    theTest->setFailed(condition + ", map " + AString::number(i) + ", element " + AString::number(j) + " should be " + AString::number(single[j]) + ", got " + AString::number(batchResult[i][j]));
+                    return;
+                }
+            }
+        }
+    }
+}
+
+void TfceTest::execute()
+{
+    const int32_t GRID = 24;
+    const int32_t numNodes = GRID * GRID;
+    SurfaceFile mySurf;
+    mySurf.setNumberOfNodesAndTriangles(numNodes, 2 * (GRID - 1) * (GRID - 1));
+    for (int32_t j = 0; j < GRID; ++j)
+    {
+        for (int32_t i = 0; i < GRID; ++i)
+        {//slightly irregular, so vertex areas differ
+            mySurf.setCoordinate(i + j * GRID, i + 0.3f * sin(0.7f * j), j + 0.3f * cos(0.9f * i), 0.1f * i * j / GRID);
+        }
+    }
+    int32_t triangle = 0;
+    for (int32_t j = 0; j < GRID - 1; ++j)
+    {
+        for (int32_t i = 0; i < GRID - 1; ++i)
+        {
+            const int32_t base = i + j * GRID;
+            mySurf.setTriangle(triangle++, base, base + 1, base + GRID + 1);
+            mySurf.setTriangle(triangle++, base, base + GRID + 1, base + GRID);
+        }
+    }
+    vector<float> areas;
+    mySurf.computeNodeAreas(areas);
+    CaretPointer<TopologyHelper> myTopoHelp = mySurf.getTopologyHelper();
+    vector<vector<int64_t> > surfNeighbors(numNodes);
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        int32_t numNeigh;
+        const int32_t* neighbors = myTopoHelp->getNodeNeighbors(i, numNeigh);
+        surfNeighbors[i].assign(neighbors, neighbors + numNeigh);
+    }
+    vector<float> roiData(numNodes, 1.0f);
+    vector<char> noRoi(numNodes, 1), roi(numNodes, 1);
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        if ((i % GRID) == GRID / 2)
+        {//a line through the roi that splits clusters
+            roiData[i] = 0.0f;
+            roi[i] = 0;
+        }
+    }
+    vector<float> data(numNodes), helperOut(numNodes);
+    vector<double> referenceOut;
+    TfceHelper surfTfce(myTopoHelp, areas.data());
+    TfceHelper surfRoiTfce(myTopoHelp, areas.data(), roiData.data());
+    const int TEST_SAMPLES = 10;
+    for (int sample = 0; sample < TEST_SAMPLES; ++sample)
+    {
+        randomData(data);
+        surfTfce.enhance(data.data(), helperOut.data());
+        tfceReference(surfNeighbors, areas, data, noRoi, 1.0f, 2.0f, referenceOut);
+        compareOutputs(this, "surface sample " + AString::number(sample), helperOut, referenceOut);
+        surfRoiTfce.enhance(data.data(), helperOut.data());
+        tfceReference(surfNeighbors, areas, data, roi, 1.0f, 2.0f, referenceOut);
+        compareOutputs(this, "surface with roi sample " + AString::number(sample), helperOut, referenceOut);
+    }
+    compareBatch(this, "surface batch", surfTfce, numNodes);
+    compareBatch(this, "surface with roi batch", surfRoiTfce, numNodes);
+    const int64_t dims[3] = { 9, 8, 7 };
+    const int64_t numVoxels = dims[0] * dims[1] * dims[2];
+    const float voxelVolume = 2.0f;
+    vector<vector<int64_t> > volNeighbors(numVoxels);
+    for (int64_t k = 0; k < dims[2]; ++k)
+    {
+        for (int64_t j = 0; j < dims[1]; ++j)
+        {
+            for (int64_t i = 0; i < dims[0]; ++i)
+            {
+                const int64_t index = i + dims[0] * (j + dims[1] * k);
+                if (i > 0) volNeighbors[index].push_back(index - 1);
+                if (i < dims[0] - 1) volNeighbors[index].push_back(index + 1);
+                if (j > 0) volNeighbors[index].push_back(index - dims[0]);
+                if (j < dims[1] - 1) volNeighbors[index].push_back(index + dims[0]);
+                if (k > 0) volNeighbors[index].push_back(index - dims[0] * dims[1]);
+                if (k < dims[2] - 1) volNeighbors[index].push_back(index + dims[0] * dims[1]);
+            }
+        }
+    }
+    vector<float> volumes(numVoxels, voxelVolume);
+    vector<char> volRoi(numVoxels, 1);
+    data.resize(numVoxels);
+    helperOut.resize(numVoxels);
+    TfceHelper volTfce(dims, voxelVolume);
+    for (int sample = 0; sample < TEST_SAMPLES; ++sample)
+    {
+        randomData(data);
+        volTfce.enhance(data.data(), helperOut.data());
+        tfceReference(volNeighbors, volumes, data, volRoi, 0.5f, 2.0f, referenceOut);
+        compareOutputs(this, "volume sample " + AString::number(sample), helperOut, referenceOut);
+    }
+    compareBatch(this, "volume batch", volTfce, numVoxels);
+}
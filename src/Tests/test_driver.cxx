@@ -33,6 +33,7 @@
 #include "CaretException.h"
 
 //tests
+#include "CaretSparseFileTest.h"
 #include "CiftiFileTest.h"
 #include "DotTest.h"
 #include "GeodesicHelperTest.h"
@@ -40,11 +41,14 @@
 #include "HeapTest.h"
 #include "LookupTest.h"
 #include "MathExpressionTest.h"
+#include "MetricGradientTest.h"
 #include "NiftiTest.h"
 #include "PointerTest.h"
 #include "ProgressTest.h"
 #include "QuatTest.h"
+#include "SignedDistanceTest.h"
 #include "StatisticsTest.h"
+#include "TfceTest.h"
 #include "TimerTest.h"
 #include "TopologyHelperTest.h"
 #include "VolumeFileTest.h"
@@ -69,6 +73,7 @@ int main(int argc, char** argv)
         caret_global_commandLine_init(argc, argv);
         SessionManager::createSessionManager(ApplicationTypeEnum::APPLICATION_TYPE_COMMAND_LINE);
         vector<TestInterface*> mytests;
+        mytests.push_back(new CaretSparseFileTest("sparsefile"));
         mytests.push_back(new CiftiFileTest("ciftifile"));
         mytests.push_back(new DotTest("dotsimd"));
         mytests.push_back(new GeodesicHelperTest("geohelp"));
@@ -76,12 +81,15 @@ int main(int argc, char** argv)
         mytests.push_back(new HttpTest("http"));
         mytests.push_back(new LookupTest("lookup"));
         mytests.push_back(new MathExpressionTest("mathexpression"));
+        mytests.push_back(new MetricGradientTest("metricgradient"));
         mytests.push_back(new NiftiFileTest("niftifile"));
         mytests.push_back(new NiftiHeaderTest("niftiheader"));
         mytests.push_back(new PointerTest("pointer"));
         mytests.push_back(new ProgressTest("progress"));
         mytests.push_back(new QuatTest("quaternion"));
+        mytests.push_back(new SignedDistanceTest("signeddistance"));
         mytests.push_back(new StatisticsTest("statistics"));
+        mytests.push_back(new TfceTest("tfce"));
         mytests.push_back(new TimerTest("timer"));
         mytests.push_back(new TopologyHelperTest("topohelp"));
         mytests.push_back(new VolumeFileTest("volumefile"));